@@ -19,7 +19,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 
-#define LTO_API_VERSION 3
+#define LTO_API_VERSION 5
 
 typedef enum {
     LTO_SYMBOL_ALIGNMENT_MASK         = 0x0000001F,    /* log2 of alignment */
@@ -215,6 +215,20 @@ extern void
 lto_codegen_set_assembler_path(lto_code_gen_t cg, const char* path);
 
 
+/**
+ * Sets a directory in which libLTO keeps the native code it generates, so
+ * that a later link can reuse it.  Code is reused for the merged module, or
+ * for each partition with lto_codegen_compile_partitions(), whose optimized
+ * contents and code generation options have not changed.  The directory is
+ * created if needed and may be shared by concurrent links.  The least
+ * recently used entries are removed when the directory grows beyond the
+ * -lto-cache-size-limit code generator option, in kilobytes (1GB by
+ * default).
+ */
+extern void
+lto_codegen_set_cache_dir(lto_code_gen_t cg, const char* path);
+
+
 /**
  * Adds to a list of all global symbols that must exist in the final
  * generated code.  If a function is not listed, it might be
@@ -245,6 +259,30 @@ extern const void*
 lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 
 
+/**
+ * Generates code for all added modules into up to 'count' native object
+ * files, which are code generated in parallel.  The merged module is split
+ * so that each object holds a share of its definitions; together the objects
+ * define the same symbols as the one lto_codegen_compile() would produce.
+ * Returns the number of objects generated, or 0 on failure (check
+ * lto_get_error_message() for details).
+ */
+extern unsigned int
+lto_codegen_compile_partitions(lto_code_gen_t cg, unsigned int count);
+
+
+/**
+ * Returns a pointer to the index'th native object file generated by the
+ * last call to lto_codegen_compile_partitions() and sets length to its size,
+ * or returns NULL if there is no such object.  The buffer is owned by the
+ * lto_code_gen_t and will be freed when lto_codegen_dispose() is called, or
+ * lto_codegen_compile_partitions() is called again.
+ */
+extern const void*
+lto_codegen_get_partition_object(lto_code_gen_t cg, unsigned int index,
+                                 size_t* length);
+
+
 /**
  * Sets options to help debug codegen bugs.
  */
@@ -50,17 +50,32 @@ FunctionPass *createVerifierPass(
   VerifierFailureAction action = AbortProcessAction ///< Action to take
 );
 
+/// @brief Create a verifier pass that only checks modified functions.
+///
+/// This is like createVerifierPass, but functions that have not been modified
+/// since a verifier pass of this kind last found them to be valid are not
+/// checked again.  This makes verifying after every pass much cheaper.  The
+/// global values of the module are always checked.  Function modifications
+/// are tracked for as long as the pass exists (see
+/// Function::startTrackingModifications).
+FunctionPass *createIncrementalVerifierPass(
+  VerifierFailureAction action = AbortProcessAction ///< Action to take
+);
+
 /// @brief Check a module for errors.
 ///
 /// If there are no errors, the function returns false. If an error is found,
 /// the action taken depends on the \p action parameter.
 /// This should only be used for debugging, because it plays games with
-/// PassManagers and stuff.
+/// PassManagers and stuff.  If \p NumThreads is more than one, the function
+/// bodies are checked on that many threads; if the module turns out to be
+/// broken, it is then checked again on this thread to report the errors.
 
 bool verifyModule(
   const Module &M,  ///< The module to be verified
   VerifierFailureAction action = AbortProcessAction, ///< Action to take
-  std::string *ErrorInfo = 0      ///< Information about failures.
+  std::string *ErrorInfo = 0,     ///< Information about failures.
+  unsigned NumThreads = 1         ///< Threads to check function bodies on.
 );
 
 // verifyFunction - Check a function for errors, useful for use when debugging a
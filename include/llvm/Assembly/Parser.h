@@ -60,6 +60,22 @@ Module *ParseAssembly(
     LLVMContext &Context
 );
 
+/// This function parses LLVM Assembly lazily.  Only the global declarations and
+/// definitions are parsed up front.  The body of a function is skipped and
+/// parsed when the function is materialized, like the bodies of a module read
+/// with getLazyBitcodeModule.  The buffer is kept for that, and errors in a
+/// body are only found when it is parsed.  The globals a body refers to are
+/// looked up when the module is read, so they may be renamed, but not deleted,
+/// before the function is materialized.  If the module cannot be read, this
+/// returns null and fills in Err.
+/// @brief Parse LLVM Assembly from a MemoryBuffer, deferring function bodies.
+/// This function *always* takes ownership of the MemoryBuffer.
+Module *getLazyAssemblyModule(
+    MemoryBuffer *F,     ///< The MemoryBuffer containing assembly
+    SMDiagnostic &Err,   ///< Error result info.
+    LLVMContext &Context ///< Context in which to allocate globals info.
+);
+
 } // End llvm namespace
 
 #endif
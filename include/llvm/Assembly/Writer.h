@@ -52,6 +52,10 @@ public:
   /// one.  This name will be printed instead of the structural version of the
   /// type in order to make the output more concise.
   void addTypeName(const Type *Ty, const std::string &N);
+
+  /// copyTypeNames - Replace the remembered type names with those of Other,
+  /// so that a printer for another thread can start out where Other is.
+  void copyTypeNames(const TypePrinting &Other);
   
 private:
   void CalcTypeName(const Type *Ty, SmallVectorImpl<const Type *> &TypeStack,
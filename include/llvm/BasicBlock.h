@@ -14,6 +14,7 @@
 #ifndef LLVM_BASICBLOCK_H
 #define LLVM_BASICBLOCK_H
 
+#include "llvm/IRArena.h"
 #include "llvm/Instruction.h"
 #include "llvm/SymbolTableListTraits.h"
 #include "llvm/ADT/ilist.h"
@@ -48,6 +49,13 @@ template<> struct ilist_traits<Instruction>
   Instruction *provideInitialHead() const { return createSentinel(); }
   Instruction *ensureHead(Instruction*) const { return createSentinel(); }
   static void noteHead(Instruction*, Instruction*) {}
+
+  // Adding, removing or reordering instructions modifies the function.
+  void addNodeToList(Instruction *I);
+  void removeNodeFromList(Instruction *I);
+  void transferNodesFromList(ilist_traits<Instruction> &L2,
+                             ilist_iterator<Instruction> first,
+                             ilist_iterator<Instruction> last);
 private:
   mutable ilist_half_node<Instruction> Sentinel;
 };
@@ -104,6 +112,10 @@ public:
   }
   ~BasicBlock();
 
+  /// Basic blocks are allocated from the current IRArena, if there is one.
+  void *operator new(size_t s) { return IRArena::allocate(s); }
+  void operator delete(void *BB);
+
   /// getParent - Return the enclosing method, or null if none
   ///
   const Function *getParent() const { return Parent; }
@@ -240,9 +252,19 @@ public:
 
   /// hasAddressTaken - returns true if there are any uses of this basic block
   /// other than direct branches, switches, etc. to it.
-  bool hasAddressTaken() const { return getSubclassDataFromValue() != 0; }
+  bool hasAddressTaken() const {
+    return (getSubclassDataFromValue() & ~FromArenaBit) != 0;
+  }
                      
 private:
+  enum {
+    /// FromArenaBit - This bit in the SubclassData field is set if the block
+    /// was allocated from an IRArena.  The low bits count the BlockAddress
+    /// objects using the block.
+    FromArenaBit = 1 << 15
+  };
+
+
   /// AdjustBlockAddressRefCount - BasicBlock stores the number of BlockAddress
   /// objects using it.  This is almost always 0, sometimes one, possibly but
   /// almost never 2, and inconceivably 3 or more.
@@ -251,6 +251,24 @@ public:
     BlockScope.pop_back();
   }
 
+  /// EmitEncodedSubblock - Emit a complete block whose contents were encoded
+  /// by another BitstreamWriter.  Contents must hold everything that writer
+  /// emitted for the block after its word-aligned header: the block size word,
+  /// the records and the END_BLOCK marker with its padding.  Because block
+  /// contents start on a word boundary they do not depend on where the block
+  /// is placed, so as long as the other writer had the same BLOCKINFO
+  /// abbreviations (see CopyBlockInfo) the result is exactly what EnterSubblock
+  /// and ExitBlock would have produced here.
+  void EmitEncodedSubblock(unsigned BlockID, unsigned CodeLen,
+                           StringRef Contents) {
+    assert((Contents.size() & 3) == 0 && "Block contents not word aligned!");
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+    Out.insert(Out.end(), Contents.begin(), Contents.end());
+  }
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
@@ -523,6 +541,27 @@ public:
 
     return Info.Abbrevs.size()-1+bitc::FIRST_APPLICATION_ABBREV;
   }
+
+  /// CopyBlockInfo - Give this writer the abbreviations that were emitted to
+  /// the BLOCKINFO_BLOCK of another writer, without emitting anything.  This
+  /// is used to encode blocks separately for EmitEncodedSubblock.  The
+  /// abbreviations are copied rather than shared, so the two writers can be
+  /// used from different threads.
+  void CopyBlockInfo(const BitstreamWriter &Other) {
+    for (unsigned i = 0, e = static_cast<unsigned>(
+           Other.BlockInfoRecords.size()); i != e; ++i) {
+      const BlockInfo &OtherInfo = Other.BlockInfoRecords[i];
+      BlockInfo &Info = getOrCreateBlockInfo(OtherInfo.BlockID);
+      for (unsigned j = 0, je = static_cast<unsigned>(
+             OtherInfo.Abbrevs.size()); j != je; ++j) {
+        const BitCodeAbbrev *OtherAbbv = OtherInfo.Abbrevs[j];
+        BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+        for (unsigned k = 0, ke = OtherAbbv->getNumOperandInfos(); k != ke; ++k)
+          Abbv->Add(OtherAbbv->getOperandInfo(k));
+        Info.Abbrevs.push_back(Abbv);
+      }
+    }
+  }
 };
 
 
@@ -29,6 +29,11 @@ namespace llvm {
   /// this takes ownership of 'buffer' and returns a non-null pointer.  On
   /// error, this returns null, *does not* take ownership of Buffer, and fills
   /// in *ErrMsg with an error description if ErrMsg is non-null.
+  ///
+  /// The module-level constants (including global initializers) and metadata
+  /// are deserialized when the first function or global variable is
+  /// materialized.  Until then, global variables with initializers are
+  /// materializable declarations, and the module has no named metadata.
   Module *getLazyBitcodeModule(MemoryBuffer *Buffer,
                                LLVMContext& Context,
                                std::string *ErrMsg = 0);
@@ -40,12 +45,16 @@ namespace llvm {
                            std::string *ErrMsg = 0);
 
   /// WriteBitcodeToFile - Write the specified module to the specified
-  /// raw output stream.
-  void WriteBitcodeToFile(const Module *M, raw_ostream &Out);
+  /// raw output stream.  If NumThreads is more than one, function bodies are
+  /// encoded on that many threads; the output is the same either way.  The
+  /// module must not be modified while it is being written.
+  void WriteBitcodeToFile(const Module *M, raw_ostream &Out,
+                          unsigned NumThreads = 1);
 
   /// WriteBitcodeToStream - Write the specified module to the specified
-  /// raw output stream.
-  void WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream);
+  /// raw output stream.  NumThreads is as for WriteBitcodeToFile.
+  void WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream,
+                            unsigned NumThreads = 1);
 
   /// createBitcodeWriterPass - Create and return a pass that writes the module
   /// to the specified ostream.
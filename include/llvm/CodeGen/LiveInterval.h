@@ -25,6 +25,7 @@
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/AlignOf.h"
 #include "llvm/CodeGen/SlotIndexes.h"
+#include <algorithm>
 #include <cassert>
 #include <climits>
 
@@ -68,7 +69,78 @@ namespace llvm {
 
   public:
 
-    typedef SmallVector<SlotIndex, 4> KillSet;
+    /// KillSet - The kill indices of a value number, in ascending order.  The
+    /// indices are allocated from the allocator that holds the VNInfo, and are
+    /// freed along with it.  Growing the set leaves the old array behind in
+    /// the allocator; since capacity doubles, that wastes at most as much
+    /// again as the set uses.
+    class KillSet {
+      BumpPtrAllocator *Allocator;
+      SlotIndex *Data;
+      unsigned Size, Capacity;
+
+      void grow(unsigned MinCapacity);
+      KillSet(const KillSet &);  // DO NOT IMPLEMENT
+    public:
+      typedef SlotIndex *iterator;
+      typedef const SlotIndex *const_iterator;
+
+      explicit KillSet(BumpPtrAllocator &A)
+        : Allocator(&A), Data(0), Size(0), Capacity(0) {}
+
+      KillSet &operator=(const KillSet &Other) {
+        if (this == &Other)
+          return *this;
+        if (Capacity < Other.Size)
+          grow(Other.Size);
+        std::copy(Other.begin(), Other.end(), Data);
+        Size = Other.Size;
+        return *this;
+      }
+
+      iterator begin() { return Data; }
+      iterator end() { return Data + Size; }
+      const_iterator begin() const { return Data; }
+      const_iterator end() const { return Data + Size; }
+
+      bool empty() const { return Size == 0; }
+      unsigned size() const { return Size; }
+
+      SlotIndex &operator[](unsigned i) {
+        assert(i < Size && "Kill index out of range!");
+        return Data[i];
+      }
+      const SlotIndex &operator[](unsigned i) const {
+        assert(i < Size && "Kill index out of range!");
+        return Data[i];
+      }
+
+      void clear() { Size = 0; }
+
+      void push_back(SlotIndex k) {
+        if (Size == Capacity)
+          grow(Size + 1);
+        Data[Size++] = k;
+      }
+
+      iterator insert(iterator i, SlotIndex k) {
+        unsigned Pos = unsigned(i - Data);
+        if (Size == Capacity)
+          grow(Size + 1);
+        std::copy_backward(Data + Pos, Data + Size, Data + Size + 1);
+        Data[Pos] = k;
+        ++Size;
+        return Data + Pos;
+      }
+
+      iterator erase(iterator i) { return erase(i, i + 1); }
+
+      iterator erase(iterator s, iterator e) {
+        std::copy(e, end(), s);
+        Size -= unsigned(e - s);
+        return s;
+      }
+    };
 
     /// The ID number of this value.
     unsigned id;
@@ -86,13 +158,14 @@ namespace llvm {
     /// VNInfo constructor.
     /// d is presumed to point to the actual defining instr. If it doesn't
     /// setIsDefAccurate(false) should be called after construction.
-    VNInfo(unsigned i, SlotIndex d, MachineInstr *c)
-      : flags(IS_DEF_ACCURATE), id(i), def(d) { cr.copy = c; }
+    VNInfo(unsigned i, SlotIndex d, MachineInstr *c, BumpPtrAllocator &A)
+      : flags(IS_DEF_ACCURATE), id(i), def(d), kills(A) { cr.copy = c; }
 
     /// VNInfo construtor, copies values from orig, except for the value number.
-    VNInfo(unsigned i, const VNInfo &orig)
-      : flags(orig.flags), cr(orig.cr), id(i), def(orig.def), kills(orig.kills)
-    { }
+    VNInfo(unsigned i, const VNInfo &orig, BumpPtrAllocator &A)
+      : flags(orig.flags), cr(orig.cr), id(i), def(orig.def), kills(A) {
+      kills = orig.kills;
+    }
 
     /// Copy from the parameter into this VNInfo.
     void copyFrom(VNInfo &src) {
@@ -374,7 +447,7 @@ namespace llvm {
       VNInfo *VNI =
         static_cast<VNInfo*>(VNInfoAllocator.Allocate((unsigned)sizeof(VNInfo),
                                                       alignof<VNInfo>()));
-      new (VNI) VNInfo((unsigned)valnos.size(), def, CopyMI);
+      new (VNI) VNInfo((unsigned)valnos.size(), def, CopyMI, VNInfoAllocator);
       VNI->setIsDefAccurate(isDefAccurate);
       valnos.push_back(VNI);
       return VNI;
@@ -388,14 +461,15 @@ namespace llvm {
         static_cast<VNInfo*>(VNInfoAllocator.Allocate((unsigned)sizeof(VNInfo),
                                                       alignof<VNInfo>()));
     
-      new (VNI) VNInfo((unsigned)valnos.size(), *orig);
+      new (VNI) VNInfo((unsigned)valnos.size(), *orig, VNInfoAllocator);
       valnos.push_back(VNI);
       return VNI;
     }
 
     /// addKills - Add a number of kills into the VNInfo kill vector. If this
     /// interval is live at a kill point, then the kill is not added.
-    void addKills(VNInfo *VNI, const VNInfo::KillSet &kills) {
+    template<typename KillList>
+    void addKills(VNInfo *VNI, const KillList &kills) {
       for (unsigned i = 0, e = static_cast<unsigned>(kills.size());
            i != e; ++i) {
         if (!liveBeforeAndAt(kills[i])) {
@@ -22,6 +22,7 @@
 #include "llvm/ADT/ilist.h"
 #include "llvm/Support/DebugLoc.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/ArrayRecycler.h"
 #include "llvm/Support/Recycler.h"
 
 namespace llvm {
@@ -101,6 +102,9 @@ class MachineFunction {
   // Allocation management for instructions in function.
   Recycler<MachineInstr> InstructionRecycler;
 
+  // Allocation management for operand arrays on instructions.
+  ArrayRecycler<MachineOperand> OperandRecycler;
+
   // Allocation management for basic blocks in function.
   Recycler<MachineBasicBlock> BasicBlockRecycler;
 
@@ -346,6 +350,22 @@ public:
   ///
   void DeleteMachineInstr(MachineInstr *MI);
 
+  typedef ArrayRecycler<MachineOperand>::Capacity OperandCapacity;
+
+  /// allocateOperandArray - Allocate an array of MachineOperands.  This is
+  /// only intended for use by internal MachineInstr functions.
+  MachineOperand *allocateOperandArray(OperandCapacity Cap) {
+    return OperandRecycler.Allocate(Cap, Allocator);
+  }
+
+  /// deallocateOperandArray - Dispose of an array of MachineOperands and
+  /// recycle the memory.  This is only intended for use by internal
+  /// MachineInstr functions.  Cap must be the same capacity that was used
+  /// to allocate the array.
+  void deallocateOperandArray(OperandCapacity Cap, MachineOperand *Array) {
+    OperandRecycler.Deallocate(Cap, Array);
+  }
+
   /// CreateMachineBasicBlock - Allocate a new MachineBasicBlock. Use this
   /// instead of `new MachineBasicBlock'.
   ///
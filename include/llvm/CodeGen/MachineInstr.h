@@ -22,6 +22,7 @@
 #include "llvm/CodeGen/MachineOperand.h"
 #include "llvm/Target/TargetInstrDesc.h"
 #include "llvm/Target/TargetOpcodes.h"
+#include "llvm/Support/ArrayRecycler.h"
 #include "llvm/Support/DebugLoc.h"
 #include <vector>
 
@@ -50,6 +51,8 @@ public:
   };
   
 private:
+  typedef ArrayRecycler<MachineOperand>::Capacity OperandCapacity;
+
   const TargetInstrDesc *TID;           // Instruction descriptor.
   unsigned short NumImplicitOps;        // Number of implicit operands (which
                                         // are determined at construction time).
@@ -61,11 +64,15 @@ private:
                                         // anything other than to convey comment
                                         // information to AsmPrinter.
 
-  std::vector<MachineOperand> Operands; // the operands
+  unsigned NumOperands;                 // Number of operands on instruction.
+  MachineOperand *Operands;             // Pointer to the first operand.  The
+                                        // array is allocated from MF.
+  MachineFunction *MF;                  // Function that owns the operands.
   mmo_iterator MemRefs;                 // information on memory references
   mmo_iterator MemRefsEnd;
   MachineBasicBlock *Parent;            // Pointer to the owning basic block.
   DebugLoc debugLoc;                    // Source line information.
+  OperandCapacity CapOperands;          // Capacity of the Operands array.
 
   // OperandComplete - Return true if it's illegal to add a new operand
   bool OperandsComplete() const;
@@ -86,26 +93,23 @@ private:
   /// TID NULL and no operands.
   MachineInstr();
 
-  // The next two constructors have DebugLoc and non-DebugLoc versions;
-  // over time, the non-DebugLoc versions should be phased out and eventually
-  // removed.
-
-  /// MachineInstr ctor - This constructor create a MachineInstr and add the
-  /// implicit operands.  It reserves space for number of operands specified by
-  /// TargetInstrDesc.  The version with a DebugLoc should be preferred.
-  explicit MachineInstr(const TargetInstrDesc &TID, bool NoImp = false);
+  // The next constructor has DebugLoc and non-DebugLoc versions; over time,
+  // the non-DebugLoc version should be phased out and eventually removed.
 
-  /// MachineInstr ctor - Work exactly the same as the ctor above, except that
-  /// the MachineInstr is created and added to the end of the specified basic
-  /// block.  The version with a DebugLoc should be preferred.
+  /// MachineInstr ctor - This constructor creates a MachineInstr in the given
+  /// MachineBasicBlock and adds it to the end of the block.  It adds the
+  /// implicit operands and reserves space for the number of operands
+  /// specified by TargetInstrDesc.  The version with a DebugLoc should be
+  /// preferred.
   ///
   MachineInstr(MachineBasicBlock *MBB, const TargetInstrDesc &TID);
 
   /// MachineInstr ctor - This constructor create a MachineInstr and add the
   /// implicit operands.  It reserves space for number of operands specified by
-  /// TargetInstrDesc.  An explicit DebugLoc is supplied.
-  explicit MachineInstr(const TargetInstrDesc &TID, const DebugLoc dl, 
-                        bool NoImp = false);
+  /// TargetInstrDesc in an array allocated from the given MachineFunction.
+  /// An explicit DebugLoc is supplied.
+  MachineInstr(MachineFunction &, const TargetInstrDesc &TID,
+               const DebugLoc dl, bool NoImp = false);
 
   /// MachineInstr ctor - Work exactly the same as the ctor above, except that
   /// the MachineInstr is created and added to the end of the specified basic
@@ -153,7 +157,7 @@ public:
 
   /// Access to explicit operands of the instruction.
   ///
-  unsigned getNumOperands() const { return (unsigned)Operands.size(); }
+  unsigned getNumOperands() const { return NumOperands; }
 
   const MachineOperand& getOperand(unsigned i) const {
     assert(i < getNumOperands() && "getOperand() out of range!");
@@ -408,6 +412,12 @@ private:
   /// this instruction.
   void addImplicitDefUseOperands();
   
+  /// moveOperands - Move NumOps operands from Src to Dst, updating the use
+  /// lists of the register operands to point at their new location.  The
+  /// ranges may overlap.
+  static void moveOperands(MachineOperand *Dst, MachineOperand *Src,
+                           unsigned NumOps);
+
   /// RemoveRegOperandsFromUseLists - Unlink all of the register operands in
   /// this instruction from their respective use lists.  This requires that the
   /// operands already be on their use lists.
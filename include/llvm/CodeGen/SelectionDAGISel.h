@@ -61,6 +61,10 @@ public:
   
   TargetLowering &getTargetLowering() { return TLI; }
 
+  /// useFastISel - Return true if a selector created at OptLevel uses
+  /// FastISel, given the -fast-isel option and EnableFastISel.
+  static bool useFastISel(CodeGenOpt::Level OptLevel);
+
   virtual void getAnalysisUsage(AnalysisUsage &AU) const;
 
   virtual bool runOnMachineFunction(MachineFunction &MF);
@@ -141,6 +141,20 @@ public:
            "implemented for all constants that have operands!");
     assert(0 && "Constants that do not have operands cannot be using 'From'!");
   }
+
+  /// replaceOperandsOnConstant - This is the bulk form of
+  /// replaceUsesOfWithOnConstant.  Ops holds a new value for each of the
+  /// operands of this constant.  The constant is rebuilt with all of them at
+  /// once, so that the uniquing tables are only updated once, and then 'this'
+  /// is either updated in place or replaced and deleted.  In general, you
+  /// should not call this method, use the bulk form of
+  /// Value::replaceAllUsesWith instead.
+  ///
+  virtual void replaceOperandsOnConstant(Value *const *, unsigned) {
+    assert(getNumOperands() == 0 && "replaceOperandsOnConstant must be "
+           "implemented for all constants that have operands!");
+    assert(0 && "Constants that do not have operands cannot be rebuilt!");
+  }
   
   static Constant* getNullValue(const Type* Ty);
   
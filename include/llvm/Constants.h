@@ -396,6 +396,7 @@ public:
 
   virtual void destroyConstant();
   virtual void replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U);
+  virtual void replaceOperandsOnConstant(Value *const *Ops, unsigned NumOps);
 
   /// Methods for support type inquiry through isa, cast, and dyn_cast:
   static inline bool classof(const ConstantArray *) { return true; }
@@ -445,6 +446,7 @@ public:
 
   virtual void destroyConstant();
   virtual void replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U);
+  virtual void replaceOperandsOnConstant(Value *const *Ops, unsigned NumOps);
 
   /// Methods for support type inquiry through isa, cast, and dyn_cast:
   static inline bool classof(const ConstantStruct *) { return true; }
@@ -489,6 +491,7 @@ public:
 
   virtual void destroyConstant();
   virtual void replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U);
+  virtual void replaceOperandsOnConstant(Value *const *Ops, unsigned NumOps);
 
   /// Methods for support type inquiry through isa, cast, and dyn_cast:
   static inline bool classof(const ConstantUnion *) { return true; }
@@ -545,6 +548,7 @@ public:
 
   virtual void destroyConstant();
   virtual void replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U);
+  virtual void replaceOperandsOnConstant(Value *const *Ops, unsigned NumOps);
 
   /// Methods for support type inquiry through isa, cast, and dyn_cast:
   static inline bool classof(const ConstantVector *) { return true; }
@@ -626,6 +630,7 @@ public:
   
   virtual void destroyConstant();
   virtual void replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U);
+  virtual void replaceOperandsOnConstant(Value *const *Ops, unsigned NumOps);
   
   /// Methods for support type inquiry through isa, cast, and dyn_cast:
   static inline bool classof(const BlockAddress *) { return true; }
@@ -901,6 +906,7 @@ public:
   
   virtual void destroyConstant();
   virtual void replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U);
+  virtual void replaceOperandsOnConstant(Value *const *Ops, unsigned NumOps);
 
   /// Methods for support type inquiry through isa, cast, and dyn_cast:
   static inline bool classof(const ConstantExpr *) { return true; }
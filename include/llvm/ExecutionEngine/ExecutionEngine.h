@@ -33,6 +33,7 @@ class ExecutionEngine;
 class Function;
 class GlobalVariable;
 class GlobalValue;
+class JITCodeCache;
 class JITEventListener;
 class JITMemoryManager;
 class MachineCodeInfo;
@@ -125,6 +126,10 @@ protected:
   /// LazyFunctionCreator - If an unknown function is needed, this function
   /// pointer is invoked to create it. If this returns null, the JIT will abort.
   void* (*LazyFunctionCreator)(const std::string &);
+
+  /// CodeCache - If set, the JIT looks up the machine code for functions here
+  /// before compiling them, and stores the code it generates.
+  JITCodeCache *CodeCache;
   
   /// ExceptionTableRegister - If Exception Handling is set, the JIT will 
   /// register dwarf tables with this function
@@ -299,6 +304,17 @@ public:
   ///
   virtual void *recompileAndRelinkFunction(Function *F) = 0;
 
+  /// recompileAndRelinkFunction - Like recompileAndRelinkFunction(F), but
+  /// generate the new copy at the specified optimization level instead of the
+  /// one the engine was created with.  This allows clients to start out with
+  /// cheap code (e.g. CodeGenOpt::None) and later recompile the functions
+  /// which turn out to be hot.  Engines which do not generate code ignore the
+  /// optimization level.
+  virtual void *recompileAndRelinkFunction(Function *F,
+                                           CodeGenOpt::Level OptLevel) {
+    return recompileAndRelinkFunction(F);
+  }
+
   /// freeMachineCodeForFunction - Release memory in the ExecutionEngine
   /// corresponding to the machine code emitted to execute this function, useful
   /// for garbage-collecting generated code.
@@ -370,6 +386,18 @@ public:
   void InstallLazyFunctionCreator(void* (*P)(const std::string &)) {
     LazyFunctionCreator = P;
   }
+
+  /// setJITCodeCache - Make the JIT reuse machine code from, and add newly
+  /// generated machine code to, the specified cache.  Pass null to stop using
+  /// a cache.  The ExecutionEngine does not take ownership of the cache, which
+  /// must outlive it.  Functions with exception handling or debug info, and
+  /// functions compiled while AllocateGVsWithCode is set, are never cached.
+  void setJITCodeCache(JITCodeCache *C) {
+    CodeCache = C;
+  }
+  JITCodeCache *getJITCodeCache() const {
+    return CodeCache;
+  }
   
   /// InstallExceptionTableRegister - The JIT will use the given function
   /// to register the exception tables it generates.
@@ -397,6 +425,12 @@ protected:
   GenericValue getConstantValue(const Constant *C);
   void LoadValueFromMemory(GenericValue &Result, GenericValue *Ptr, 
                            const Type *Ty);
+
+  /// globalMappingChanged - Called with the ExecutionEngine lock held after
+  /// the mapping of GV is added, replaced or removed, or with a null GV after
+  /// all mappings are cleared.  Engines that keep their own record of
+  /// addresses override this to forget stale ones.
+  virtual void globalMappingChanged(const GlobalValue *GV) {}
 };
 
 namespace EngineKind {
@@ -0,0 +1,59 @@
+//===-- JITCodeCache.h - Persistent cache of JIT'd machine code -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the JITCodeCache interface, which lets the JIT reuse the
+// machine code it generated for a function in an earlier run instead of
+// running code generation again.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTION_ENGINE_JITCODECACHE_H
+#define LLVM_EXECUTION_ENGINE_JITCODECACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/System/DataTypes.h"
+
+namespace llvm {
+class MemoryBuffer;
+
+/// JITCodeCache - Storage for the relocatable machine code of JIT'd functions.
+/// The JIT computes a key from everything that affects the code generated for
+/// a function (its IR, the target and the codegen options) and asks the cache
+/// for it before compiling the function.  On a miss, the code is compiled as
+/// usual and then handed to the cache together with the relocations needed to
+/// link it into a later process.
+///
+/// The contents of the stored blobs are private to the JIT; a cache only has
+/// to give back exactly the bytes that were stored under a key.
+class JITCodeCache {
+public:
+  JITCodeCache() {}
+  virtual ~JITCodeCache();
+
+  /// lookup - Return the blob that was stored under Key, or null if there is
+  /// none.  The caller takes ownership of the returned buffer.
+  virtual MemoryBuffer *lookup(StringRef Key) = 0;
+
+  /// store - Remember Blob under Key, replacing anything that was previously
+  /// stored for it.  Failures to store are silently ignored.
+  virtual void store(StringRef Key, StringRef Blob) = 0;
+};
+
+/// createFileJITCodeCache - Create a JITCodeCache which keeps one file per
+/// function in the specified directory, creating the directory if it does not
+/// exist yet.  Returns null and sets ErrMsg if the directory cannot be created.
+/// Several processes may share the directory.  When the entries in it grow
+/// beyond SizeLimit bytes, the least recently used ones are removed; a
+/// SizeLimit of zero means no limit.
+JITCodeCache *createFileJITCodeCache(StringRef Directory, uint64_t SizeLimit,
+                                     std::string *ErrMsg = 0);
+
+} // end namespace llvm.
+
+#endif
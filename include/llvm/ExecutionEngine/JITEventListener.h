@@ -27,6 +27,8 @@ class MachineFunction;
 /// Empty for now, but this object will contain all details about the
 /// generated machine code that a Listener might care about.
 struct JITEvent_EmittedFunctionDetails {
+  // The function's MachineFunction, or null if the function's code was taken
+  // from a JITCodeCache instead of being generated.
   const MachineFunction *MF;
 
   struct LineStart {
@@ -55,7 +57,8 @@ public:
   typedef JITEvent_EmittedFunctionDetails EmittedFunctionDetails;
   /// NotifyFunctionEmitted - Called after a function has been successfully
   /// emitted to memory.  The function still has its MachineFunction attached,
-  /// if you should happen to need that.
+  /// if you should happen to need that, unless it was loaded from a code
+  /// cache.
   virtual void NotifyFunctionEmitted(const Function &F,
                                      void *Code, size_t Size,
                                      const EmittedFunctionDetails &Details) {}
@@ -46,6 +46,13 @@ template<> struct ilist_traits<BasicBlock>
   static void noteHead(BasicBlock*, BasicBlock*) {}
 
   static ValueSymbolTable *getSymTab(Function *ItemParent);
+
+  // Adding, removing or reordering blocks modifies the function.
+  void addNodeToList(BasicBlock *BB);
+  void removeNodeFromList(BasicBlock *BB);
+  void transferNodesFromList(ilist_traits<BasicBlock> &L2,
+                             ilist_iterator<BasicBlock> first,
+                             ilist_iterator<BasicBlock> last);
 private:
   mutable ilist_half_node<BasicBlock> Sentinel;
 };
@@ -93,6 +100,16 @@ private:
   // The Calling Convention is stored in Value::SubclassData.
   /*CallingConv::ID CallingConvention;*/
 
+  /// UnmodifiedEpoch - The modification tracking epoch in which
+  /// markUnmodified() was last called, or zero if the function has been
+  /// modified since.
+  unsigned UnmodifiedEpoch;
+
+  /// ModificationEpoch - The current modification tracking epoch.  A new one
+  /// starts whenever tracking is turned off, as changes are not seen then.
+  static unsigned ModificationEpoch;
+  static unsigned NumModificationTrackers;
+
   friend class SymbolTableListTraits<Function, Module>;
 
   void setParent(Module *parent);
@@ -164,6 +181,7 @@ public:
   void setCallingConv(CallingConv::ID CC) {
     setValueSubclassData((getSubclassDataFromValue() & 1) |
                          (static_cast<unsigned>(CC) << 1));
+    markModified();
   }
   
   /// getAttributes - Return the attribute list for this Function.
@@ -172,7 +190,10 @@ public:
 
   /// setAttributes - Set the attribute list for this Function.
   ///
-  void setAttributes(const AttrListPtr &attrs) { AttributeList = attrs; }
+  void setAttributes(const AttrListPtr &attrs) {
+    AttributeList = attrs;
+    markModified();
+  }
 
   /// hasFnAttr - Return true if this function has the given attribute.
   bool hasFnAttr(Attributes N) const {
@@ -411,6 +432,32 @@ public:
   /// hasAddressTaken - returns true if there are any uses of this function
   /// other than direct calls or invokes to it.
   bool hasAddressTaken() const;
+
+  /// startTrackingModifications/stopTrackingModifications - While at least
+  /// one client has started modification tracking, any change to the blocks,
+  /// instructions, operands or attributes of a function marks it modified.
+  /// This lets clients like the verifier skip functions that have not changed
+  /// since they last looked at them.  Tracking makes every operand update a
+  /// little slower, so stop it when it is no longer needed.
+  static void startTrackingModifications();
+  static void stopTrackingModifications();
+  static bool isTrackingModifications() { return Use::TrackModifications; }
+
+  /// isModified - Return true if this function may have changed since the
+  /// last call to markUnmodified.  This is always true while modification
+  /// tracking is off.
+  bool isModified() const { return UnmodifiedEpoch != ModificationEpoch; }
+
+  /// markUnmodified - Start watching this function for modifications.  This
+  /// may only be called while modification tracking is on.
+  void markUnmodified() {
+    assert(isTrackingModifications() && "Modifications are not tracked!");
+    UnmodifiedEpoch = ModificationEpoch;
+  }
+
+  /// markModified - Note that this function has been modified.  This is done
+  /// automatically for the changes that modification tracking covers.
+  void markModified() { UnmodifiedEpoch = 0; }
 private:
   // Shadow Value::setValueSubclassData with a private forwarding method so that
   // subclasses cannot accidentally use it.
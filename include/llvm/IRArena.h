@@ -0,0 +1,107 @@
+//===-- llvm/IRArena.h - Arena allocation of IR objects ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the IRArena class, a bump pointer arena that Instructions,
+// their operand lists and BasicBlocks can be allocated from instead of the
+// general purpose heap.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IRARENA_H
+#define LLVM_IRARENA_H
+
+#include "llvm/Support/Allocator.h"
+#include "llvm/System/Atomic.h"
+
+namespace llvm {
+
+/// IRArena - An arena for the Instructions, BasicBlocks and operand lists that
+/// are created on a thread while the arena is made current with an
+/// IRArena::Scope.  Clients that build and throw away many short-lived
+/// functions, such as a JIT, can use one arena per function to avoid most of
+/// the heap traffic that creating and deleting the IR involves.
+///
+/// Objects allocated from an arena behave like any other: they can be moved
+/// to other functions or modules, and deleted in any order and on any thread.
+/// Deleting an object does not make its memory available for reuse.  Instead,
+/// the arena returns all of its memory at once, when release() has been called
+/// and the last object allocated from it has been deleted.  An instruction that
+/// is moved out of an arena-allocated function into a long-lived one thus
+/// keeps its whole arena alive.
+///
+/// Typical use:
+///
+///   IRArena *Arena = IRArena::create();
+///   {
+///     IRArena::Scope S(Arena);
+///     ... create F and its body ...
+///   }
+///   Arena->release();
+///   ... compile and run F ...
+///   F->eraseFromParent();    // The arena's memory is freed here.
+///
+class IRArena {
+  IRArena(const IRArena &);          // Do not implement
+  void operator=(const IRArena &);   // Do not implement
+
+  /// RefCount - One for the reference that release() drops, plus one for
+  /// each object allocated from the arena that has not been deleted yet.
+  volatile sys::cas_flag RefCount;
+
+  BumpPtrAllocator Allocator;
+
+  IRArena();
+  ~IRArena();
+
+  void dropRef() {
+    if (sys::AtomicDecrement(&RefCount) == 0)
+      delete this;
+  }
+
+public:
+  /// create - Return a new, empty arena.  The caller owns the returned
+  /// reference and has to give it up with release().
+  static IRArena *create();
+
+  /// release - Give up the reference returned by create().  The arena may not
+  /// be made current afterwards.  It is destroyed as soon as nothing that was
+  /// allocated from it is left.
+  void release() { dropRef(); }
+
+  /// getCurrent - Return the arena that is current on this thread, or null if
+  /// IR objects are allocated from the heap.
+  static IRArena *getCurrent();
+
+  /// Scope - Make an arena current on this thread for the lifetime of the
+  /// object.  Scopes nest; a null arena makes IR objects come from the heap
+  /// again.  An arena may be current on only one thread at a time.
+  class Scope {
+    IRArena *Prev;
+    Scope(const Scope &);            // Do not implement
+    void operator=(const Scope &);   // Do not implement
+  public:
+    explicit Scope(IRArena *A);
+    ~Scope();
+  };
+
+  /// allocate - Allocate Size bytes for an IR object, from the current arena
+  /// if there is one and from the heap otherwise.  Memory from an arena has a
+  /// word in front of it that records the arena, so that deallocate() needs
+  /// neither a lock nor a search.  Heap memory has no such word; the object
+  /// itself has to remember whether an arena was current when it was created.
+  static void *allocate(size_t Size);
+
+  /// deallocate - Free memory returned by allocate().  FromArena tells whether
+  /// it came from an arena.
+  static void deallocate(void *Ptr, bool FromArena);
+};
+
+} // End llvm namespace
+
+#endif
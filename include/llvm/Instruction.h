@@ -35,11 +35,27 @@ class Instruction : public User, public ilist_node<Instruction> {
   enum {
     /// HasMetadataBit - This is a bit stored in the SubClassData field which
     /// indicates whether this instruction has metadata attached to it or not.
-    HasMetadataBit = 1 << 15
+    HasMetadataBit = 1 << 15,
+
+    /// FromArenaBit - This bit in the SubClassData field is set if the
+    /// instruction and its fixed operands were allocated from an IRArena.
+    FromArenaBit = 1 << 14
   };
 public:
   // Out of line virtual method, so the vtable, etc has a home.
   ~Instruction();
+
+  /// operator delete - Free the memory of an instruction and its operands,
+  /// which may have come from an IRArena.
+  void operator delete(void *I);
+  /// placement delete - required by std, but never called.
+  void operator delete(void*, unsigned) {
+    assert(0 && "Constructor throws?");
+  }
+  /// placement delete - required by std, but never called.
+  void operator delete(void*, unsigned, bool) {
+    assert(0 && "Constructor throws?");
+  }
   
   /// use_back - Specialize the methods defined in Value, as we know that an
   /// instruction can only be used by other instructions.
@@ -72,6 +88,12 @@ public:
   /// MovePos.
   void moveBefore(Instruction *MovePos);
 
+  /// markFunctionModified - Mark the function containing this instruction as
+  /// modified (see Function::isModified).  Changes to the operands or the
+  /// position of an instruction do this automatically; other changes that can
+  /// affect whether the function is valid, like new call attributes, call it.
+  void markFunctionModified();
+
   //===--------------------------------------------------------------------===//
   // Subclass classification.
   //===--------------------------------------------------------------------===//
@@ -323,19 +345,30 @@ private:
   friend class SymbolTableListTraits<Instruction, BasicBlock>;
   void setParent(BasicBlock *P);
 protected:
-  // Instruction subclasses can stick up to 15 bits of stuff into the
+  // Instruction subclasses can stick up to 14 bits of stuff into the
   // SubclassData field of instruction with these members.
   
-  // Verify that only the low 15 bits are used.
+  // Verify that only the low 14 bits are used.
   void setInstructionSubclassData(unsigned short D) {
-    assert((D & HasMetadataBit) == 0 && "Out of range value put into field");
-    setValueSubclassData((getSubclassDataFromValue() & HasMetadataBit) | D);
+    assert((D & (HasMetadataBit | FromArenaBit)) == 0 &&
+           "Out of range value put into field");
+    setValueSubclassData((getSubclassDataFromValue() &
+                          (HasMetadataBit | FromArenaBit)) | D);
   }
   
   unsigned getSubclassDataFromInstruction() const {
-    return getSubclassDataFromValue() & ~HasMetadataBit;
+    return getSubclassDataFromValue() & ~(HasMetadataBit | FromArenaBit);
   }
   
+  /// Instructions and their operands are allocated from the current IRArena,
+  /// if there is one.
+  void *operator new(size_t s, unsigned Us) {
+    return allocateWithUses(s, Us, false, true);
+  }
+  void *operator new(size_t s, unsigned Us, bool Prefix) {
+    return allocateWithUses(s, Us, Prefix, true);
+  }
+
   Instruction(const Type *Ty, unsigned iType, Use *Ops, unsigned NumOps,
               Instruction *InsertBefore = 0);
   Instruction(const Type *Ty, unsigned iType, Use *Ops, unsigned NumOps,
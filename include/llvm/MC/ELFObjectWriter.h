@@ -0,0 +1,34 @@
+//===-- llvm/MC/ELFObjectWriter.h - ELF File Writer -------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_MC_ELFOBJECTWRITER_H
+#define LLVM_MC_ELFOBJECTWRITER_H
+
+namespace llvm {
+class MCObjectWriter;
+class raw_ostream;
+
+/// createELFObjectWriter - Create an MCObjectWriter which writes an ELF
+/// relocatable object file.
+///
+/// \param Is64Bit - Whether to write an ELFCLASS64 file.
+/// \param EMachine - The e_machine value; this also selects the relocation
+/// types used. Only EM_386 and EM_X86_64 are currently supported.
+///
+/// The writer only knows the absolute and PC-relative relocations.  Target
+/// specific expressions, which are used for references through the GOT or
+/// PLT and for thread-local variables, are rejected with a fatal error, so
+/// object files cannot be written for position independent code yet.  Debug
+/// line tables (.file and .loc) are dropped.
+MCObjectWriter *createELFObjectWriter(raw_ostream &OS, bool Is64Bit,
+                                      bool IsLittleEndian, unsigned EMachine);
+
+} // End llvm namespace
+
+#endif
@@ -26,6 +26,7 @@ class MCAssembler;
 class MCContext;
 class MCExpr;
 class MCFragment;
+class MCObjectWriter;
 class MCSection;
 class MCSectionData;
 class MCSymbol;
@@ -45,14 +46,9 @@ struct MCAsmFixup {
   /// Kind - The fixup kind.
   MCFixupKind Kind;
 
-  /// FixedValue - The value to replace the fix up by.
-  //
-  // FIXME: This should not be here.
-  uint64_t FixedValue;
-
 public:
   MCAsmFixup(uint64_t _Offset, const MCExpr &_Value, MCFixupKind _Kind)
-    : Offset(_Offset), Value(&_Value), Kind(_Kind), FixedValue(0) {}
+    : Offset(_Offset), Value(&_Value), Kind(_Kind) {}
 };
 
 class MCFragment : public ilist_node<MCFragment> {
@@ -493,6 +489,10 @@ public:
   // FIXME: Pack this in with other fields?
   unsigned CommonAlign;
 
+  /// SymbolSize - An expression describing how to calculate the size of
+  /// a symbol. If a symbol has no size this field will be NULL.
+  const MCExpr *SymbolSize;
+
   /// Flags - The Flags field is used by object file implementations to store
   /// additional per symbol information which is not easily classified.
   uint32_t Flags;
@@ -544,6 +544,12 @@ public:
     CommonAlign = Align;
   }
 
+  /// getSize - Return the size expression of the symbol, if any.
+  const MCExpr *getSize() const { return SymbolSize; }
+
+  /// setSize - Set the size expression of the symbol.
+  void setSize(const MCExpr *SS) { SymbolSize = SS; }
+
   /// getCommonSize - Return the size of a 'common' symbol.
   uint64_t getCommonSize() const {
     assert(isCommon() && "Not a 'common' symbol!");
@@ -634,7 +640,11 @@ private:
   /// were adjusted.
   bool LayoutOnce();
 
-  // FIXME: Make protected once we factor out object writer classes.
+  /// ApplyFixup - Write the resolved value \arg FixedValue of \arg Fixup into
+  /// the contents of its fragment.
+  void ApplyFixup(const MCAsmFixup &Fixup, MCDataFragment &DF,
+                  uint64_t FixedValue) const;
+
 public:
   /// Evaluate a fixup to a relocatable expression and the value which should be
   /// placed into the fixup.
@@ -653,6 +663,11 @@ public:
                      MCAsmFixup &Fixup, MCDataFragment *DF,
                      MCValue &Target, uint64_t &Value) const;
 
+  /// WriteSectionData - Write the contents of the section \arg SD, including
+  /// any trailing padding, using the given object writer. Virtual sections
+  /// are skipped.
+  void WriteSectionData(const MCSectionData *SD, MCObjectWriter *OW) const;
+
 public:
   /// Construct a new assembler instance.
   ///
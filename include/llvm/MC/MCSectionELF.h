@@ -171,6 +171,8 @@ public:
   
   virtual void PrintSwitchToSection(const MCAsmInfo &MAI,
                                     raw_ostream &OS) const;
+
+  virtual bool isVirtualSection() const;
   
   
   /// PrintTargetSpecificSectionFlags - Targets that define their own
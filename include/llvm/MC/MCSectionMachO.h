@@ -168,6 +168,8 @@ public:
   
   virtual void PrintSwitchToSection(const MCAsmInfo &MAI,
                                     raw_ostream &OS) const;
+
+  virtual bool isVirtualSection() const;
 };
 
 } // end namespace llvm
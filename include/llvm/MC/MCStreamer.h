@@ -66,6 +66,11 @@ class TargetAsmBackend;
     /// all.
     virtual bool isVerboseAsm() const { return false; }
 
+    /// hasRawTextSupport - Return true if this streamer writes assembly text,
+    /// so that clients may print directives it has no method for straight to
+    /// the output.  Object file streamers never do.
+    virtual bool hasRawTextSupport() const { return false; }
+
     /// AddComment - Add a comment that can be emitted to the generated .s
     /// file if applicable as a QoI issue to make the output of the compiler
     /// more readable.  This only affects the MCAsmStreamer, and only when
@@ -309,6 +314,11 @@ class TargetAsmBackend;
   MCStreamer *createMachOStreamer(MCContext &Ctx, TargetAsmBackend &TAB,
                                   raw_ostream &OS, MCCodeEmitter *CE);
 
+  /// createELFStreamer - Create a machine code streamer which will generate
+  /// ELF format object files.
+  MCStreamer *createELFStreamer(MCContext &Ctx, TargetAsmBackend &TAB,
+                                raw_ostream &OS, MCCodeEmitter *CE);
+
 } // end namespace llvm
 
 #endif
@@ -0,0 +1,24 @@
+//===-- llvm/MC/MachObjectWriter.h - Mach-O File Writer ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_MC_MACHOBJECTWRITER_H
+#define LLVM_MC_MACHOBJECTWRITER_H
+
+namespace llvm {
+class MCObjectWriter;
+class raw_ostream;
+
+/// createMachObjectWriter - Create an MCObjectWriter which writes a Mach-O
+/// object file for an i386 or x86_64 target.
+MCObjectWriter *createMachObjectWriter(raw_ostream &OS, bool Is64Bit,
+                                       bool IsLittleEndian = true);
+
+} // End llvm namespace
+
+#endif
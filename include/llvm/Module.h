@@ -533,8 +533,12 @@ public:
 /// @name Utility functions for printing and dumping Module objects
 /// @{
 
-  /// Print the module to an output stream with AssemblyAnnotationWriter.
-  void print(raw_ostream &OS, AssemblyAnnotationWriter *AAW) const;
+  /// Print the module to an output stream with AssemblyAnnotationWriter.  If
+  /// NumThreads is more than one and there is no AssemblyAnnotationWriter,
+  /// function bodies are formatted on that many threads; the output is the
+  /// same either way.  The module must not be modified while it is printed.
+  void print(raw_ostream &OS, AssemblyAnnotationWriter *AAW,
+             unsigned NumThreads = 1) const;
   
   /// Dump the module to stderr (for debugging).
   void dump() const;
@@ -91,6 +91,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 
 namespace llvm {
+  class Function;
   class Module;
   class Pass;
   class StringRef;
@@ -109,6 +110,7 @@ enum PassDebuggingString {
   EXECUTION_MSG, // "Executing Pass '"
   MODIFICATION_MSG, // "' Made Modification '"
   FREEING_MSG, // " Freeing Pass '"
+  REUSING_MSG, // " Reusing Pass '"
   ON_BASICBLOCK_MSG, // "'  on BasicBlock '" + PassName + "'...\n"
   ON_FUNCTION_MSG, // "' on Function '" + FunctionName + "'...\n"
   ON_MODULE_MSG, // "' on Module '" + ModuleName + "'...\n"
@@ -134,6 +136,40 @@ public:
   virtual void print(raw_ostream &OS) const;
 };
   
+/// PassTraceEvent - Records one run of a pass in the -pass-trace file: when it
+/// started and ended, the number of instructions in the unit it ran on before
+/// and after, and the change in heap usage.  The run is the lifetime of this
+/// object, so create it on the stack around the call that runs the pass.  It
+/// does nothing unless -pass-trace is given.
+class PassTraceEvent {
+  Pass *P;
+  Module *M;
+  SmallVector<Function *, 4> Functions;
+  const char *Category;
+  unsigned InstructionsBefore;
+  uint64_t StartTime;
+  size_t StartMemory;
+
+  void start();
+public:
+  PassTraceEvent(Pass *p, Module &m);   // When P is run on M
+  PassTraceEvent(Pass *p, Function &f, const char *Category = "function");
+  /// A pass run on all the functions in [Begin, End) at once, such as the
+  /// functions of a call graph SCC.
+  PassTraceEvent(Pass *p, Function *const *Begin, Function *const *End);
+  ~PassTraceEvent();
+
+  /// setFunctions - Replace the functions that the pass ran on, for passes
+  /// that replace functions of a call graph SCC with new ones.
+  void setFunctions(Function *const *Begin, Function *const *End) {
+    Functions.clear();
+    Functions.append(Begin, End);
+  }
+
+  /// isEnabled - Return true if -pass-trace is given.
+  static bool isEnabled();
+};
+
   
 //===----------------------------------------------------------------------===//
 // PMStack
@@ -359,7 +395,7 @@ public:
     return PMT_Unknown; 
   }
 
-  std::map<AnalysisID, Pass*> *getAvailableAnalysis() {
+  DenseMap<AnalysisID, Pass*> *getAvailableAnalysis() {
     return &AvailableAnalysis;
   }
 
@@ -382,7 +418,7 @@ protected:
   // Collection of Analysis provided by Parent pass manager and
   // used by current pass manager. At at time there can not be more
   // then PMT_Last active pass mangers.
-  std::map<AnalysisID, Pass *> *InheritedAnalysis[PMT_Last];
+  DenseMap<AnalysisID, Pass *> *InheritedAnalysis[PMT_Last];
 
   
   /// isPassDebuggingExecutionsOrMore - Return true if -debug-pass=Executions
@@ -397,7 +433,7 @@ private:
   // pass. If a pass requires an analysis which is not available then 
   // the required analysis pass is scheduled to run before the pass itself is
   // scheduled to run.
-  std::map<AnalysisID, Pass*> AvailableAnalysis;
+  DenseMap<AnalysisID, Pass*> AvailableAnalysis;
 
   // Collection of higher level analysis used by the pass managed by
   // this manager.
@@ -460,6 +496,34 @@ public:
   virtual PassManagerType getPassManagerType() const { 
     return PMT_FunctionPassManager; 
   }
+
+private:
+  // A pass that leaves the function unchanged does not really invalidate the
+  // analyses it does not preserve.  Their results are kept while the function
+  // stays unchanged, and a later instance of the same analysis uses them
+  // instead of computing them again.  This state is reset for each function.
+  void recordReusableAnalysis(Pass *P);
+  Pass *findReusableAnalysis(Pass *P);
+  void reuseAnalysis(Pass *P, Pass *Impl);
+  void releaseDeadPasses(Pass *P, Function &F);
+  void releaseRetainedAnalysis(Function &F);
+
+  /// ReusableAnalysis - Analyses that are no longer available, but whose
+  /// results are still valid for the current function.
+  DenseMap<AnalysisID, Pass*> ReusableAnalysis;
+
+  /// ReusedAnalysis - Maps each analysis pass that was not run to the pass
+  /// whose results were used in its place.
+  DenseMap<Pass*, Pass*> ReusedAnalysis;
+
+  /// ExtraLifetimes - The number of passes that were not run in favor of the
+  /// key pass and whose last users have not run yet.  The key pass is kept
+  /// alive until they have.
+  DenseMap<Pass*, unsigned> ExtraLifetimes;
+
+  /// RetainedAnalysis - Reusable analysis passes whose last users have run.
+  /// They are freed once the function changes or all passes have run on it.
+  SmallVector<Pass*, 8> RetainedAnalysis;
 };
 
 extern Timer *StartPassTimer(Pass *);
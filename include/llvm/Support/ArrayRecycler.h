@@ -0,0 +1,127 @@
+//==- llvm/Support/ArrayRecycler.h - Recycling of Arrays ---------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the ArrayRecycler class template which can recycle small
+// arrays allocated from one of the allocators in Allocator.h
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_ARRAYRECYCLER_H
+#define LLVM_SUPPORT_ARRAYRECYCLER_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/AlignOf.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/System/DataTypes.h"
+#include <cassert>
+
+namespace llvm {
+
+/// ArrayRecycler - Recycle arrays of T whose sizes are powers of two.  Arrays
+/// are grouped by Capacity; a deallocated array goes on the free list of its
+/// capacity and is handed out again by the next allocation of the same
+/// capacity.  The memory is only given back to the allocator by clear().
+///
+template<class T, size_t Align = AlignOf<T>::Alignment>
+class ArrayRecycler {
+  /// FreeList - The structure the recycler imposes on a free array to link
+  /// it into the free list of its capacity.
+  struct FreeList {
+    FreeList *Next;
+  };
+
+  /// Bucket - The free list of each capacity, indexed by log2 of the size.
+  SmallVector<FreeList*, 8> Bucket;
+
+  /// pop - Remove an array from the free list of bucket Idx and return it, or
+  /// return null if the free list is empty.
+  T *pop(unsigned Idx) {
+    if (Idx >= Bucket.size())
+      return 0;
+    FreeList *Entry = Bucket[Idx];
+    if (!Entry)
+      return 0;
+    Bucket[Idx] = Entry->Next;
+    return reinterpret_cast<T*>(Entry);
+  }
+
+  /// push - Add the array Ptr to the free list of bucket Idx.
+  void push(unsigned Idx, T *Ptr) {
+    assert(Ptr && "Cannot recycle a null array");
+    assert(sizeof(T) >= sizeof(FreeList) && "Elements too small to recycle");
+    FreeList *Entry = reinterpret_cast<FreeList*>(Ptr);
+    if (Idx >= Bucket.size())
+      Bucket.resize(size_t(Idx) + 1);
+    Entry->Next = Bucket[Idx];
+    Bucket[Idx] = Entry;
+  }
+
+public:
+  /// Capacity - The size of an array handed out by the recycler.  Only the
+  /// log2 of the size is kept, so a Capacity fits in a byte.
+  class Capacity {
+    uint8_t Index;
+    explicit Capacity(uint8_t Idx) : Index(Idx) {}
+
+  public:
+    Capacity() : Index(0) {}
+
+    /// get - Return the smallest Capacity that holds N elements.
+    static Capacity get(size_t N) {
+      return Capacity(N ? Log2_64_Ceil(N) : 0);
+    }
+
+    /// getSize - Return the number of elements an array of this Capacity
+    /// holds.
+    size_t getSize() const { return size_t(1u) << Index; }
+
+    /// getBucket - Return the index of the free list for this Capacity.
+    unsigned getBucket() const { return Index; }
+
+    /// getNext - Return the next larger Capacity, which holds twice as many
+    /// elements.
+    Capacity getNext() const { return Capacity(Index + 1); }
+  };
+
+  ~ArrayRecycler() {
+    // If this fails, the client didn't call clear() before deleting the
+    // recycler, and the free arrays were never returned to their allocator.
+    assert(Bucket.empty() && "Non-empty ArrayRecycler deleted!");
+  }
+
+  /// clear - Release all the free arrays to the allocator.  The recycler must
+  /// be cleared before it is deleted.
+  template<class AllocatorType>
+  void clear(AllocatorType &Allocator) {
+    for (unsigned Idx = 0, E = Bucket.size(); Idx != E; ++Idx)
+      while (T *Ptr = pop(Idx))
+        Allocator.Deallocate(Ptr);
+    Bucket.clear();
+  }
+
+  /// Allocate - Return an uninitialized array that holds Cap.getSize()
+  /// elements, reusing a free array of the same capacity if there is one.
+  template<class AllocatorType>
+  T *Allocate(Capacity Cap, AllocatorType &Allocator) {
+    if (T *Ptr = pop(Cap.getBucket()))
+      return Ptr;
+    return static_cast<T*>(Allocator.Allocate(sizeof(T) * Cap.getSize(),
+                                              Align));
+  }
+
+  /// Deallocate - Put the array Ptr on the free list.  Cap must be the
+  /// capacity it was allocated with.  The elements are not destroyed.
+  void Deallocate(Capacity Cap, T *Ptr) {
+    push(Cap.getBucket(), Ptr);
+  }
+};
+
+}
+
+#endif
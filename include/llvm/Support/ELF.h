@@ -232,10 +232,21 @@ enum {
   STT_FUNC    = 2,   // Symbol is executable code (function, etc.)
   STT_SECTION = 3,   // Symbol refers to a section
   STT_FILE    = 4,   // Local, absolute symbol that refers to a file
+  STT_COMMON  = 5,   // An uninitialised common block
+  STT_TLS     = 6,   // Thread local data object
+  STT_GNU_IFUNC = 10, // GNU indirect function
   STT_LOPROC  = 13,  // Lowest processor-specific symbol type
   STT_HIPROC  = 15   // Highest processor-specific symbol type
 };
 
+// Symbol visibility, stored in the low bits of st_other.
+enum {
+  STV_DEFAULT   = 0, // Visibility is specified by binding type
+  STV_INTERNAL  = 1, // Defined by processor supplements
+  STV_HIDDEN    = 2, // Not visible to other components
+  STV_PROTECTED = 3  // Visible in other components but not preemptable
+};
+
 // Relocation entry, without explicit addend.
 struct Elf32_Rel {
   Elf32_Addr r_offset; // Location (file byte offset, or program virtual addr)
@@ -269,6 +280,31 @@ struct Elf32_Rela {
   };
 };
 
+// i386 relocation types.
+enum {
+  R_386_NONE = 0,
+  R_386_32   = 1,
+  R_386_PC32 = 2,
+  R_386_16   = 20,
+  R_386_PC16 = 21,
+  R_386_8    = 22,
+  R_386_PC8  = 23
+};
+
+// x86-64 relocation types.
+enum {
+  R_X86_64_NONE = 0,
+  R_X86_64_64   = 1,
+  R_X86_64_PC32 = 2,
+  R_X86_64_32   = 10,
+  R_X86_64_32S  = 11,
+  R_X86_64_16   = 12,
+  R_X86_64_PC16 = 13,
+  R_X86_64_8    = 14,
+  R_X86_64_PC8  = 15,
+  R_X86_64_PC64 = 24
+};
+
 // Program header.
 struct Elf32_Phdr {
   Elf32_Word p_type;   // Type of segment
@@ -28,8 +28,9 @@ namespace llvm {
 
   /// If the given MemoryBuffer holds a bitcode image, return a Module for it
   /// which does lazy deserialization of function bodies.  Otherwise, attempt to
-  /// parse it as LLVM Assembly and return a fully populated Module. This
-  /// function *always* takes ownership of the given MemoryBuffer.
+  /// parse it as LLVM Assembly and return a Module for it which parses function
+  /// bodies lazily. This function *always* takes ownership of the given
+  /// MemoryBuffer.
   inline Module *getLazyIRModule(MemoryBuffer *Buffer,
                                  SMDiagnostic &Err,
                                  LLVMContext &Context) {
@@ -46,13 +47,13 @@ namespace llvm {
       return M;
     }
 
-    return ParseAssembly(Buffer, 0, Err, Context);
+    return getLazyAssemblyModule(Buffer, Err, Context);
   }
 
   /// If the given file holds a bitcode image, return a Module
   /// for it which does lazy deserialization of function bodies.  Otherwise,
-  /// attempt to parse it as LLVM Assembly and return a fully populated
-  /// Module.
+  /// attempt to parse it as LLVM Assembly and return a Module for it which
+  /// parses function bodies lazily.
   inline Module *getLazyIRFileModule(const std::string &Filename,
                                      SMDiagnostic &Err,
                                      LLVMContext &Context) {
@@ -0,0 +1,63 @@
+//===-- llvm/Support/SHA1.h - SHA-1 message digest --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the SHA1 class, which computes the SHA-1 digest (FIPS
+// 180-2) of a byte stream, for keying caches on large inputs.
+//
+// To hash some data:
+//
+//   SHA1 Hash;
+//   Hash.update(Part1);
+//   Hash.update(Part2);
+//   StringRef Digest = Hash.final();   // 20 bytes
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_SHA1_H
+#define LLVM_SUPPORT_SHA1_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/System/DataTypes.h"
+
+namespace llvm {
+
+class SHA1 {
+public:
+  /// DigestSize - The size of a digest in bytes.
+  enum { DigestSize = 20 };
+
+  SHA1() { init(); }
+
+  /// init - Start hashing a new byte stream.
+  void init();
+
+  /// update - Add 'Data' to the stream being hashed.
+  void update(StringRef Data);
+
+  /// final - Finish the stream and return its digest.  The digest remains
+  /// valid until the next call to init(), which must come before hashing
+  /// anything else.
+  StringRef final();
+
+private:
+  enum { BlockSize = 64 };
+
+  void addByte(uint8_t Byte);
+  void hashBlock();
+
+  uint32_t State[5];
+  uint8_t Buffer[BlockSize];
+  unsigned BufferOffset;
+  uint64_t ByteCount;
+  char Digest[DigestSize];
+};
+
+} // end namespace llvm
+
+#endif
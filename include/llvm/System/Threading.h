@@ -14,6 +14,8 @@
 #ifndef LLVM_SYSTEM_THREADING_H
 #define LLVM_SYSTEM_THREADING_H
 
+#include <vector>
+
 namespace llvm {
   /// llvm_start_multithreaded - Allocate and initialize structures needed to
   /// make LLVM safe for multithreading.  The return value indicates whether
@@ -40,6 +42,24 @@ namespace llvm {
   /// release_global_lock - Release the global lock.  This is a no-op if called
   /// before llvm_start_multithreaded().
   void llvm_release_global_lock();
+
+  /// llvm_execute_on_threads - Call UserFn(UserData, ThreadNo) once for each
+  /// ThreadNo in [0, NumThreads), with the calls running concurrently on
+  /// separate threads, and return when all of them have finished.  Call 0 is
+  /// made on the calling thread.  If threads are not available, or one cannot
+  /// be created, the remaining calls are made one after another on the calling
+  /// thread instead, so UserFn must not wait for its siblings.
+  void llvm_execute_on_threads(void (*UserFn)(void*, unsigned), void *UserData,
+                               unsigned NumThreads);
+
+  /// llvm_split_into_runs - Split a sequence of work items, whose sizes are
+  /// given by Sizes, into at most MaxRuns contiguous runs of similar total
+  /// size, for llvm_execute_on_threads.  Run i covers the items in
+  /// [RunStarts[i], RunStarts[i+1]), and no run is empty.  Returns the number
+  /// of runs, which is less than MaxRuns only if there are fewer items.
+  unsigned llvm_split_into_runs(const std::vector<unsigned> &Sizes,
+                                unsigned MaxRuns,
+                                std::vector<unsigned> &RunStarts);
 }
 
 #endif
@@ -11,7 +11,9 @@
 #define LLVM_TARGET_TARGETASMBACKEND_H
 
 namespace llvm {
+class MCObjectWriter;
 class Target;
+class raw_ostream;
 
 /// TargetAsmBackend - Generic interface to target specific assembler backends.
 class TargetAsmBackend {
@@ -28,6 +30,23 @@ public:
 
   const Target &getTarget() const { return TheTarget; }
 
+  /// createObjectWriter - Create a new MCObjectWriter instance for use by the
+  /// assembler backend to emit the final object file.
+  virtual MCObjectWriter *createObjectWriter(raw_ostream &OS) const = 0;
+
+  /// getFixupKindLog2Size - Get the log2 of the size, in bytes, of the data
+  /// which is rewritten by a fixup of the given kind.
+  virtual unsigned getFixupKindLog2Size(unsigned Kind) const;
+
+  /// isFixupKindPCRel - Check whether the value of a fixup of the given kind
+  /// is relative to the address of the fixup itself.
+  virtual bool isFixupKindPCRel(unsigned Kind) const;
+
+  /// isFixupKindSignExtended - Check whether the processor sign extends the
+  /// value of a fixup of the given kind to the address size.  Object formats
+  /// like ELF use different relocations for such fields.
+  virtual bool isFixupKindSignExtended(unsigned Kind) const;
+
   /// hasAbsolutizedSet - Check whether this target "absolutizes"
   /// assignments. That is, given code like:
   ///   a:
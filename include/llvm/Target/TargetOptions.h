@@ -137,7 +137,8 @@ namespace llvm {
 
   /// EnableFastISel - This flag enables fast-path instruction selection
   /// which trades away generated code quality in favor of reducing
-  /// compile time.
+  /// compile time, at every optimization level.  Instruction selectors
+  /// created at CodeGenOpt::None use it regardless.
   extern bool EnableFastISel;
   
   /// StrongPHIElim - This flag enables more aggressive PHI elimination
@@ -0,0 +1,51 @@
+//===- PartitionModule.h - Split a module for parallel codegen --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares utilities that divide the definitions of a module into
+// partitions which can be code generated independently, for example by
+// parallel LTO code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_PARTITIONMODULE_H
+#define LLVM_TRANSFORMS_IPO_PARTITIONMODULE_H
+
+#include <vector>
+
+namespace llvm {
+  class Module;
+
+/// PartitionModule - Assign the definitions in M to at most NumPartitions
+/// partitions of similar size.  Functions are assigned by strongly connected
+/// components of the call graph, bottom-up, so that callees tend to share a
+/// partition with their callers.  A global variable goes with the first
+/// partition that refers to it, and an alias goes with its aliasee.
+///
+/// Every global with local linkage that is referred to from another partition
+/// is given hidden external linkage and a new unique name, so that M can be
+/// split with ExtractPartition.  Nothing else in M is changed.
+///
+/// On return, Assignment holds the partition of each global value of M: the
+/// global variables, then the functions, then the aliases, each in module
+/// order.  Declarations are in partition 0.  The return value is the number of
+/// partitions that were used.
+unsigned PartitionModule(Module *M, unsigned NumPartitions,
+                         std::vector<unsigned> &Assignment);
+
+/// ExtractPartition - Reduce M, which must be a copy of a module that was
+/// passed to PartitionModule with the same global values in the same order,
+/// to the definitions assigned to Partition.  Definitions in other partitions
+/// become external declarations.  Appending globals such as llvm.used and the
+/// module inline asm are only kept in partition 0.
+void ExtractPartition(Module *M, const std::vector<unsigned> &Assignment,
+                      unsigned Partition);
+
+} // End llvm namespace
+
+#endif
@@ -116,6 +116,12 @@ public:
 private:
   const Use* getImpliedUser() const;
   static Use *initTags(Use *Start, Use *Stop, ptrdiff_t Done = 0);
+
+  /// TrackModifications - This is set while Function modification tracking is
+  /// enabled (see Function::startTrackingModifications), and makes set() and
+  /// swap() report the change to the function that contains the user.
+  static bool TrackModifications;
+  void noteUserModified();
   
   Value *Val;
   Use *Next;
@@ -138,6 +144,7 @@ private:
 
   friend class Value;
   friend class User;
+  friend class Function;
 };
 
 // simplify_type - Allow clients to treat uses just like values when using
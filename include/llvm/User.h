@@ -62,8 +62,17 @@ protected:
 
   void *operator new(size_t s, unsigned Us);
   void *operator new(size_t s, unsigned Us, bool Prefix);
+  /// allocateWithUses - Allocate an object of size s with room for Us Uses in
+  /// front of it, and for a null prefix word before those if Prefix is true.
+  /// The memory comes from IRArena::allocate() if FromArena is true, and from
+  /// the global operator new otherwise.
+  static void *allocateWithUses(size_t s, unsigned Us, bool Prefix,
+                                bool FromArena);
   User(const Type *ty, unsigned vty, Use *OpList, unsigned NumOps)
     : Value(ty, vty), OperandList(OpList), NumOperands(NumOps) {}
+  /// getAllocation - Return the start of the memory that was allocated for
+  /// the User at Usr, which has already been destroyed.
+  static void *getAllocation(void *Usr);
   Use *allocHungoffUses(unsigned) const;
   void dropHungoffUses(Use *U) {
     if (OperandList == U) {
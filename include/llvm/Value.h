@@ -19,6 +19,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Casting.h"
 #include <string>
+#include <utility>
 
 namespace llvm {
 
@@ -43,6 +44,7 @@ class ValueHandleBase;
 class LLVMContext;
 class Twine;
 class MDNode;
+template<typename T> class SmallVectorImpl;
 
 //===----------------------------------------------------------------------===//
 //                                 Value Class
@@ -149,6 +151,16 @@ public:
   ///
   void replaceAllUsesWith(Value *V);
 
+  /// replaceAllUsesWith - Replace all uses of the first value of each pair in
+  /// Replacements with the second one, with the same effect as calling
+  /// replaceAllUsesWith on each pair in turn.  The value a pair replaces with
+  /// may itself be replaced by another pair, in which case its uses end up
+  /// using the last value of the chain; chains must not form a cycle.  Each
+  /// constant that uses the replaced values is only rebuilt and uniqued once,
+  /// however many of its operands change.
+  static void replaceAllUsesWith(
+              const SmallVectorImpl<std::pair<Value*, Value*> > &Replacements);
+
   // uncheckedReplaceAllUsesWith - Just like replaceAllUsesWith but dangerous.
   // Only use when in type resolution situations!
   void uncheckedReplaceAllUsesWith(Value *V);
@@ -318,6 +330,7 @@ void Use::set(Value *V) {
   if (Val) removeFromList();
   Val = V;
   if (V) V->addUse(*this);
+  if (TrackModifications) noteUserModified();
 }
 
 
@@ -90,6 +90,15 @@ private:
 
 char CGPassManager::ID = 0;
 
+/// CollectFunctions - Set Functions to the functions in SCC.
+static void CollectFunctions(const std::vector<CallGraphNode*> &SCC,
+                             SmallVectorImpl<Function*> &Functions) {
+  Functions.clear();
+  for (unsigned i = 0, e = SCC.size(); i != e; ++i)
+    if (Function *F = SCC[i]->getFunction())
+      Functions.push_back(F);
+}
+
 bool CGPassManager::RunPassOnSCC(Pass *P, std::vector<CallGraphNode*> &CurSCC,
                                  CallGraph &CG, bool &CallGraphUpToDate) {
   bool Changed = false;
@@ -102,9 +111,22 @@ bool CGPassManager::RunPassOnSCC(Pass *P, std::vector<CallGraphNode*> &CurSCC,
       CallGraphUpToDate = true;
     }
 
-    Timer *T = StartPassTimer(CGSP);
-    Changed = CGSP->runOnSCC(CurSCC);
-    StopPassTimer(CGSP, T);
+    {
+      SmallVector<Function*, 4> Functions;
+      if (PassTraceEvent::isEnabled())
+        CollectFunctions(CurSCC, Functions);
+      PassTraceEvent Trace(CGSP, Functions.begin(), Functions.end());
+
+      Timer *T = StartPassTimer(CGSP);
+      Changed = CGSP->runOnSCC(CurSCC);
+      StopPassTimer(CGSP, T);
+
+      // The pass may have replaced some of the functions.
+      if (PassTraceEvent::isEnabled()) {
+        CollectFunctions(CurSCC, Functions);
+        Trace.setFunctions(Functions.begin(), Functions.end());
+      }
+    }
     
     // After the CGSCCPass is done, when assertions are enabled, use
     // RefreshCallGraph to verify that the callgraph was correctly updated.
@@ -228,6 +228,8 @@ bool LPPassManager::runOnFunction(Function &F) {
 
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
+        PassTraceEvent Trace(P, *CurrentLoop->getHeader()->getParent(),
+                             "loop");
         Timer *T = StartPassTimer(P);
         Changed |= P->runOnLoop(CurrentLoop, *this);
         StopPassTimer(P, T);
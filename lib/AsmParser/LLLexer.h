@@ -65,6 +65,14 @@ namespace llvm {
     bool Error(LocTy L, const std::string &Msg) const;
     bool Error(const std::string &Msg) const { return Error(getLoc(), Msg); }
     std::string getFilename() const;
+    const SMDiagnostic &getDiagnostic() const { return ErrorInfo; }
+
+    /// Restart - Continue lexing from L, which must be the start of a token
+    /// that was lexed before.
+    void Restart(LocTy L) {
+      CurPtr = L.getPointer();
+      Lex();
+    }
 
   private:
     lltok::Kind LexToken();
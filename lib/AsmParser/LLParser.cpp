@@ -39,7 +39,34 @@ bool LLParser::Run() {
 /// ValidateEndOfModule - Do final validity and sanity checks at the end of the
 /// module.
 bool LLParser::ValidateEndOfModule() {
-  // Update auto-upgraded malloc calls to "malloc".
+  UpgradeMallocFunction();
+
+  // The bodies of a lazily parsed module are checked and upgraded as they are
+  // parsed.  Only the bodies whose blocks have their address taken are parsed
+  // now.
+  if (Lazy) {
+    if (CheckForwardRefs() ||
+        ResolveDeferredGlobalRefs())
+      return true;
+    RecordUpgradedIntrinsics();
+    return ResolveRemainingBlockAddresses();
+  }
+
+  if (ResolveRemainingBlockAddresses() ||
+      CheckForwardRefs())
+    return true;
+
+  // Look for intrinsic functions and CallInst that need to be upgraded
+  for (Module::iterator FI = M->begin(), FE = M->end(); FI != FE; )
+    UpgradeCallsToIntrinsic(FI++); // must be post-increment, as we remove
+
+  // Check debug info intrinsics.
+  CheckDebugInfoIntrinsics(M);
+  return false;
+}
+
+/// UpgradeMallocFunction - Update auto-upgraded malloc calls to "malloc".
+void LLParser::UpgradeMallocFunction() {
   // FIXME: Remove in LLVM 3.0.
   if (MallocF) {
     MallocF->setName("malloc");
@@ -55,32 +82,11 @@ bool LLParser::ValidateEndOfModule() {
       MallocF = NULL;
     }
   }
-  
-  
-  // If there are entries in ForwardRefBlockAddresses at this point, they are
-  // references after the function was defined.  Resolve those now.
-  while (!ForwardRefBlockAddresses.empty()) {
-    // Okay, we are referencing an already-parsed function, resolve them now.
-    Function *TheFn = 0;
-    const ValID &Fn = ForwardRefBlockAddresses.begin()->first;
-    if (Fn.Kind == ValID::t_GlobalName)
-      TheFn = M->getFunction(Fn.StrVal);
-    else if (Fn.UIntVal < NumberedVals.size())
-      TheFn = dyn_cast<Function>(NumberedVals[Fn.UIntVal]);
-    
-    if (TheFn == 0)
-      return Error(Fn.Loc, "unknown function referenced by blockaddress");
-    
-    // Resolve all these references.
-    if (ResolveForwardRefBlockAddresses(TheFn, 
-                                      ForwardRefBlockAddresses.begin()->second,
-                                        0))
-      return true;
-    
-    ForwardRefBlockAddresses.erase(ForwardRefBlockAddresses.begin());
-  }
-  
-  
+}
+
+/// CheckForwardRefs - Report an error if some type, global value or metadata
+/// was referred to but never defined.
+bool LLParser::CheckForwardRefs() {
   if (!ForwardRefTypes.empty())
     return Error(ForwardRefTypes.begin()->second.second,
                  "use of undefined type named '" +
@@ -104,14 +110,88 @@ bool LLParser::ValidateEndOfModule() {
     return Error(ForwardRefMDNodes.begin()->second.second,
                  "use of undefined metadata '!" +
                  utostr(ForwardRefMDNodes.begin()->first) + "'");
+  return false;
+}
 
+/// RecordUpgradedIntrinsics - Upgrade the declarations of old intrinsics, and
+/// remember them so that calls in bodies that are parsed later can be
+/// upgraded too.
+void LLParser::RecordUpgradedIntrinsics() {
+  for (Module::iterator FI = M->begin(), FE = M->end(); FI != FE; ++FI) {
+    if (!FI->getName().startswith("llvm."))
+      continue;
+    Function *NewFn;
+    if (UpgradeIntrinsicFunction(FI, NewFn))
+      UpgradedIntrinsics.push_back(std::make_pair(FI, NewFn));
+  }
+}
 
-  // Look for intrinsic functions and CallInst that need to be upgraded
-  for (Module::iterator FI = M->begin(), FE = M->end(); FI != FE; )
-    UpgradeCallsToIntrinsic(FI++); // must be post-increment, as we remove
+/// ResolveDeferredGlobalRefs - Look up the globals that the skipped bodies
+/// refer to, now that all of them have been defined.
+bool LLParser::ResolveDeferredGlobalRefs() {
+  for (std::map<std::string, std::pair<WeakVH, LocTy> >::iterator
+       I = DeferredGlobalRefs.begin(), E = DeferredGlobalRefs.end();
+       I != E; ++I) {
+    GlobalValue *GV = M->getNamedValue(I->first);
+    if (GV == 0)
+      return Error(I->second.second,
+                   "use of undefined value '@" + I->first + "'");
+    I->second.first = GV;
+  }
 
-  // Check debug info intrinsics.
-  CheckDebugInfoIntrinsics(M);
+  for (std::map<unsigned, std::pair<WeakVH, LocTy> >::iterator
+       I = DeferredGlobalRefIDs.begin(), E = DeferredGlobalRefIDs.end();
+       I != E; ++I) {
+    if (I->first >= NumberedVals.size())
+      return Error(I->second.second,
+                   "use of undefined value '@" + utostr(I->first) + "'");
+    I->second.first = NumberedVals[I->first];
+  }
+  return false;
+}
+
+/// ResolveRemainingBlockAddresses - Resolve the blockaddress references that
+/// were not resolved when the body of their function was parsed.
+bool LLParser::ResolveRemainingBlockAddresses() {
+  // If there are entries in ForwardRefBlockAddresses at this point, they are
+  // references after the function was defined.  Resolve those now.
+  while (!ForwardRefBlockAddresses.empty()) {
+    // Okay, we are referencing an already-parsed function, resolve them now.
+    Function *TheFn = 0;
+    const ValID &Fn = ForwardRefBlockAddresses.begin()->first;
+    GlobalValue *GV = 0;
+    if (Fn.Kind == ValID::t_GlobalName) {
+      if (LookupDeferredGlobalRef(Fn.StrVal, Fn.Loc, GV))
+        return true;
+      TheFn = GV ? dyn_cast<Function>(GV) : M->getFunction(Fn.StrVal);
+    } else {
+      if (LookupDeferredGlobalRef(Fn.UIntVal, Fn.Loc, GV))
+        return true;
+      if (GV)
+        TheFn = dyn_cast<Function>(GV);
+      else if (Fn.UIntVal < NumberedVals.size())
+        TheFn = dyn_cast<Function>(NumberedVals[Fn.UIntVal]);
+    }
+    
+    if (TheFn == 0)
+      return Error(Fn.Loc, "unknown function referenced by blockaddress");
+
+    // If the body of the function was skipped, parsing it resolves the
+    // references.
+    if (isMaterializable(TheFn)) {
+      if (ParseDeferredFunctionBody(TheFn))
+        return true;
+      continue;
+    }
+    
+    // Resolve all these references.
+    if (ResolveForwardRefBlockAddresses(TheFn, 
+                                      ForwardRefBlockAddresses.begin()->second,
+                                        0))
+      return true;
+    
+    ForwardRefBlockAddresses.erase(ForwardRefBlockAddresses.begin());
+  }
   return false;
 }
 
@@ -388,8 +468,17 @@ bool LLParser::ParseDefine() {
   Lex.Lex();
 
   Function *F;
-  return ParseFunctionHeader(F, true) ||
-         ParseFunctionBody(*F);
+  if (ParseFunctionHeader(F, true))
+    return true;
+  int FunctionNumber = F->hasName() ? -1 : int(NumberedVals.size())-1;
+
+  // When parsing lazily, remember where the body is and skip over it.  Bodies
+  // in the old 'begin'/'end' syntax are parsed right away.
+  if (Lazy && Lex.getKind() == lltok::lbrace) {
+    DeferredFunctionInfo[F] = std::make_pair(Lex.getLoc(), FunctionNumber);
+    return SkipFunctionBody();
+  }
+  return ParseFunctionBody(*F, FunctionNumber);
 }
 
 /// ParseGlobalType
@@ -766,9 +855,14 @@ GlobalValue *LLParser::GetGlobalVal(const std::string &Name, const Type *Ty,
     return 0;
   }
 
-  // Look this name up in the normal function symbol table.
-  GlobalValue *Val =
-    cast_or_null<GlobalValue>(M->getValueSymbolTable().lookup(Name));
+  // A body that was skipped refers to the global that had this name when the
+  // module was read.  Otherwise look the name up in the normal function
+  // symbol table.
+  GlobalValue *Val = 0;
+  if (LookupDeferredGlobalRef(Name, Loc, Val))
+    return 0;
+  if (Val == 0)
+    Val = cast_or_null<GlobalValue>(M->getValueSymbolTable().lookup(Name));
 
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
@@ -813,7 +907,11 @@ GlobalValue *LLParser::GetGlobalVal(unsigned ID, const Type *Ty, LocTy Loc) {
     return 0;
   }
 
-  GlobalValue *Val = ID < NumberedVals.size() ? NumberedVals[ID] : 0;
+  GlobalValue *Val = 0;
+  if (LookupDeferredGlobalRef(ID, Loc, Val))
+    return 0;
+  if (Val == 0 && ID < NumberedVals.size())
+    Val = NumberedVals[ID];
 
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
@@ -851,6 +949,36 @@ GlobalValue *LLParser::GetGlobalVal(unsigned ID, const Type *Ty, LocTy Loc) {
 }
 
 
+bool LLParser::LookupDeferredGlobalRef(const std::string &Name, LocTy Loc,
+                                       GlobalValue *&Val) {
+  if (!ParsingDeferredBody)
+    return false;
+  std::map<std::string, std::pair<WeakVH, LocTy> >::iterator
+    I = DeferredGlobalRefs.find(Name);
+  if (I == DeferredGlobalRefs.end())
+    return false;
+  Val = dyn_cast_or_null<GlobalValue>((Value*)I->second.first);
+  if (Val == 0)
+    return Error(Loc, "'@" + Name + "' was deleted before this body was read");
+  return false;
+}
+
+bool LLParser::LookupDeferredGlobalRef(unsigned ID, LocTy Loc,
+                                       GlobalValue *&Val) {
+  if (!ParsingDeferredBody)
+    return false;
+  std::map<unsigned, std::pair<WeakVH, LocTy> >::iterator
+    I = DeferredGlobalRefIDs.find(ID);
+  if (I == DeferredGlobalRefIDs.end())
+    return false;
+  Val = dyn_cast_or_null<GlobalValue>((Value*)I->second.first);
+  if (Val == 0)
+    return Error(Loc, "'@" + utostr(ID) +
+                 "' was deleted before this body was read");
+  return false;
+}
+
+
 //===----------------------------------------------------------------------===//
 // Helper Routines.
 //===----------------------------------------------------------------------===//
@@ -2748,18 +2876,27 @@ bool LLParser::ParseFunctionHeader(Function *&Fn, bool isDefine) {
       ForwardRefVals.find(FunctionName);
     if (FRVI != ForwardRefVals.end()) {
       Fn = M->getFunction(FunctionName);
+      // The function keeps the type of its forward reference.  Bodies that
+      // are parsed lazily are checked against the declared type instead, so
+      // in lazy mode reject the mismatch here rather than when one of them
+      // is materialized.
+      if (Lazy && Fn->getType() != PFT)
+        return Error(FRVI->second.second, "invalid forward reference to "
+                     "function '" + FunctionName + "' with wrong type!");
       ForwardRefVals.erase(FRVI);
     } else if ((Fn = M->getFunction(FunctionName))) {
       // If this function already exists in the symbol table, then it is
       // multiply defined.  We accept a few cases for old backwards compat.
       // FIXME: Remove this stuff for LLVM 3.0.
+      // A function whose body was skipped is not a declaration either.
+      bool HasBody = !Fn->isDeclaration() || DeferredFunctionInfo.count(Fn);
       if (Fn->getType() != PFT || Fn->getAttributes() != PAL ||
-          (!Fn->isDeclaration() && isDefine)) {
+          (HasBody && isDefine)) {
         // If the redefinition has different type or different attributes,
         // reject it.  If both have bodies, reject it.
         return Error(NameLoc, "invalid redefinition of function '" +
                      FunctionName + "'");
-      } else if (Fn->isDeclaration()) {
+      } else if (!HasBody) {
         // Make sure to strip off any argument names so we can't get conflicts.
         for (Function::arg_iterator AI = Fn->arg_begin(), AE = Fn->arg_end();
              AI != AE; ++AI)
@@ -2825,14 +2962,11 @@ bool LLParser::ParseFunctionHeader(Function *&Fn, bool isDefine) {
 ///   ::= '{' BasicBlock+ '}'
 ///   ::= 'begin' BasicBlock+ 'end'  // FIXME: remove in LLVM 3.0
 ///
-bool LLParser::ParseFunctionBody(Function &Fn) {
+bool LLParser::ParseFunctionBody(Function &Fn, int FunctionNumber) {
   if (Lex.getKind() != lltok::lbrace && Lex.getKind() != lltok::kw_begin)
     return TokError("expected '{' in function body");
   Lex.Lex();  // eat the {.
 
-  int FunctionNumber = -1;
-  if (!Fn.hasName()) FunctionNumber = NumberedVals.size()-1;
-  
   PerFunctionState PFS(*this, Fn, FunctionNumber);
 
   // We need at least one basic block.
@@ -3934,3 +4068,141 @@ bool LLParser::ParseMDNodeVector(SmallVectorImpl<Value*> &Elts,
 
   return false;
 }
+
+//===----------------------------------------------------------------------===//
+// GVMaterializer implementation
+//===----------------------------------------------------------------------===//
+
+/// SkipFunctionBody - The current token is the '{' of a body that is parsed
+/// when its function is materialized.  Lex past the matching '}', recording
+/// the globals that the body refers to.
+bool LLParser::SkipFunctionBody() {
+  unsigned Depth = 0;
+  do {
+    switch (Lex.getKind()) {
+    default: break;
+    case lltok::lbrace:
+      ++Depth;
+      break;
+    case lltok::rbrace:
+      --Depth;
+      break;
+    case lltok::GlobalVar:
+      DeferredGlobalRefs.insert(std::make_pair(Lex.getStrVal(),
+                                  std::make_pair(WeakVH(), Lex.getLoc())));
+      break;
+    case lltok::GlobalID:
+      DeferredGlobalRefIDs.insert(std::make_pair(Lex.getUIntVal(),
+                                    std::make_pair(WeakVH(), Lex.getLoc())));
+      break;
+    case lltok::Eof:
+      return TokError("expected '}' at end of function body");
+    case lltok::Error:
+      return true;
+    }
+    Lex.Lex();
+  } while (Depth != 0);
+  return false;
+}
+
+/// ParseDeferredFunctionBody - Parse the body of Fn, which was skipped when
+/// the module was read, and upgrade what has to be upgraded in it.
+bool LLParser::ParseDeferredFunctionBody(Function *Fn) {
+  DenseMap<Function*, std::pair<LocTy, int> >::iterator DFII =
+    DeferredFunctionInfo.find(Fn);
+  assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
+
+  // Move the lexer back to the '{' of the body.
+  Lex.Restart(DFII->second.first);
+  ParsingDeferredBody = true;
+  bool Failed = ParseFunctionBody(*Fn, DFII->second.second);
+  ParsingDeferredBody = false;
+  if (Failed)
+    return true;
+
+  UpgradeMallocFunction();
+  if (CheckForwardRefs())
+    return true;
+
+  // Upgrade any old intrinsic calls in the function.
+  for (std::vector<std::pair<Function*, Function*> >::iterator I =
+       UpgradedIntrinsics.begin(), E = UpgradedIntrinsics.end(); I != E; ++I) {
+    if (I->first != I->second) {
+      for (Value::use_iterator UI = I->first->use_begin(),
+           UE = I->first->use_end(); UI != UE; ) {
+        if (CallInst* CI = dyn_cast<CallInst>(*UI++))
+          UpgradeIntrinsicCall(CI, I->second);
+      }
+    }
+  }
+
+  // The body may take the address of blocks in other functions.
+  return ResolveRemainingBlockAddresses();
+}
+
+bool LLParser::isMaterializable(const GlobalValue *GV) const {
+  if (const Function *F = dyn_cast<Function>(GV))
+    return F->isDeclaration() &&
+      DeferredFunctionInfo.count(const_cast<Function*>(F));
+  return false;
+}
+
+bool LLParser::isDematerializable(const GlobalValue *GV) const {
+  const Function *F = dyn_cast<Function>(GV);
+  if (!F || F->isDeclaration())
+    return false;
+  return DeferredFunctionInfo.count(const_cast<Function*>(F));
+}
+
+bool LLParser::Materialize(GlobalValue *GV, std::string *ErrInfo) {
+  // If it's not a function or is already material, ignore the request.
+  Function *F = dyn_cast<Function>(GV);
+  if (!F || !isMaterializable(F)) return false;
+
+  if (ParseDeferredFunctionBody(F)) {
+    if (ErrInfo) {
+      raw_string_ostream OS(*ErrInfo);
+      Lex.getDiagnostic().Print(0, OS);
+      OS.flush();
+      // Like the bitcode reader's messages, this does not end in a newline.
+      if (!ErrInfo->empty() && (*ErrInfo)[ErrInfo->size()-1] == '\n')
+        ErrInfo->erase(ErrInfo->size()-1);
+    }
+    return true;
+  }
+  return false;
+}
+
+void LLParser::Dematerialize(GlobalValue *GV) {
+  // If this function isn't dematerializable, this is a noop.
+  Function *F = dyn_cast<Function>(GV);
+  if (!F || !isDematerializable(F))
+    return;
+
+  // Just forget the function body, we can parse it again later.
+  F->deleteBody();
+}
+
+bool LLParser::MaterializeModule(Module *Mod, std::string *ErrInfo) {
+  assert(Mod == M &&
+         "Can only Materialize the Module this LLParser is attached to.");
+  // Parse all of the bodies that are still skipped.
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (isMaterializable(F) && Materialize(F, ErrInfo))
+      return true;
+
+  // Now that no body can refer to them anymore, delete the old intrinsics.
+  for (std::vector<std::pair<Function*, Function*> >::iterator I =
+       UpgradedIntrinsics.begin(), E = UpgradedIntrinsics.end(); I != E; ++I) {
+    if (I->first != I->second) {
+      if (!I->first->use_empty())
+        I->first->replaceAllUsesWith(I->second);
+      I->first->eraseFromParent();
+    }
+  }
+  std::vector<std::pair<Function*, Function*> >().swap(UpgradedIntrinsics);
+
+  // Check debug info intrinsics.
+  CheckDebugInfoIntrinsics(M);
+  return false;
+}
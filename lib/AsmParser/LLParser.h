@@ -15,8 +15,11 @@
 #define LLVM_ASMPARSER_LLPARSER_H
 
 #include "LLLexer.h"
+#include "llvm/GVMaterializer.h"
 #include "llvm/Module.h"
 #include "llvm/Type.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/Support/ValueHandle.h"
 #include <map>
 
@@ -69,7 +72,7 @@ namespace llvm {
     }
   };
   
-  class LLParser {
+  class LLParser : public GVMaterializer {
   public:
     typedef LLLexer::LocTy LocTy;
   private:
@@ -77,6 +80,38 @@ namespace llvm {
     LLLexer Lex;
     Module *M;
 
+    /// Lazy - If true, function bodies are skipped when the module is read,
+    /// and parsed when the function is materialized.
+    bool Lazy;
+
+    /// DeferredFunctionInfo - For each function whose body was skipped, the
+    /// location of the '{' that starts the body, and the slot number of the
+    /// function if it is unnamed (-1 otherwise).
+    DenseMap<Function*, std::pair<LocTy, int> > DeferredFunctionInfo;
+
+    /// UpgradedIntrinsics - When parsing lazily, the intrinsics that have to
+    /// be upgraded, with their replacements.  Calls to them are upgraded as
+    /// each body is parsed.
+    std::vector<std::pair<Function*, Function*> > UpgradedIntrinsics;
+
+    /// DeferredGlobalRefs, DeferredGlobalRefIDs - The globals that skipped
+    /// bodies refer to by name or number, with the location of the first
+    /// reference.  They are looked up once the module has been read, and a
+    /// body parsed later uses these globals rather than looking the name up
+    /// again, so renaming a global does not change what the body refers to.
+    std::map<std::string, std::pair<WeakVH, LocTy> > DeferredGlobalRefs;
+    std::map<unsigned, std::pair<WeakVH, LocTy> > DeferredGlobalRefIDs;
+
+    /// ParsingDeferredBody - True while the body of a function whose body was
+    /// skipped is being parsed.
+    bool ParsingDeferredBody;
+
+    /// OwnedSM, OwnedDiag - A lazy parser outlives the call that created it,
+    /// so it owns the SourceMgr that holds its buffer and the diagnostic that
+    /// its lexer reports into.
+    OwningPtr<SourceMgr> OwnedSM;
+    OwningPtr<SMDiagnostic> OwnedDiag;
+
     // Type resolution handling data structures.
     std::map<std::string, std::pair<PATypeHolder, LocTy> > ForwardRefTypes;
     std::map<unsigned, std::pair<PATypeHolder, LocTy> > ForwardRefTypeIDs;
@@ -117,13 +152,28 @@ namespace llvm {
     
     Function *MallocF;
   public:
-    LLParser(MemoryBuffer *F, SourceMgr &SM, SMDiagnostic &Err, Module *m) : 
+    LLParser(MemoryBuffer *F, SourceMgr &SM, SMDiagnostic &Err, Module *m,
+             bool lazy = false) :
       Context(m->getContext()), Lex(F, SM, Err, m->getContext()),
-      M(m), MallocF(NULL) {}
+      M(m), Lazy(lazy), ParsingDeferredBody(false), MallocF(NULL) {}
     bool Run();
 
     LLVMContext& getContext() { return Context; }
 
+    /// adoptSourceMgr - Take ownership of the SourceMgr and diagnostic that
+    /// were passed to the constructor.
+    void adoptSourceMgr(SourceMgr *SM, SMDiagnostic *Diag) {
+      OwnedSM.reset(SM);
+      OwnedDiag.reset(Diag);
+    }
+
+    // GVMaterializer interface.
+    virtual bool isMaterializable(const GlobalValue *GV) const;
+    virtual bool isDematerializable(const GlobalValue *GV) const;
+    virtual bool Materialize(GlobalValue *GV, std::string *ErrInfo = 0);
+    virtual bool MaterializeModule(Module *Mod, std::string *ErrInfo = 0);
+    virtual void Dematerialize(GlobalValue *GV);
+
   private:
 
     bool Error(LocTy L, const std::string &Msg) const {
@@ -139,6 +189,14 @@ namespace llvm {
     GlobalValue *GetGlobalVal(const std::string &N, const Type *Ty, LocTy Loc);
     GlobalValue *GetGlobalVal(unsigned ID, const Type *Ty, LocTy Loc);
 
+    /// LookupDeferredGlobalRef - While a skipped body is parsed, set Val to
+    /// the global that the name or ID referred to when the module was read, if
+    /// the body was seen to refer to it.  Returns true, after reporting an
+    /// error, if that global has been deleted since.
+    bool LookupDeferredGlobalRef(const std::string &Name, LocTy Loc,
+                                 GlobalValue *&Val);
+    bool LookupDeferredGlobalRef(unsigned ID, LocTy Loc, GlobalValue *&Val);
+
     // Helper Routines.
     bool ParseToken(lltok::Kind T, const char *ErrMsg);
     bool EatIfPresent(lltok::Kind T) {
@@ -186,6 +244,11 @@ namespace llvm {
     // Top-Level Entities
     bool ParseTopLevelEntities();
     bool ValidateEndOfModule();
+    void UpgradeMallocFunction();
+    bool CheckForwardRefs();
+    void RecordUpgradedIntrinsics();
+    bool ResolveRemainingBlockAddresses();
+    bool ResolveDeferredGlobalRefs();
     bool ParseTargetDefinition();
     bool ParseDepLibs();
     bool ParseModuleAsm();
@@ -313,7 +376,9 @@ namespace llvm {
     bool ParseArgumentList(std::vector<ArgInfo> &ArgList,
                            bool &isVarArg, bool inType);
     bool ParseFunctionHeader(Function *&Fn, bool isDefine);
-    bool ParseFunctionBody(Function &Fn);
+    bool ParseFunctionBody(Function &Fn, int FunctionNumber);
+    bool SkipFunctionBody();
+    bool ParseDeferredFunctionBody(Function *Fn);
     bool ParseBasicBlock(PerFunctionState &PFS);
 
     // Instruction Parsing.  Each instruction parsing routine can return with a
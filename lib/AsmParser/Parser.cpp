@@ -39,6 +39,26 @@ Module *llvm::ParseAssembly(MemoryBuffer *F,
   return M2.take();
 }
 
+Module *llvm::getLazyAssemblyModule(MemoryBuffer *F, SMDiagnostic &Err,
+                                    LLVMContext &Context) {
+  // Function bodies are parsed after this returns, so the parser owns the
+  // SourceMgr and the diagnostic it reports into, and the module owns the
+  // parser.
+  SourceMgr *SM = new SourceMgr();
+  SM->AddNewSourceBuffer(F, SMLoc());
+  SMDiagnostic *Diag = new SMDiagnostic();
+
+  OwningPtr<Module> M(new Module(F->getBufferIdentifier(), Context));
+  LLParser *P = new LLParser(F, *SM, *Diag, M.get(), /*lazy=*/true);
+  P->adoptSourceMgr(SM, Diag);
+  M->setMaterializer(P);
+  if (P->Run()) {
+    Err = *Diag;
+    return 0;
+  }
+  return M.take();
+}
+
 Module *llvm::ParseAssemblyFile(const std::string &Filename, SMDiagnostic &Err,
                                 LLVMContext &Context) {
   std::string ErrorStr;
@@ -39,6 +39,8 @@ void BitcodeReader::FreeState() {
   std::vector<BasicBlock*>().swap(FunctionBBs);
   std::vector<Function*>().swap(FunctionsWithBodies);
   DeferredFunctionInfo.clear();
+  std::vector<std::pair<unsigned, uint64_t> >().swap(DeferredModuleBlocks);
+  GlobalsWithDeferredInits.clear();
 }
 
 //===----------------------------------------------------------------------===//
@@ -471,6 +473,129 @@ bool BitcodeReader::ParseAttributeBlock() {
 }
 
 
+/// GetTypeOperands - Set [First, End) to the range of the operands of a type
+/// record that are type IDs.  The range is empty for malformed records, which
+/// ParseTypeRecord rejects.
+static void GetTypeOperands(unsigned Code, unsigned NumOps,
+                            unsigned &First, unsigned &End) {
+  First = End = 0;
+  switch (Code) {
+  default: break;
+  case bitc::TYPE_CODE_POINTER:   // POINTER: [pointee type, ...]
+    if (NumOps >= 1) End = 1;
+    break;
+  case bitc::TYPE_CODE_FUNCTION:  // FUNCTION: [vararg, attrid, retty, ...]
+    if (NumOps >= 3) First = 2, End = NumOps;
+    break;
+  case bitc::TYPE_CODE_STRUCT:    // STRUCT: [ispacked, eltty x N]
+    if (NumOps >= 1) First = 1, End = NumOps;
+    break;
+  case bitc::TYPE_CODE_UNION:     // UNION: [eltty x N]
+    End = NumOps;
+    break;
+  case bitc::TYPE_CODE_ARRAY:     // ARRAY: [numelts, eltty]
+  case bitc::TYPE_CODE_VECTOR:    // VECTOR: [numelts, eltty]
+    if (NumOps >= 2) First = 1, End = 2;
+    break;
+  }
+}
+
+/// ParseTypeRecord - Build the type described by a record of the type table.
+/// The types that it refers to must be in TypeList already.  ResultTy is set
+/// to null for opaque types.
+bool BitcodeReader::ParseTypeRecord(unsigned Code,
+                                    const SmallVectorImpl<uint64_t> &Record,
+                                    const Type *&ResultTy) {
+  switch (Code) {
+  default:  // Default behavior: unknown type.
+    ResultTy = 0;
+    break;
+  case bitc::TYPE_CODE_VOID:      // VOID
+    ResultTy = Type::getVoidTy(Context);
+    break;
+  case bitc::TYPE_CODE_FLOAT:     // FLOAT
+    ResultTy = Type::getFloatTy(Context);
+    break;
+  case bitc::TYPE_CODE_DOUBLE:    // DOUBLE
+    ResultTy = Type::getDoubleTy(Context);
+    break;
+  case bitc::TYPE_CODE_X86_FP80:  // X86_FP80
+    ResultTy = Type::getX86_FP80Ty(Context);
+    break;
+  case bitc::TYPE_CODE_FP128:     // FP128
+    ResultTy = Type::getFP128Ty(Context);
+    break;
+  case bitc::TYPE_CODE_PPC_FP128: // PPC_FP128
+    ResultTy = Type::getPPC_FP128Ty(Context);
+    break;
+  case bitc::TYPE_CODE_LABEL:     // LABEL
+    ResultTy = Type::getLabelTy(Context);
+    break;
+  case bitc::TYPE_CODE_OPAQUE:    // OPAQUE
+    ResultTy = 0;
+    break;
+  case bitc::TYPE_CODE_METADATA:  // METADATA
+    ResultTy = Type::getMetadataTy(Context);
+    break;
+  case bitc::TYPE_CODE_INTEGER:   // INTEGER: [width]
+    if (Record.size() < 1)
+      return Error("Invalid Integer type record");
+
+    ResultTy = IntegerType::get(Context, Record[0]);
+    break;
+  case bitc::TYPE_CODE_POINTER: { // POINTER: [pointee type] or
+                                  //          [pointee type, address space]
+    if (Record.size() < 1)
+      return Error("Invalid POINTER type record");
+    unsigned AddressSpace = 0;
+    if (Record.size() == 2)
+      AddressSpace = Record[1];
+    ResultTy = PointerType::get(getTypeByID(Record[0]), AddressSpace);
+    break;
+  }
+  case bitc::TYPE_CODE_FUNCTION: {
+    // FIXME: attrid is dead, remove it in LLVM 3.0
+    // FUNCTION: [vararg, attrid, retty, paramty x N]
+    if (Record.size() < 3)
+      return Error("Invalid FUNCTION type record");
+    std::vector<const Type*> ArgTys;
+    for (unsigned i = 3, e = Record.size(); i != e; ++i)
+      ArgTys.push_back(getTypeByID(Record[i]));
+
+    ResultTy = FunctionType::get(getTypeByID(Record[2]), ArgTys,
+                                 Record[0]);
+    break;
+  }
+  case bitc::TYPE_CODE_STRUCT: {  // STRUCT: [ispacked, eltty x N]
+    if (Record.size() < 1)
+      return Error("Invalid STRUCT type record");
+    std::vector<const Type*> EltTys;
+    for (unsigned i = 1, e = Record.size(); i != e; ++i)
+      EltTys.push_back(getTypeByID(Record[i]));
+    ResultTy = StructType::get(Context, EltTys, Record[0]);
+    break;
+  }
+  case bitc::TYPE_CODE_UNION: {  // UNION: [eltty x N]
+    SmallVector<const Type*, 8> EltTys;
+    for (unsigned i = 0, e = Record.size(); i != e; ++i)
+      EltTys.push_back(getTypeByID(Record[i]));
+    ResultTy = UnionType::get(&EltTys[0], EltTys.size());
+    break;
+  }
+  case bitc::TYPE_CODE_ARRAY:     // ARRAY: [numelts, eltty]
+    if (Record.size() < 2)
+      return Error("Invalid ARRAY type record");
+    ResultTy = ArrayType::get(getTypeByID(Record[1]), Record[0]);
+    break;
+  case bitc::TYPE_CODE_VECTOR:    // VECTOR: [numelts, eltty]
+    if (Record.size() < 2)
+      return Error("Invalid VECTOR type record");
+    ResultTy = VectorType::get(getTypeByID(Record[1]), Record[0]);
+    break;
+  }
+  return false;
+}
+
 bool BitcodeReader::ParseTypeTable() {
   if (Stream.EnterSubBlock(bitc::TYPE_BLOCK_ID))
     return Error("Malformed block record");
@@ -478,18 +603,18 @@ bool BitcodeReader::ParseTypeTable() {
   if (!TypeList.empty())
     return Error("Multiple TYPE_BLOCKs found!");
 
+  // Read all the records for this type table.  The operands of all of the
+  // records are kept in Ops, and those of record i start at OpStart[i].
   SmallVector<uint64_t, 64> Record;
-  unsigned NumRecords = 0;
-
-  // Read all the records for this type table.
+  std::vector<unsigned> Codes;
+  std::vector<uint64_t> Ops;
+  std::vector<unsigned> OpStart;
   while (1) {
     unsigned Code = Stream.ReadCode();
     if (Code == bitc::END_BLOCK) {
-      if (NumRecords != TypeList.size())
-        return Error("Invalid type forward reference in TYPE_BLOCK");
       if (Stream.ReadBlockEnd())
         return Error("Error at end of type table block");
-      return false;
+      break;
     }
 
     if (Code == bitc::ENTER_SUBBLOCK) {
@@ -505,134 +630,94 @@ bool BitcodeReader::ParseTypeTable() {
       continue;
     }
 
-    // Read a record.
     Record.clear();
-    const Type *ResultTy = 0;
-    switch (Stream.ReadRecord(Code, Record)) {
-    default:  // Default behavior: unknown type.
-      ResultTy = 0;
-      break;
-    case bitc::TYPE_CODE_NUMENTRY: // TYPE_CODE_NUMENTRY: [numentries]
+    unsigned RecordCode = Stream.ReadRecord(Code, Record);
+    if (RecordCode == bitc::TYPE_CODE_NUMENTRY) {
       // TYPE_CODE_NUMENTRY contains a count of the number of types in the
       // type list.  This allows us to reserve space.
       if (Record.size() < 1)
         return Error("Invalid TYPE_CODE_NUMENTRY record");
-      TypeList.reserve(Record[0]);
+      Codes.reserve(Record[0]);
+      OpStart.reserve(Record[0]+1);
       continue;
-    case bitc::TYPE_CODE_VOID:      // VOID
-      ResultTy = Type::getVoidTy(Context);
-      break;
-    case bitc::TYPE_CODE_FLOAT:     // FLOAT
-      ResultTy = Type::getFloatTy(Context);
-      break;
-    case bitc::TYPE_CODE_DOUBLE:    // DOUBLE
-      ResultTy = Type::getDoubleTy(Context);
-      break;
-    case bitc::TYPE_CODE_X86_FP80:  // X86_FP80
-      ResultTy = Type::getX86_FP80Ty(Context);
-      break;
-    case bitc::TYPE_CODE_FP128:     // FP128
-      ResultTy = Type::getFP128Ty(Context);
-      break;
-    case bitc::TYPE_CODE_PPC_FP128: // PPC_FP128
-      ResultTy = Type::getPPC_FP128Ty(Context);
-      break;
-    case bitc::TYPE_CODE_LABEL:     // LABEL
-      ResultTy = Type::getLabelTy(Context);
-      break;
-    case bitc::TYPE_CODE_OPAQUE:    // OPAQUE
-      ResultTy = 0;
-      break;
-    case bitc::TYPE_CODE_METADATA:  // METADATA
-      ResultTy = Type::getMetadataTy(Context);
-      break;
-    case bitc::TYPE_CODE_INTEGER:   // INTEGER: [width]
-      if (Record.size() < 1)
-        return Error("Invalid Integer type record");
-
-      ResultTy = IntegerType::get(Context, Record[0]);
-      break;
-    case bitc::TYPE_CODE_POINTER: { // POINTER: [pointee type] or
-                                    //          [pointee type, address space]
-      if (Record.size() < 1)
-        return Error("Invalid POINTER type record");
-      unsigned AddressSpace = 0;
-      if (Record.size() == 2)
-        AddressSpace = Record[1];
-      ResultTy = PointerType::get(getTypeByID(Record[0], true),
-                                        AddressSpace);
-      break;
-    }
-    case bitc::TYPE_CODE_FUNCTION: {
-      // FIXME: attrid is dead, remove it in LLVM 3.0
-      // FUNCTION: [vararg, attrid, retty, paramty x N]
-      if (Record.size() < 3)
-        return Error("Invalid FUNCTION type record");
-      std::vector<const Type*> ArgTys;
-      for (unsigned i = 3, e = Record.size(); i != e; ++i)
-        ArgTys.push_back(getTypeByID(Record[i], true));
-
-      ResultTy = FunctionType::get(getTypeByID(Record[2], true), ArgTys,
-                                   Record[0]);
-      break;
-    }
-    case bitc::TYPE_CODE_STRUCT: {  // STRUCT: [ispacked, eltty x N]
-      if (Record.size() < 1)
-        return Error("Invalid STRUCT type record");
-      std::vector<const Type*> EltTys;
-      for (unsigned i = 1, e = Record.size(); i != e; ++i)
-        EltTys.push_back(getTypeByID(Record[i], true));
-      ResultTy = StructType::get(Context, EltTys, Record[0]);
-      break;
-    }
-    case bitc::TYPE_CODE_UNION: {  // UNION: [eltty x N]
-      SmallVector<const Type*, 8> EltTys;
-      for (unsigned i = 0, e = Record.size(); i != e; ++i)
-        EltTys.push_back(getTypeByID(Record[i], true));
-      ResultTy = UnionType::get(&EltTys[0], EltTys.size());
-      break;
-    }
-    case bitc::TYPE_CODE_ARRAY:     // ARRAY: [numelts, eltty]
-      if (Record.size() < 2)
-        return Error("Invalid ARRAY type record");
-      ResultTy = ArrayType::get(getTypeByID(Record[1], true), Record[0]);
-      break;
-    case bitc::TYPE_CODE_VECTOR:    // VECTOR: [numelts, eltty]
-      if (Record.size() < 2)
-        return Error("Invalid VECTOR type record");
-      ResultTy = VectorType::get(getTypeByID(Record[1], true), Record[0]);
-      break;
     }
+    Codes.push_back(RecordCode);
+    OpStart.push_back(Ops.size());
+    Ops.insert(Ops.end(), Record.begin(), Record.end());
+  }
+  OpStart.push_back(Ops.size());
+
+  // Build the types so that the types each one refers to come first, walking
+  // the references depth first.  Only a reference back to a type that is still
+  // being built, which happens for recursive types, needs an opaque type as a
+  // placeholder, which is refined to the real type when it is done.  A type
+  // graph without cycles is built without any abstract types or refinement.
+  // Until a type is built, its slot holds the void type.
+  unsigned NumTypes = Codes.size();
+  enum { NotStarted, InProgress, Done };
+  std::vector<unsigned char> State(NumTypes, NotStarted);
+  std::vector<bool> HasPlaceholder(NumTypes);
+  TypeList.reserve(NumTypes);
+  for (unsigned i = 0; i != NumTypes; ++i)
+    TypeList.push_back(Type::getVoidTy(Context));
+
+  // The worklist holds the types being built, each with the index of the next
+  // type operand to look at.
+  SmallVector<std::pair<unsigned, unsigned>, 16> Worklist;
+  for (unsigned Root = 0; Root != NumTypes; ++Root) {
+    if (State[Root] != NotStarted)
+      continue;
+    State[Root] = InProgress;
+    Worklist.push_back(std::make_pair(Root, 0U));
+
+    while (!Worklist.empty()) {
+      unsigned ID = Worklist.back().first;
+      unsigned First, End, NumOps = OpStart[ID+1] - OpStart[ID];
+      GetTypeOperands(Codes[ID], NumOps, First, End);
+
+      // Start on the first operand that hasn't been built yet.
+      bool Descended = false;
+      for (unsigned &i = Worklist.back().second; First+i < End; ) {
+        uint64_t OpID = Ops[OpStart[ID]+First+i++];
+        if (OpID >= NumTypes)
+          return Error("Invalid type forward reference in TYPE_BLOCK");
+        if (State[OpID] == NotStarted) {
+          State[OpID] = InProgress;
+          Worklist.push_back(std::make_pair(unsigned(OpID), 0U));
+          Descended = true;
+          break;
+        }
+        if (State[OpID] == InProgress && !HasPlaceholder[OpID]) {
+          TypeList[OpID] = OpaqueType::get(Context);
+          HasPlaceholder[OpID] = true;
+        }
+      }
+      if (Descended)
+        continue;
 
-    if (NumRecords == TypeList.size()) {
-      // If this is a new type slot, just append it.
-      TypeList.push_back(ResultTy ? ResultTy : OpaqueType::get(Context));
-      ++NumRecords;
-    } else if (ResultTy == 0) {
-      // Otherwise, this was forward referenced, so an opaque type was created,
-      // but the result type is actually just an opaque.  Leave the one we
-      // created previously.
-      ++NumRecords;
-    } else {
-      // Otherwise, this was forward referenced, so an opaque type was created.
-      // Resolve the opaque type to the real type now.
-      assert(NumRecords < TypeList.size() && "Typelist imbalance");
-      const OpaqueType *OldTy = cast<OpaqueType>(TypeList[NumRecords++].get());
-
-      // Don't directly push the new type on the Tab. Instead we want to replace
-      // the opaque type we previously inserted with the new concrete value. The
-      // refinement from the abstract (opaque) type to the new type causes all
-      // uses of the abstract type to use the concrete type (NewTy). This will
-      // also cause the opaque type to be deleted.
-      const_cast<OpaqueType*>(OldTy)->refineAbstractTypeTo(ResultTy);
-
-      // This should have replaced the old opaque type with the new type in the
-      // value table... or with a preexisting type that was already in the
-      // system.  Let's just make sure it did.
-      assert(TypeList[NumRecords-1].get() != OldTy &&
-             "refineAbstractType didn't work!");
+      // All of the operands are there, build the type itself.
+      Worklist.pop_back();
+      Record.clear();
+      Record.append(Ops.begin()+OpStart[ID], Ops.begin()+OpStart[ID+1]);
+      const Type *ResultTy;
+      if (ParseTypeRecord(Codes[ID], Record, ResultTy))
+        return true;
+      State[ID] = Done;
+
+      if (!HasPlaceholder[ID]) {
+        TypeList[ID] = ResultTy ? ResultTy : OpaqueType::get(Context);
+      } else if (ResultTy) {
+        // Replace the placeholder with the real type.  The refinement updates
+        // TypeList, and every type that was built on top of the placeholder.
+        const OpaqueType *OldTy = cast<OpaqueType>(TypeList[ID].get());
+        const_cast<OpaqueType*>(OldTy)->refineAbstractTypeTo(ResultTy);
+        assert(TypeList[ID].get() != OldTy &&
+               "refineAbstractType didn't work!");
+      }
+      // Otherwise the type is opaque itself, so the placeholder is the type.
     }
   }
+  return false;
 }
 
 
@@ -1257,6 +1342,54 @@ bool BitcodeReader::RememberAndSkipFunctionBody() {
   return false;
 }
 
+/// RememberAndSkipModuleBlock - Skip over a module-level constants or metadata
+/// block, remembering where it is so ParseDeferredModuleBlocks can read it
+/// when its contents are first needed.
+bool BitcodeReader::RememberAndSkipModuleBlock(unsigned BlockID) {
+  DeferredModuleBlocks.push_back(std::make_pair(BlockID,
+                                                Stream.GetCurrentBitNo()));
+  if (Stream.SkipBlock())
+    return Error("Malformed block record");
+  return false;
+}
+
+/// ParseDeferredModuleBlocks - Parse the module-level blocks skipped by
+/// RememberAndSkipModuleBlock, and set the initializers that refer to them.
+/// The stream position is preserved.
+bool BitcodeReader::ParseDeferredModuleBlocks() {
+  if (DeferredModuleBlocks.empty())
+    return false;
+
+  std::vector<std::pair<unsigned, uint64_t> > Blocks;
+  Blocks.swap(DeferredModuleBlocks);
+  GlobalsWithDeferredInits.clear();
+
+  uint64_t CurBit = Stream.GetCurrentBitNo();
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+    Stream.JumpToBit(Blocks[i].second);
+    if (Blocks[i].first == bitc::CONSTANTS_BLOCK_ID) {
+      if (ParseConstants() || ResolveGlobalAndAliasInits())
+        return true;
+    } else {
+      assert(Blocks[i].first == bitc::METADATA_BLOCK_ID &&
+             "Unexpected deferred block!");
+      if (ParseMetadata())
+        return true;
+    }
+  }
+  Stream.JumpToBit(CurBit);
+
+  // If the module has been read completely, every initializer must be known
+  // by now.
+  if (HasParsedModule) {
+    if (!GlobalInits.empty() || !AliasInits.empty())
+      return Error("Malformed global initializer set");
+    std::vector<std::pair<GlobalVariable*, unsigned> >().swap(GlobalInits);
+    std::vector<std::pair<GlobalAlias*, unsigned> >().swap(AliasInits);
+  }
+  return false;
+}
+
 bool BitcodeReader::ParseModule() {
   if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
     return Error("Malformed block record");
@@ -1272,12 +1405,19 @@ bool BitcodeReader::ParseModule() {
       if (Stream.ReadBlockEnd())
         return Error("Error at end of module block");
 
+      // Aliases must always have an aliasee, so if any of them refer to a
+      // deferred constant, read the constants now.
+      if (!AliasInits.empty() && ParseDeferredModuleBlocks())
+        return true;
+
       // Patch the initializers for globals and aliases up.
       ResolveGlobalAndAliasInits();
-      if (!GlobalInits.empty() || !AliasInits.empty())
+      if (DeferredModuleBlocks.empty() &&
+          (!GlobalInits.empty() || !AliasInits.empty()))
         return Error("Malformed global initializer set");
       if (!FunctionsWithBodies.empty())
         return Error("Too few function bodies found");
+      HasParsedModule = true;
 
       // Look for intrinsic functions which need to be upgraded at some point
       for (Module::iterator FI = TheModule->begin(), FE = TheModule->end();
@@ -1289,14 +1429,20 @@ bool BitcodeReader::ParseModule() {
 
       // Force deallocation of memory for these vectors to favor the client that
       // want lazy deserialization.
-      std::vector<std::pair<GlobalVariable*, unsigned> >().swap(GlobalInits);
-      std::vector<std::pair<GlobalAlias*, unsigned> >().swap(AliasInits);
+      if (DeferredModuleBlocks.empty()) {
+        std::vector<std::pair<GlobalVariable*, unsigned> >().swap(GlobalInits);
+        std::vector<std::pair<GlobalAlias*, unsigned> >().swap(AliasInits);
+      } else {
+        for (unsigned i = 0, e = GlobalInits.size(); i != e; ++i)
+          GlobalsWithDeferredInits.insert(GlobalInits[i].first);
+      }
       std::vector<Function*>().swap(FunctionsWithBodies);
       return false;
     }
 
     if (Code == bitc::ENTER_SUBBLOCK) {
-      switch (Stream.ReadSubBlockID()) {
+      unsigned BlockID = Stream.ReadSubBlockID();
+      switch (BlockID) {
       default:  // Skip unknown content.
         if (Stream.SkipBlock())
           return Error("Malformed block record");
@@ -1322,11 +1468,8 @@ bool BitcodeReader::ParseModule() {
           return true;
         break;
       case bitc::CONSTANTS_BLOCK_ID:
-        if (ParseConstants() || ResolveGlobalAndAliasInits())
-          return true;
-        break;
       case bitc::METADATA_BLOCK_ID:
-        if (ParseMetadata())
+        if (RememberAndSkipModuleBlock(BlockID))
           return true;
         break;
       case bitc::FUNCTION_BLOCK_ID:
@@ -1350,7 +1493,19 @@ bool BitcodeReader::ParseModule() {
     }
 
     // Read a record.
-    switch (Stream.ReadRecord(Code, Record)) {
+    unsigned RecordCode = Stream.ReadRecord(Code, Record);
+
+    // Module-level values are numbered in the order they appear, so a deferred
+    // constants block must be read before any value that follows it.
+    if (!DeferredModuleBlocks.empty() &&
+        (RecordCode == bitc::MODULE_CODE_GLOBALVAR ||
+         RecordCode == bitc::MODULE_CODE_FUNCTION ||
+         RecordCode == bitc::MODULE_CODE_ALIAS ||
+         RecordCode == bitc::MODULE_CODE_PURGEVALS) &&
+        ParseDeferredModuleBlocks())
+      return true;
+
+    switch (RecordCode) {
     default: break;  // Default behavior, ignore unknown content.
     case bitc::MODULE_CODE_VERSION:  // VERSION: [version#]
       if (Record.size() < 1)
@@ -2310,10 +2465,19 @@ bool BitcodeReader::isMaterializable(const GlobalValue *GV) const {
     return F->isDeclaration() &&
       DeferredFunctionInfo.count(const_cast<Function*>(F));
   }
+  if (const GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV))
+    return GlobalsWithDeferredInits.count(GVar);
   return false;
 }
 
 bool BitcodeReader::Materialize(GlobalValue *GV, std::string *ErrInfo) {
+  // Function bodies and global initializers may refer to module-level
+  // constants and metadata, so read those first.
+  if (isMaterializable(GV) && ParseDeferredModuleBlocks()) {
+    if (ErrInfo) *ErrInfo = ErrorString;
+    return true;
+  }
+
   Function *F = dyn_cast<Function>(GV);
   // If it's not a function or is already material, ignore the request.
   if (!F || !F->isMaterializable()) return false;
@@ -2367,6 +2531,11 @@ void BitcodeReader::Dematerialize(GlobalValue *GV) {
 bool BitcodeReader::MaterializeModule(Module *M, std::string *ErrInfo) {
   assert(M == TheModule &&
          "Can only Materialize the Module this BitcodeReader is attached to.");
+  if (ParseDeferredModuleBlocks()) {
+    if (ErrInfo) *ErrInfo = ErrorString;
+    return true;
+  }
+
   // Iterate over the module, deserializing any functions that are still on
   // disk.
   for (Module::iterator F = TheModule->begin(), E = TheModule->end();
@@ -22,6 +22,7 @@
 #include "llvm/Bitcode/LLVMBitCodes.h"
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include <vector>
 
 namespace llvm {
@@ -160,11 +161,25 @@ class BitcodeReader : public GVMaterializer {
   // After the module header has been read, the FunctionsWithBodies list is 
   // reversed.  This keeps track of whether we've done this yet.
   bool HasReversedFunctionsWithBodies;
+
+  // This is set once the end of the module block has been read.
+  bool HasParsedModule;
   
   /// DeferredFunctionInfo - When function bodies are initially scanned, this
   /// map contains info about where to find deferred function body in the
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
+
+  /// DeferredModuleBlocks - The module-level constants and metadata blocks are
+  /// not parsed when the module is read; this holds their block IDs and where
+  /// to find them in the stream, in file order.  They are parsed all at once
+  /// before the first function body or global initializer is materialized.
+  std::vector<std::pair<unsigned, uint64_t> > DeferredModuleBlocks;
+
+  /// GlobalsWithDeferredInits - The global variables whose initializers are
+  /// in the deferred constants blocks.  Until those are parsed, these look
+  /// like declarations and are materializable.
+  SmallPtrSet<const GlobalVariable*, 16> GlobalsWithDeferredInits;
   
   /// BlockAddrFwdRefs - These are blockaddr references to basic blocks.  These
   /// are resolved lazily when functions are loaded.
@@ -176,6 +191,7 @@ public:
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
       ErrorString(0), ValueList(C), MDValueList(C) {
     HasReversedFunctionsWithBodies = false;
+    HasParsedModule = false;
   }
   ~BitcodeReader() {
     FreeState();
@@ -252,10 +268,14 @@ private:
   bool ParseModule();
   bool ParseAttributeBlock();
   bool ParseTypeTable();
+  bool ParseTypeRecord(unsigned Code, const SmallVectorImpl<uint64_t> &Record,
+                       const Type *&ResultTy);
   bool ParseTypeSymbolTable();
   bool ParseValueSymbolTable();
   bool ParseConstants();
   bool RememberAndSkipFunctionBody();
+  bool RememberAndSkipModuleBlock(unsigned BlockID);
+  bool ParseDeferredModuleBlocks();
   bool ParseFunctionBody(Function *F);
   bool ResolveGlobalAndAliasInits();
   bool ParseMetadata();
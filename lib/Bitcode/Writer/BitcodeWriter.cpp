@@ -27,6 +27,7 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/System/Program.h"
+#include "llvm/System/Threading.h"
 using namespace llvm;
 
 /// These are manifest constants used by the bitcode writer. They do not need to
@@ -1217,10 +1218,9 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
   Stream.ExitBlock();
 }
 
-/// WriteFunction - Emit a function body to the module stream.
-static void WriteFunction(const Function &F, ValueEnumerator &VE,
-                          BitstreamWriter &Stream) {
-  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+/// WriteFunctionBody - Emit the contents of a function block to the stream.
+static void WriteFunctionBody(const Function &F, ValueEnumerator &VE,
+                              BitstreamWriter &Stream) {
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -1256,9 +1256,112 @@ static void WriteFunction(const Function &F, ValueEnumerator &VE,
 
   WriteMetadataAttachment(F, VE, Stream);
   VE.purgeFunction();
+}
+
+/// WriteFunction - Emit a function body to the module stream.
+static void WriteFunction(const Function &F, ValueEnumerator &VE,
+                          BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+  WriteFunctionBody(F, VE, Stream);
   Stream.ExitBlock();
 }
 
+namespace {
+  /// ParallelFunctionWriter - The state shared by the threads that encode
+  /// function blocks for WriteFunctionsInParallel.  Each thread encodes a
+  /// contiguous run of functions into its own buffer, using its own copy of
+  /// the module-level numbering.
+  struct ParallelFunctionWriter {
+    const ValueEnumerator &VE;
+    const BitstreamWriter &Stream;
+
+    /// Functions - The functions to write, in module order.
+    std::vector<const Function*> Functions;
+
+    /// FirstMDValues - For each function, the number of metadata values that
+    /// are numbered before its body is incorporated.
+    std::vector<unsigned> FirstMDValues;
+
+    /// RunStarts - Thread i writes Functions[RunStarts[i], RunStarts[i+1]).
+    std::vector<unsigned> RunStarts;
+
+    /// Buffers - The encoded function blocks of each thread.
+    std::vector<std::vector<unsigned char> > Buffers;
+
+    /// Contents - For each function, the range of its thread's buffer that
+    /// holds the function block's contents.
+    std::vector<std::pair<size_t, size_t> > Contents;
+
+    ParallelFunctionWriter(const ValueEnumerator &ve,
+                           const BitstreamWriter &stream)
+      : VE(ve), Stream(stream) {}
+  };
+}
+
+static void WriteFunctionRun(void *Arg, unsigned ThreadNo) {
+  ParallelFunctionWriter &PW = *static_cast<ParallelFunctionWriter*>(Arg);
+  unsigned Begin = PW.RunStarts[ThreadNo], End = PW.RunStarts[ThreadNo+1];
+  if (Begin == End)
+    return;
+
+  ValueEnumerator VE(PW.VE, PW.FirstMDValues[Begin]);
+  std::vector<unsigned char> &Buffer = PW.Buffers[ThreadNo];
+  BitstreamWriter Stream(Buffer);
+  Stream.CopyBlockInfo(PW.Stream);
+
+  for (unsigned i = Begin; i != End; ++i) {
+    Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+    // The contents start with the block size word EnterSubblock just emitted.
+    PW.Contents[i].first = Buffer.size()-4;
+    WriteFunctionBody(*PW.Functions[i], VE, Stream);
+    Stream.ExitBlock();
+    PW.Contents[i].second = Buffer.size();
+  }
+}
+
+/// WriteFunctionsInParallel - Emit the function bodies of M, encoding them on
+/// NumThreads threads.  The result is the same as calling WriteFunction for
+/// each of them in order.
+static void WriteFunctionsInParallel(const Module *M, ValueEnumerator &VE,
+                                     BitstreamWriter &Stream,
+                                     unsigned NumThreads) {
+  ParallelFunctionWriter PW(VE, Stream);
+
+  // Function-local metadata is numbered after the metadata of the functions
+  // written before it, so number the metadata of all of them up front.  Also
+  // count instructions to give each thread a similar amount of work.
+  std::vector<unsigned> InstCounts;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    PW.Functions.push_back(F);
+    PW.FirstMDValues.push_back(VE.getMDValues().size());
+    VE.incorporateFunctionMetadata(*F);
+
+    unsigned NumInsts = 0;
+    for (Function::const_iterator BB = F->begin(), BE = F->end();
+         BB != BE; ++BB)
+      NumInsts += BB->size();
+    InstCounts.push_back(NumInsts);
+  }
+
+  unsigned NumFunctions = PW.Functions.size();
+  NumThreads = llvm_split_into_runs(InstCounts, NumThreads, PW.RunStarts);
+
+  PW.Buffers.resize(NumThreads);
+  PW.Contents.resize(NumFunctions);
+  llvm_execute_on_threads(WriteFunctionRun, &PW, NumThreads);
+
+  for (unsigned i = 0, Run = 0; i != NumFunctions; ++i) {
+    while (i >= PW.RunStarts[Run+1])
+      ++Run;
+    const std::vector<unsigned char> &Buffer = PW.Buffers[Run];
+    Stream.EmitEncodedSubblock(bitc::FUNCTION_BLOCK_ID, 4,
+                 StringRef((const char*)&Buffer[0] + PW.Contents[i].first,
+                           PW.Contents[i].second - PW.Contents[i].first));
+  }
+}
+
 /// WriteTypeSymbolTable - Emit a block for the specified type symtab.
 static void WriteTypeSymbolTable(const TypeSymbolTable &TST,
                                  const ValueEnumerator &VE,
@@ -1462,7 +1565,8 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
 
 
 /// WriteModule - Emit the specified module to the bitstream.
-static void WriteModule(const Module *M, BitstreamWriter &Stream) {
+static void WriteModule(const Module *M, BitstreamWriter &Stream,
+                        unsigned NumThreads) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   // Emit the version number if it is non-zero.
@@ -1495,9 +1599,12 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   WriteModuleMetadata(VE, Stream);
 
   // Emit function bodies.
-  for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
-    if (!I->isDeclaration())
-      WriteFunction(*I, VE, Stream);
+  if (NumThreads > 1)
+    WriteFunctionsInParallel(M, VE, Stream, NumThreads);
+  else
+    for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
+      if (!I->isDeclaration())
+        WriteFunction(*I, VE, Stream);
 
   // Emit metadata.
   WriteModuleMetadataStore(M, Stream);
@@ -1614,13 +1721,14 @@ static void EmitDarwinBCTrailer(BitstreamWriter &Stream, unsigned BufferSize) {
 
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
-void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
+void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
+                              unsigned NumThreads) {
   std::vector<unsigned char> Buffer;
   BitstreamWriter Stream(Buffer);
 
   Buffer.reserve(256*1024);
 
-  WriteBitcodeToStream( M, Stream );
+  WriteBitcodeToStream(M, Stream, NumThreads);
 
   // If writing to stdout, set binary mode.
   if (&llvm::outs() == &Out)
@@ -1635,7 +1743,8 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
 
 /// WriteBitcodeToStream - Write the specified module to the specified output
 /// stream.
-void llvm::WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream) {
+void llvm::WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream,
+                                unsigned NumThreads) {
   // If this is darwin, emit a file header and trailer if needed.
   bool isDarwin = M->getTargetTriple().find("-darwin") != std::string::npos;
   if (isDarwin)
@@ -1650,7 +1759,7 @@ void llvm::WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream) {
   Stream.Emit(0xD, 4);
 
   // Emit the module.
-  WriteModule(M, Stream);
+  WriteModule(M, Stream, NumThreads);
 
   if (isDarwin)
     EmitDarwinBCTrailer(Stream, Stream.getBuffer().size());
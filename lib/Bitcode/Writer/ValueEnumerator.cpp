@@ -127,6 +127,19 @@ ValueEnumerator::ValueEnumerator(const Module *M) {
     TypeMap[Types[i].first] = i+1;
 }
 
+ValueEnumerator::ValueEnumerator(const ValueEnumerator &VE,
+                                 unsigned NumMDValues)
+  : TypeMap(VE.TypeMap), Types(VE.Types), ValueMap(VE.ValueMap),
+    Values(VE.Values), MDValues(VE.MDValues.begin(),
+                                VE.MDValues.begin()+NumMDValues),
+    MDValueMap(VE.MDValueMap), AttributeMap(VE.AttributeMap),
+    Attributes(VE.Attributes), InstructionCount(0) {
+  assert(VE.BasicBlocks.empty() && "Copying a function's numbering!");
+  assert(NumMDValues <= VE.MDValues.size() && "Not that many MD values!");
+  for (unsigned i = NumMDValues, e = VE.MDValues.size(); i != e; ++i)
+    MDValueMap.erase(VE.MDValues[i].first);
+}
+
 unsigned ValueEnumerator::getInstructionID(const Instruction *Inst) const {
   InstructionMapType::const_iterator I = InstructionMap.find(Inst);
   assert (I != InstructionMap.end() && "Instruction is not mapped!");
@@ -259,6 +272,23 @@ void ValueEnumerator::EnumerateMetadata(const Value *MD) {
   MDValueID = MDValues.size();
 }
 
+/// EnumerateMetadataOnly - Give MD and the metadata it refers to the same
+/// numbers as EnumerateMetadata, but don't enumerate any other values.
+void ValueEnumerator::EnumerateMetadataOnly(const Value *MD) {
+  unsigned &MDValueID = MDValueMap[MD];
+  if (MDValueID)
+    return;
+
+  MDValues.push_back(std::make_pair(MD, 1U));
+  MDValueID = MDValues.size();
+
+  if (const MDNode *N = dyn_cast<MDNode>(MD))
+    for (unsigned i = 0, e = N->getNumOperands(); i != e; ++i)
+      if (Value *V = N->getOperand(i))
+        if (isa<MDNode>(V) || isa<MDString>(V))
+          EnumerateMetadataOnly(V);
+}
+
 void ValueEnumerator::EnumerateValue(const Value *V) {
   assert(!V->getType()->isVoidTy() && "Can't insert void values!");
   if (isa<MDNode>(V) || isa<MDString>(V))
@@ -428,6 +458,16 @@ void ValueEnumerator::incorporateFunction(const Function &F) {
     EnumerateOperandType(FunctionLocalMDs[i]);
 }
 
+void ValueEnumerator::incorporateFunctionMetadata(const Function &F) {
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I!=E; ++I)
+      for (User::const_op_iterator OI = I->op_begin(), E = I->op_end();
+           OI != E; ++OI)
+        if (MDNode *MD = dyn_cast<MDNode>(*OI))
+          if (MD->isFunctionLocal() && MD->getFunction())
+            EnumerateMetadataOnly(MD);
+}
+
 void ValueEnumerator::purgeFunction() {
   /// Remove purged values from the ValueMap.
   for (unsigned i = NumModuleValues, e = Values.size(); i != e; ++i)
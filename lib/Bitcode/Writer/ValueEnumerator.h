@@ -78,6 +78,12 @@ private:
 public:
   ValueEnumerator(const Module *M);
 
+  /// ValueEnumerator - Copy the module-level numbering of VE, keeping only its
+  /// first NumMDValues metadata values.  VE must not have a function
+  /// incorporated.  The copy can incorporate functions independently of VE,
+  /// which lets function bodies be written on several threads.
+  ValueEnumerator(const ValueEnumerator &VE, unsigned NumMDValues);
+
   unsigned getValueID(const Value *V) const;
 
   unsigned getTypeID(const Type *T) const {
@@ -124,10 +130,17 @@ public:
   void incorporateFunction(const Function &F);
   void purgeFunction();
 
+  /// incorporateFunctionMetadata - Number the metadata that
+  /// incorporateFunction would add for F, without numbering anything else.
+  /// Function-local metadata stays in the table after purgeFunction, so this
+  /// tells how the metadata of later functions will be numbered.
+  void incorporateFunctionMetadata(const Function &F);
+
 private:
   void OptimizeConstants(unsigned CstStart, unsigned CstEnd);
     
   void EnumerateMetadata(const Value *MD);
+  void EnumerateMetadataOnly(const Value *MD);
   void EnumerateNamedMDNode(const NamedMDNode *NMD);
   void EnumerateValue(const Value *V);
   void EnumerateType(const Type *T);
@@ -137,14 +137,14 @@ void DwarfPrinter::EmitSLEB128(int Value, const char *Desc) const {
   if (Asm->VerboseAsm && Desc)
     Asm->OutStreamer.AddComment(Desc);
     
-  if (MAI->hasLEB128()) {
+  if (MAI->hasLEB128() && Asm->OutStreamer.hasRawTextSupport()) {
     // FIXME: MCize.
     O << "\t.sleb128\t" << Value;
     Asm->OutStreamer.AddBlankLine();
     return;
   }
 
-  // If we don't have .sleb128, emit as .bytes.
+  // If we don't have .sleb128, or are writing an object file, emit as .bytes.
   int Sign = Value >> (8 * sizeof(Value) - 1);
   bool IsMore;
   
@@ -163,14 +163,16 @@ void DwarfPrinter::EmitULEB128(unsigned Value, const char *Desc,
   if (Asm->VerboseAsm && Desc)
     Asm->OutStreamer.AddComment(Desc);
  
-  if (MAI->hasLEB128() && PadTo == 0) {
+  if (MAI->hasLEB128() && PadTo == 0 &&
+      Asm->OutStreamer.hasRawTextSupport()) {
     // FIXME: MCize.
     O << "\t.uleb128\t" << Value;
     Asm->OutStreamer.AddBlankLine();
     return;
   }
   
-  // If we don't have .uleb128 or we want to emit padding, emit as .bytes.
+  // If we don't have .uleb128, are writing an object file or want to emit
+  // padding, emit as .bytes.
   do {
     unsigned char Byte = static_cast<unsigned char>(Value & 0x7f);
     Value >>= 7;
@@ -79,13 +79,6 @@ static bool getVerboseAsm() {
   }      
 }
 
-// Enable or disable FastISel. Both options are needed, because
-// FastISel is enabled by default with -fast, and we wish to be
-// able to enable or disable fast-isel independently from -O0.
-static cl::opt<cl::boolOrDefault>
-EnableFastISelOption("fast-isel", cl::Hidden,
-  cl::desc("Enable the \"fast\" instruction selector"));
-
 // Enable or disable an experimental optimization to split GEPs
 // and run a special GVN pass which does not examine loads, in
 // an effort to factor out redundancy implicit in complex GEPs.
@@ -138,14 +131,35 @@ bool LLVMTargetMachine::addPassesToEmitFile(PassManagerBase &PM,
     break;
   }
   case CGFT_ObjectFile: {
+    Triple::OSType OS = Triple(TargetTriple).getOS();
+    switch (OS) {
+    case Triple::Cygwin:
+    case Triple::MinGW32:
+    case Triple::MinGW64:
+    case Triple::Win32:
+      // FIXME: COFF object files are not supported yet.
+      return true;
+    case Triple::Darwin:
+      break;
+    default:
+      // FIXME: The ELF writer has no GOT or PLT relocations yet, so it cannot
+      // write position independent code.
+      if (getRelocationModel() == Reloc::PIC_)
+        return true;
+      break;
+    }
+
     // Create the code emitter for the target if it exists.  If not, .o file
     // emission fails.
     MCCodeEmitter *MCE = getTarget().createCodeEmitter(*this, *Context);
     TargetAsmBackend *TAB = getTarget().createAsmBackend(TargetTriple);
     if (MCE == 0 || TAB == 0)
       return true;
-    
-    AsmStreamer.reset(createMachOStreamer(*Context, *TAB, Out, MCE));
+
+    if (OS == Triple::Darwin)
+      AsmStreamer.reset(createMachOStreamer(*Context, *TAB, Out, MCE));
+    else
+      AsmStreamer.reset(createELFStreamer(*Context, *TAB, Out, MCE));
     
     // Any output to the asmprinter's "O" stream is bad and needs to be fixed,
     // force it to come out stderr.
@@ -302,12 +316,8 @@ bool LLVMTargetMachine::addCommonCodeGenPasses(PassManagerBase &PM,
   // Set up a MachineFunction for the rest of CodeGen to work on.
   PM.add(new MachineFunctionAnalysis(*this, OptLevel));
 
-  // Enable FastISel with -fast, but allow that to be overridden.
-  if (EnableFastISelOption == cl::BOU_TRUE ||
-      (OptLevel == CodeGenOpt::None && EnableFastISelOption != cl::BOU_FALSE))
-    EnableFastISel = true;
-
-  // Ask the target for an isel.
+  // Ask the target for an isel.  Whether it uses FastISel depends on the
+  // OptLevel it is created with.
   if (addInstSelector(PM, OptLevel))
     return true;
 
@@ -30,6 +30,16 @@
 #include <algorithm>
 using namespace llvm;
 
+void VNInfo::KillSet::grow(unsigned MinCapacity) {
+  unsigned NewCapacity = std::max(MinCapacity, Capacity * 2);
+  SlotIndex *NewData = static_cast<SlotIndex*>(
+    Allocator->Allocate(NewCapacity * sizeof(SlotIndex),
+                        AlignOf<SlotIndex>::Alignment));
+  std::uninitialized_copy(Data, Data + Size, NewData);
+  Data = NewData;
+  Capacity = NewCapacity;
+}
+
 // An example for liveAt():
 //
 // this = [1,4), liveAt(0) will return false. The instruction defining this
@@ -121,6 +131,11 @@ bool LiveInterval::overlapsFrom(const LiveInterval& other,
     if (i->end > j->start)
       return true;
     ++i;
+
+    // Skip the ranges that end before j starts in one step, rather than
+    // walking through a long stretch of them one at a time.
+    if (i != ie && i->end <= j->start)
+      i = std::upper_bound(i, ie, j->start) - 1;
   }
 
   return false;
@@ -214,7 +229,10 @@ LiveInterval::extendIntervalStartTo(Ranges::iterator I, SlotIndex NewStart) {
 LiveInterval::iterator
 LiveInterval::addRangeFrom(LiveRange LR, iterator From) {
   SlotIndex Start = LR.start, End = LR.end;
-  iterator it = std::upper_bound(From, ranges.end(), Start);
+  // Intervals are built in instruction order, so most ranges are added at the
+  // end.  Avoid the search when nothing starts after LR.
+  iterator it = (!ranges.empty() && ranges.back().start <= Start) ?
+    ranges.end() : std::upper_bound(From, ranges.end(), Start);
 
   // If the inserted interval starts in the middle or right at the end of
   // another interval, just extend that interval to contain the range of LR.
@@ -364,6 +382,9 @@ void LiveInterval::removeValNo(VNInfo *ValNo) {
 /// specified index, or null if there is none.
 LiveInterval::const_iterator 
 LiveInterval::FindLiveRangeContaining(SlotIndex Idx) const {
+  if (empty() || Idx >= endIndex())
+    return end();
+
   const_iterator It = std::upper_bound(begin(), end(), Idx);
   if (It != ranges.begin()) {
     --It;
@@ -376,6 +397,9 @@ LiveInterval::FindLiveRangeContaining(SlotIndex Idx) const {
 
 LiveInterval::iterator 
 LiveInterval::FindLiveRangeContaining(SlotIndex Idx) {
+  if (empty() || Idx >= endIndex())
+    return end();
+
   iterator It = std::upper_bound(begin(), end(), Idx);
   if (It != begin()) {
     --It;
@@ -0,0 +1,69 @@
+//===-- LiveIntervalUnion.cpp - Live intervals of one register ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements LiveIntervalUnion, the union of the live ranges of all
+// virtual registers assigned to a single physical register.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LiveIntervalUnion.h"
+#include "llvm/CodeGen/LiveInterval.h"
+#include <algorithm>
+
+using namespace llvm;
+
+void LiveIntervalUnion::unify(LiveInterval &LI) {
+  SegmentMap::iterator Hint = Segments.end();
+  for (LiveInterval::iterator I = LI.begin(), E = LI.end(); I != E; ++I) {
+    // The ranges of LI are sorted, so each one goes right after the last.
+    Hint = Segments.insert(Hint, std::make_pair(I->start,
+                                                Segment(I->end, &LI)));
+    assert(Hint->second.LI == &LI && "Interval overlaps the union!");
+  }
+}
+
+void LiveIntervalUnion::extract(LiveInterval &LI) {
+  for (LiveInterval::iterator I = LI.begin(), E = LI.end(); I != E; ++I) {
+    SegmentMap::iterator SI = Segments.find(I->start);
+    assert(SI != Segments.end() && SI->second.LI == &LI &&
+           "Interval was not in the union!");
+    Segments.erase(SI);
+  }
+}
+
+bool LiveIntervalUnion::collectInterferences(const LiveInterval &LI,
+                                SmallVectorImpl<LiveInterval*> &Intervals) const {
+  unsigned NumFound = Intervals.size();
+  if (Segments.empty())
+    return false;
+  SlotIndex UnionEnd = (--Segments.end())->second.End;
+
+  for (LiveInterval::const_iterator I = LI.begin(), E = LI.end(); I != E; ++I) {
+    if (I->start >= UnionEnd)
+      break;
+
+    // The segments are disjoint, so only the one starting before I->start can
+    // reach into the range from the left; the rest start inside it.
+    iterator SI = Segments.upper_bound(I->start);
+    if (SI != Segments.begin()) {
+      iterator Prev = SI;
+      --Prev;
+      if (Prev->second.End > I->start)
+        SI = Prev;
+    }
+
+    for (; SI != Segments.end() && SI->first < I->end; ++SI) {
+      LiveInterval *Other = SI->second.LI;
+      if (std::find(Intervals.begin() + NumFound, Intervals.end(), Other) ==
+          Intervals.end())
+        Intervals.push_back(Other);
+    }
+  }
+  return Intervals.size() != NumFound;
+}
@@ -0,0 +1,73 @@
+//===-- LiveIntervalUnion.h - Live intervals of one register ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares LiveIntervalUnion, the union of the live ranges of all
+// virtual registers assigned to a single physical register.  The ranges are
+// kept in a balanced tree ordered by SlotIndex, so the intervals interfering
+// with a candidate interval can be found in logarithmic time instead of by
+// scanning every allocated interval.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_LIVEINTERVALUNION_H
+#define LLVM_CODEGEN_LIVEINTERVALUNION_H
+
+#include "llvm/CodeGen/SlotIndexes.h"
+#include "llvm/ADT/SmallVector.h"
+#include <map>
+
+namespace llvm {
+
+  class LiveInterval;
+
+  /// LiveIntervalUnion - The live ranges of the intervals assigned to one
+  /// physical register.  Intervals assigned to the same register never
+  /// overlap, so the ranges in the union are disjoint and ordering them by
+  /// start index also orders them by end index.
+  class LiveIntervalUnion {
+  public:
+    /// Segment - A live range in the union, keyed by its start index.
+    struct Segment {
+      SlotIndex End;       // End of the range (exclusive).
+      LiveInterval *LI;    // The interval the range belongs to.
+
+      Segment(SlotIndex E, LiveInterval *L) : End(E), LI(L) {}
+    };
+
+    typedef std::map<SlotIndex, Segment> SegmentMap;
+    typedef SegmentMap::const_iterator iterator;
+
+  private:
+    SegmentMap Segments;
+
+  public:
+    iterator begin() const { return Segments.begin(); }
+    iterator end() const { return Segments.end(); }
+
+    bool empty() const { return Segments.empty(); }
+    unsigned size() const { return Segments.size(); }
+    void clear() { Segments.clear(); }
+
+    /// unify - Add the live ranges of LI to the union.  LI must not overlap
+    /// any interval already in the union.
+    void unify(LiveInterval &LI);
+
+    /// extract - Remove the live ranges of LI from the union.  LI must have
+    /// been added with unify and its ranges must not have changed since.
+    void extract(LiveInterval &LI);
+
+    /// collectInterferences - Append each interval in the union that overlaps
+    /// LI to Intervals, once.  Return true if any interval was found.
+    bool collectInterferences(const LiveInterval &LI,
+                              SmallVectorImpl<LiveInterval*> &Intervals) const;
+  };
+
+}
+
+#endif
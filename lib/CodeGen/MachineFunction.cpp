@@ -84,9 +84,11 @@ void ilist_traits<MachineBasicBlock>::deleteNode(MachineBasicBlock *MBB) {
   MBB->getParent()->DeleteMachineBasicBlock(MBB);
 }
 
+// The operand arrays of calls run to a few KB, so Allocator uses slabs large
+// enough that the tail left behind when one doesn't fit is small.
 MachineFunction::MachineFunction(Function *F, const TargetMachine &TM,
                                  unsigned FunctionNum, MCContext &ctx)
-  : Fn(F), Target(TM), Ctx(ctx) {
+  : Fn(F), Target(TM), Ctx(ctx), Allocator(16384, 16384) {
   if (TM.getRegisterInfo())
     RegInfo = new (Allocator.Allocate<MachineRegisterInfo>())
                   MachineRegisterInfo(*TM.getRegisterInfo());
@@ -108,6 +110,7 @@ MachineFunction::MachineFunction(Function *F, const TargetMachine &TM,
 MachineFunction::~MachineFunction() {
   BasicBlocks.clear();
   InstructionRecycler.clear(Allocator);
+  OperandRecycler.clear(Allocator);
   BasicBlockRecycler.clear(Allocator);
   if (RegInfo) {
     RegInfo->~MachineRegisterInfo();
@@ -186,7 +189,7 @@ MachineInstr *
 MachineFunction::CreateMachineInstr(const TargetInstrDesc &TID,
                                     DebugLoc DL, bool NoImp) {
   return new (InstructionRecycler.Allocate<MachineInstr>(Allocator))
-    MachineInstr(TID, DL, NoImp);
+    MachineInstr(*this, TID, DL, NoImp);
 }
 
 /// CloneMachineInstr - Create a new MachineInstr which is a copy of the
@@ -203,7 +206,12 @@ MachineFunction::CloneMachineInstr(const MachineInstr *Orig) {
 ///
 void
 MachineFunction::DeleteMachineInstr(MachineInstr *MI) {
+  // The operand array and the MI object itself are recycled separately.
+  MachineOperand *Operands = MI->Operands;
+  OperandCapacity CapOperands = MI->CapOperands;
   MI->~MachineInstr();
+  if (Operands)
+    deallocateOperandArray(CapOperands, Operands);
   InstructionRecycler.Deallocate(Allocator, MI);
 }
 
@@ -394,8 +394,9 @@ raw_ostream &llvm::operator<<(raw_ostream &OS, const MachineMemOperand &MMO) {
 /// MachineInstr ctor - This constructor creates a dummy MachineInstr with
 /// TID NULL and no operands.
 MachineInstr::MachineInstr()
-  : TID(0), NumImplicitOps(0), AsmPrinterFlags(0), MemRefs(0), MemRefsEnd(0),
-    Parent(0), debugLoc(DebugLoc::getUnknownLoc()) {
+  : TID(0), NumImplicitOps(0), AsmPrinterFlags(0), NumOperands(0), Operands(0),
+    MF(0), MemRefs(0), MemRefsEnd(0), Parent(0),
+    debugLoc(DebugLoc::getUnknownLoc()) {
   // Make sure that we get added to a machine basicblock
   LeakDetector::addGarbageObject(this);
 }
@@ -413,48 +414,33 @@ void MachineInstr::addImplicitDefUseOperands() {
 /// implicit operands. It reserves space for number of operands specified by
 /// TargetInstrDesc or the numOperands if it is not zero. (for
 /// instructions with variable number of operands).
-MachineInstr::MachineInstr(const TargetInstrDesc &tid, bool NoImp)
-  : TID(&tid), NumImplicitOps(0), AsmPrinterFlags(0),
-    MemRefs(0), MemRefsEnd(0), Parent(0),
-    debugLoc(DebugLoc::getUnknownLoc()) {
-  if (!NoImp && TID->getImplicitDefs())
-    for (const unsigned *ImpDefs = TID->getImplicitDefs(); *ImpDefs; ++ImpDefs)
-      NumImplicitOps++;
-  if (!NoImp && TID->getImplicitUses())
-    for (const unsigned *ImpUses = TID->getImplicitUses(); *ImpUses; ++ImpUses)
-      NumImplicitOps++;
-  Operands.reserve(NumImplicitOps + TID->getNumOperands());
-  if (!NoImp)
-    addImplicitDefUseOperands();
-  // Make sure that we get added to a machine basicblock
-  LeakDetector::addGarbageObject(this);
-}
-
-/// MachineInstr ctor - As above, but with a DebugLoc.
-MachineInstr::MachineInstr(const TargetInstrDesc &tid, const DebugLoc dl,
-                           bool NoImp)
-  : TID(&tid), NumImplicitOps(0), AsmPrinterFlags(0), MemRefs(0), MemRefsEnd(0),
-    Parent(0), debugLoc(dl) {
+MachineInstr::MachineInstr(MachineFunction &mf, const TargetInstrDesc &tid,
+                           const DebugLoc dl, bool NoImp)
+  : TID(&tid), NumImplicitOps(0), AsmPrinterFlags(0), NumOperands(0),
+    Operands(0), MF(&mf), MemRefs(0), MemRefsEnd(0), Parent(0), debugLoc(dl) {
   if (!NoImp && TID->getImplicitDefs())
     for (const unsigned *ImpDefs = TID->getImplicitDefs(); *ImpDefs; ++ImpDefs)
       NumImplicitOps++;
   if (!NoImp && TID->getImplicitUses())
     for (const unsigned *ImpUses = TID->getImplicitUses(); *ImpUses; ++ImpUses)
       NumImplicitOps++;
-  Operands.reserve(NumImplicitOps + TID->getNumOperands());
+  if (unsigned NumOps = NumImplicitOps + TID->getNumOperands()) {
+    CapOperands = OperandCapacity::get(NumOps);
+    Operands = MF->allocateOperandArray(CapOperands);
+  }
   if (!NoImp)
     addImplicitDefUseOperands();
   // Make sure that we get added to a machine basicblock
   LeakDetector::addGarbageObject(this);
 }
 
-/// MachineInstr ctor - Work exactly the same as the ctor two above, except
-/// that the MachineInstr is created and added to the end of the specified 
-/// basic block.
+/// MachineInstr ctor - Work exactly the same as the ctor above, except that
+/// the MachineInstr is created and added to the end of the specified basic
+/// block.
 ///
 MachineInstr::MachineInstr(MachineBasicBlock *MBB, const TargetInstrDesc &tid)
-  : TID(&tid), NumImplicitOps(0), AsmPrinterFlags(0),
-    MemRefs(0), MemRefsEnd(0), Parent(0), 
+  : TID(&tid), NumImplicitOps(0), AsmPrinterFlags(0), NumOperands(0),
+    Operands(0), MF(MBB->getParent()), MemRefs(0), MemRefsEnd(0), Parent(0),
     debugLoc(DebugLoc::getUnknownLoc()) {
   assert(MBB && "Cannot use inserting ctor with null basic block!");
   if (TID->ImplicitDefs)
@@ -463,7 +449,10 @@ MachineInstr::MachineInstr(MachineBasicBlock *MBB, const TargetInstrDesc &tid)
   if (TID->ImplicitUses)
     for (const unsigned *ImpUses = TID->getImplicitUses(); *ImpUses; ++ImpUses)
       NumImplicitOps++;
-  Operands.reserve(NumImplicitOps + TID->getNumOperands());
+  if (unsigned NumOps = NumImplicitOps + TID->getNumOperands()) {
+    CapOperands = OperandCapacity::get(NumOps);
+    Operands = MF->allocateOperandArray(CapOperands);
+  }
   addImplicitDefUseOperands();
   // Make sure that we get added to a machine basicblock
   LeakDetector::addGarbageObject(this);
@@ -474,8 +463,9 @@ MachineInstr::MachineInstr(MachineBasicBlock *MBB, const TargetInstrDesc &tid)
 ///
 MachineInstr::MachineInstr(MachineBasicBlock *MBB, const DebugLoc dl,
                            const TargetInstrDesc &tid)
-  : TID(&tid), NumImplicitOps(0), AsmPrinterFlags(0), MemRefs(0), MemRefsEnd(0),
-    Parent(0), debugLoc(dl) {
+  : TID(&tid), NumImplicitOps(0), AsmPrinterFlags(0), NumOperands(0),
+    Operands(0), MF(MBB->getParent()), MemRefs(0), MemRefsEnd(0), Parent(0),
+    debugLoc(dl) {
   assert(MBB && "Cannot use inserting ctor with null basic block!");
   if (TID->ImplicitDefs)
     for (const unsigned *ImpDefs = TID->getImplicitDefs(); *ImpDefs; ++ImpDefs)
@@ -483,7 +473,10 @@ MachineInstr::MachineInstr(MachineBasicBlock *MBB, const DebugLoc dl,
   if (TID->ImplicitUses)
     for (const unsigned *ImpUses = TID->getImplicitUses(); *ImpUses; ++ImpUses)
       NumImplicitOps++;
-  Operands.reserve(NumImplicitOps + TID->getNumOperands());
+  if (unsigned NumOps = NumImplicitOps + TID->getNumOperands()) {
+    CapOperands = OperandCapacity::get(NumOps);
+    Operands = MF->allocateOperandArray(CapOperands);
+  }
   addImplicitDefUseOperands();
   // Make sure that we get added to a machine basicblock
   LeakDetector::addGarbageObject(this);
@@ -492,11 +485,14 @@ MachineInstr::MachineInstr(MachineBasicBlock *MBB, const DebugLoc dl,
 
 /// MachineInstr ctor - Copies MachineInstr arg exactly
 ///
-MachineInstr::MachineInstr(MachineFunction &MF, const MachineInstr &MI)
-  : TID(&MI.getDesc()), NumImplicitOps(0), AsmPrinterFlags(0),
-    MemRefs(MI.MemRefs), MemRefsEnd(MI.MemRefsEnd),
+MachineInstr::MachineInstr(MachineFunction &mf, const MachineInstr &MI)
+  : TID(&MI.getDesc()), NumImplicitOps(0), AsmPrinterFlags(0), NumOperands(0),
+    Operands(0), MF(&mf), MemRefs(MI.MemRefs), MemRefsEnd(MI.MemRefsEnd),
     Parent(0), debugLoc(MI.getDebugLoc()) {
-  Operands.reserve(MI.getNumOperands());
+  if (unsigned NumOps = MI.getNumOperands()) {
+    CapOperands = OperandCapacity::get(NumOps);
+    Operands = MF->allocateOperandArray(CapOperands);
+  }
 
   // Add operands
   for (unsigned i = 0; i != MI.getNumOperands(); ++i)
@@ -512,7 +508,7 @@ MachineInstr::MachineInstr(MachineFunction &MF, const MachineInstr &MI)
 MachineInstr::~MachineInstr() {
   LeakDetector::removeGarbageObject(this);
 #ifndef NDEBUG
-  for (unsigned i = 0, e = Operands.size(); i != e; ++i) {
+  for (unsigned i = 0, e = NumOperands; i != e; ++i) {
     assert(Operands[i].ParentMI == this && "ParentMI mismatch!");
     assert((!Operands[i].isReg() || !Operands[i].isOnRegUseList()) &&
            "Reg operand def/use list corrupted");
@@ -533,7 +529,7 @@ MachineRegisterInfo *MachineInstr::getRegInfo() {
 /// this instruction from their respective use lists.  This requires that the
 /// operands already be on their use lists.
 void MachineInstr::RemoveRegOperandsFromUseLists() {
-  for (unsigned i = 0, e = Operands.size(); i != e; ++i) {
+  for (unsigned i = 0, e = NumOperands; i != e; ++i) {
     if (Operands[i].isReg())
       Operands[i].RemoveRegOperandFromRegInfo();
   }
@@ -543,13 +539,43 @@ void MachineInstr::RemoveRegOperandsFromUseLists() {
 /// this instruction from their respective use lists.  This requires that the
 /// operands not be on their use lists yet.
 void MachineInstr::AddRegOperandsToUseLists(MachineRegisterInfo &RegInfo) {
-  for (unsigned i = 0, e = Operands.size(); i != e; ++i) {
+  for (unsigned i = 0, e = NumOperands; i != e; ++i) {
     if (Operands[i].isReg())
       Operands[i].AddRegOperandToRegInfo(&RegInfo);
   }
 }
 
 
+/// moveOperands - Move NumOps operands from Src to Dst, updating the use
+/// lists of the register operands to point at their new location.  The ranges
+/// may overlap.
+void MachineInstr::moveOperands(MachineOperand *Dst, MachineOperand *Src,
+                                unsigned NumOps) {
+  if (Dst == Src || NumOps == 0)
+    return;
+
+  // Copy backwards if Dst is within the Src range.
+  int Stride = 1;
+  if (Dst > Src && Dst < Src + NumOps) {
+    Stride = -1;
+    Dst += NumOps - 1;
+    Src += NumOps - 1;
+  }
+
+  // Copy one operand at a time, and let it take the place of the original on
+  // its use list.  Operands that are not on a list have null links.
+  do {
+    new (Dst) MachineOperand(*Src);
+    if (Dst->isReg() && Dst->isOnRegUseList()) {
+      *Dst->Contents.Reg.Prev = Dst;
+      if (MachineOperand *Next = Dst->Contents.Reg.Next)
+        Next->Contents.Reg.Prev = &Dst->Contents.Reg.Next;
+    }
+    Dst += Stride;
+    Src += Stride;
+  } while (--NumOps);
+}
+
 /// addOperand - Add the specified operand to the instruction.  If it is an
 /// implicit operand, it is added to the end of the operand list.  If it is
 /// an explicit operand it is added at the end of the explicit operand list
@@ -559,96 +585,40 @@ void MachineInstr::addOperand(const MachineOperand &Op) {
   assert((isImpReg || !OperandsComplete()) &&
          "Trying to add an operand to a machine instr that is already done!");
 
-  MachineRegisterInfo *RegInfo = getRegInfo();
-
-  // If we are adding the operand to the end of the list, our job is simpler.
-  // This is true most of the time, so this is a reasonable optimization.
-  if (isImpReg || NumImplicitOps == 0) {
-    // We can only do this optimization if we know that the operand list won't
-    // reallocate.
-    if (Operands.empty() || Operands.size()+1 <= Operands.capacity()) {
-      Operands.push_back(Op);
-    
-      // Set the parent of the operand.
-      Operands.back().ParentMI = this;
-  
-      // If the operand is a register, update the operand's use list.
-      if (Op.isReg()) {
-        Operands.back().AddRegOperandToRegInfo(RegInfo);
-        // If the register operand is flagged as early, mark the operand as such
-        unsigned OpNo = Operands.size() - 1;
-        if (TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
-          Operands[OpNo].setIsEarlyClobber(true);
-      }
-      return;
-    }
+  // Find the position of the new operand.
+  unsigned OpNo = NumOperands;
+  if (!isImpReg)
+    OpNo -= NumImplicitOps;
+
+  // If the operand array is full, move the operands in front of the new one
+  // to an array twice the size.
+  MachineOperand *OldOperands = Operands;
+  OperandCapacity OldCap = CapOperands;
+  if (!OldOperands || NumOperands == OldCap.getSize()) {
+    CapOperands = OldOperands ? OldCap.getNext() : OperandCapacity::get(1);
+    Operands = MF->allocateOperandArray(CapOperands);
+    moveOperands(Operands, OldOperands, OpNo);
   }
-  
-  // Otherwise, we have to insert a real operand before any implicit ones.
-  unsigned OpNo = Operands.size()-NumImplicitOps;
-
-  // If this instruction isn't embedded into a function, then we don't need to
-  // update any operand lists.
-  if (RegInfo == 0) {
-    // Simple insertion, no reginfo update needed for other register operands.
-    Operands.insert(Operands.begin()+OpNo, Op);
-    Operands[OpNo].ParentMI = this;
-
-    // Do explicitly set the reginfo for this operand though, to ensure the
-    // next/prev fields are properly nulled out.
-    if (Operands[OpNo].isReg()) {
-      Operands[OpNo].AddRegOperandToRegInfo(0);
-      // If the register operand is flagged as early, mark the operand as such
-      if (TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
-        Operands[OpNo].setIsEarlyClobber(true);
-    }
 
-  } else if (Operands.size()+1 <= Operands.capacity()) {
-    // Otherwise, we have to remove register operands from their register use
-    // list, add the operand, then add the register operands back to their use
-    // list.  This also must handle the case when the operand list reallocates
-    // to somewhere else.
-  
-    // If insertion of this operand won't cause reallocation of the operand
-    // list, just remove the implicit operands, add the operand, then re-add all
-    // the rest of the operands.
-    for (unsigned i = OpNo, e = Operands.size(); i != e; ++i) {
-      assert(Operands[i].isReg() && "Should only be an implicit reg!");
-      Operands[i].RemoveRegOperandFromRegInfo();
-    }
-    
-    // Add the operand.  If it is a register, add it to the reg list.
-    Operands.insert(Operands.begin()+OpNo, Op);
-    Operands[OpNo].ParentMI = this;
-
-    if (Operands[OpNo].isReg()) {
-      Operands[OpNo].AddRegOperandToRegInfo(RegInfo);
-      // If the register operand is flagged as early, mark the operand as such
-      if (TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
-        Operands[OpNo].setIsEarlyClobber(true);
-    }
-    
-    // Re-add all the implicit ops.
-    for (unsigned i = OpNo+1, e = Operands.size(); i != e; ++i) {
-      assert(Operands[i].isReg() && "Should only be an implicit reg!");
-      Operands[i].AddRegOperandToRegInfo(RegInfo);
-    }
-  } else {
-    // Otherwise, we will be reallocating the operand list.  Remove all reg
-    // operands from their list, then readd them after the operand list is
-    // reallocated.
-    RemoveRegOperandsFromUseLists();
-    
-    Operands.insert(Operands.begin()+OpNo, Op);
-    Operands[OpNo].ParentMI = this;
-  
-    // Re-add all the operands.
-    AddRegOperandsToUseLists(*RegInfo);
-
-      // If the register operand is flagged as early, mark the operand as such
-    if (Operands[OpNo].isReg()
-        && TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
-      Operands[OpNo].setIsEarlyClobber(true);
+  // Move the operands after the new one up a slot.
+  if (OpNo != NumOperands)
+    moveOperands(Operands + OpNo + 1, OldOperands + OpNo, NumOperands - OpNo);
+  ++NumOperands;
+
+  if (OldOperands && OldOperands != Operands)
+    MF->deallocateOperandArray(OldCap, OldOperands);
+
+  // Copy Op into place and set its parent.
+  MachineOperand *NewMO = new (Operands + OpNo) MachineOperand(Op);
+  NewMO->ParentMI = this;
+
+  // If the operand is a register, update the operand's use list.  Without
+  // reginfo this just nulls out the links.
+  if (NewMO->isReg()) {
+    NewMO->AddRegOperandToRegInfo(getRegInfo());
+    // If the register operand is flagged as early, mark the operand as such
+    if (TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
+      NewMO->setIsEarlyClobber(true);
   }
 }
 
@@ -656,37 +626,16 @@ void MachineInstr::addOperand(const MachineOperand &Op) {
 /// fewer operand than it started with.
 ///
 void MachineInstr::RemoveOperand(unsigned OpNo) {
-  assert(OpNo < Operands.size() && "Invalid operand number");
-  
-  // Special case removing the last one.
-  if (OpNo == Operands.size()-1) {
-    // If needed, remove from the reg def/use list.
-    if (Operands.back().isReg() && Operands.back().isOnRegUseList())
-      Operands.back().RemoveRegOperandFromRegInfo();
-    
-    Operands.pop_back();
-    return;
-  }
+  assert(OpNo < NumOperands && "Invalid operand number");
 
-  // Otherwise, we are removing an interior operand.  If we have reginfo to
-  // update, remove all operands that will be shifted down from their reg lists,
-  // move everything down, then re-add them.
-  MachineRegisterInfo *RegInfo = getRegInfo();
-  if (RegInfo) {
-    for (unsigned i = OpNo, e = Operands.size(); i != e; ++i) {
-      if (Operands[i].isReg())
-        Operands[i].RemoveRegOperandFromRegInfo();
-    }
-  }
-  
-  Operands.erase(Operands.begin()+OpNo);
+  // If needed, remove from the reg def/use list.
+  MachineOperand &MO = Operands[OpNo];
+  if (MO.isReg() && MO.isOnRegUseList())
+    MO.RemoveRegOperandFromRegInfo();
 
-  if (RegInfo) {
-    for (unsigned i = OpNo, e = Operands.size(); i != e; ++i) {
-      if (Operands[i].isReg())
-        Operands[i].AddRegOperandToRegInfo(RegInfo);
-    }
-  }
+  // Move the operands after it down a slot.  They stay on their use lists.
+  moveOperands(Operands + OpNo, Operands + OpNo + 1, NumOperands - OpNo - 1);
+  --NumOperands;
 }
 
 /// addMemOperand - Add a MachineMemOperand to the machine instruction.
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "regalloc"
+#include "LiveIntervalUnion.h"
 #include "VirtRegMap.h"
 #include "VirtRegRewriter.h"
 #include "Spiller.h"
@@ -141,9 +142,21 @@ namespace {
     IntervalPtrs active_;
 
     /// inactive_ - Intervals that are currently being processed, but which have
-    /// a hold at the current point.
+    /// a hole at the current point.  This is kept as a heap ordered by the
+    /// start of the live range each interval resumes at, so that advancing the
+    /// current point only visits the intervals that become live again.
     IntervalPtrs inactive_;
 
+    /// inactiveCounts_ - The number of intervals in inactive_ assigned to each
+    /// physical register.
+    SmallVector<unsigned, 32> inactiveCounts_;
+
+    /// unions_ - The live ranges of the allocated intervals, grouped by the
+    /// physical register they are assigned to.  Used to find the inactive
+    /// intervals that interfere with the current one without scanning all of
+    /// inactive_.
+    std::vector<LiveIntervalUnion> unions_;
+
     typedef std::priority_queue<LiveInterval*,
                                 SmallVector<LiveInterval*, 64>,
                                 greater_ptr<LiveInterval> > IntervalHeap;
@@ -226,6 +239,11 @@ namespace {
     /// ones to the active list.
     void processInactiveIntervals(SlotIndex CurPoint);
 
+    /// addInactive - Add an interval assigned to the physical register PhysReg
+    /// to the inactive heap.
+    void addInactive(LiveInterval *Interval, LiveInterval::iterator Pos,
+                     unsigned PhysReg);
+
     /// hasNextReloadInterval - Return the next liveinterval that's being
     /// defined by a reload from the same SS as the specified one.
     LiveInterval *hasNextReloadInterval(LiveInterval *cur);
@@ -269,6 +287,8 @@ namespace {
     void initRegUses() {
       regUse_.resize(tri_->getNumRegs(), 0);
       regUseBackUp_.resize(tri_->getNumRegs(), 0);
+      inactiveCounts_.resize(tri_->getNumRegs(), 0);
+      unions_.resize(tri_->getNumRegs());
     }
 
     void finalizeRegUses() {
@@ -286,6 +306,8 @@ namespace {
 #endif
       regUse_.clear();
       regUseBackUp_.clear();
+      inactiveCounts_.clear();
+      unions_.clear();
     }
 
     void addRegUse(unsigned physReg) {
@@ -331,7 +353,6 @@ namespace {
     unsigned getFreePhysReg(LiveInterval* cur,
                             const TargetRegisterClass *RC,
                             unsigned MaxInactiveCount,
-                            SmallVector<unsigned, 256> &inactiveCounts,
                             bool SkipDGRegs);
 
     void ComputeRelatedRegClasses();
@@ -355,6 +376,15 @@ namespace {
     }
   };
   char RALinScan::ID = 0;
+
+  /// InactiveOrder - Heap order for inactive_: the interval whose next live
+  /// range starts first is on top.
+  struct InactiveOrder {
+    bool operator()(const RALinScan::IntervalPtr &LHS,
+                    const RALinScan::IntervalPtr &RHS) const {
+      return LHS.second->start > RHS.second->start;
+    }
+  };
 }
 
 static RegisterPass<RALinScan>
@@ -667,7 +697,7 @@ void RALinScan::processActiveIntervals(SlotIndex CurPoint)
       reg = vrm_->getPhys(reg);
       delRegUse(reg);
       // add to inactive.
-      inactive_.push_back(std::make_pair(Interval, IntervalPos));
+      addInactive(Interval, IntervalPos, reg);
 
       // Pop off the end of the list.
       active_[i] = active_.back();
@@ -686,41 +716,48 @@ void RALinScan::processInactiveIntervals(SlotIndex CurPoint)
 {
   DEBUG(dbgs() << "\tprocessing inactive intervals:\n");
 
-  for (unsigned i = 0, e = inactive_.size(); i != e; ++i) {
-    LiveInterval *Interval = inactive_[i].first;
-    LiveInterval::iterator IntervalPos = inactive_[i].second;
+  // Intervals whose next live range starts after CurPoint stay inactive, and
+  // the heap keeps them below the ones that have to be looked at.
+  while (!inactive_.empty() && inactive_.front().second->start <= CurPoint) {
+    std::pop_heap(inactive_.begin(), inactive_.end(), InactiveOrder());
+    LiveInterval *Interval = inactive_.back().first;
+    LiveInterval::iterator IntervalPos = inactive_.back().second;
+    inactive_.pop_back();
     unsigned reg = Interval->reg;
+    assert(TargetRegisterInfo::isVirtualRegister(reg) &&
+           "Can only allocate virtual registers!");
+    reg = vrm_->getPhys(reg);
 
     IntervalPos = Interval->advanceTo(IntervalPos, CurPoint);
 
     if (IntervalPos == Interval->end()) {       // remove expired intervals.
       DEBUG(dbgs() << "\t\tinterval " << *Interval << " expired\n");
-
-      // Pop off the end of the list.
-      inactive_[i] = inactive_.back();
-      inactive_.pop_back();
-      --i; --e;
+      --inactiveCounts_[reg];
     } else if (IntervalPos->start <= CurPoint) {
       // move re-activated intervals in active list
       DEBUG(dbgs() << "\t\tinterval " << *Interval << " active\n");
-      assert(TargetRegisterInfo::isVirtualRegister(reg) &&
-             "Can only allocate virtual registers!");
-      reg = vrm_->getPhys(reg);
+      --inactiveCounts_[reg];
       addRegUse(reg);
       // add to active
       active_.push_back(std::make_pair(Interval, IntervalPos));
-
-      // Pop off the end of the list.
-      inactive_[i] = inactive_.back();
-      inactive_.pop_back();
-      --i; --e;
     } else {
-      // Otherwise, just update the iterator position.
-      inactive_[i].second = IntervalPos;
+      // Otherwise, the interval skipped to a later hole; requeue it at the
+      // start of its next live range.
+      inactive_.push_back(std::make_pair(Interval, IntervalPos));
+      std::push_heap(inactive_.begin(), inactive_.end(), InactiveOrder());
     }
   }
 }
 
+/// addInactive - Add an interval assigned to the physical register PhysReg
+/// to the inactive heap.
+void RALinScan::addInactive(LiveInterval *Interval, LiveInterval::iterator Pos,
+                            unsigned PhysReg) {
+  inactive_.push_back(std::make_pair(Interval, Pos));
+  std::push_heap(inactive_.begin(), inactive_.end(), InactiveOrder());
+  ++inactiveCounts_[PhysReg];
+}
+
 /// updateSpillWeights - updates the spill weights of the specifed physical
 /// register and its weight.
 void RALinScan::updateSpillWeights(std::vector<float> &Weights,
@@ -997,20 +1034,27 @@ void RALinScan::assignRegOrStackSlotAtInterval(LiveInterval* cur) {
   }
 
   // For every interval in inactive we overlap with, mark the
-  // register as not free and update spill weights.
-  for (IntervalPtrs::const_iterator i = inactive_.begin(),
-         e = inactive_.end(); i != e; ++i) {
-    unsigned Reg = i->first->reg;
-    assert(TargetRegisterInfo::isVirtualRegister(Reg) &&
-           "Can only allocate virtual registers!");
-    const TargetRegisterClass *RegRC = mri_->getRegClass(Reg);
+  // register as not free and update spill weights.  The allocated intervals
+  // that overlap cur are found in the union of each register; the ones live at
+  // the start of cur are active and already accounted for in regUse_.
+  SmallVector<LiveInterval*, 8> Interferences;
+  for (unsigned Reg = 1, e = unions_.size(); Reg != e; ++Reg) {
+    if (unions_[Reg].empty())
+      continue;
     // If this is not in a related reg class to the register we're allocating, 
     // don't check it.
-    if (RelatedRegClasses.getLeaderValue(RegRC) == RCLeader &&
-        cur->overlapsFrom(*i->first, i->second-1)) {
-      Reg = vrm_->getPhys(Reg);
+    const TargetRegisterClass *RegRC = OneClassForEachPhysReg[Reg];
+    if (RelatedRegClasses.getLeaderValue(RegRC) != RCLeader)
+      continue;
+    Interferences.clear();
+    if (!unions_[Reg].collectInterferences(*cur, Interferences))
+      continue;
+    for (unsigned i = 0, e = Interferences.size(); i != e; ++i) {
+      LiveInterval *I = Interferences[i];
+      if (I->liveAt(StartPosition))
+        continue;
       addRegUse(Reg);
-      SpillWeightsToAdd.push_back(std::make_pair(Reg, i->first->weight));
+      SpillWeightsToAdd.push_back(std::make_pair(Reg, I->weight));
     }
   }
   
@@ -1091,6 +1135,7 @@ void RALinScan::assignRegOrStackSlotAtInterval(LiveInterval* cur) {
     DEBUG(dbgs() <<  tri_->getName(physReg) << '\n');
     vrm_->assignVirt2Phys(cur->reg, physReg);
     addRegUse(physReg);
+    unions_[physReg].unify(*cur);
     active_.push_back(std::make_pair(cur, cur->begin()));
     handled_.push_back(cur);
 
@@ -1284,6 +1329,10 @@ void RALinScan::assignRegOrStackSlotAtInterval(LiveInterval* cur) {
     DEBUG(dbgs() << "\t\t\tspilling(a): " << *sli << '\n');
     if (sli->beginIndex() < earliestStart)
       earliestStart = sli->beginIndex();
+
+    // The spiller may change the ranges of sli, so take it out of the union
+    // while they still match.
+    unions_[vrm_->getPhys(sli->reg)].extract(*sli);
        
     std::vector<LiveInterval*> newIs;
     newIs = spiller_->spill(sli, spillIs, &earliestStart);
@@ -1308,15 +1357,19 @@ void RALinScan::assignRegOrStackSlotAtInterval(LiveInterval* cur) {
     // When undoing a live interval allocation we must know if it is active or
     // inactive to properly update regUse_ and the VirtRegMap.
     IntervalPtrs::iterator it;
+    unsigned PhysReg = vrm_->getPhys(i->reg);
+    if (!spilled.count(i->reg))
+      unions_[PhysReg].extract(*i);
     if ((it = FindIntervalInVector(active_, i)) != active_.end()) {
       active_.erase(it);
       assert(!TargetRegisterInfo::isPhysicalRegister(i->reg));
       if (!spilled.count(i->reg))
         unhandled_.push(i);
-      delRegUse(vrm_->getPhys(i->reg));
+      delRegUse(PhysReg);
       vrm_->clearVirt(i->reg);
     } else if ((it = FindIntervalInVector(inactive_, i)) != inactive_.end()) {
       inactive_.erase(it);
+      --inactiveCounts_[PhysReg];
       assert(!TargetRegisterInfo::isPhysicalRegister(i->reg));
       if (!spilled.count(i->reg))
         unhandled_.push(i);
@@ -1344,6 +1397,7 @@ void RALinScan::assignRegOrStackSlotAtInterval(LiveInterval* cur) {
   RevertVectorIteratorsTo(active_, earliestStart);
   RevertVectorIteratorsTo(inactive_, earliestStart);
   RevertVectorIteratorsTo(fixed_, earliestStart);
+  std::make_heap(inactive_.begin(), inactive_.end(), InactiveOrder());
 
   // Scan the rest and undo each interval that expired after t and
   // insert it in active (the next iteration of the algorithm will
@@ -1392,7 +1446,6 @@ void RALinScan::assignRegOrStackSlotAtInterval(LiveInterval* cur) {
 unsigned RALinScan::getFreePhysReg(LiveInterval* cur,
                                    const TargetRegisterClass *RC,
                                    unsigned MaxInactiveCount,
-                                   SmallVector<unsigned, 256> &inactiveCounts,
                                    bool SkipDGRegs) {
   unsigned FreeReg = 0;
   unsigned FreeRegInactiveCount = 0;
@@ -1417,10 +1470,7 @@ unsigned RALinScan::getFreePhysReg(LiveInterval* cur,
     // Skip recently allocated registers.
     if (isRegAvail(Reg) && !isRecentlyUsed(Reg)) {
       FreeReg = Reg;
-      if (FreeReg < inactiveCounts.size())
-        FreeRegInactiveCount = inactiveCounts[FreeReg];
-      else
-        FreeRegInactiveCount = 0;
+      FreeRegInactiveCount = inactiveCounts_[FreeReg];
       break;
     }
   }
@@ -1442,10 +1492,10 @@ unsigned RALinScan::getFreePhysReg(LiveInterval* cur,
     // Ignore "downgraded" registers.
     if (SkipDGRegs && DowngradedRegs.count(Reg))
       continue;
-    if (isRegAvail(Reg) && Reg < inactiveCounts.size() &&
-        FreeRegInactiveCount < inactiveCounts[Reg] && !isRecentlyUsed(Reg)) {
+    if (isRegAvail(Reg) && FreeRegInactiveCount < inactiveCounts_[Reg] &&
+        !isRecentlyUsed(Reg)) {
       FreeReg = Reg;
-      FreeRegInactiveCount = inactiveCounts[Reg];
+      FreeRegInactiveCount = inactiveCounts_[Reg];
       if (FreeRegInactiveCount == MaxInactiveCount)
         break;    // We found the one with the max inactive count.
     }
@@ -1460,29 +1510,15 @@ unsigned RALinScan::getFreePhysReg(LiveInterval* cur,
 /// getFreePhysReg - return a free physical register for this virtual register
 /// interval if we have one, otherwise return 0.
 unsigned RALinScan::getFreePhysReg(LiveInterval *cur) {
-  SmallVector<unsigned, 256> inactiveCounts;
   unsigned MaxInactiveCount = 0;
   
   const TargetRegisterClass *RC = mri_->getRegClass(cur->reg);
-  const TargetRegisterClass *RCLeader = RelatedRegClasses.getLeaderValue(RC);
- 
-  for (IntervalPtrs::iterator i = inactive_.begin(), e = inactive_.end();
-       i != e; ++i) {
-    unsigned reg = i->first->reg;
-    assert(TargetRegisterInfo::isVirtualRegister(reg) &&
-           "Can only allocate virtual registers!");
 
-    // If this is not in a related reg class to the register we're allocating, 
-    // don't check it.
-    const TargetRegisterClass *RegRC = mri_->getRegClass(reg);
-    if (RelatedRegClasses.getLeaderValue(RegRC) == RCLeader) {
-      reg = vrm_->getPhys(reg);
-      if (inactiveCounts.size() <= reg)
-        inactiveCounts.resize(reg+1);
-      ++inactiveCounts[reg];
-      MaxInactiveCount = std::max(MaxInactiveCount, inactiveCounts[reg]);
-    }
-  }
+  // Only the registers of RC are candidates, so the highest inactive count
+  // among them is the most any candidate can reach.
+  for (TargetRegisterClass::iterator I = RC->begin(), E = RC->end();
+       I != E; ++I)
+    MaxInactiveCount = std::max(MaxInactiveCount, inactiveCounts_[*I]);
 
   // If copy coalescer has assigned a "preferred" register, check if it's
   // available first.
@@ -1495,12 +1531,11 @@ unsigned RALinScan::getFreePhysReg(LiveInterval *cur) {
   }
 
   if (!DowngradedRegs.empty()) {
-    unsigned FreeReg = getFreePhysReg(cur, RC, MaxInactiveCount, inactiveCounts,
-                                      true);
+    unsigned FreeReg = getFreePhysReg(cur, RC, MaxInactiveCount, true);
     if (FreeReg)
       return FreeReg;
   }
-  return getFreePhysReg(cur, RC, MaxInactiveCount, inactiveCounts, false);
+  return getFreePhysReg(cur, RC, MaxInactiveCount, false);
 }
 
 FunctionPass* llvm::createLinearScanRegisterAllocator() {
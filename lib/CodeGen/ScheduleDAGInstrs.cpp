@@ -24,11 +24,18 @@
 #include "llvm/Target/TargetInstrInfo.h"
 #include "llvm/Target/TargetRegisterInfo.h"
 #include "llvm/Target/TargetSubtarget.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallSet.h"
 using namespace llvm;
 
+static cl::opt<unsigned>
+MaxPendingLoads("sched-max-pending-loads", cl::Hidden, cl::init(100),
+    cl::desc("Maximum number of unknown loads to track between "
+             "aliasing stores before chaining them together"));
+
 ScheduleDAGInstrs::ScheduleDAGInstrs(MachineFunction &mf,
                                      const MachineLoopInfo &mli,
                                      const MachineDominatorTree &mdt)
@@ -155,8 +162,10 @@ void ScheduleDAGInstrs::BuildSchedGraph(AliasAnalysis *AA) {
   // so that they can be given more precise dependencies. We track
   // separately the known memory locations that may alias and those
   // that are known not to alias
-  std::map<const Value *, SUnit *> AliasMemDefs, NonAliasMemDefs;
-  std::map<const Value *, std::vector<SUnit *> > AliasMemUses, NonAliasMemUses;
+  typedef DenseMap<const Value *, SUnit *> MemDefMap;
+  typedef DenseMap<const Value *, std::vector<SUnit *> > MemUseMap;
+  MemDefMap AliasMemDefs, NonAliasMemDefs;
+  MemUseMap AliasMemUses, NonAliasMemUses;
 
   // Keep track of dangling debug references to registers.
   std::pair<MachineInstr*, unsigned>
@@ -225,7 +234,14 @@ void ScheduleDAGInstrs::BuildSchedGraph(AliasAnalysis *AA) {
       //       there's no cost for reusing registers.
       SDep::Kind Kind = MO.isUse() ? SDep::Anti : SDep::Output;
       unsigned AOLatency = (Kind == SDep::Anti) ? 0 : 1;
-      for (unsigned i = 0, e = DefList.size(); i != e; ++i) {
+      // A dead def needs no output dependence on other dead defs.  Only a
+      // live def clears DefList, so only its first entry can be live; don't
+      // walk the long run of dead defs (of flags, usually) behind it.
+      bool OnlyLiveDefs = Kind == SDep::Output && MO.isDead();
+      unsigned NumDefs = DefList.size();
+      if (OnlyLiveDefs && NumDefs > 1)
+        NumDefs = 1;
+      for (unsigned i = 0; i != NumDefs; ++i) {
         SUnit *DefSU = DefList[i];
         if (DefSU != SU &&
             (Kind != SDep::Output || !MO.isDead() ||
@@ -234,7 +250,10 @@ void ScheduleDAGInstrs::BuildSchedGraph(AliasAnalysis *AA) {
       }
       for (const unsigned *Alias = TRI->getAliasSet(Reg); *Alias; ++Alias) {
         std::vector<SUnit *> &DefList = Defs[*Alias];
-        for (unsigned i = 0, e = DefList.size(); i != e; ++i) {
+        unsigned NumDefs = DefList.size();
+        if (OnlyLiveDefs && NumDefs > 1)
+          NumDefs = 1;
+        for (unsigned i = 0; i != NumDefs; ++i) {
           SUnit *DefSU = DefList[i];
           if (DefSU != SU &&
               (Kind != SDep::Output || !MO.isDead() ||
@@ -362,11 +381,11 @@ void ScheduleDAGInstrs::BuildSchedGraph(AliasAnalysis *AA) {
          (!TID.mayLoad() || !MI->isInvariantLoad(AA)))) {
       // Be conservative with these and add dependencies on all memory
       // references, even those that are known to not alias.
-      for (std::map<const Value *, SUnit *>::iterator I = 
+      for (MemDefMap::iterator I = 
              NonAliasMemDefs.begin(), E = NonAliasMemDefs.end(); I != E; ++I) {
         I->second->addPred(SDep(SU, SDep::Order, /*Latency=*/0));
       }
-      for (std::map<const Value *, std::vector<SUnit *> >::iterator I =
+      for (MemUseMap::iterator I =
              NonAliasMemUses.begin(), E = NonAliasMemUses.end(); I != E; ++I) {
         for (unsigned i = 0, e = I->second.size(); i != e; ++i)
           I->second[i]->addPred(SDep(SU, SDep::Order, TrueMemOrderLatency));
@@ -386,11 +405,11 @@ void ScheduleDAGInstrs::BuildSchedGraph(AliasAnalysis *AA) {
       AliasChain = SU;
       for (unsigned k = 0, m = PendingLoads.size(); k != m; ++k)
         PendingLoads[k]->addPred(SDep(SU, SDep::Order, TrueMemOrderLatency));
-      for (std::map<const Value *, SUnit *>::iterator I = AliasMemDefs.begin(),
+      for (MemDefMap::iterator I = AliasMemDefs.begin(),
            E = AliasMemDefs.end(); I != E; ++I) {
         I->second->addPred(SDep(SU, SDep::Order, /*Latency=*/0));
       }
-      for (std::map<const Value *, std::vector<SUnit *> >::iterator I =
+      for (MemUseMap::iterator I =
            AliasMemUses.begin(), E = AliasMemUses.end(); I != E; ++I) {
         for (unsigned i = 0, e = I->second.size(); i != e; ++i)
           I->second[i]->addPred(SDep(SU, SDep::Order, TrueMemOrderLatency));
@@ -405,9 +424,9 @@ void ScheduleDAGInstrs::BuildSchedGraph(AliasAnalysis *AA) {
         // A store to a specific PseudoSourceValue. Add precise dependencies.
         // Record the def in MemDefs, first adding a dep if there is
         // an existing def.
-        std::map<const Value *, SUnit *>::iterator I = 
+        MemDefMap::iterator I = 
           ((MayAlias) ? AliasMemDefs.find(V) : NonAliasMemDefs.find(V));
-        std::map<const Value *, SUnit *>::iterator IE = 
+        MemDefMap::iterator IE = 
           ((MayAlias) ? AliasMemDefs.end() : NonAliasMemDefs.end());
         if (I != IE) {
           I->second->addPred(SDep(SU, SDep::Order, /*Latency=*/0, /*Reg=*/0,
@@ -420,9 +439,9 @@ void ScheduleDAGInstrs::BuildSchedGraph(AliasAnalysis *AA) {
             NonAliasMemDefs[V] = SU;
         }
         // Handle the uses in MemUses, if there are any.
-        std::map<const Value *, std::vector<SUnit *> >::iterator J =
+        MemUseMap::iterator J =
           ((MayAlias) ? AliasMemUses.find(V) : NonAliasMemUses.find(V));
-        std::map<const Value *, std::vector<SUnit *> >::iterator JE =
+        MemUseMap::iterator JE =
           ((MayAlias) ? AliasMemUses.end() : NonAliasMemUses.end());
         if (J != JE) {
           for (unsigned i = 0, e = J->second.size(); i != e; ++i)
@@ -455,21 +474,26 @@ void ScheduleDAGInstrs::BuildSchedGraph(AliasAnalysis *AA) {
         if (const Value *V = 
             getUnderlyingObjectForInstr(MI, MFI, MayAlias)) {
           // A load from a specific PseudoSourceValue. Add precise dependencies.
-          std::map<const Value *, SUnit *>::iterator I = 
+          MemDefMap::iterator I = 
             ((MayAlias) ? AliasMemDefs.find(V) : NonAliasMemDefs.find(V));
-          std::map<const Value *, SUnit *>::iterator IE = 
+          MemDefMap::iterator IE = 
             ((MayAlias) ? AliasMemDefs.end() : NonAliasMemDefs.end());
           if (I != IE)
             I->second->addPred(SDep(SU, SDep::Order, /*Latency=*/0, /*Reg=*/0,
                                     /*isNormalMemory=*/true));
           if (MayAlias)
             AliasMemUses[V].push_back(SU);
-          else 
+          else
             NonAliasMemUses[V].push_back(SU);
+        } else if (PendingLoads.size() >= MaxPendingLoads) {
+          // Every aliasing store above would need an edge to each of the
+          // pending loads, which is quadratic in huge blocks.  Chain them
+          // through this load instead.
+          goto new_alias_chain;
         } else {
           // A load with no underlying object. Depend on all
           // potentially aliasing stores.
-          for (std::map<const Value *, SUnit *>::iterator I = 
+          for (MemDefMap::iterator I = 
                  AliasMemDefs.begin(), E = AliasMemDefs.end(); I != E; ++I)
             I->second->addPred(SDep(SU, SDep::Order, /*Latency=*/0));
           
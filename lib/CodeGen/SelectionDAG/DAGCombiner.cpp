@@ -29,6 +29,7 @@
 #include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CommandLine.h"
@@ -63,9 +64,14 @@ namespace {
     bool LegalOperations;
     bool LegalTypes;
 
-    // Worklist of all of the nodes that need to be simplified.
+    // Worklist of all of the nodes that need to be simplified.  Nodes that are
+    // removed, or moved to the back, leave a null entry behind.
     std::vector<SDNode*> WorkList;
 
+    // WorkListMap - The index of each node in WorkList, so that nodes can be
+    // found and removed without scanning the whole list.
+    DenseMap<SDNode*, unsigned> WorkListMap;
+
     // AA - Used for DAG load/store alias analysis.
     AliasAnalysis &AA;
 
@@ -87,15 +93,26 @@ namespace {
     /// AddToWorkList - Add to the work list making sure it's instance is at the
     /// the back (next to be processed.)
     void AddToWorkList(SDNode *N) {
-      removeFromWorkList(N);
+      std::pair<DenseMap<SDNode*, unsigned>::iterator, bool> InsertResult =
+        WorkListMap.insert(std::make_pair(N, WorkList.size()));
+      if (!InsertResult.second) {
+        unsigned &Idx = InsertResult.first->second;
+        if (Idx == WorkList.size() - 1)
+          return;
+        WorkList[Idx] = 0;
+        Idx = WorkList.size();
+      }
       WorkList.push_back(N);
     }
 
     /// removeFromWorkList - remove all instances of N from the worklist.
     ///
     void removeFromWorkList(SDNode *N) {
-      WorkList.erase(std::remove(WorkList.begin(), WorkList.end(), N),
-                     WorkList.end());
+      DenseMap<SDNode*, unsigned>::iterator I = WorkListMap.find(N);
+      if (I == WorkListMap.end())
+        return;
+      WorkList[I->second] = 0;
+      WorkListMap.erase(I);
     }
 
     SDValue CombineTo(SDNode *N, const SDValue *To, unsigned NumTo,
@@ -643,7 +660,7 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   WorkList.reserve(DAG.allnodes_size());
   for (SelectionDAG::allnodes_iterator I = DAG.allnodes_begin(),
        E = DAG.allnodes_end(); I != E; ++I)
-    WorkList.push_back(I);
+    AddToWorkList(I);
 
   // Create a dummy node (which is not added to allnodes), that adds a reference
   // to the root node, preventing it from being deleted, and tracking any
@@ -659,6 +676,9 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   while (!WorkList.empty()) {
     SDNode *N = WorkList.back();
     WorkList.pop_back();
+    if (N == 0)
+      continue;
+    WorkListMap.erase(N);
 
     // If N has no uses, it is dead.  Make sure to revisit all N's operands once
     // N is deleted from the DAG, since they too may now be dead or may have a
@@ -53,15 +53,25 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include <algorithm>
 using namespace llvm;
 
 STATISTIC(NumFastIselFailures, "Number of instructions fast isel failed on");
 
+// Enable or disable FastISel. Both options are needed, because
+// FastISel is enabled by default with -fast, and we wish to be
+// able to enable or disable fast-isel independently from -O0.
+static cl::opt<cl::boolOrDefault>
+EnableFastISelOption("fast-isel", cl::Hidden,
+  cl::desc("Enable the \"fast\" instruction selector"));
 static cl::opt<bool>
 EnableFastISelVerbose("fast-isel-verbose", cl::Hidden,
           cl::desc("Enable verbose messages in the \"fast\" "
@@ -70,6 +80,10 @@ static cl::opt<bool>
 EnableFastISelAbort("fast-isel-abort", cl::Hidden,
           cl::desc("Enable abort calls when \"fast\" instruction fails"));
 static cl::opt<bool>
+EnableFastISelStats("fast-isel-stats", cl::Hidden,
+          cl::desc("Print a report of the instructions the \"fast\" "
+                   "instruction selector hands to SelectionDAG"));
+static cl::opt<bool>
 SchedLiveInCopies("schedule-livein-copies", cl::Hidden,
                   cl::desc("Schedule copies of livein registers"),
                   cl::init(false));
@@ -111,6 +125,111 @@ static const bool ViewDAGCombine1 = false,
                   ViewSUnitDAGs = false;
 #endif
 
+namespace {
+/// FastISelReport - Tally for -fast-isel-stats of the instructions selected
+/// by FastISel and of the ones handed to SelectionDAG, with the instruction
+/// FastISel missed on each time it gave up.  This is used in a ManagedStatic
+/// so that the report covers the whole module; it is printed from the
+/// destructor when llvm_shutdown is called.
+class FastISelReport {
+  unsigned NumFastISel;
+  unsigned NumSelectionDAG;
+  StringMap<unsigned> Misses;
+public:
+  FastISelReport() : NumFastISel(0), NumSelectionDAG(0) {}
+  ~FastISelReport();
+
+  void addFastISel() { ++NumFastISel; }
+  void addSelectionDAG(unsigned N) { NumSelectionDAG += N; }
+  void addMiss(StringRef Key) { ++Misses[Key]; }
+};
+
+/// MissCompare - Order misses by decreasing count, then by name.
+struct MissCompare {
+  bool operator()(const std::pair<unsigned, std::string> &LHS,
+                  const std::pair<unsigned, std::string> &RHS) const {
+    if (LHS.first != RHS.first)
+      return LHS.first > RHS.first;
+    return LHS.second < RHS.second;
+  }
+};
+}
+
+static ManagedStatic<FastISelReport> FastISelStats;
+
+FastISelReport::~FastISelReport() {
+  unsigned Total = NumFastISel + NumSelectionDAG;
+  if (Total == 0) return;
+
+  std::vector<std::pair<unsigned, std::string> > Sorted;
+  for (StringMap<unsigned>::iterator I = Misses.begin(), E = Misses.end();
+       I != E; ++I)
+    Sorted.push_back(std::make_pair(I->getValue(), I->getKey().str()));
+  std::sort(Sorted.begin(), Sorted.end(), MissCompare());
+
+  raw_ostream &OS = errs();
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                     ... FastISel Instruction Selection ...\n"
+     << "===" << std::string(73, '-') << "===\n\n";
+  OS << format("%8u instructions selected by FastISel (%.1f%%)\n",
+               NumFastISel, 100.0 * NumFastISel / Total);
+  OS << format("%8u instructions selected by SelectionDAG\n", NumSelectionDAG);
+  if (!Sorted.empty()) {
+    OS << "\nFastISel misses:\n";
+    for (unsigned i = 0, e = Sorted.size(); i != e; ++i)
+      OS << format("%8u ", Sorted[i].first) << Sorted[i].second << '\n';
+  }
+  OS << '\n';
+  OS.flush();
+}
+
+/// getFastISelMissKey - Describe the instruction FastISel failed on for the
+/// -fast-isel-stats report.  Calls are keyed by callee, casts by their source
+/// and destination types, and everything else by opcode and the type of the
+/// value it works on.
+static std::string getFastISelMissKey(const Instruction *I) {
+  std::string Key;
+  raw_string_ostream OS(Key);
+  OS << I->getOpcodeName();
+
+  // Calls and invokes are keyed by their callee.
+  const Value *Callee = 0;
+  if (const CallInst *CI = dyn_cast<CallInst>(I))
+    Callee = CI->getCalledValue();
+  else if (const InvokeInst *II = dyn_cast<InvokeInst>(I))
+    Callee = II->getCalledValue();
+  if (Callee) {
+    if (isa<InlineAsm>(Callee))
+      OS << " asm";
+    else if (isa<Function>(Callee))
+      OS << " @" << Callee->getName();
+    else
+      OS << " indirect";
+    return OS.str();
+  }
+
+  if (const CastInst *C = dyn_cast<CastInst>(I)) {
+    OS << ' ';
+    C->getSrcTy()->print(OS);
+    OS << " to ";
+    C->getDestTy()->print(OS);
+    return OS.str();
+  }
+
+  // Stores, compares and returns are most usefully keyed by their operand.
+  const Type *Ty = I->getType();
+  if (isa<StoreInst>(I) || isa<CmpInst>(I) || isa<ReturnInst>(I)) {
+    if (I->getNumOperands() == 0)
+      return OS.str();
+    Ty = I->getOperand(0)->getType();
+  }
+  if (!Ty->isVoidTy()) {
+    OS << ' ';
+    Ty->print(OS);
+  }
+  return OS.str();
+}
+
 //===---------------------------------------------------------------------===//
 ///
 /// RegisterScheduler class - Track the registration of instruction schedulers.
@@ -307,13 +426,22 @@ void SelectionDAGISel::getAnalysisUsage(AnalysisUsage &AU) const {
   MachineFunctionPass::getAnalysisUsage(AU);
 }
 
+/// useFastISel - Return true if FastISel should be used at the given
+/// OptLevel.  This is decided by each selector rather than once per process,
+/// as the JIT builds pipelines at several levels.
+bool SelectionDAGISel::useFastISel(CodeGenOpt::Level OptLevel) {
+  if (EnableFastISel || EnableFastISelOption == cl::BOU_TRUE)
+    return true;
+  return OptLevel == CodeGenOpt::None && EnableFastISelOption != cl::BOU_FALSE;
+}
+
 bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
   Function &Fn = *mf.getFunction();
 
   // Do some sanity-checking on the command-line options.
-  assert((!EnableFastISelVerbose || EnableFastISel) &&
+  assert((!EnableFastISelVerbose || useFastISel(OptLevel)) &&
          "-fast-isel-verbose requires -fast-isel");
-  assert((!EnableFastISelAbort || EnableFastISel) &&
+  assert((!EnableFastISelAbort || useFastISel(OptLevel)) &&
          "-fast-isel-abort requires -fast-isel");
 
   // Get alias analysis for load/store combining.
@@ -333,7 +461,7 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
   MachineModuleInfo *MMI = getAnalysisIfAvailable<MachineModuleInfo>();
   DwarfWriter *DW = getAnalysisIfAvailable<DwarfWriter>();
   CurDAG->init(*MF, MMI, DW);
-  FuncInfo->set(Fn, *MF, EnableFastISel);
+  FuncInfo->set(Fn, *MF, useFastISel(OptLevel));
   SDB->init(GFI, *AA);
 
   for (Function::iterator I = Fn.begin(), E = Fn.end(); I != E; ++I)
@@ -857,7 +985,7 @@ void SelectionDAGISel::SelectAllBasicBlocks(Function &Fn,
                                             const TargetInstrInfo &TII) {
   // Initialize the Fast-ISel state, if needed.
   FastISel *FastIS = 0;
-  if (EnableFastISel)
+  if (useFastISel(OptLevel))
     FastIS = TLI.createFastISel(MF, MMI, DW,
                                 FuncInfo->ValueMap,
                                 FuncInfo->MBBMap,
@@ -892,6 +1020,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(Function &Fn,
           if (Fn.paramHasAttr(j, Attribute::ByVal)) {
             if (EnableFastISelVerbose || EnableFastISelAbort)
               dbgs() << "FastISel skips entry block due to byval argument\n";
+            if (EnableFastISelStats)
+              FastISelStats->addMiss("entry block with byval argument");
             SuppressFastISel = true;
             break;
           }
@@ -956,6 +1086,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(Function &Fn,
         if (isa<TerminatorInst>(BI))
           if (!HandlePHINodesInSuccessorBlocksFast(LLVMBB, FastIS)) {
             ++NumFastIselFailures;
+            if (EnableFastISelStats)
+              FastISelStats->addMiss("phi in successor block");
             ResetDebugLoc(SDB, FastIS);
             if (EnableFastISelVerbose || EnableFastISelAbort) {
               dbgs() << "FastISel miss: ";
@@ -970,6 +1102,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(Function &Fn,
 
         // Try to select the instruction with FastISel.
         if (FastIS->SelectInstruction(BI)) {
+          if (EnableFastISelStats)
+            FastISelStats->addFastISel();
           ResetDebugLoc(SDB, FastIS);
           continue;
         }
@@ -981,6 +1115,10 @@ void SelectionDAGISel::SelectAllBasicBlocks(Function &Fn,
         // Then handle certain instructions as single-LLVM-Instruction blocks.
         if (isa<CallInst>(BI)) {
           ++NumFastIselFailures;
+          if (EnableFastISelStats) {
+            FastISelStats->addMiss(getFastISelMissKey(BI));
+            FastISelStats->addSelectionDAG(1);
+          }
           if (EnableFastISelVerbose || EnableFastISelAbort) {
             dbgs() << "FastISel missed call: ";
             BI->dump();
@@ -1008,6 +1146,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(Function &Fn,
         }
 
         // Otherwise, give up on FastISel for the rest of the block.
+        if (EnableFastISelStats)
+          FastISelStats->addMiss(getFastISelMissKey(BI));
         // For now, be a little lenient about non-branch terminators.
         if (!isa<TerminatorInst>(BI) || isa<BranchInst>(BI)) {
           ++NumFastIselFailures;
@@ -1028,6 +1168,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(Function &Fn,
     // not handled by FastISel. If FastISel is not run, this is the entire
     // block.
     if (BI != End) {
+      if (EnableFastISelStats)
+        FastISelStats->addSelectionDAG(std::distance(BI, End));
       bool HadTailCall;
       SelectBasicBlock(LLVMBB, BI, End, HadTailCall);
     }
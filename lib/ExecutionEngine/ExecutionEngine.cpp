@@ -52,7 +52,7 @@ ExecutionEngine::EERegisterFn ExecutionEngine::ExceptionTableRegister = 0;
 
 ExecutionEngine::ExecutionEngine(Module *M)
   : EEState(*this),
-    LazyFunctionCreator(0) {
+    LazyFunctionCreator(0), CodeCache(0) {
   CompilingLazily         = false;
   GVCompilationDisabled   = false;
   SymbolSearchingDisabled = false;
@@ -134,6 +134,7 @@ void ExecutionEngine::addGlobalMapping(const GlobalValue *GV, void *Addr) {
     assert((V == 0 || GV == 0) && "GlobalMapping already established!");
     V = GV;
   }
+  globalMappingChanged(GV);
 }
 
 /// clearAllGlobalMappings - Clear all global mappings and start over again
@@ -143,6 +144,7 @@ void ExecutionEngine::clearAllGlobalMappings() {
   
   EEState.getGlobalAddressMap(locked).clear();
   EEState.getGlobalAddressReverseMap(locked).clear();
+  globalMappingChanged(0);
 }
 
 /// clearGlobalMappingsFromModule - Clear all global mappings that came from a
@@ -152,10 +154,12 @@ void ExecutionEngine::clearGlobalMappingsFromModule(Module *M) {
   
   for (Module::iterator FI = M->begin(), FE = M->end(); FI != FE; ++FI) {
     EEState.RemoveMapping(locked, FI);
+    globalMappingChanged(FI);
   }
   for (Module::global_iterator GI = M->global_begin(), GE = M->global_end(); 
        GI != GE; ++GI) {
     EEState.RemoveMapping(locked, GI);
+    globalMappingChanged(GI);
   }
 }
 
@@ -170,7 +174,9 @@ void *ExecutionEngine::updateGlobalMapping(const GlobalValue *GV, void *Addr) {
 
   // Deleting from the mapping?
   if (Addr == 0) {
-    return EEState.RemoveMapping(locked, GV);
+    void *OldVal = EEState.RemoveMapping(locked, GV);
+    globalMappingChanged(GV);
+    return OldVal;
   }
   
   void *&CurVal = Map[GV];
@@ -187,6 +193,7 @@ void *ExecutionEngine::updateGlobalMapping(const GlobalValue *GV, void *Addr) {
     assert((V == 0 || GV == 0) && "GlobalMapping already established!");
     V = GV;
   }
+  globalMappingChanged(GV);
   return OldVal;
 }
 
@@ -264,6 +271,12 @@ void ExecutionEngine::runStaticConstructorsDestructors(Module *module,
   
  GlobalVariable *GV = module->getNamedGlobal(Name);
 
+ // The initializer may not have been read from bitcode yet.
+ std::string ErrorMsg;
+ if (GV && GV->Materialize(&ErrorMsg))
+   llvm_report_error("Error reading '" + GV->getName() + "' from bitcode file: "
+                     + ErrorMsg);
+
  // If this global has internal linkage, or if it has a use, then it must be
  // an old-style (llvmgcc3) static ctor with __main linked in and in use.  If
  // this is the case, don't execute any of the global ctors, __main will do
@@ -453,9 +466,13 @@ void *ExecutionEngine::getPointerToGlobal(const GlobalValue *GV) {
 
   // Global variable might have been added since interpreter started.
   if (GlobalVariable *GVar =
-          const_cast<GlobalVariable *>(dyn_cast<GlobalVariable>(GV)))
+          const_cast<GlobalVariable *>(dyn_cast<GlobalVariable>(GV))) {
+    std::string ErrorMsg;
+    if (GVar->Materialize(&ErrorMsg))
+      llvm_report_error("Error reading global '" + GVar->getName() +
+                        "' from bitcode file: " + ErrorMsg);
     EmitGlobalVariable(GVar);
-  else
+  } else
     llvm_unreachable("Global hasn't had an address allocated yet!");
   return EEState.getGlobalAddressMap(locked)[GV];
 }
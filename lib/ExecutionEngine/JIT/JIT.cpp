@@ -18,19 +18,27 @@
 #include "llvm/Function.h"
 #include "llvm/GlobalVariable.h"
 #include "llvm/Instructions.h"
+#include "llvm/Module.h"
+#include "llvm/TypeSymbolTable.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/CodeGen/JITCodeEmitter.h"
 #include "llvm/CodeGen/MachineCodeInfo.h"
+#include "llvm/CodeGen/SelectionDAGISel.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/Target/TargetData.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetJITInfo.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Target/TargetRegistry.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/InstIterator.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/System/DynamicLibrary.h"
+#include "llvm/System/Host.h"
 #include "llvm/Config/config.h"
 
 using namespace llvm;
@@ -231,7 +239,18 @@ ExecutionEngine *JIT::createJIT(Module *M,
 
   // If the target supports JIT code generation, create a the JIT.
   if (TargetJITInfo *TJ = TM->getJITInfo()) {
-    return new JIT(M, *TM, *TJ, JMM, OptLevel, GVsWithCode);
+    JIT *J = new JIT(M, *TM, *TJ, JMM, OptLevel, GVsWithCode);
+
+    // Code for the host CPU may use any feature the host has, so name it
+    // explicitly rather than trusting an empty -mcpu to mean the same thing
+    // in the next process.
+    raw_string_ostream OS(J->CodeCacheTarget);
+    OS << TM->getTarget().getName() << ' '
+       << (MCPU.empty() ? sys::getHostCPUName() : MCPU.str());
+    for (unsigned i = 0, e = MAttrs.size(); i != e; ++i)
+      OS << ' ' << MAttrs[i];
+    OS.flush();
+    return J;
   } else {
     if (ErrorStr)
       *ErrorStr = "target does not support JIT code generation";
@@ -285,7 +304,8 @@ extern "C" {
 JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
          JITMemoryManager *JMM, CodeGenOpt::Level OptLevel, bool GVsWithCode)
   : ExecutionEngine(M), TM(tm), TJI(tji), AllocateGVsWithCode(GVsWithCode),
-    isAlreadyCodeGenerating(false) {
+    isAlreadyCodeGenerating(false), OptLevel(OptLevel),
+    CompiledFunctions(&CompiledFunctionsLock) {
   setTargetData(TM.getTargetData());
 
   jitstate = new JITState(M);
@@ -296,17 +316,6 @@ JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
   // Register in global list of all JITs.
   AllJits->Add(this);
 
-  // Add target data
-  MutexGuard locked(lock);
-  FunctionPassManager &PM = jitstate->getPM(locked);
-  PM.add(new TargetData(*TM.getTargetData()));
-
-  // Turn the machine code intermediate representation into bytes in memory that
-  // may be executed.
-  if (TM.addPassesToEmitMachineCode(PM, *JCE, OptLevel)) {
-    llvm_report_error("Target does not support machine code emission!");
-  }
-  
   // Register routine for informing unwinding runtime about new EH frames
 #if defined(__GNUC__) && !defined(__ARM_EABI__)
 #if USE_KEYMGR
@@ -325,8 +334,8 @@ JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
 #endif // __APPLE__
 #endif // __GNUC__
   
-  // Initialize passes.
-  PM.doInitialization();
+  MutexGuard locked(lock);
+  addPassesToPM(jitstate->getPM(locked), OptLevel);
 }
 
 JIT::~JIT() {
@@ -336,6 +345,22 @@ JIT::~JIT() {
   delete &TM;
 }
 
+/// addPassesToPM - Fill in and initialize a pass manager which compiles
+/// functions at the given optimization level into the JIT's code emitter.
+void JIT::addPassesToPM(FunctionPassManager &PM, CodeGenOpt::Level Level) {
+  // Add target data
+  PM.add(new TargetData(*TM.getTargetData()));
+
+  // Turn the machine code intermediate representation into bytes in memory that
+  // may be executed.
+  if (TM.addPassesToEmitMachineCode(PM, *JCE, Level)) {
+    llvm_report_error("Target does not support machine code emission!");
+  }
+
+  // Initialize passes.
+  PM.doInitialization();
+}
+
 /// addModule - Add a new Module to the JIT.  If we previously removed the last
 /// Module, we need re-initialize jitstate with a valid Module.
 void JIT::addModule(Module *M) {
@@ -345,18 +370,7 @@ void JIT::addModule(Module *M) {
     assert(!jitstate && "jitstate should be NULL if Modules vector is empty!");
 
     jitstate = new JITState(M);
-
-    FunctionPassManager &PM = jitstate->getPM(locked);
-    PM.add(new TargetData(*TM.getTargetData()));
-
-    // Turn the machine code intermediate representation into bytes in memory
-    // that may be executed.
-    if (TM.addPassesToEmitMachineCode(PM, *JCE, CodeGenOpt::Default)) {
-      llvm_report_error("Target does not support machine code emission!");
-    }
-    
-    // Initialize passes.
-    PM.doInitialization();
+    addPassesToPM(jitstate->getPM(locked), OptLevel);
   }
   
   ExecutionEngine::addModule(M);
@@ -368,6 +382,9 @@ bool JIT::removeModule(Module *M) {
   bool result = ExecutionEngine::removeModule(M);
   
   MutexGuard locked(lock);
+
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    setCompiledFunction(I, 0);
   
   if (jitstate->getModule() == M) {
     delete jitstate;
@@ -376,22 +393,78 @@ bool JIT::removeModule(Module *M) {
   
   if (!jitstate && !Modules.empty()) {
     jitstate = new JITState(Modules[0]);
-
-    FunctionPassManager &PM = jitstate->getPM(locked);
-    PM.add(new TargetData(*TM.getTargetData()));
-    
-    // Turn the machine code intermediate representation into bytes in memory
-    // that may be executed.
-    if (TM.addPassesToEmitMachineCode(PM, *JCE, CodeGenOpt::Default)) {
-      llvm_report_error("Target does not support machine code emission!");
-    }
-    
-    // Initialize passes.
-    PM.doInitialization();
+    addPassesToPM(jitstate->getPM(locked), OptLevel);
   }    
   return result;
 }
 
+/// createRunFunctionStub - Create a nullary function that calls F with the
+/// given arguments as constants and returns its result.  The caller must hold
+/// the JIT lock.
+static Function *
+createRunFunctionStub(Function *F, const std::vector<GenericValue> &ArgValues) {
+  const FunctionType *FTy = F->getFunctionType();
+  const Type *RetTy = FTy->getReturnType();
+
+  // First, create the function.
+  FunctionType *STy=FunctionType::get(RetTy, false);
+  Function *Stub = Function::Create(STy, Function::InternalLinkage, "",
+                                    F->getParent());
+
+  // Insert a basic block.
+  BasicBlock *StubBB = BasicBlock::Create(F->getContext(), "", Stub);
+
+  // Convert all of the GenericValue arguments over to constants.  Note that we
+  // currently don't support varargs.
+  SmallVector<Value*, 8> Args;
+  for (unsigned i = 0, e = ArgValues.size(); i != e; ++i) {
+    Constant *C = 0;
+    const Type *ArgTy = FTy->getParamType(i);
+    const GenericValue &AV = ArgValues[i];
+    switch (ArgTy->getTypeID()) {
+    default: llvm_unreachable("Unknown argument type for function call!");
+    case Type::IntegerTyID:
+        C = ConstantInt::get(F->getContext(), AV.IntVal);
+        break;
+    case Type::FloatTyID:
+        C = ConstantFP::get(F->getContext(), APFloat(AV.FloatVal));
+        break;
+    case Type::DoubleTyID:
+        C = ConstantFP::get(F->getContext(), APFloat(AV.DoubleVal));
+        break;
+    case Type::PPC_FP128TyID:
+    case Type::X86_FP80TyID:
+    case Type::FP128TyID:
+        C = ConstantFP::get(F->getContext(), APFloat(AV.IntVal));
+        break;
+    case Type::PointerTyID:
+      void *ArgPtr = GVTOP(AV);
+      if (sizeof(void*) == 4)
+        C = ConstantInt::get(Type::getInt32Ty(F->getContext()), 
+                             (int)(intptr_t)ArgPtr);
+      else
+        C = ConstantInt::get(Type::getInt64Ty(F->getContext()),
+                             (intptr_t)ArgPtr);
+      // Cast the integer to pointer
+      C = ConstantExpr::getIntToPtr(C, ArgTy);
+      break;
+    }
+    Args.push_back(C);
+  }
+
+  CallInst *TheCall = CallInst::Create(F, Args.begin(), Args.end(),
+                                       "", StubBB);
+  TheCall->setCallingConv(F->getCallingConv());
+  TheCall->setTailCall();
+  if (!TheCall->getType()->isVoidTy())
+    // Return result of the call.
+    ReturnInst::Create(F->getContext(), TheCall, StubBB);
+  else
+    ReturnInst::Create(F->getContext(), StubBB);           // Just return void.
+
+  return Stub;
+}
+
 /// run - Start execution with the specified function and arguments.
 ///
 GenericValue JIT::runFunction(Function *F,
@@ -495,67 +568,21 @@ GenericValue JIT::runFunction(Function *F,
   // Okay, this is not one of our quick and easy cases.  Because we don't have a
   // full FFI, we have to codegen a nullary stub function that just calls the
   // function we are interested in, passing in constants for all of the
-  // arguments.  Make this function and return.
-
-  // First, create the function.
-  FunctionType *STy=FunctionType::get(RetTy, false);
-  Function *Stub = Function::Create(STy, Function::InternalLinkage, "",
-                                    F->getParent());
-
-  // Insert a basic block.
-  BasicBlock *StubBB = BasicBlock::Create(F->getContext(), "", Stub);
-
-  // Convert all of the GenericValue arguments over to constants.  Note that we
-  // currently don't support varargs.
-  SmallVector<Value*, 8> Args;
-  for (unsigned i = 0, e = ArgValues.size(); i != e; ++i) {
-    Constant *C = 0;
-    const Type *ArgTy = FTy->getParamType(i);
-    const GenericValue &AV = ArgValues[i];
-    switch (ArgTy->getTypeID()) {
-    default: llvm_unreachable("Unknown argument type for function call!");
-    case Type::IntegerTyID:
-        C = ConstantInt::get(F->getContext(), AV.IntVal);
-        break;
-    case Type::FloatTyID:
-        C = ConstantFP::get(F->getContext(), APFloat(AV.FloatVal));
-        break;
-    case Type::DoubleTyID:
-        C = ConstantFP::get(F->getContext(), APFloat(AV.DoubleVal));
-        break;
-    case Type::PPC_FP128TyID:
-    case Type::X86_FP80TyID:
-    case Type::FP128TyID:
-        C = ConstantFP::get(F->getContext(), APFloat(AV.IntVal));
-        break;
-    case Type::PointerTyID:
-      void *ArgPtr = GVTOP(AV);
-      if (sizeof(void*) == 4)
-        C = ConstantInt::get(Type::getInt32Ty(F->getContext()), 
-                             (int)(intptr_t)ArgPtr);
-      else
-        C = ConstantInt::get(Type::getInt64Ty(F->getContext()),
-                             (intptr_t)ArgPtr);
-      // Cast the integer to pointer
-      C = ConstantExpr::getIntToPtr(C, ArgTy);
-      break;
-    }
-    Args.push_back(C);
+  // arguments.
+  //
+  // Building the stub modifies the module, so it must be done with the JIT
+  // lock held.  Calling it must not be, or other threads could not run code
+  // while it executes.
+  Function *Stub;
+  {
+    MutexGuard locked(lock);
+    Stub = createRunFunctionStub(F, ArgValues);
   }
 
-  CallInst *TheCall = CallInst::Create(F, Args.begin(), Args.end(),
-                                       "", StubBB);
-  TheCall->setCallingConv(F->getCallingConv());
-  TheCall->setTailCall();
-  if (!TheCall->getType()->isVoidTy())
-    // Return result of the call.
-    ReturnInst::Create(F->getContext(), TheCall, StubBB);
-  else
-    ReturnInst::Create(F->getContext(), StubBB);           // Just return void.
-
   // Finally, call our nullary stub function.
   GenericValue Result = runFunction(Stub, std::vector<GenericValue>());
   // Erase it, since no other function can have a reference to it.
+  MutexGuard locked(lock);
   Stub->eraseFromParent();
   // And return the result.
   return Result;
@@ -624,11 +651,27 @@ void JIT::runJITOnFunction(Function *F, MachineCodeInfo *MCI) {
 }
 
 void JIT::runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked) {
+  runJITOnFunctionUnlocked(F, OptLevel, locked);
+}
+
+void JIT::runJITOnFunctionUnlocked(Function *F, CodeGenOpt::Level Level,
+                                   const MutexGuard &locked) {
   assert(!isAlreadyCodeGenerating && "Error: Recursive compilation detected!");
 
-  // JIT the function
+  FunctionPassManager *PM = &jitstate->getPM(locked);
+  if (Level != OptLevel) {
+    FunctionPassManager *&LevelPM = jitstate->getLevelPM(locked, Level);
+    if (!LevelPM) {
+      LevelPM = new FunctionPassManager(jitstate->getModule());
+      addPassesToPM(*LevelPM, Level);
+    }
+    PM = LevelPM;
+  }
+
+  // JIT the function, unless its code can be taken from the code cache.
   isAlreadyCodeGenerating = true;
-  jitstate->getPM(locked).run(*F);
+  if (!emitFunctionFromCache(F, Level))
+    PM->run(*F);
   isAlreadyCodeGenerating = false;
 
   // If the function referred to another function that had not yet been
@@ -642,7 +685,8 @@ void JIT::runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked) {
 
     // JIT the function
     isAlreadyCodeGenerating = true;
-    jitstate->getPM(locked).run(*PF);
+    if (!emitFunctionFromCache(PF, OptLevel))
+      jitstate->getPM(locked).run(*PF);
     isAlreadyCodeGenerating = false;
     
     // Now that the function has been jitted, ask the JITEmitter to rewrite
@@ -655,9 +699,10 @@ void JIT::runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked) {
 /// specified function, compiling it if neccesary.
 ///
 void *JIT::getPointerToFunction(Function *F) {
-
-  if (void *Addr = getPointerToGlobalIfAvailable(F))
-    return Addr;   // Check if function already code gen'd
+  // Check if the function has already been code gen'd.  This does not take
+  // the JIT lock, so it does not wait for other threads' compilations.
+  if (void *Addr = getCompiledFunctionIfAvailable(F))
+    return Addr;
 
   MutexGuard locked(lock);
 
@@ -677,6 +722,10 @@ void *JIT::getPointerToFunction(Function *F) {
     bool AbortOnFailure = !F->hasExternalWeakLinkage();
     void *Addr = getPointerToNamedFunction(F->getName(), AbortOnFailure);
     addGlobalMapping(F, Addr);
+    // The emitter may still replace this mapping with a stub if we are in the
+    // middle of code generation; only remember it for top-level requests.
+    if (!isAlreadyCodeGenerating)
+      setCompiledFunction(F, Addr);
     return Addr;
   }
 
@@ -684,9 +733,100 @@ void *JIT::getPointerToFunction(Function *F) {
 
   void *Addr = getPointerToGlobalIfAvailable(F);
   assert(Addr && "Code generation didn't add function to GlobalAddress table!");
+  setCompiledFunction(F, Addr);
   return Addr;
 }
 
+/// getCompiledFunctionIfAvailable - Return the address of F if
+/// getPointerToFunction has completely emitted it, otherwise null.  This may be
+/// called without holding the JIT lock.
+void *JIT::getCompiledFunctionIfAvailable(const Function *F) {
+  MutexGuard locked(CompiledFunctionsLock);
+  return CompiledFunctions.lookup(F);
+}
+
+/// setCompiledFunction - Record that F's code is complete and lives at Addr,
+/// or forget about F's code if Addr is null.
+void JIT::setCompiledFunction(const Function *F, void *Addr) {
+  MutexGuard locked(CompiledFunctionsLock);
+  if (Addr)
+    CompiledFunctions[F] = Addr;
+  else
+    CompiledFunctions.erase(F);
+}
+
+void JIT::globalMappingChanged(const GlobalValue *GV) {
+  MutexGuard locked(CompiledFunctionsLock);
+  if (!GV)
+    CompiledFunctions.clear();
+  else if (const Function *F = dyn_cast<Function>(GV))
+    CompiledFunctions.erase(F);
+}
+
+/// getCodeCacheKey - Return the key under which the machine code for F,
+/// compiled at Level, is kept in the code cache.  It describes everything the
+/// code depends on: the target and codegen options, F's body, the named types,
+/// and the properties of the global values F refers to.
+std::string JIT::getCodeCacheKey(const Function *F, CodeGenOpt::Level Level) {
+  std::string Key;
+  raw_string_ostream OS(Key);
+  const Module *M = F->getParent();
+
+  OS << "; LLVM JIT code cache v1\n"
+     << CodeCacheTarget << ' ' << sys::getHostTriple() << ' '
+     << M->getTargetTriple() << ' '
+     << getTargetData()->getStringRepresentation() << '\n'
+     << "O" << unsigned(Level) << " CM" << unsigned(TM.getCodeModel())
+     << " fpe" << NoFramePointerElim << " fpmad" << LessPreciseFPMADOption
+     << " xfp" << NoExcessFPPrecision << " ufp" << UnsafeFPMath
+     << " finfp" << FiniteOnlyFPMathOption
+     << " rnd" << HonorSignDependentRoundingFPMathOption
+     << " sfp" << UseSoftFloat << " abi" << unsigned(FloatABIType)
+     << " sjlj" << SjLjExceptionHandling << " uwt" << UnwindTablesMandatory
+     << " tail" << GuaranteedTailCallOpt << " stk" << StackAlignment
+     << " rstk" << RealignStack << " jt" << DisableJumpTables
+     << " fisel" << SelectionDAGISel::useFastISel(Level)
+     << " sphi" << StrongPHIElim << '\n';
+
+  const TypeSymbolTable &TST = M->getTypeSymbolTable();
+  for (TypeSymbolTable::const_iterator I = TST.begin(), E = TST.end();
+       I != E; ++I)
+    OS << "%" << I->first << " = type " << I->second->getDescription() << '\n';
+
+  // Collect the global values referenced by F, including through constant
+  // expressions.
+  SmallPtrSet<const Constant*, 16> Visited;
+  SmallVector<const Constant*, 16> Worklist;
+  for (const_inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
+    for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
+      if (const Constant *C = dyn_cast<Constant>(I->getOperand(i)))
+        if (Visited.insert(C))
+          Worklist.push_back(C);
+  while (!Worklist.empty()) {
+    const Constant *C = Worklist.pop_back_val();
+    if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+      // A function that has not been read from bitcode yet is not really a
+      // declaration.
+      bool IsDeclaration = GV->isDeclaration() && !GV->isMaterializable();
+      OS << "@" << GV->getName() << ' ' << GV->getType()->getDescription()
+         << ' ' << GV->getLinkage() << ' ' << GV->getVisibility() << ' '
+         << IsDeclaration << ' ' << GV->getAlignment() << ' '
+         << GV->getSection();
+      if (const GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV))
+        OS << ' ' << GVar->isThreadLocal() << ' ' << GVar->isConstant();
+      OS << '\n';
+      continue;
+    }
+    for (unsigned i = 0, e = C->getNumOperands(); i != e; ++i)
+      if (const Constant *Op = dyn_cast<Constant>(C->getOperand(i)))
+        if (Visited.insert(Op))
+          Worklist.push_back(Op);
+  }
+
+  F->print(OS);
+  return OS.str();
+}
+
 /// getOrEmitGlobalVariable - Return the address of the specified global
 /// variable, possibly emitting it to memory if needed.  This is used by the
 /// Emitter.
@@ -696,6 +836,13 @@ void *JIT::getOrEmitGlobalVariable(const GlobalVariable *GV) {
   void *Ptr = getPointerToGlobalIfAvailable(GV);
   if (Ptr) return Ptr;
 
+  // Make sure the initializer has been read from bitcode, if it exists.
+  std::string ErrorMsg;
+  if (const_cast<GlobalVariable*>(GV)->Materialize(&ErrorMsg)) {
+    llvm_report_error("Error reading global '" + GV->getName() +
+                      "' from bitcode file: " + ErrorMsg);
+  }
+
   // If the global is external, just remember the address.
   if (GV->isDeclaration() || GV->hasAvailableExternallyLinkage()) {
 #if HAVE___DSO_HANDLE
@@ -725,6 +872,12 @@ void *JIT::getOrEmitGlobalVariable(const GlobalVariable *GV) {
 /// just like JIT::getPointerToFunction().
 ///
 void *JIT::recompileAndRelinkFunction(Function *F) {
+  return recompileAndRelinkFunction(F, OptLevel);
+}
+
+void *JIT::recompileAndRelinkFunction(Function *F, CodeGenOpt::Level Level) {
+  MutexGuard locked(lock);
+
   void *OldAddr = getPointerToGlobalIfAvailable(F);
 
   // If it's not already compiled there is no reason to patch it up.
@@ -732,9 +885,10 @@ void *JIT::recompileAndRelinkFunction(Function *F) {
 
   // Delete the old function mapping.
   addGlobalMapping(F, 0);
+  setCompiledFunction(F, 0);
 
   // Recodegen the function
-  runJITOnFunction(F);
+  runJITOnFunctionUnlocked(F, Level, locked);
 
   // Update state, forward the old function to the new function.
   void *Addr = getPointerToGlobalIfAvailable(F);
@@ -16,7 +16,9 @@
 
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/PassManager.h"
+#include "llvm/ADT/ValueMap.h"
 #include "llvm/Support/ValueHandle.h"
+#include "llvm/System/Mutex.h"
 
 namespace llvm {
 
@@ -32,16 +34,33 @@ private:
   FunctionPassManager PM;  // Passes to compile a function
   Module *M;               // Module used to create the PM
 
+  /// LevelPMs - Pass managers which compile at optimization levels other than
+  /// the JIT's own, created on demand when a function is recompiled at a
+  /// different level.
+  FunctionPassManager *LevelPMs[CodeGenOpt::Aggressive + 1];
+
   /// PendingFunctions - Functions which have not been code generated yet, but
   /// were called from a function being code generated.
   std::vector<AssertingVH<Function> > PendingFunctions;
 
 public:
-  explicit JITState(Module *M) : PM(M), M(M) {}
+  explicit JITState(Module *M) : PM(M), M(M) {
+    for (unsigned i = 0; i <= CodeGenOpt::Aggressive; ++i)
+      LevelPMs[i] = 0;
+  }
+  ~JITState() {
+    for (unsigned i = 0; i <= CodeGenOpt::Aggressive; ++i)
+      delete LevelPMs[i];
+  }
 
   FunctionPassManager &getPM(const MutexGuard &L) {
     return PM;
   }
+
+  FunctionPassManager *&getLevelPM(const MutexGuard &L,
+                                   CodeGenOpt::Level OptLevel) {
+    return LevelPMs[OptLevel];
+  }
   
   Module *getModule() const { return M; }
   std::vector<AssertingVH<Function> > &getPendingFunctions(const MutexGuard &L){
@@ -65,8 +84,35 @@ class JIT : public ExecutionEngine {
   /// entry.
   bool isAlreadyCodeGenerating;
 
+  /// OptLevel - The optimization level functions are compiled at, unless they
+  /// are explicitly recompiled at another one.
+  CodeGenOpt::Level OptLevel;
+
+  /// CodeCacheTarget - Describes the target and subtarget the JIT generates
+  /// code for.  It is part of every code cache key.
+  std::string CodeCacheTarget;
+
   JITState *jitstate;
 
+  struct CompiledFunctionMapConfig : public ValueMapConfig<const Function*> {
+    typedef sys::Mutex *ExtraData;
+    static sys::Mutex *getMutex(sys::Mutex *M) { return M; }
+  };
+  typedef ValueMap<const Function *, void *, CompiledFunctionMapConfig>
+    CompiledFunctionMapTy;
+
+  /// CompiledFunctionsLock - Guards CompiledFunctions.  The JIT lock may be
+  /// held when acquiring this lock, but not the other way around.
+  sys::Mutex CompiledFunctionsLock;
+
+  /// CompiledFunctions - The addresses of functions whose code has been
+  /// completely emitted by getPointerToFunction.  Unlike the global address
+  /// map, this never contains the address of a function which is still being
+  /// emitted, so it can be consulted without holding the JIT lock; threads
+  /// which only need existing code then do not wait behind another thread's
+  /// compilation.
+  CompiledFunctionMapTy CompiledFunctions;
+
   JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
       JITMemoryManager *JMM, CodeGenOpt::Level OptLevel,
       bool AllocateGVsWithCode);
@@ -151,6 +197,12 @@ public:
   ///
   void *recompileAndRelinkFunction(Function *F);
 
+  /// recompileAndRelinkFunction - Like recompileAndRelinkFunction(F), but
+  /// generate the new copy of F at the specified optimization level.  Only F
+  /// itself is affected; functions compiled later still use the JIT's level.
+  ///
+  void *recompileAndRelinkFunction(Function *F, CodeGenOpt::Level Level);
+
   /// freeMachineCodeForFunction - deallocate memory used to code-generate this
   /// Function.
   ///
@@ -200,14 +252,25 @@ public:
 private:
   static JITCodeEmitter *createEmitter(JIT &J, JITMemoryManager *JMM,
                                        TargetMachine &tm);
+  void addPassesToPM(FunctionPassManager &PM, CodeGenOpt::Level Level);
   void runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked);
+  void runJITOnFunctionUnlocked(Function *F, CodeGenOpt::Level Level,
+                                const MutexGuard &locked);
   void updateFunctionStub(Function *F);
+  bool emitFunctionFromCache(Function *F, CodeGenOpt::Level Level);
+  std::string getCodeCacheKey(const Function *F, CodeGenOpt::Level Level);
+  void *getCompiledFunctionIfAvailable(const Function *F);
+  void setCompiledFunction(const Function *F, void *Addr);
 
 protected:
 
   /// getMemoryforGV - Allocate memory for a global variable.
   virtual char* getMemoryForGV(const GlobalVariable* GV);
 
+  /// globalMappingChanged - Forget the compiled address of a function whose
+  /// mapping the client changed, so getPointerToFunction does not return it.
+  virtual void globalMappingChanged(const GlobalValue *GV);
+
 };
 
 } // End llvm namespace
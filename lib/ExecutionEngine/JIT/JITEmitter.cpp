@@ -28,6 +28,7 @@
 #include "llvm/CodeGen/MachineModuleInfo.h"
 #include "llvm/CodeGen/MachineRelocation.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/JITCodeCache.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/CodeGen/MachineCodeInfo.h"
@@ -38,6 +39,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/Support/raw_ostream.h"
@@ -58,6 +60,7 @@ using namespace llvm;
 STATISTIC(NumBytes, "Number of bytes of machine code compiled");
 STATISTIC(NumRelos, "Number of relocations applied");
 STATISTIC(NumRetries, "Number of retries with more memory");
+STATISTIC(NumCached, "Number of functions loaded from the code cache");
 
 
 // A declaration may stop being a declaration once it's fully read from bitcode.
@@ -371,13 +374,19 @@ namespace {
 
     DILocation PrevDLT;
 
+    /// CodeCacheFn, CodeCacheKey - The function whose machine code should be
+    /// added to the JIT's code cache once it has been emitted, and the key to
+    /// store it under.
+    const Function *CodeCacheFn;
+    std::string CodeCacheKey;
+
     /// Instance of the JIT
     JIT *TheJIT;
 
   public:
     JITEmitter(JIT &jit, JITMemoryManager *JMM, TargetMachine &TM)
       : SizeEstimate(0), Resolver(jit, *this), MMI(0), CurFn(0),
-        EmittedFunctions(this), PrevDLT(NULL), TheJIT(&jit) {
+        EmittedFunctions(this), PrevDLT(NULL), CodeCacheFn(0), TheJIT(&jit) {
       MemMgr = JMM ? JMM : JITMemoryManager::CreateDefaultMemManager();
       if (jit.getJITInfo().needsGOT()) {
         MemMgr->AllocateGOT();
@@ -479,7 +488,25 @@ namespace {
 
     JITMemoryManager *getMemMgr() const { return MemMgr; }
 
+    /// canUseCodeCache - Return true if functions emitted by this emitter may
+    /// be loaded from, and added to, a JITCodeCache.
+    bool canUseCodeCache() const;
+
+    /// setCodeCacheKey - Add the code that is about to be emitted for F to the
+    /// JIT's code cache, under the specified key.
+    void setCodeCacheKey(const Function *F, StringRef Key) {
+      CodeCacheFn = F;
+      CodeCacheKey = Key;
+    }
+
+    /// emitCachedFunction - Copy the machine code for F out of a blob which was
+    /// produced by encodeCachedFunction, link it and make it F's code.  Returns
+    /// false, without having emitted anything, if the blob cannot be used.
+    bool emitCachedFunction(Function *F, StringRef Blob);
+
   private:
+    void encodeCachedFunction(MachineFunction &F, uint8_t *FnStart,
+                              uint8_t *FnEnd, std::string &Blob);
     void *getPointerToGlobal(GlobalValue *GV, void *Reference,
                              bool MayNeedFarStub);
     void *getPointerToGVIndirectSym(GlobalValue *V, void *Reference);
@@ -1122,6 +1149,12 @@ bool JITEmitter::finishFunction(MachineFunction &F) {
   // FnEnd is the end of the function's machine code.
   uint8_t *FnEnd = CurBufferPtr;
 
+  // If the code is to be added to the code cache, capture it before it is
+  // relocated.
+  std::string CachedCode;
+  if (CodeCacheFn == F.getFunction())
+    encodeCachedFunction(F, FnStart, FnEnd, CachedCode);
+
   if (!Relocations.empty()) {
     CurFn = F.getFunction();
     NumRelos += Relocations.size();
@@ -1203,6 +1236,13 @@ bool JITEmitter::finishFunction(MachineFunction &F) {
     SizeEstimate = 0;
   }
 
+  if (CodeCacheFn == F.getFunction()) {
+    if (!CachedCode.empty() && TheJIT->getJITCodeCache())
+      TheJIT->getJITCodeCache()->store(CodeCacheKey, CachedCode);
+    CodeCacheFn = 0;
+    CodeCacheKey.clear();
+  }
+
   BufferBegin = CurBufferPtr = 0;
   NumBytes += FnEnd-FnStart;
 
@@ -1297,6 +1337,255 @@ bool JITEmitter::finishFunction(MachineFunction &F) {
   return false;
 }
 
+//===----------------------------------------------------------------------===//
+// Code cache support.
+//
+// A function's entry in the code cache holds the bytes of its allocation from
+// the start of the block up to the end of its code (the constant pool and the
+// code, before relocation), and the relocations to apply to them.  Everything
+// is stored as 64-bit little-endian words:
+//
+//   Skew CodeOffset Size <Size bytes> NumRelocs
+//   { Kind Offset Type ConstantVal MayNeedFarStub Target NameLength <Name> }*
+//
+// Skew is the block's start address modulo 16.  A cached function is loaded at
+// an address with the same skew, so the alignment of the constant pool and the
+// code does not change, and so offsets relative to the start of the block
+// (which is what TargetJITInfo::relocate works with) stay valid.  Relocations
+// against basic blocks and constant pool entries are stored as a Target offset
+// within the block, the others refer to a global value or external symbol by
+// Name.
+//
+namespace {
+  enum CachedRelocationKind {
+    CachedGlobalValue,
+    CachedExternalSymbol,
+    CachedBlockOffset
+  };
+
+  class CachedCodeReader {
+    StringRef Data;
+    bool Failed;
+  public:
+    explicit CachedCodeReader(StringRef data) : Data(data), Failed(false) {}
+
+    bool failed() const { return Failed; }
+    bool atEnd() const { return Data.empty(); }
+
+    uint64_t readWord() {
+      if (Failed || Data.size() < 8) {
+        Failed = true;
+        return 0;
+      }
+      uint64_t V = 0;
+      for (unsigned i = 0; i != 8; ++i)
+        V |= uint64_t((unsigned char)Data[i]) << (i * 8);
+      Data = Data.substr(8);
+      return V;
+    }
+
+    StringRef readBytes(uint64_t Size) {
+      if (Failed || Data.size() < Size) {
+        Failed = true;
+        return StringRef();
+      }
+      StringRef Result = Data.substr(0, Size);
+      Data = Data.substr(Size);
+      return Result;
+    }
+  };
+
+  struct CachedRelocation {
+    unsigned Kind;
+    uintptr_t Offset;
+    unsigned Type;
+    intptr_t ConstantVal;
+    bool MayNeedFarStub;
+    uintptr_t Target;
+    std::string Name;
+  };
+}
+
+static void writeCachedWord(std::string &Blob, uint64_t V) {
+  for (unsigned i = 0; i != 8; ++i)
+    Blob += char(V >> (i * 8));
+}
+
+bool JITEmitter::canUseCodeCache() const {
+  // Exception tables and debug info refer to the code through absolute
+  // addresses that are not recorded as relocations, and GOT entries and custom
+  // constant pools live outside of the function's block.
+  return !DwarfExceptionHandling && !JITEmitDebugInfo &&
+         !MemMgr->isManagingGOT() &&
+         !TheJIT->getJITInfo().hasCustomConstantPool();
+}
+
+/// encodeCachedFunction - Fill in Blob with the code cache entry for F, whose
+/// code is at [FnStart, FnEnd) and has not been relocated yet.  Blob is left
+/// empty if F's code cannot be cached.
+void JITEmitter::encodeCachedFunction(MachineFunction &F, uint8_t *FnStart,
+                                      uint8_t *FnEnd, std::string &Blob) {
+  // Jump tables hold absolute addresses without relocations, and a larger
+  // alignment than the skew preserves would be lost when loading the code.
+  if (F.getJumpTableInfo() && !F.getJumpTableInfo()->isEmpty())
+    return;
+  if (F.getFunction()->getAlignment() > 16 ||
+      F.getConstantPool()->getConstantPoolAlignment() > 16)
+    return;
+
+  uintptr_t Size = FnEnd - BufferBegin;
+  writeCachedWord(Blob, (uintptr_t)BufferBegin & 15);
+  writeCachedWord(Blob, FnStart - BufferBegin);
+  writeCachedWord(Blob, Size);
+  Blob.append((const char*)BufferBegin, Size);
+  writeCachedWord(Blob, Relocations.size());
+
+  for (unsigned i = 0, e = Relocations.size(); i != e; ++i) {
+    MachineRelocation &MR = Relocations[i];
+    if (MR.letTargetResolve() || MR.isGOTRelative() ||
+        MR.getMachineCodeOffset() >= Size) {
+      Blob.clear();
+      return;
+    }
+
+    unsigned Kind;
+    uintptr_t Target = 0;
+    StringRef Name;
+    if (MR.isExternalSymbol()) {
+      Kind = CachedExternalSymbol;
+      Name = MR.getExternalSymbol();
+    } else if (MR.isGlobalValue() && MR.getGlobalValue()->hasName()) {
+      Kind = CachedGlobalValue;
+      Name = MR.getGlobalValue()->getName();
+    } else if (MR.isBasicBlock()) {
+      Kind = CachedBlockOffset;
+      Target = getMachineBasicBlockAddress(MR.getBasicBlock()) -
+               (uintptr_t)BufferBegin;
+    } else if (MR.isConstantPoolIndex()) {
+      Kind = CachedBlockOffset;
+      Target = getConstantPoolEntryAddress(MR.getConstantPoolIndex()) -
+               (uintptr_t)BufferBegin;
+    } else {
+      // Indirect symbols, jump tables and unnamed globals.
+      Blob.clear();
+      return;
+    }
+
+    writeCachedWord(Blob, Kind);
+    writeCachedWord(Blob, MR.getMachineCodeOffset());
+    writeCachedWord(Blob, MR.getRelocationType());
+    writeCachedWord(Blob, MR.getConstantVal());
+    writeCachedWord(Blob, MR.mayNeedFarStub());
+    writeCachedWord(Blob, Target);
+    writeCachedWord(Blob, Name.size());
+    Blob.append(Name.begin(), Name.end());
+  }
+}
+
+bool JITEmitter::emitCachedFunction(Function *F, StringRef Blob) {
+  // Decode and check the whole entry before emitting anything.
+  CachedCodeReader R(Blob);
+  uintptr_t Skew = R.readWord();
+  uintptr_t CodeOffset = R.readWord();
+  StringRef Code = R.readBytes(R.readWord());
+  uint64_t NumRelocs = R.readWord();
+  if (R.failed() || Skew > 15 || CodeOffset >= Code.size() ||
+      NumRelocs > Blob.size())
+    return false;
+
+  Module *M = F->getParent();
+  SmallVector<CachedRelocation, 16> CachedRelocs(NumRelocs);
+  for (unsigned i = 0; i != NumRelocs; ++i) {
+    CachedRelocation &CR = CachedRelocs[i];
+    CR.Kind = R.readWord();
+    CR.Offset = R.readWord();
+    CR.Type = R.readWord();
+    CR.ConstantVal = R.readWord();
+    CR.MayNeedFarStub = R.readWord();
+    CR.Target = R.readWord();
+    CR.Name = R.readBytes(R.readWord());
+    if (R.failed() || CR.Offset >= Code.size() || CR.Type > 63)
+      return false;
+    if (CR.Kind == CachedGlobalValue) {
+      if (!M->getNamedValue(CR.Name))
+        return false;
+    } else if (CR.Kind != CachedExternalSymbol &&
+               (CR.Kind != CachedBlockOffset || CR.Target >= Code.size())) {
+      return false;
+    }
+  }
+  if (!R.atEnd())
+    return false;
+
+  // Allocate enough memory to give the code its original skew.
+  uintptr_t NeededSize = Code.size() + 15;
+  uintptr_t ActualSize = NeededSize;
+  MemMgr->setMemoryWritable();
+  uint8_t *Body = MemMgr->startFunctionBody(F, ActualSize);
+  if (ActualSize < NeededSize) {
+    MemMgr->endFunctionBody(F, Body, Body);
+    MemMgr->deallocateFunctionBody(Body);
+    MemMgr->setMemoryExecutable();
+    return false;
+  }
+
+  uint8_t *Begin = Body + ((Skew - (uintptr_t)Body) & 15);
+  uint8_t *FnStart = Begin + CodeOffset;
+  uint8_t *FnEnd = Begin + Code.size();
+  memcpy(Begin, Code.data(), Code.size());
+
+  EmittedFunctions[F].FunctionBody = Body;
+  EmittedFunctions[F].Code = FnStart;
+  TheJIT->updateGlobalMapping(F, FnStart);
+
+  // Resolve the relocations the same way finishFunction does.
+  std::vector<MachineRelocation> Relocs;
+  Relocs.reserve(NumRelocs);
+  for (unsigned i = 0; i != NumRelocs; ++i) {
+    CachedRelocation &CR = CachedRelocs[i];
+    void *ResultPtr;
+    if (CR.Kind == CachedExternalSymbol) {
+      ResultPtr = TheJIT->getPointerToNamedFunction(CR.Name, false);
+      if (CR.MayNeedFarStub)
+        ResultPtr = Resolver.getExternalFunctionStub(ResultPtr);
+    } else if (CR.Kind == CachedGlobalValue) {
+      ResultPtr = getPointerToGlobal(M->getNamedValue(CR.Name),
+                                     Begin + CR.Offset, CR.MayNeedFarStub);
+    } else {
+      ResultPtr = Begin + CR.Target;
+    }
+
+    MachineRelocation MR =
+      MachineRelocation::getBB(CR.Offset, CR.Type, 0, CR.ConstantVal);
+    MR.setResultPointer(ResultPtr);
+    Relocs.push_back(MR);
+  }
+
+  if (!Relocs.empty()) {
+    NumRelos += Relocs.size();
+    TheJIT->getJITInfo().relocate(Begin, &Relocs[0], Relocs.size(),
+                                  MemMgr->getGOTBase());
+  }
+
+  MemMgr->endFunctionBody(F, Body, FnEnd);
+  NumBytes += FnEnd-FnStart;
+  ++NumCached;
+
+  sys::Memory::InvalidateInstructionCache(FnStart, FnEnd-FnStart);
+
+  JITEvent_EmittedFunctionDetails Details;
+  Details.MF = 0;
+  TheJIT->NotifyFunctionEmitted(*F, FnStart, FnEnd-FnStart, Details);
+
+  DEBUG(dbgs() << "JIT: Loaded [" << (void*)FnStart
+        << "] Function: " << F->getName() << " from the code cache: "
+        << (FnEnd-FnStart) << " bytes of text, "
+        << Relocs.size() << " relocations\n");
+
+  MemMgr->setMemoryExecutable();
+  return true;
+}
+
 void JITEmitter::retryWithMoreMemory(MachineFunction &F) {
   DEBUG(dbgs() << "JIT: Ran out of space for native code.  Reattempting.\n");
   Relocations.clear();  // Clear the old relocations or we'll reapply them.
@@ -1563,6 +1852,34 @@ void *JIT::getPointerToFunctionOrStub(Function *F) {
   return JE->getJITResolver().getLazyFunctionStub(F);
 }
 
+/// emitFunctionFromCache - If the code cache holds machine code for F compiled
+/// at Level, emit F from it and return true.  Otherwise return false, and have
+/// the emitter add the code that is about to be generated for F to the cache.
+bool JIT::emitFunctionFromCache(Function *F, CodeGenOpt::Level Level) {
+  JITCodeCache *Cache = getJITCodeCache();
+  if (!Cache || AllocateGVsWithCode)
+    return false;
+
+  assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
+  JITEmitter *JE = cast<JITEmitter>(getCodeEmitter());
+  if (!JE->canUseCodeCache())
+    return false;
+
+  // The key is computed from F's body, so read it in first.  Leave reporting
+  // any error to the code generator.
+  std::string ErrorMsg;
+  if (F->Materialize(&ErrorMsg))
+    return false;
+
+  std::string Key = getCodeCacheKey(F, Level);
+  OwningPtr<MemoryBuffer> Blob(Cache->lookup(Key));
+  if (Blob && JE->emitCachedFunction(F, Blob->getBuffer()))
+    return true;
+
+  JE->setCodeCacheKey(F, Key);
+  return false;
+}
+
 void JIT::updateFunctionStub(Function *F) {
   // Get the empty stub we generated earlier.
   assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
@@ -1585,6 +1902,7 @@ void JIT::freeMachineCodeForFunction(Function *F) {
   // Delete translation for this from the ExecutionEngine, so it will get
   // retranslated next time it is used.
   updateGlobalMapping(F, 0);
+  setCompiledFunction(F, 0);
 
   // Free the actual memory for the function body and related stuff.
   assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
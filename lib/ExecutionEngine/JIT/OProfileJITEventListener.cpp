@@ -120,7 +120,7 @@ void OProfileJITEventListener::NotifyFunctionEmitted(
   FilenameCache Filenames;
   std::vector<debug_line_info> LineInfo;
   LineInfo.reserve(1 + Details.LineStarts.size());
-  if (!Details.MF->getDefaultDebugLoc().isUnknown()) {
+  if (Details.MF && !Details.MF->getDefaultDebugLoc().isUnknown()) {
     LineInfo.push_back(LineStartToOProfileFormat(
         *Details.MF, Filenames,
         reinterpret_cast<uintptr_t>(FnStart),
@@ -0,0 +1,201 @@
+//===-- JITCodeCache.cpp - Persistent cache of JIT'd machine code ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the file-backed JITCodeCache.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "jit"
+#include "llvm/ExecutionEngine/JITCodeCache.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/System/Path.h"
+#include <algorithm>
+#include <set>
+#include <vector>
+using namespace llvm;
+
+STATISTIC(NumCachePruned, "Number of code cache entries removed to limit "
+                          "its size");
+
+JITCodeCache::~JITCodeCache() {}
+
+namespace {
+  /// FileJITCodeCache - Keeps each blob in its own file, named after the SHA-1
+  /// digest of the key.  The file also holds the digest so that entries are
+  /// used only when all of it matches:
+  ///
+  ///   "LLVMJITC" <digest: 20 bytes> <blob>
+  ///
+  /// New entries are written to a temporary file and renamed into place, so
+  /// concurrent readers never see a partially written entry.  After storing
+  /// an entry, the least recently used entries are removed until the directory
+  /// fits within SizeLimit bytes.
+  class FileJITCodeCache : public JITCodeCache {
+    sys::Path Directory;
+    uint64_t SizeLimit;
+
+    sys::Path getPathForDigest(StringRef Digest) const;
+    void prune(const sys::Path &Keep);
+  public:
+    FileJITCodeCache(const sys::Path &Dir, uint64_t Limit)
+      : Directory(Dir), SizeLimit(Limit) {}
+
+    virtual MemoryBuffer *lookup(StringRef Key);
+    virtual void store(StringRef Key, StringRef Blob);
+  };
+
+  /// CacheEntry - A file in the cache directory, for pruning.
+  struct CacheEntry {
+    sys::TimeValue ModTime;
+    uint64_t Size;
+    sys::Path Path;
+
+    CacheEntry(const sys::FileStatus &Status, const sys::Path &P)
+      : ModTime(Status.getTimestamp()), Size(Status.getSize()), Path(P) {}
+
+    bool operator<(const CacheEntry &RHS) const {
+      return ModTime < RHS.ModTime;
+    }
+  };
+}
+
+static const char CacheFileMagic[] = "LLVMJITC";
+static const unsigned CacheFileMagicSize = sizeof(CacheFileMagic) - 1;
+static const char CacheFileSuffix[] = ".jitcode";
+
+/// getDigest - Return the SHA-1 digest of Key.
+static std::string getDigest(StringRef Key) {
+  SHA1 Hash;
+  Hash.update(Key);
+  return Hash.final();
+}
+
+/// getPathForDigest - Return the name of the file that holds the entry for
+/// the key with the given digest.
+sys::Path FileJITCodeCache::getPathForDigest(StringRef Digest) const {
+  std::string Name;
+  for (unsigned i = 0, e = Digest.size(); i != e; ++i) {
+    unsigned char C = Digest[i];
+    Name += hexdigit(C >> 4);
+    Name += hexdigit(C & 15);
+  }
+  Name += CacheFileSuffix;
+
+  sys::Path Result(Directory);
+  Result.appendComponent(Name);
+  return Result;
+}
+
+MemoryBuffer *FileJITCodeCache::lookup(StringRef Key) {
+  std::string Digest = getDigest(Key);
+  sys::PathWithStatus P(getPathForDigest(Digest));
+  OwningPtr<MemoryBuffer> File(MemoryBuffer::getFile(P.str()));
+  if (!File)
+    return 0;
+
+  StringRef Contents = File->getBuffer();
+  unsigned HeaderSize = CacheFileMagicSize + SHA1::DigestSize;
+  if (Contents.size() < HeaderSize ||
+      !Contents.startswith(StringRef(CacheFileMagic, CacheFileMagicSize)) ||
+      Contents.substr(CacheFileMagicSize, SHA1::DigestSize) != Digest)
+    return 0;
+
+  // Mark the entry as recently used, for pruning.  setStatusInfoOnDisk
+  // mishandles fractions of a second, so leave them out.
+  if (const sys::FileStatus *Status = P.getFileStatus(false, 0)) {
+    sys::FileStatus Used = *Status;
+    Used.modTime = sys::TimeValue(sys::TimeValue::now().seconds());
+    P.setStatusInfoOnDisk(Used, 0);
+  }
+
+  StringRef Blob = Contents.substr(HeaderSize);
+  return MemoryBuffer::getMemBufferCopy(Blob.begin(), Blob.end(),
+                                        P.c_str());
+}
+
+void FileJITCodeCache::store(StringRef Key, StringRef Blob) {
+  std::string Digest = getDigest(Key);
+  sys::Path P = getPathForDigest(Digest);
+  sys::Path Tmp(P);
+  if (Tmp.createTemporaryFileOnDisk())
+    return;
+
+  {
+    std::string ErrorInfo;
+    raw_fd_ostream OS(Tmp.c_str(), ErrorInfo, raw_fd_ostream::F_Binary);
+    if (!ErrorInfo.empty()) {
+      Tmp.eraseFromDisk();
+      return;
+    }
+
+    OS << StringRef(CacheFileMagic, CacheFileMagicSize) << Digest << Blob;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      Tmp.eraseFromDisk();
+      return;
+    }
+  }
+
+  if (Tmp.renamePathOnDisk(P, 0)) {
+    Tmp.eraseFromDisk();
+    return;
+  }
+  prune(P);
+}
+
+/// prune - Remove the least recently used entries from the directory until it
+/// is within SizeLimit, but never Keep, the entry that was just added.
+void FileJITCodeCache::prune(const sys::Path &Keep) {
+  if (SizeLimit == 0)
+    return;
+
+  std::set<sys::Path> Contents;
+  if (Directory.getDirectoryContents(Contents, 0))
+    return;
+
+  std::vector<CacheEntry> Entries;
+  uint64_t TotalSize = 0;
+  for (std::set<sys::Path>::iterator I = Contents.begin(), E = Contents.end();
+       I != E; ++I) {
+    if (!StringRef(I->str()).endswith(CacheFileSuffix))
+      continue;
+    sys::PathWithStatus P(*I);
+    const sys::FileStatus *Status = P.getFileStatus(false, 0);
+    if (!Status || Status->isDir)
+      continue;
+    Entries.push_back(CacheEntry(*Status, *I));
+    TotalSize += Status->getSize();
+  }
+
+  std::sort(Entries.begin(), Entries.end());
+  for (unsigned i = 0, e = Entries.size(); i != e && TotalSize > SizeLimit;
+       ++i) {
+    if (Entries[i].Path == Keep)
+      continue;
+    // Another process may have removed it already; that is fine too.
+    Entries[i].Path.eraseFromDisk();
+    TotalSize -= Entries[i].Size;
+    ++NumCachePruned;
+  }
+}
+
+JITCodeCache *llvm::createFileJITCodeCache(StringRef Directory,
+                                           uint64_t SizeLimit,
+                                           std::string *ErrMsg) {
+  sys::Path Dir(Directory);
+  if (!Dir.exists() && Dir.createDirectoryOnDisk(true, ErrMsg))
+    return 0;
+  return new FileJITCodeCache(Dir, SizeLimit);
+}
@@ -0,0 +1,586 @@
+//===- lib/MC/ELFObjectWriter.cpp - ELF File Writer -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements ELF object file writer information.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/MC/ELFObjectWriter.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/MC/MCAsmLayout.h"
+#include "llvm/MC/MCAssembler.h"
+#include "llvm/MC/MCELFSymbolFlags.h"
+#include "llvm/MC/MCExpr.h"
+#include "llvm/MC/MCObjectWriter.h"
+#include "llvm/MC/MCSectionELF.h"
+#include "llvm/MC/MCSymbol.h"
+#include "llvm/MC/MCValue.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Target/TargetAsmBackend.h"
+#include <vector>
+using namespace llvm;
+
+namespace {
+
+class ELFObjectWriter : public MCObjectWriter {
+  // See <elf.h>.
+  enum {
+    ELF32HeaderSize = 52, ELF64HeaderSize = 64,
+    ELF32SectionHeaderSize = 40, ELF64SectionHeaderSize = 64,
+    ELF32SymbolSize = 16, ELF64SymbolSize = 24,
+    ELF32RelSize = 8, ELF32RelaSize = 12,
+    ELF64RelSize = 16, ELF64RelaSize = 24
+  };
+
+  /// ELFSymbolData - Helper struct for containing some precomputed information
+  /// on symbols.
+  struct ELFSymbolData {
+    MCSymbolData *SymbolData;
+    uint64_t StringIndex;
+    uint16_t SectionIndex;
+  };
+
+  /// ELFRelocationEntry - A relocation, in section relative terms.
+  struct ELFRelocationEntry {
+    uint64_t Offset;
+    unsigned SymbolIndex;
+    unsigned Type;
+    int64_t Addend;
+  };
+
+  /// @name Relocation Data
+  /// @{
+
+  DenseMap<const MCSectionData*,
+           std::vector<ELFRelocationEntry> > Relocations;
+
+  /// @}
+  /// @name Symbol Table Data
+  /// @{
+
+  /// SectionIndexMap - The ELF section header index of each section.
+  DenseMap<const MCSection*, unsigned> SectionIndexMap;
+
+  SmallString<256> StringTable;
+  std::vector<ELFSymbolData> LocalSymbolData;
+  std::vector<ELFSymbolData> ExternalSymbolData;
+
+  /// @}
+
+  unsigned Is64Bit : 1;
+
+  /// HasRelocationAddend - Whether relocations carry an explicit addend
+  /// (.rela sections) rather than storing it in the relocated data (.rel).
+  unsigned HasRelocationAddend : 1;
+
+  unsigned EMachine;
+
+public:
+  ELFObjectWriter(raw_ostream &_OS, bool _Is64Bit, bool _IsLittleEndian,
+                  unsigned _EMachine)
+    : MCObjectWriter(_OS, _IsLittleEndian),
+      Is64Bit(_Is64Bit), HasRelocationAddend(_EMachine == ELF::EM_X86_64),
+      EMachine(_EMachine) {
+  }
+
+  /// WriteWord - Write an address sized value.
+  void WriteWord(uint64_t Value) {
+    if (Is64Bit)
+      Write64(Value);
+    else
+      Write32(uint32_t(Value));
+  }
+
+  void WriteHeader(uint64_t SectionHeaderOffset, unsigned NumSections,
+                   unsigned ShStrTabIndex) {
+    // Note that WriteWord writes 4 bytes for ELF32 and 8 bytes for ELF64.
+    Write8(0x7f); // e_ident[EI_MAG0]
+    Write8('E');  // e_ident[EI_MAG1]
+    Write8('L');  // e_ident[EI_MAG2]
+    Write8('F');  // e_ident[EI_MAG3]
+
+    Write8(Is64Bit ? ELF::ELFCLASS64 : ELF::ELFCLASS32); // e_ident[EI_CLASS]
+
+    // e_ident[EI_DATA]
+    Write8(isLittleEndian() ? ELF::ELFDATA2LSB : ELF::ELFDATA2MSB);
+
+    Write8(1); // e_ident[EI_VERSION] = EV_CURRENT
+    Write8(0); // e_ident[EI_OSABI] = ELFOSABI_NONE
+    Write8(0); // e_ident[EI_ABIVERSION]
+
+    WriteZeros(16 - 9); // Pad to EI_NIDENT.
+
+    Write16(ELF::ET_REL); // e_type
+    Write16(EMachine);    // e_machine = target
+    Write32(1);           // e_version = EV_CURRENT
+    WriteWord(0);         // e_entry, no entry point in .o file
+    WriteWord(0);         // e_phoff, no program header for .o
+    WriteWord(SectionHeaderOffset); // e_shoff
+    Write32(0);           // e_flags
+
+    Write16(Is64Bit ? ELF64HeaderSize : ELF32HeaderSize); // e_ehsize
+    Write16(0);           // e_phentsize = prog header entry size
+    Write16(0);           // e_phnum = # prog header entries = 0
+
+    // e_shentsize = Section header entry size
+    Write16(Is64Bit ? ELF64SectionHeaderSize : ELF32SectionHeaderSize);
+    Write16(NumSections); // e_shnum = # of section header ents
+    Write16(ShStrTabIndex); // e_shstrndx = Section # of '.shstrtab'
+  }
+
+  void WriteSymbolEntry(uint32_t Name, uint8_t Info, uint8_t Other,
+                        uint16_t SectionIndex, uint64_t Value, uint64_t Size) {
+    if (Is64Bit) {
+      Write32(Name);         // st_name
+      Write8(Info);          // st_info
+      Write8(Other);         // st_other
+      Write16(SectionIndex); // st_shndx
+      Write64(Value);        // st_value
+      Write64(Size);         // st_size
+    } else {
+      Write32(Name);         // st_name
+      Write32(Value);        // st_value
+      Write32(Size);         // st_size
+      Write8(Info);          // st_info
+      Write8(Other);         // st_other
+      Write16(SectionIndex); // st_shndx
+    }
+  }
+
+  void WriteSymbol(MCAsmLayout &Layout, const ELFSymbolData &MSD,
+                   bool IsLocal) {
+    MCSymbolData &Data = *MSD.SymbolData;
+    const MCSymbol &Symbol = Data.getSymbol();
+    uint32_t Flags = Data.getFlags();
+
+    uint8_t Binding = ELF::STB_LOCAL;
+    if (!IsLocal)
+      Binding = (Flags & ELF_STB_Mask) == ELF_STB_Weak ? ELF::STB_WEAK :
+        ELF::STB_GLOBAL;
+
+    uint8_t Type = (Flags & ELF_STT_Mask) >> ELF_STT_Shift;
+    if (Data.isCommon() && Type == ELF::STT_NOTYPE)
+      Type = ELF::STT_OBJECT;
+
+    uint8_t Visibility = (Flags & ELF_STV_Mask) >> ELF_STV_Shift;
+
+    uint64_t Value = 0, Size = 0;
+    if (Data.isCommon()) {
+      // The value of a common symbol is its alignment.
+      Value = Data.getCommonAlignment();
+      Size = Data.getCommonSize();
+    } else if (Symbol.isAbsolute()) {
+      int64_t Res;
+      if (Symbol.isVariable() &&
+          Symbol.getValue()->EvaluateAsAbsolute(Res, &Layout))
+        Value = Res;
+    } else if (Symbol.isDefined()) {
+      const MCSectionData &SD =
+        Layout.getAssembler().getSectionData(Symbol.getSection());
+      Value = Data.getAddress() - SD.getAddress();
+    }
+
+    if (const MCExpr *ESize = Data.getSize()) {
+      // The size is usually the difference of two labels in the same section
+      // (for example, '.size foo, .Ltmp0-foo'), which we can resolve now that
+      // layout is complete.
+      MCValue Res;
+      if (!ESize->EvaluateAsRelocatable(Res, &Layout))
+        llvm_report_error("Size expression for symbol '" + Symbol.getName() +
+                          "' must be an absolute expression");
+      Size = Res.getConstant();
+      if (!Res.isAbsolute()) {
+        const MCSymbol *A = Res.getSymA(), *B = Res.getSymB();
+        if (!B || !A->isDefined() || !B->isDefined() ||
+            &A->getSection() != &B->getSection())
+          llvm_report_error("Size expression for symbol '" + Symbol.getName() +
+                            "' must be an absolute expression");
+        MCAssembler &Asm = Layout.getAssembler();
+        Size += Asm.getSymbolData(*A).getAddress() -
+                Asm.getSymbolData(*B).getAddress();
+      }
+    }
+
+    WriteSymbolEntry(MSD.StringIndex, (Binding << 4) | Type, Visibility,
+                     MSD.SectionIndex, Value, Size);
+  }
+
+  void WriteSecHdrEntry(uint32_t Name, uint32_t Type, uint64_t Flags,
+                        uint64_t Offset, uint64_t Size, uint32_t Link,
+                        uint32_t Info, uint64_t Alignment, uint64_t EntrySize) {
+    Write32(Name);      // sh_name: index into string table
+    Write32(Type);      // sh_type
+    WriteWord(Flags);   // sh_flags
+    WriteWord(0);       // sh_addr: address where section is loaded
+    WriteWord(Offset);  // sh_offset: offset in file
+    WriteWord(Size);    // sh_size: size of section in file
+    Write32(Link);      // sh_link: section index of associated section
+    Write32(Info);      // sh_info: extra section information
+    WriteWord(Alignment); // sh_addralign: alignment of section
+    WriteWord(EntrySize); // sh_entsize: size of entries in the section
+  }
+
+  void WriteRelocationEntry(const ELFRelocationEntry &Entry) {
+    if (Is64Bit) {
+      Write64(Entry.Offset);
+      Write64((uint64_t(Entry.SymbolIndex) << 32) | Entry.Type);
+      if (HasRelocationAddend)
+        Write64(Entry.Addend);
+    } else {
+      Write32(uint32_t(Entry.Offset));
+      Write32((Entry.SymbolIndex << 8) | (Entry.Type & 0xFF));
+      if (HasRelocationAddend)
+        Write32(uint32_t(Entry.Addend));
+    }
+  }
+
+  /// getEntrySize - Return the sh_entsize of a mergeable section, which the
+  /// linker requires to split it into elements.
+  static unsigned getEntrySize(const MCSectionELF &Section) {
+    SectionKind Kind = Section.getKind();
+    if (Kind.isMergeable1ByteCString()) return 1;
+    if (Kind.isMergeable2ByteCString()) return 2;
+    if (Kind.isMergeable4ByteCString()) return 4;
+    if (Kind.isMergeableConst4()) return 4;
+    if (Kind.isMergeableConst8()) return 8;
+    if (Kind.isMergeableConst16()) return 16;
+    return 0;
+  }
+
+  /// isInMergeableSection - Return true if the symbol is defined in a section
+  /// with SHF_MERGE set.  A reference to such a symbol cannot be rewritten as
+  /// section symbol plus offset: once the linker merges the section, the
+  /// offset no longer points at the same entry.
+  static bool isInMergeableSection(const MCSymbol &Symbol) {
+    if (!Symbol.isDefined() || Symbol.isAbsolute())
+      return false;
+    const MCSectionELF &Section =
+      static_cast<const MCSectionELF&>(Symbol.getSection());
+    return Section.getFlags() & MCSectionELF::SHF_MERGE;
+  }
+
+  unsigned getRelocType(bool IsPCRel, bool IsSigned, unsigned Log2Size) {
+    if (EMachine == ELF::EM_X86_64) {
+      if (IsPCRel) {
+        switch (Log2Size) {
+        case 0: return ELF::R_X86_64_PC8;
+        case 1: return ELF::R_X86_64_PC16;
+        case 2: return ELF::R_X86_64_PC32;
+        case 3: return ELF::R_X86_64_PC64;
+        }
+      } else {
+        switch (Log2Size) {
+        case 0: return ELF::R_X86_64_8;
+        case 1: return ELF::R_X86_64_16;
+        case 2: return IsSigned ? ELF::R_X86_64_32S : ELF::R_X86_64_32;
+        case 3: return ELF::R_X86_64_64;
+        }
+      }
+    } else if (EMachine == ELF::EM_386) {
+      if (IsPCRel) {
+        switch (Log2Size) {
+        case 0: return ELF::R_386_PC8;
+        case 1: return ELF::R_386_PC16;
+        case 2: return ELF::R_386_PC32;
+        }
+      } else {
+        switch (Log2Size) {
+        case 0: return ELF::R_386_8;
+        case 1: return ELF::R_386_16;
+        case 2: return ELF::R_386_32;
+        }
+      }
+    }
+
+    llvm_report_error("unsupported relocation in ELF object file");
+  }
+
+  void RecordRelocation(const MCAssembler &Asm, const MCDataFragment &Fragment,
+                        const MCAsmFixup &Fixup, MCValue Target,
+                        uint64_t &FixedValue) {
+    const MCSectionData *FixupSD = Fragment.getParent();
+    uint64_t FixupOffset = Fragment.getOffset() + Fixup.Offset;
+    uint64_t FixupAddress = Fragment.getAddress() + Fixup.Offset;
+    bool IsPCRel = Asm.getBackend().isFixupKindPCRel(Fixup.Kind);
+    bool IsSigned = Asm.getBackend().isFixupKindSignExtended(Fixup.Kind);
+    unsigned Log2Size = Asm.getBackend().getFixupKindLog2Size(Fixup.Kind);
+    int64_t Addend = Target.getConstant();
+    unsigned Index = 0;
+
+    // ELF has no symbol difference relocations, but a difference against a
+    // symbol in the fixup's own section can be rewritten as a PC relative
+    // reference: A - B + C == A - P + (P - B + C).
+    if (const MCSymbol *B = Target.getSymB()) {
+      if (IsPCRel || !B->isDefined() || B->isAbsolute() ||
+          &B->getSection() != &FixupSD->getSection())
+        llvm_report_error("unsupported symbol difference relocation against '"
+                          + B->getName() + "'");
+
+      Addend += FixupAddress - Asm.getSymbolData(*B).getAddress();
+      IsPCRel = true;
+    }
+
+    if (const MCSymbol *A = Target.getSymA()) {
+      MCSymbolData &SD = Asm.getSymbolData(*A);
+
+      if (isInMergeableSection(*A)) {
+        // The linker moves the entries of a mergeable section around, so the
+        // relocation must name the symbol, as gas does.
+        Index = SD.getIndex();
+      } else if (A->isDefined() && !A->isAbsolute() && !SD.isExternal()) {
+        // References to local symbols are made relative to the section symbol,
+        // which allows assembler temporaries to be dropped from the symbol
+        // table.
+        const MCSectionData &TargetSD = Asm.getSectionData(A->getSection());
+        Index = SectionIndexMap.lookup(&A->getSection());
+        Addend += SD.getAddress() - TargetSD.getAddress();
+      } else if (A->isTemporary()) {
+        llvm_report_error("unable to relocate against temporary symbol '" +
+                          A->getName() + "'");
+      } else {
+        Index = SD.getIndex();
+      }
+    }
+
+    ELFRelocationEntry Entry;
+    Entry.Offset = FixupOffset;
+    Entry.SymbolIndex = Index;
+    Entry.Type = getRelocType(IsPCRel, IsSigned, Log2Size);
+    Entry.Addend = Addend;
+    Relocations[FixupSD].push_back(Entry);
+
+    // With .rel sections the addend lives in the relocated data.
+    FixedValue = HasRelocationAddend ? 0 : Addend;
+  }
+
+  /// ComputeSymbolTable - Compute the symbol table data.
+  void ComputeSymbolTable(MCAssembler &Asm) {
+    // Build section lookup table; section symbols use the same indices.
+    unsigned Index = 1;
+    for (MCAssembler::iterator it = Asm.begin(),
+           ie = Asm.end(); it != ie; ++it, ++Index)
+      SectionIndexMap[&it->getSection()] = Index;
+    assert(Index < ELF::SHN_LORESERVE && "Too many sections!");
+
+    // Index 0 is always the empty string.
+    StringMap<uint64_t> StringIndexMap;
+    StringTable += '\x00';
+
+    for (MCAssembler::symbol_iterator it = Asm.symbol_begin(),
+           ie = Asm.symbol_end(); it != ie; ++it) {
+      const MCSymbol &Symbol = it->getSymbol();
+
+      // Ignore assembler temporaries, except those in mergeable sections,
+      // which relocations refer to by symbol.
+      if (Symbol.isTemporary() && !isInMergeableSection(Symbol))
+        continue;
+
+      // FIXME: Aliases of non-absolute symbols need to be resolved to their
+      // target; drop them for now.
+      if (Symbol.isVariable() && !Symbol.isAbsolute())
+        continue;
+
+      uint64_t &Entry = StringIndexMap[Symbol.getName()];
+      if (!Entry) {
+        Entry = StringTable.size();
+        StringTable += Symbol.getName();
+        StringTable += '\x00';
+      }
+
+      ELFSymbolData MSD;
+      MSD.SymbolData = it;
+      MSD.StringIndex = Entry;
+
+      if (it->isCommon())
+        MSD.SectionIndex = ELF::SHN_COMMON;
+      else if (Symbol.isUndefined())
+        MSD.SectionIndex = ELF::SHN_UNDEF;
+      else if (Symbol.isAbsolute())
+        MSD.SectionIndex = ELF::SHN_ABS;
+      else {
+        MSD.SectionIndex = SectionIndexMap.lookup(&Symbol.getSection());
+        assert(MSD.SectionIndex && "Invalid section index!");
+      }
+
+      if (it->isExternal() || Symbol.isUndefined())
+        ExternalSymbolData.push_back(MSD);
+      else
+        LocalSymbolData.push_back(MSD);
+    }
+
+    // Set the symbol indices. Local symbols must come before all other
+    // symbols, and the section symbols come first.
+    Index = Asm.size() + 1;
+    for (unsigned i = 0, e = LocalSymbolData.size(); i != e; ++i)
+      LocalSymbolData[i].SymbolData->setIndex(Index++);
+    for (unsigned i = 0, e = ExternalSymbolData.size(); i != e; ++i)
+      ExternalSymbolData[i].SymbolData->setIndex(Index++);
+  }
+
+  void ExecutePostLayoutBinding(MCAssembler &Asm) {
+    // Compute symbol table information.
+    ComputeSymbolTable(Asm);
+  }
+
+  void WriteObject(MCAssembler &Asm) {
+    MCAsmLayout Layout(Asm);
+
+    unsigned NumContentSections = Asm.size();
+    unsigned ShStrTabIndex = NumContentSections + 1;
+    unsigned SymTabIndex = NumContentSections + 2;
+    unsigned StrTabIndex = NumContentSections + 3;
+    unsigned NumSections = NumContentSections + 4;
+
+    unsigned HeaderSize = Is64Bit ? ELF64HeaderSize : ELF32HeaderSize;
+    unsigned SymbolSize = Is64Bit ? ELF64SymbolSize : ELF32SymbolSize;
+    unsigned RelEntrySize = Is64Bit ?
+      (HasRelocationAddend ? ELF64RelaSize : ELF64RelSize) :
+      (HasRelocationAddend ? ELF32RelaSize : ELF32RelSize);
+    unsigned WordAlign = Is64Bit ? 8 : 4;
+
+    // Build the section name string table, including the names of the
+    // relocation sections.
+    SmallString<256> ShStrTab;
+    ShStrTab += '\x00';
+    std::vector<unsigned> SectionNameIndices;
+    std::vector<unsigned> RelSectionNameIndices;
+    std::vector<const MCSectionData*> RelocatedSections;
+    uint64_t SectionDataSize = 0, MaxAlignment = 1;
+    for (MCAssembler::const_iterator it = Asm.begin(),
+           ie = Asm.end(); it != ie; ++it) {
+      const MCSectionELF &Section =
+        static_cast<const MCSectionELF&>(it->getSection());
+
+      SectionNameIndices.push_back(ShStrTab.size());
+      ShStrTab += Section.getSectionName();
+      ShStrTab += '\x00';
+
+      SectionDataSize += it->getFileSize();
+      if (!Section.isVirtualSection())
+        MaxAlignment = std::max(MaxAlignment, uint64_t(it->getAlignment()));
+
+      if (!Relocations.count(it))
+        continue;
+
+      RelocatedSections.push_back(it);
+      RelSectionNameIndices.push_back(ShStrTab.size());
+      ShStrTab += HasRelocationAddend ? ".rela" : ".rel";
+      ShStrTab += Section.getSectionName();
+      ShStrTab += '\x00';
+    }
+    NumSections += RelocatedSections.size();
+
+    unsigned ShStrTabName = ShStrTab.size();
+    ShStrTab += ".shstrtab";
+    ShStrTab += '\x00';
+    unsigned SymTabName = ShStrTab.size();
+    ShStrTab += ".symtab";
+    ShStrTab += '\x00';
+    unsigned StrTabName = ShStrTab.size();
+    ShStrTab += ".strtab";
+    ShStrTab += '\x00';
+
+    // Compute the file layout. The section contents were laid out
+    // contiguously by the assembler, so the data is written as one block.
+    uint64_t SectionDataStart = RoundUpToAlignment(HeaderSize, MaxAlignment);
+    uint64_t ShStrTabOffset = SectionDataStart + SectionDataSize;
+    uint64_t SymTabOffset = RoundUpToAlignment(ShStrTabOffset + ShStrTab.size(),
+                                               WordAlign);
+    unsigned NumSymbols = 1 + NumContentSections + LocalSymbolData.size() +
+      ExternalSymbolData.size();
+    uint64_t StrTabOffset = SymTabOffset + NumSymbols * SymbolSize;
+    uint64_t RelocationsOffset =
+      RoundUpToAlignment(StrTabOffset + StringTable.size(), WordAlign);
+    uint64_t NumRelocations = 0;
+    for (unsigned i = 0, e = RelocatedSections.size(); i != e; ++i)
+      NumRelocations += Relocations[RelocatedSections[i]].size();
+    uint64_t SectionHeaderOffset = RelocationsOffset +
+      NumRelocations * RelEntrySize;
+
+    // Write the file header and the section data.
+    WriteHeader(SectionHeaderOffset, NumSections, ShStrTabIndex);
+    WriteZeros(SectionDataStart - HeaderSize);
+    for (MCAssembler::const_iterator it = Asm.begin(),
+           ie = Asm.end(); it != ie; ++it)
+      Asm.WriteSectionData(it, this);
+
+    // Write the string and symbol tables.
+    WriteBytes(ShStrTab.str());
+    WriteZeros(SymTabOffset - (ShStrTabOffset + ShStrTab.size()));
+
+    WriteSymbolEntry(0, 0, 0, 0, 0, 0);
+    for (unsigned i = 0; i != NumContentSections; ++i)
+      WriteSymbolEntry(0, (ELF::STB_LOCAL << 4) | ELF::STT_SECTION, 0,
+                       i + 1, 0, 0);
+    for (unsigned i = 0, e = LocalSymbolData.size(); i != e; ++i)
+      WriteSymbol(Layout, LocalSymbolData[i], true);
+    for (unsigned i = 0, e = ExternalSymbolData.size(); i != e; ++i)
+      WriteSymbol(Layout, ExternalSymbolData[i], false);
+
+    WriteBytes(StringTable.str());
+    WriteZeros(RelocationsOffset - (StrTabOffset + StringTable.size()));
+
+    // Write the relocation entries.
+    for (unsigned i = 0, e = RelocatedSections.size(); i != e; ++i) {
+      std::vector<ELFRelocationEntry> &Relocs =
+        Relocations[RelocatedSections[i]];
+      for (unsigned j = 0, je = Relocs.size(); j != je; ++j)
+        WriteRelocationEntry(Relocs[j]);
+    }
+
+    // Write the section header table.
+    WriteSecHdrEntry(0, ELF::SHT_NULL, 0, 0, 0, 0, 0, 0, 0);
+
+    unsigned Index = 0;
+    for (MCAssembler::const_iterator it = Asm.begin(),
+           ie = Asm.end(); it != ie; ++it, ++Index) {
+      const MCSectionELF &Section =
+        static_cast<const MCSectionELF&>(it->getSection());
+      uint64_t Offset = Section.isVirtualSection() ? ShStrTabOffset :
+        SectionDataStart + it->getAddress();
+      WriteSecHdrEntry(SectionNameIndices[Index], Section.getType(),
+                       Section.getFlags(), Offset, it->getSize(), 0, 0,
+                       it->getAlignment(), getEntrySize(Section));
+    }
+
+    WriteSecHdrEntry(ShStrTabName, ELF::SHT_STRTAB, 0, ShStrTabOffset,
+                     ShStrTab.size(), 0, 0, 1, 0);
+    WriteSecHdrEntry(SymTabName, ELF::SHT_SYMTAB, 0, SymTabOffset,
+                     NumSymbols * SymbolSize, StrTabIndex,
+                     1 + NumContentSections + LocalSymbolData.size(),
+                     WordAlign, SymbolSize);
+    WriteSecHdrEntry(StrTabName, ELF::SHT_STRTAB, 0, StrTabOffset,
+                     StringTable.size(), 0, 0, 1, 0);
+
+    uint64_t RelocationOffset = RelocationsOffset;
+    for (unsigned i = 0, e = RelocatedSections.size(); i != e; ++i) {
+      const MCSectionData *SD = RelocatedSections[i];
+      uint64_t Size = Relocations[SD].size() * RelEntrySize;
+      WriteSecHdrEntry(RelSectionNameIndices[i],
+                       HasRelocationAddend ? ELF::SHT_RELA : ELF::SHT_REL, 0,
+                       RelocationOffset, Size, SymTabIndex,
+                       SectionIndexMap.lookup(&SD->getSection()),
+                       WordAlign, RelEntrySize);
+      RelocationOffset += Size;
+    }
+  }
+};
+
+}
+
+MCObjectWriter *llvm::createELFObjectWriter(raw_ostream &OS, bool Is64Bit,
+                                            bool IsLittleEndian,
+                                            unsigned EMachine) {
+  return new ELFObjectWriter(OS, Is64Bit, IsLittleEndian, EMachine);
+}
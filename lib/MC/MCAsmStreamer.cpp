@@ -68,6 +68,10 @@ public:
   /// all.
   virtual bool isVerboseAsm() const { return IsVerboseAsm; }
 
+  /// hasRawTextSupport - We write assembly text, so directives may be printed
+  /// to the output directly.
+  virtual bool hasRawTextSupport() const { return true; }
+
   /// AddComment - Add a comment that can be emitted to the generated .s
   /// file if applicable as a QoI issue to make the output of the compiler
   /// more readable.  This only affects the MCAsmStreamer, and only when
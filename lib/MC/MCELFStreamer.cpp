@@ -0,0 +1,434 @@
+//===- lib/MC/MCELFStreamer.cpp - ELF Object Output -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file assembles .s files and emits ELF .o object files.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/MC/MCStreamer.h"
+
+#include "llvm/MC/MCAssembler.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCCodeEmitter.h"
+#include "llvm/MC/MCELFSymbolFlags.h"
+#include "llvm/MC/MCExpr.h"
+#include "llvm/MC/MCInst.h"
+#include "llvm/MC/MCSectionELF.h"
+#include "llvm/MC/MCSymbol.h"
+#include "llvm/MC/SectionKind.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+namespace {
+
+class MCELFStreamer : public MCStreamer {
+private:
+  MCAssembler Assembler;
+  MCCodeEmitter *Emitter;
+  MCSectionData *CurSectionData;
+
+  /// LocalSymbols - Symbols which have been explicitly marked with '.local';
+  /// a later '.comm' of such a symbol allocates it in .bss instead of making
+  /// it a global common symbol.
+  SmallPtrSet<const MCSymbol*, 16> LocalSymbols;
+
+  /// BSSSection - The section used for local common symbols, created lazily.
+  const MCSection *BSSSection;
+
+private:
+  MCFragment *getCurrentFragment() const {
+    assert(CurSectionData && "No current section!");
+
+    if (!CurSectionData->empty())
+      return &CurSectionData->getFragmentList().back();
+
+    return 0;
+  }
+
+  /// SetSymbolFlags - Replace the bits of \arg SD's flags selected by \arg Mask
+  /// with \arg Value.
+  static void SetSymbolFlags(MCSymbolData &SD, unsigned Value, unsigned Mask) {
+    SD.setFlags((SD.getFlags() & ~Mask) | Value);
+  }
+
+  const MCSection *getBSSSection();
+
+  /// EmitLocalCommon - Allocate \arg Size bytes for \arg Symbol in .bss.
+  void EmitLocalCommon(MCSymbol *Symbol, uint64_t Size, unsigned ByteAlignment);
+
+public:
+  MCELFStreamer(MCContext &Context, TargetAsmBackend &TAB,
+                raw_ostream &_OS, MCCodeEmitter *_Emitter)
+    : MCStreamer(Context), Assembler(Context, TAB, _OS), Emitter(_Emitter),
+      CurSectionData(0), BSSSection(0) {}
+  ~MCELFStreamer() {}
+
+  const MCExpr *AddValueSymbols(const MCExpr *Value) {
+    switch (Value->getKind()) {
+    case MCExpr::Target: {
+      // These are the @GOT, @PLT and thread-local references, which need
+      // relocations the ELF writer does not know about yet.  Position
+      // independent code is refused up front (see LLVMTargetMachine), but
+      // thread-local variables still get here.
+      std::string Str;
+      raw_string_ostream OS(Str);
+      Value->print(OS);
+      llvm_report_error("ELF object emission does not support the reference '"
+                        + OS.str() + "'; use -filetype=asm instead");
+    }
+    case MCExpr::Constant:
+      break;
+
+    case MCExpr::Binary: {
+      const MCBinaryExpr *BE = cast<MCBinaryExpr>(Value);
+      AddValueSymbols(BE->getLHS());
+      AddValueSymbols(BE->getRHS());
+      break;
+    }
+
+    case MCExpr::SymbolRef:
+      Assembler.getOrCreateSymbolData(
+        cast<MCSymbolRefExpr>(Value)->getSymbol());
+      break;
+
+    case MCExpr::Unary:
+      AddValueSymbols(cast<MCUnaryExpr>(Value)->getSubExpr());
+      break;
+    }
+
+    return Value;
+  }
+
+  /// @name MCStreamer Interface
+  /// @{
+
+  virtual void SwitchSection(const MCSection *Section);
+  virtual void EmitLabel(MCSymbol *Symbol);
+  virtual void EmitAssemblerFlag(MCAssemblerFlag Flag);
+  virtual void EmitAssignment(MCSymbol *Symbol, const MCExpr *Value);
+  virtual void EmitSymbolAttribute(MCSymbol *Symbol, MCSymbolAttr Attribute);
+  virtual void EmitSymbolDesc(MCSymbol *Symbol, unsigned DescValue) {
+    assert(0 && "ELF doesn't support this directive");
+  }
+  virtual void EmitCommonSymbol(MCSymbol *Symbol, uint64_t Size,
+                                unsigned ByteAlignment);
+  virtual void EmitELFSize(MCSymbol *Symbol, const MCExpr *Value);
+  virtual void EmitLocalCommonSymbol(MCSymbol *Symbol, uint64_t Size);
+  virtual void EmitZerofill(const MCSection *Section, MCSymbol *Symbol = 0,
+                            unsigned Size = 0, unsigned ByteAlignment = 0) {
+    assert(0 && "ELF doesn't support this directive");
+  }
+  virtual void EmitBytes(StringRef Data, unsigned AddrSpace);
+  virtual void EmitValue(const MCExpr *Value, unsigned Size,unsigned AddrSpace);
+  virtual void EmitGPRel32Value(const MCExpr *Value) {
+    assert(0 && "ELF doesn't support this directive");
+  }
+  virtual void EmitValueToAlignment(unsigned ByteAlignment, int64_t Value = 0,
+                                    unsigned ValueSize = 1,
+                                    unsigned MaxBytesToEmit = 0);
+  virtual void EmitCodeAlignment(unsigned ByteAlignment,
+                                 unsigned MaxBytesToEmit = 0);
+  virtual void EmitValueToOffset(const MCExpr *Offset,
+                                 unsigned char Value = 0);
+
+  // FIXME: These should produce an STT_FILE symbol and .debug_line data; for
+  // now they are dropped, which only affects debug information.
+  virtual void EmitFileDirective(StringRef Filename) {}
+  virtual void EmitDwarfFileDirective(unsigned FileNo, StringRef Filename) {}
+
+  virtual void EmitInstruction(const MCInst &Inst);
+  virtual void Finish();
+
+  /// @}
+};
+
+} // end anonymous namespace.
+
+const MCSection *MCELFStreamer::getBSSSection() {
+  if (BSSSection)
+    return BSSSection;
+
+  // Reuse the .bss section if the client already switched to it.
+  for (MCAssembler::iterator it = Assembler.begin(),
+         ie = Assembler.end(); it != ie; ++it) {
+    const MCSectionELF &Section =
+      static_cast<const MCSectionELF&>(it->getSection());
+    if (Section.getSectionName() == ".bss")
+      return BSSSection = &Section;
+  }
+
+  return BSSSection =
+    MCSectionELF::Create(".bss", MCSectionELF::SHT_NOBITS,
+                         MCSectionELF::SHF_WRITE | MCSectionELF::SHF_ALLOC,
+                         SectionKind::getBSS(), false, getContext());
+}
+
+void MCELFStreamer::SwitchSection(const MCSection *Section) {
+  assert(Section && "Cannot switch to a null section!");
+
+  // If already in this section, then this is a noop.
+  if (Section == CurSection) return;
+
+  CurSection = Section;
+  CurSectionData = &Assembler.getOrCreateSectionData(*Section);
+}
+
+void MCELFStreamer::EmitLabel(MCSymbol *Symbol) {
+  assert(Symbol->isUndefined() && "Cannot define a symbol twice!");
+
+  // FIXME: We should also use offsets into Fill fragments.
+  MCDataFragment *F = dyn_cast_or_null<MCDataFragment>(getCurrentFragment());
+  if (!F)
+    F = new MCDataFragment(CurSectionData);
+
+  MCSymbolData &SD = Assembler.getOrCreateSymbolData(*Symbol);
+  assert(!SD.getFragment() && "Unexpected fragment on symbol data!");
+  SD.setFragment(F);
+  SD.setOffset(F->getContents().size());
+
+  Symbol->setSection(*CurSection);
+}
+
+void MCELFStreamer::EmitAssemblerFlag(MCAssemblerFlag Flag) {
+  switch (Flag) {
+  case MCAF_SubsectionsViaSymbols:
+    assert(0 && "ELF doesn't support this directive");
+    return;
+  }
+
+  assert(0 && "invalid assembler flag!");
+}
+
+void MCELFStreamer::EmitAssignment(MCSymbol *Symbol, const MCExpr *Value) {
+  // Only absolute symbols can be redefined.
+  assert((Symbol->isUndefined() || Symbol->isAbsolute()) &&
+         "Cannot define a symbol twice!");
+
+  // FIXME: Lift context changes into super class.
+  // FIXME: Set associated section.
+  Symbol->setValue(AddValueSymbols(Value));
+}
+
+void MCELFStreamer::EmitSymbolAttribute(MCSymbol *Symbol,
+                                        MCSymbolAttr Attribute) {
+  // Adding a symbol attribute always introduces the symbol, note that an
+  // important side effect of calling getOrCreateSymbolData here is to register
+  // the symbol with the assembler.
+  MCSymbolData &SD = Assembler.getOrCreateSymbolData(*Symbol);
+
+  switch (Attribute) {
+  case MCSA_Invalid:
+  case MCSA_IndirectSymbol:
+  case MCSA_LazyReference:
+  case MCSA_NoDeadStrip:
+  case MCSA_PrivateExtern:
+  case MCSA_Reference:
+  case MCSA_WeakDefinition:
+  case MCSA_WeakReference:
+    assert(0 && "Invalid symbol attribute for ELF!");
+    break;
+
+  case MCSA_Global:
+    SD.setExternal(true);
+    LocalSymbols.erase(Symbol);
+    break;
+
+  case MCSA_Weak:
+    SD.setExternal(true);
+    SetSymbolFlags(SD, ELF_STB_Weak, ELF_STB_Mask);
+    LocalSymbols.erase(Symbol);
+    break;
+
+  case MCSA_Local:
+    SD.setExternal(false);
+    SetSymbolFlags(SD, ELF_STB_Local, ELF_STB_Mask);
+    LocalSymbols.insert(Symbol);
+    break;
+
+  case MCSA_ELF_TypeFunction:
+    SetSymbolFlags(SD, ELF_STT_Func, ELF_STT_Mask);
+    break;
+
+  case MCSA_ELF_TypeIndFunction:
+    SetSymbolFlags(SD, ELF_STT_GnuIFunc, ELF_STT_Mask);
+    break;
+
+  case MCSA_ELF_TypeObject:
+    SetSymbolFlags(SD, ELF_STT_Object, ELF_STT_Mask);
+    break;
+
+  case MCSA_ELF_TypeTLS:
+    SetSymbolFlags(SD, ELF_STT_Tls, ELF_STT_Mask);
+    break;
+
+  case MCSA_ELF_TypeCommon:
+    SetSymbolFlags(SD, ELF_STT_Common, ELF_STT_Mask);
+    break;
+
+  case MCSA_ELF_TypeNoType:
+    SetSymbolFlags(SD, ELF_STT_Notype, ELF_STT_Mask);
+    break;
+
+  case MCSA_Protected:
+    SetSymbolFlags(SD, ELF_STV_Protected, ELF_STV_Mask);
+    break;
+
+  case MCSA_Hidden:
+    SetSymbolFlags(SD, ELF_STV_Hidden, ELF_STV_Mask);
+    break;
+
+  case MCSA_Internal:
+    SetSymbolFlags(SD, ELF_STV_Internal, ELF_STV_Mask);
+    break;
+  }
+}
+
+void MCELFStreamer::EmitLocalCommon(MCSymbol *Symbol, uint64_t Size,
+                                    unsigned ByteAlignment) {
+  assert(Symbol->isUndefined() && "Cannot define a symbol twice!");
+
+  const MCSection *Section = getBSSSection();
+  MCSectionData &SectData = Assembler.getOrCreateSectionData(*Section);
+
+  MCSymbolData &SD = Assembler.getOrCreateSymbolData(*Symbol);
+  SD.setExternal(false);
+
+  MCFragment *F = new MCZeroFillFragment(Size, ByteAlignment, &SectData);
+  SD.setFragment(F);
+  // Like the assembler, give the symbol the size of the common block.
+  if (!SD.getSize())
+    SD.setSize(MCConstantExpr::Create(Size, getContext()));
+
+  Symbol->setSection(*Section);
+
+  // Update the maximum alignment on the .bss section if necessary.
+  if (ByteAlignment > SectData.getAlignment())
+    SectData.setAlignment(ByteAlignment);
+}
+
+void MCELFStreamer::EmitCommonSymbol(MCSymbol *Symbol, uint64_t Size,
+                                     unsigned ByteAlignment) {
+  if (LocalSymbols.count(Symbol)) {
+    EmitLocalCommon(Symbol, Size, ByteAlignment);
+    return;
+  }
+
+  assert(Symbol->isUndefined() && "Cannot define a symbol twice!");
+
+  MCSymbolData &SD = Assembler.getOrCreateSymbolData(*Symbol);
+  SD.setExternal(true);
+  SD.setCommon(Size, ByteAlignment);
+}
+
+void MCELFStreamer::EmitLocalCommonSymbol(MCSymbol *Symbol, uint64_t Size) {
+  // FIXME: .lcomm doesn't carry an alignment; 'as' picks one based on the
+  // size, we just use byte alignment.
+  EmitLocalCommon(Symbol, Size, 1);
+}
+
+void MCELFStreamer::EmitELFSize(MCSymbol *Symbol, const MCExpr *Value) {
+  Assembler.getOrCreateSymbolData(*Symbol).setSize(AddValueSymbols(Value));
+}
+
+void MCELFStreamer::EmitBytes(StringRef Data, unsigned AddrSpace) {
+  MCDataFragment *DF = dyn_cast_or_null<MCDataFragment>(getCurrentFragment());
+  if (!DF)
+    DF = new MCDataFragment(CurSectionData);
+  DF->getContents().append(Data.begin(), Data.end());
+}
+
+void MCELFStreamer::EmitValue(const MCExpr *Value, unsigned Size,
+                              unsigned AddrSpace) {
+  MCDataFragment *DF = dyn_cast_or_null<MCDataFragment>(getCurrentFragment());
+  if (!DF)
+    DF = new MCDataFragment(CurSectionData);
+
+  // Avoid fixups when possible.
+  int64_t AbsValue;
+  if (AddValueSymbols(Value)->EvaluateAsAbsolute(AbsValue)) {
+    // FIXME: Endianness assumption.
+    for (unsigned i = 0; i != Size; ++i)
+      DF->getContents().push_back(uint8_t(AbsValue >> (i * 8)));
+  } else {
+    DF->addFixup(MCAsmFixup(DF->getContents().size(), *AddValueSymbols(Value),
+                            MCFixup::getKindForSize(Size)));
+    DF->getContents().resize(DF->getContents().size() + Size, 0);
+  }
+}
+
+void MCELFStreamer::EmitValueToAlignment(unsigned ByteAlignment,
+                                         int64_t Value, unsigned ValueSize,
+                                         unsigned MaxBytesToEmit) {
+  if (MaxBytesToEmit == 0)
+    MaxBytesToEmit = ByteAlignment;
+  new MCAlignFragment(ByteAlignment, Value, ValueSize, MaxBytesToEmit,
+                      false /* EmitNops */, CurSectionData);
+
+  // Update the maximum alignment on the current section if necessary.
+  if (ByteAlignment > CurSectionData->getAlignment())
+    CurSectionData->setAlignment(ByteAlignment);
+}
+
+void MCELFStreamer::EmitCodeAlignment(unsigned ByteAlignment,
+                                      unsigned MaxBytesToEmit) {
+  if (MaxBytesToEmit == 0)
+    MaxBytesToEmit = ByteAlignment;
+  // FIXME the 0x90 is the default x86 1 byte nop opcode.
+  new MCAlignFragment(ByteAlignment, 0x90, 1, MaxBytesToEmit,
+                      true /* EmitNops */, CurSectionData);
+
+  // Update the maximum alignment on the current section if necessary.
+  if (ByteAlignment > CurSectionData->getAlignment())
+    CurSectionData->setAlignment(ByteAlignment);
+}
+
+void MCELFStreamer::EmitValueToOffset(const MCExpr *Offset,
+                                      unsigned char Value) {
+  new MCOrgFragment(*Offset, Value, CurSectionData);
+}
+
+void MCELFStreamer::EmitInstruction(const MCInst &Inst) {
+  // Scan for values.
+  for (unsigned i = 0; i != Inst.getNumOperands(); ++i)
+    if (Inst.getOperand(i).isExpr())
+      AddValueSymbols(Inst.getOperand(i).getExpr());
+
+  if (!Emitter)
+    llvm_unreachable("no code emitter available!");
+
+  CurSectionData->setHasInstructions(true);
+
+  SmallVector<MCFixup, 4> Fixups;
+  SmallString<256> Code;
+  raw_svector_ostream VecOS(Code);
+  Emitter->EncodeInstruction(Inst, VecOS, Fixups);
+  VecOS.flush();
+
+  // Add the fixups and data.
+  MCDataFragment *DF = dyn_cast_or_null<MCDataFragment>(getCurrentFragment());
+  if (!DF)
+    DF = new MCDataFragment(CurSectionData);
+  for (unsigned i = 0, e = Fixups.size(); i != e; ++i) {
+    MCFixup &F = Fixups[i];
+    DF->addFixup(MCAsmFixup(DF->getContents().size()+F.getOffset(),
+                            *F.getValue(), F.getKind()));
+  }
+  DF->getContents().append(Code.begin(), Code.end());
+}
+
+void MCELFStreamer::Finish() {
+  Assembler.Finish();
+}
+
+MCStreamer *llvm::createELFStreamer(MCContext &Context, TargetAsmBackend &TAB,
+                                    raw_ostream &OS, MCCodeEmitter *CE) {
+  return new MCELFStreamer(Context, TAB, OS, CE);
+}
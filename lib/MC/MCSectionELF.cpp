@@ -121,6 +121,10 @@ void MCSectionELF::PrintSwitchToSection(const MCAsmInfo &MAI,
   OS << '\n';
 }
 
+bool MCSectionELF::isVirtualSection() const {
+  return getType() == MCSectionELF::SHT_NOBITS;
+}
+
 // HasCommonSymbols - True if this section holds common symbols, this is
 // indicated on the ELF object file by a symbol with SHN_COMMON section 
 // header index.
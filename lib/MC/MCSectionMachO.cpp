@@ -133,6 +133,11 @@ void MCSectionMachO::PrintSwitchToSection(const MCAsmInfo &MAI,
   OS << '\n';
 }
 
+bool MCSectionMachO::isVirtualSection() const {
+  unsigned Type = getTypeAndAttributes() & MCSectionMachO::SECTION_TYPE;
+  return (Type == MCSectionMachO::S_ZEROFILL);
+}
+
 /// StripSpaces - This removes leading and trailing spaces from the StringRef.
 static void StripSpaces(StringRef &Str) {
   while (!Str.empty() && isspace(Str[0]))
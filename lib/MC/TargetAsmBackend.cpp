@@ -8,6 +8,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Target/TargetAsmBackend.h"
+#include "llvm/MC/MCFixup.h"
+#include "llvm/Support/ErrorHandling.h"
 using namespace llvm;
 
 TargetAsmBackend::TargetAsmBackend(const Target &T)
@@ -17,3 +19,21 @@ TargetAsmBackend::TargetAsmBackend(const Target &T)
 
 TargetAsmBackend::~TargetAsmBackend() {
 }
+
+unsigned TargetAsmBackend::getFixupKindLog2Size(unsigned Kind) const {
+  switch (Kind) {
+  default: llvm_unreachable("invalid fixup kind!");
+  case FK_Data_1: return 0;
+  case FK_Data_2: return 1;
+  case FK_Data_4: return 2;
+  case FK_Data_8: return 3;
+  }
+}
+
+bool TargetAsmBackend::isFixupKindPCRel(unsigned Kind) const {
+  return false;
+}
+
+bool TargetAsmBackend::isFixupKindSignExtended(unsigned Kind) const {
+  return false;
+}
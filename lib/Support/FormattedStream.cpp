@@ -13,6 +13,7 @@
 
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormattedStream.h"
+#include <cstring>
 
 using namespace llvm;
 
@@ -20,19 +21,26 @@ using namespace llvm;
 /// column we end up in after output.
 ///
 static unsigned CountColumns(unsigned Column, const char *Ptr, size_t Size) {
-  // Keep track of the current column by scanning the string for
-  // special characters
-
-  for (const char *End = Ptr + Size; Ptr != End; ++Ptr) {
-    ++Column;
-    if (*Ptr == '\n' || *Ptr == '\r')
+  // Only the characters after the last newline matter, so search backwards
+  // for it instead of examining every character.
+  const char *End = Ptr + Size;
+  for (const char *P = End; P != Ptr; --P)
+    if (P[-1] == '\n' || P[-1] == '\r') {
       Column = 0;
-    else if (*Ptr == '\t')
-      // Assumes tab stop = 8 characters.
-      Column += (8 - (Column & 0x7)) & 0x7;
+      Ptr = P;
+      break;
+    }
+
+  // Keep track of the current column by scanning the rest for tabs.
+  while (const char *Tab =
+           static_cast<const char*>(memchr(Ptr, '\t', End - Ptr))) {
+    Column += Tab - Ptr + 1;
+    // Assumes tab stop = 8 characters.
+    Column += (8 - (Column & 0x7)) & 0x7;
+    Ptr = Tab + 1;
   }
 
-  return Column;
+  return Column + (End - Ptr);
 }
 
 /// ComputeColumn - Examine the current output and figure out which
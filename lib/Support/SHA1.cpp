@@ -0,0 +1,102 @@
+//===-- SHA1.cpp - SHA-1 message digest -----------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the SHA-1 digest, as specified by FIPS 180-2.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/SHA1.h"
+using namespace llvm;
+
+static inline uint32_t rotl(uint32_t V, unsigned Bits) {
+  return (V << Bits) | (V >> (32 - Bits));
+}
+
+void SHA1::init() {
+  State[0] = 0x67452301;
+  State[1] = 0xEFCDAB89;
+  State[2] = 0x98BADCFE;
+  State[3] = 0x10325476;
+  State[4] = 0xC3D2E1F0;
+  BufferOffset = 0;
+  ByteCount = 0;
+}
+
+void SHA1::hashBlock() {
+  uint32_t W[80];
+  for (unsigned i = 0; i != 16; ++i)
+    W[i] = (uint32_t(Buffer[4*i]) << 24) | (uint32_t(Buffer[4*i+1]) << 16) |
+           (uint32_t(Buffer[4*i+2]) << 8) | uint32_t(Buffer[4*i+3]);
+  for (unsigned i = 16; i != 80; ++i)
+    W[i] = rotl(W[i-3] ^ W[i-8] ^ W[i-14] ^ W[i-16], 1);
+
+  uint32_t A = State[0], B = State[1], C = State[2], D = State[3],
+           E = State[4];
+  for (unsigned i = 0; i != 80; ++i) {
+    uint32_t F, K;
+    if (i < 20) {
+      F = (B & C) | (~B & D);
+      K = 0x5A827999;
+    } else if (i < 40) {
+      F = B ^ C ^ D;
+      K = 0x6ED9EBA1;
+    } else if (i < 60) {
+      F = (B & C) | (B & D) | (C & D);
+      K = 0x8F1BBCDC;
+    } else {
+      F = B ^ C ^ D;
+      K = 0xCA62C1D6;
+    }
+    uint32_t T = rotl(A, 5) + F + E + K + W[i];
+    E = D;
+    D = C;
+    C = rotl(B, 30);
+    B = A;
+    A = T;
+  }
+
+  State[0] += A;
+  State[1] += B;
+  State[2] += C;
+  State[3] += D;
+  State[4] += E;
+}
+
+void SHA1::addByte(uint8_t Byte) {
+  Buffer[BufferOffset++] = Byte;
+  if (BufferOffset == BlockSize) {
+    hashBlock();
+    BufferOffset = 0;
+  }
+}
+
+void SHA1::update(StringRef Data) {
+  ByteCount += Data.size();
+  for (StringRef::iterator I = Data.begin(), E = Data.end(); I != E; ++I)
+    addByte(*I);
+}
+
+StringRef SHA1::final() {
+  // Pad with a one bit, then zeros up to the last eight bytes of a block,
+  // which hold the length of the stream in bits.
+  uint64_t BitCount = ByteCount * 8;
+  addByte(0x80);
+  while (BufferOffset != BlockSize - 8)
+    addByte(0);
+  for (int Shift = 56; Shift >= 0; Shift -= 8)
+    addByte(uint8_t(BitCount >> Shift));
+
+  for (unsigned i = 0; i != 5; ++i) {
+    Digest[4*i] = char(State[i] >> 24);
+    Digest[4*i+1] = char(State[i] >> 16);
+    Digest[4*i+2] = char(State[i] >> 8);
+    Digest[4*i+3] = char(State[i]);
+  }
+  return StringRef(Digest, DigestSize);
+}
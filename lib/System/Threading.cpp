@@ -14,8 +14,14 @@
 #include "llvm/System/Threading.h"
 #include "llvm/System/Atomic.h"
 #include "llvm/System/Mutex.h"
+#include "llvm/System/DataTypes.h"
 #include "llvm/Config/config.h"
 #include <cassert>
+#include <vector>
+
+#if defined(LLVM_MULTITHREADED) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
 
 using namespace llvm;
 
@@ -62,3 +68,84 @@ void llvm::llvm_acquire_global_lock() {
 void llvm::llvm_release_global_lock() {
   if (multithreaded_mode) global_lock->release();
 }
+
+#if defined(LLVM_MULTITHREADED) && defined(HAVE_PTHREAD_H)
+namespace {
+  struct ThreadInfo {
+    void (*UserFn)(void*, unsigned);
+    void *UserData;
+    unsigned ThreadNo;
+  };
+}
+
+static void *ExecuteOnThread_Dispatch(void *Arg) {
+  ThreadInfo *TI = reinterpret_cast<ThreadInfo*>(Arg);
+  TI->UserFn(TI->UserData, TI->ThreadNo);
+  return 0;
+}
+
+void llvm::llvm_execute_on_threads(void (*UserFn)(void*, unsigned),
+                                   void *UserData, unsigned NumThreads) {
+  if (NumThreads == 0)
+    return;
+
+  std::vector<ThreadInfo> Infos(NumThreads);
+  std::vector<pthread_t> Threads;
+  Threads.reserve(NumThreads);
+
+  // Start threads for calls 1 and up; if creating one fails, make the
+  // remaining calls here.
+  unsigned FirstInline = NumThreads;
+  for (unsigned i = 1; i < NumThreads; ++i) {
+    ThreadInfo &TI = Infos[i];
+    TI.UserFn = UserFn;
+    TI.UserData = UserData;
+    TI.ThreadNo = i;
+    pthread_t Thread;
+    if (::pthread_create(&Thread, 0, ExecuteOnThread_Dispatch, &TI) != 0) {
+      FirstInline = i;
+      break;
+    }
+    Threads.push_back(Thread);
+  }
+
+  UserFn(UserData, 0);
+  for (unsigned i = FirstInline; i < NumThreads; ++i)
+    UserFn(UserData, i);
+
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    ::pthread_join(Threads[i], 0);
+}
+#else
+void llvm::llvm_execute_on_threads(void (*UserFn)(void*, unsigned),
+                                   void *UserData, unsigned NumThreads) {
+  for (unsigned i = 0; i < NumThreads; ++i)
+    UserFn(UserData, i);
+}
+#endif
+
+unsigned llvm::llvm_split_into_runs(const std::vector<unsigned> &Sizes,
+                                    unsigned MaxRuns,
+                                    std::vector<unsigned> &RunStarts) {
+  unsigned NumItems = Sizes.size();
+  unsigned NumRuns = MaxRuns < NumItems ? MaxRuns : NumItems;
+  uint64_t TotalSize = 0;
+  for (unsigned i = 0; i != NumItems; ++i)
+    TotalSize += Sizes[i];
+
+  RunStarts.clear();
+  RunStarts.push_back(0);
+  uint64_t SizeSoFar = 0;
+  for (unsigned i = 0; i != NumItems; ++i) {
+    SizeSoFar += Sizes[i];
+    // End the current run once it has its share of the total size, keeping
+    // enough items for the runs that are left.
+    unsigned Run = RunStarts.size();
+    if (Run < NumRuns && SizeSoFar * NumRuns >= TotalSize * Run &&
+        NumItems-(i+1) >= NumRuns-Run)
+      RunStarts.push_back(i+1);
+  }
+  while (RunStarts.size() <= NumRuns)
+    RunStarts.push_back(NumItems);
+  return NumRuns;
+}
@@ -9,6 +9,10 @@
 
 #include "llvm/Target/TargetAsmBackend.h"
 #include "X86.h"
+#include "X86FixupKinds.h"
+#include "llvm/MC/ELFObjectWriter.h"
+#include "llvm/MC/MachObjectWriter.h"
+#include "llvm/Support/ELF.h"
 #include "llvm/Target/TargetRegistry.h"
 #include "llvm/Target/TargetAsmBackend.h"
 using namespace llvm;
@@ -16,19 +20,62 @@ using namespace llvm;
 namespace {
 
 class X86AsmBackend : public TargetAsmBackend {
+protected:
+  bool Is64Bit;
+
+public:
+  X86AsmBackend(const Target &T, bool _Is64Bit)
+    : TargetAsmBackend(T), Is64Bit(_Is64Bit) {}
+
+  unsigned getFixupKindLog2Size(unsigned Kind) const {
+    switch (Kind) {
+    case X86::reloc_pcrel_1byte: return 0;
+    case X86::reloc_pcrel_4byte:
+    case X86::reloc_riprel_4byte:
+    case X86::reloc_signed_4byte: return 2;
+    default: return TargetAsmBackend::getFixupKindLog2Size(Kind);
+    }
+  }
+
+  bool isFixupKindPCRel(unsigned Kind) const {
+    switch (Kind) {
+    case X86::reloc_pcrel_1byte:
+    case X86::reloc_pcrel_4byte:
+    case X86::reloc_riprel_4byte:
+      return true;
+    default:
+      return TargetAsmBackend::isFixupKindPCRel(Kind);
+    }
+  }
+
+  bool isFixupKindSignExtended(unsigned Kind) const {
+    return Kind == X86::reloc_signed_4byte;
+  }
+};
+
+class ELFX86AsmBackend : public X86AsmBackend {
 public:
-  X86AsmBackend(const Target &T)
-    : TargetAsmBackend(T) {}
+  ELFX86AsmBackend(const Target &T, bool _Is64Bit)
+    : X86AsmBackend(T, _Is64Bit) {}
+
+  MCObjectWriter *createObjectWriter(raw_ostream &OS) const {
+    return createELFObjectWriter(OS, Is64Bit, /*IsLittleEndian=*/true,
+                                 Is64Bit ? ELF::EM_X86_64 : ELF::EM_386);
+  }
 };
 
 class DarwinX86AsmBackend : public X86AsmBackend {
 public:
-  DarwinX86AsmBackend(const Target &T)
-    : X86AsmBackend(T) {}
+  DarwinX86AsmBackend(const Target &T, bool _Is64Bit)
+    : X86AsmBackend(T, _Is64Bit) {}
 
   virtual bool hasAbsolutizedSet() const { return true; }
 
   virtual bool hasScatteredSymbols() const { return true; }
+
+  MCObjectWriter *createObjectWriter(raw_ostream &OS) const {
+    return createMachObjectWriter(OS, Is64Bit);
+  }
 };
 
 }
@@ -37,9 +84,9 @@ TargetAsmBackend *llvm::createX86_32AsmBackend(const Target &T,
                                                const std::string &TT) {
   switch (Triple(TT).getOS()) {
   case Triple::Darwin:
-    return new DarwinX86AsmBackend(T);
+    return new DarwinX86AsmBackend(T, false);
   default:
-    return new X86AsmBackend(T);
+    return new ELFX86AsmBackend(T, false);
   }
 }
 
@@ -47,8 +94,8 @@ TargetAsmBackend *llvm::createX86_64AsmBackend(const Target &T,
                                                const std::string &TT) {
   switch (Triple(TT).getOS()) {
   case Triple::Darwin:
-    return new DarwinX86AsmBackend(T);
+    return new DarwinX86AsmBackend(T, true);
   default:
-    return new X86AsmBackend(T);
+    return new ELFX86AsmBackend(T, true);
   }
 }
@@ -16,6 +16,7 @@
 #include "X86.h"
 #include "X86InstrBuilder.h"
 #include "X86ISelLowering.h"
+#include "X86MachineFunctionInfo.h"
 #include "X86RegisterInfo.h"
 #include "X86Subtarget.h"
 #include "X86TargetMachine.h"
@@ -81,12 +82,13 @@ public:
 private:
   bool X86FastEmitCompare(Value *LHS, Value *RHS, EVT VT);
   
-  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR);
+  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR,
+                       unsigned Alignment = 0);
 
   bool X86FastEmitStore(EVT VT, Value *Val,
-                        const X86AddressMode &AM);
+                        const X86AddressMode &AM, unsigned Alignment = 0);
   bool X86FastEmitStore(EVT VT, unsigned Val,
-                        const X86AddressMode &AM);
+                        const X86AddressMode &AM, unsigned Alignment = 0);
 
   bool X86FastEmitExtend(ISD::NodeType Opc, EVT DstVT, unsigned Src, EVT SrcVT,
                          unsigned &ResultReg);
@@ -115,8 +117,22 @@ private:
 
   bool X86SelectExtractValue(Instruction *I);
 
+  bool X86SelectDivRem(Instruction *I);
+
+  bool X86SelectBitCast(Instruction *I);
+
+  bool X86SelectRet(Instruction *I);
+
+  bool X86SelectSwitch(Instruction *I);
+
   bool X86VisitIntrinsicCall(IntrinsicInst &I);
   bool X86SelectCall(Instruction *I);
+  bool DoSelectCall(Instruction *I, const char *MemIntName);
+
+  bool IsMemcpySmall(uint64_t Len);
+
+  bool TryEmitSmallMemcpy(X86AddressMode DestAM,
+                          X86AddressMode SrcAM, uint64_t Len);
 
   CCAssignFn *CCAssignFnForCall(CallingConv::ID CC, bool isTailCall = false);
 
@@ -192,9 +208,10 @@ CCAssignFn *X86FastISel::CCAssignFnForCall(CallingConv::ID CC,
 
 /// X86FastEmitLoad - Emit a machine instruction to load a value of type VT.
 /// The address is either pre-computed, i.e. Ptr, or a GlobalAddress, i.e. GV.
+/// Alignment is the known alignment of the address, or 0 if it is unknown.
 /// Return true and the result register by reference if it is possible.
 bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
-                                  unsigned &ResultReg) {
+                                  unsigned &ResultReg, unsigned Alignment) {
   // Get opcode and regclass of the output for the given load instruction.
   unsigned Opc = 0;
   const TargetRegisterClass *RC = NULL;
@@ -239,6 +256,17 @@ bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
   case MVT::f80:
     // No f80 support yet.
     return false;
+  case MVT::v4f32:
+  case MVT::v2f64:
+  case MVT::v4i32:
+  case MVT::v2i64:
+  case MVT::v8i16:
+  case MVT::v16i8:
+    // The type is only legal with SSE, and movaps/movups move all of the
+    // 128-bit vector types.
+    Opc = Alignment >= 16 ? X86::MOVAPSrm : X86::MOVUPSrm;
+    RC  = X86::VR128RegisterClass;
+    break;
   }
 
   ResultReg = createResultReg(RC);
@@ -249,10 +277,11 @@ bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
 /// X86FastEmitStore - Emit a machine instruction to store a value Val of
 /// type VT. The address is either pre-computed, consisted of a base ptr, Ptr
 /// and a displacement offset, or a GlobalAddress,
-/// i.e. V. Return true if it is possible.
+/// i.e. V. Alignment is the known alignment of the address, or 0 if it is
+/// unknown. Return true if it is possible.
 bool
 X86FastISel::X86FastEmitStore(EVT VT, unsigned Val,
-                              const X86AddressMode &AM) {
+                              const X86AddressMode &AM, unsigned Alignment) {
   // Get opcode and regclass of the output for the given store instruction.
   unsigned Opc = 0;
   switch (VT.getSimpleVT().SimpleTy) {
@@ -276,6 +305,14 @@ X86FastISel::X86FastEmitStore(EVT VT, unsigned Val,
   case MVT::f64:
     Opc = Subtarget->hasSSE2() ? X86::MOVSDmr : X86::ST_Fp64m;
     break;
+  case MVT::v4f32:
+  case MVT::v2f64:
+  case MVT::v4i32:
+  case MVT::v2i64:
+  case MVT::v8i16:
+  case MVT::v16i8:
+    Opc = Alignment >= 16 ? X86::MOVAPSmr : X86::MOVUPSmr;
+    break;
   }
   
   addFullAddress(BuildMI(MBB, DL, TII.get(Opc)), AM).addReg(Val);
@@ -283,7 +320,8 @@ X86FastISel::X86FastEmitStore(EVT VT, unsigned Val,
 }
 
 bool X86FastISel::X86FastEmitStore(EVT VT, Value *Val,
-                                   const X86AddressMode &AM) {
+                                   const X86AddressMode &AM,
+                                   unsigned Alignment) {
   // Handle 'null' like i32/i64 0.
   if (isa<ConstantPointerNull>(Val))
     Val = Constant::getNullValue(TD.getIntPtrType(Val->getContext()));
@@ -317,7 +355,7 @@ bool X86FastISel::X86FastEmitStore(EVT VT, Value *Val,
   if (ValReg == 0)
     return false;    
  
-  return X86FastEmitStore(VT, ValReg, AM);
+  return X86FastEmitStore(VT, ValReg, AM, Alignment);
 }
 
 /// X86FastEmitExtend - Emit a machine instruction to extend a value Src of
@@ -638,7 +676,11 @@ bool X86FastISel::X86SelectStore(Instruction* I) {
   if (!X86SelectAddress(I->getOperand(1), AM))
     return false;
 
-  return X86FastEmitStore(VT, I->getOperand(0), AM);
+  unsigned Alignment = cast<StoreInst>(I)->getAlignment();
+  if (Alignment == 0)
+    Alignment = TD.getABITypeAlignment(I->getOperand(0)->getType());
+
+  return X86FastEmitStore(VT, I->getOperand(0), AM, Alignment);
 }
 
 /// X86SelectLoad - Select and emit code to implement load instructions.
@@ -652,8 +694,12 @@ bool X86FastISel::X86SelectLoad(Instruction *I)  {
   if (!X86SelectAddress(I->getOperand(0), AM))
     return false;
 
+  unsigned Alignment = cast<LoadInst>(I)->getAlignment();
+  if (Alignment == 0)
+    Alignment = TD.getABITypeAlignment(I->getType());
+
   unsigned ResultReg = 0;
-  if (X86FastEmitLoad(VT, AM, ResultReg)) {
+  if (X86FastEmitLoad(VT, AM, ResultReg, Alignment)) {
     UpdateValueMap(I, ResultReg);
     return true;
   }
@@ -1041,6 +1087,10 @@ bool X86FastISel::X86SelectSelect(Instruction *I) {
   
   unsigned Opc = 0;
   const TargetRegisterClass *RC = NULL;
+  // There is no conditional move between SSE registers, so scalar SSE values
+  // are moved to an integer register, selected there with a cmov, and moved
+  // back.
+  unsigned ToIntOpc = 0, FromIntOpc = 0;
   if (VT.getSimpleVT() == MVT::i16) {
     Opc = X86::CMOVE16rr;
     RC = &X86::GR16RegClass;
@@ -1050,6 +1100,16 @@ bool X86FastISel::X86SelectSelect(Instruction *I) {
   } else if (VT.getSimpleVT() == MVT::i64) {
     Opc = X86::CMOVE64rr;
     RC = &X86::GR64RegClass;
+  } else if (VT.getSimpleVT() == MVT::f32 && Subtarget->hasSSE2()) {
+    Opc = X86::CMOVE32rr;
+    RC = &X86::GR32RegClass;
+    ToIntOpc = X86::MOVSS2DIrr;
+    FromIntOpc = X86::MOVDI2SSrr;
+  } else if (VT.getSimpleVT() == MVT::f64 && Subtarget->is64Bit()) {
+    Opc = X86::CMOVE64rr;
+    RC = &X86::GR64RegClass;
+    ToIntOpc = X86::MOVSDto64rr;
+    FromIntOpc = X86::MOV64toSDrr;
   } else {
     return false; 
   }
@@ -1061,9 +1121,24 @@ bool X86FastISel::X86SelectSelect(Instruction *I) {
   unsigned Op2Reg = getRegForValue(I->getOperand(2));
   if (Op2Reg == 0) return false;
 
+  if (ToIntOpc) {
+    unsigned IntReg1 = createResultReg(RC);
+    BuildMI(MBB, DL, TII.get(ToIntOpc), IntReg1).addReg(Op1Reg);
+    unsigned IntReg2 = createResultReg(RC);
+    BuildMI(MBB, DL, TII.get(ToIntOpc), IntReg2).addReg(Op2Reg);
+    Op1Reg = IntReg1;
+    Op2Reg = IntReg2;
+  }
+
   BuildMI(MBB, DL, TII.get(X86::TEST8rr)).addReg(Op0Reg).addReg(Op0Reg);
   unsigned ResultReg = createResultReg(RC);
   BuildMI(MBB, DL, TII.get(Opc), ResultReg).addReg(Op1Reg).addReg(Op2Reg);
+
+  if (FromIntOpc) {
+    unsigned IntReg = ResultReg;
+    ResultReg = createResultReg(TLI.getRegClassFor(VT));
+    BuildMI(MBB, DL, TII.get(FromIntOpc), ResultReg).addReg(IntReg);
+  }
   UpdateValueMap(I, ResultReg);
   return true;
 }
@@ -1162,6 +1237,306 @@ bool X86FastISel::X86SelectExtractValue(Instruction *I) {
   return false;
 }
 
+/// IsMemcpySmall - Return true if a copy of Len bytes is short enough to be
+/// done with a few loads and stores rather than a call to memcpy.
+bool X86FastISel::IsMemcpySmall(uint64_t Len) {
+  return Len <= (Subtarget->is64Bit() ? 32 : 16);
+}
+
+/// TryEmitSmallMemcpy - Emit the loads and stores that copy Len bytes from
+/// SrcAM to DestAM, using the widest legal integer type for each piece.
+bool X86FastISel::TryEmitSmallMemcpy(X86AddressMode DestAM,
+                                     X86AddressMode SrcAM, uint64_t Len) {
+  if (!IsMemcpySmall(Len))
+    return false;
+
+  bool i64Legal = Subtarget->is64Bit();
+  while (Len) {
+    MVT VT;
+    if (Len >= 8 && i64Legal)
+      VT = MVT::i64;
+    else if (Len >= 4)
+      VT = MVT::i32;
+    else if (Len >= 2)
+      VT = MVT::i16;
+    else
+      VT = MVT::i8;
+
+    unsigned Reg;
+    if (!X86FastEmitLoad(VT, SrcAM, Reg) ||
+        !X86FastEmitStore(VT, Reg, DestAM))
+      return false;
+
+    unsigned Size = VT.getSizeInBits() / 8;
+    Len -= Size;
+    DestAM.Disp += Size;
+    SrcAM.Disp += Size;
+  }
+  return true;
+}
+
+/// X86SelectDivRem - Select and emit code for integer division and
+/// remainder. DIV and IDIV divide the double-width value in DX:AX (or its
+/// wider forms) by their operand and leave the quotient and remainder in
+/// fixed registers, so the operands are copied into place around them.
+bool X86FastISel::X86SelectDivRem(Instruction *I) {
+  EVT VT;
+  if (!isTypeLegal(I->getType(), VT))
+    return false;
+
+  unsigned Opcode = I->getOpcode();
+  bool IsSigned = Opcode == Instruction::SDiv || Opcode == Instruction::SRem;
+  bool IsDiv = Opcode == Instruction::SDiv || Opcode == Instruction::UDiv;
+
+  const TargetRegisterClass *RC = NULL;
+  unsigned LoReg = 0, HiReg = 0, DivOpc = 0, SExtOpc = 0, ZeroOpc = 0;
+  switch (VT.getSimpleVT().SimpleTy) {
+  default: return false;
+  case MVT::i8:
+    // The byte forms divide AX and leave the remainder in AH, which can't be
+    // copied to every 8-bit register in 64-bit mode; only divisions are
+    // handled.
+    if (!IsDiv)
+      return false;
+    RC = X86::GR8RegisterClass;
+    DivOpc = IsSigned ? X86::IDIV8r : X86::DIV8r;
+    break;
+  case MVT::i16:
+    RC = X86::GR16RegisterClass;
+    LoReg = X86::AX; HiReg = X86::DX;
+    DivOpc = IsSigned ? X86::IDIV16r : X86::DIV16r;
+    SExtOpc = X86::CWD; ZeroOpc = X86::MOV16r0;
+    break;
+  case MVT::i32:
+    RC = X86::GR32RegisterClass;
+    LoReg = X86::EAX; HiReg = X86::EDX;
+    DivOpc = IsSigned ? X86::IDIV32r : X86::DIV32r;
+    SExtOpc = X86::CDQ; ZeroOpc = X86::MOV32r0;
+    break;
+  case MVT::i64:
+    RC = X86::GR64RegisterClass;
+    LoReg = X86::RAX; HiReg = X86::RDX;
+    DivOpc = IsSigned ? X86::IDIV64r : X86::DIV64r;
+    SExtOpc = X86::CQO; ZeroOpc = X86::MOV64r0;
+    break;
+  }
+
+  unsigned Op0Reg = getRegForValue(I->getOperand(0));
+  if (Op0Reg == 0) return false;
+  unsigned Op1Reg = getRegForValue(I->getOperand(1));
+  if (Op1Reg == 0) return false;
+
+  unsigned ResultReg = createResultReg(RC);
+  if (VT == MVT::i8) {
+    // Extend the dividend into AX and copy the quotient out of AL.
+    TargetRegisterClass *RC16 = X86::GR16RegisterClass;
+    unsigned ExtReg = createResultReg(RC16);
+    BuildMI(MBB, DL, TII.get(IsSigned ? X86::MOVSX16rr8 : X86::MOVZX16rr8),
+            ExtReg).addReg(Op0Reg);
+    bool Emitted = TII.copyRegToReg(*MBB, MBB->end(), X86::AX, ExtReg,
+                                    RC16, RC16);
+    assert(Emitted && "Failed to emit a copy instruction!"); Emitted=Emitted;
+    BuildMI(MBB, DL, TII.get(DivOpc)).addReg(Op1Reg);
+    Emitted = TII.copyRegToReg(*MBB, MBB->end(), ResultReg, X86::AL, RC, RC);
+    assert(Emitted && "Failed to emit a copy instruction!"); Emitted=Emitted;
+    UpdateValueMap(I, ResultReg);
+    return true;
+  }
+
+  bool Emitted = TII.copyRegToReg(*MBB, MBB->end(), LoReg, Op0Reg, RC, RC);
+  assert(Emitted && "Failed to emit a copy instruction!"); Emitted=Emitted;
+  if (IsSigned) {
+    // Sign-extend the dividend into the high half.
+    BuildMI(MBB, DL, TII.get(SExtOpc));
+  } else {
+    // Zero the high half.
+    unsigned ZeroReg = createResultReg(RC);
+    BuildMI(MBB, DL, TII.get(ZeroOpc), ZeroReg);
+    Emitted = TII.copyRegToReg(*MBB, MBB->end(), HiReg, ZeroReg, RC, RC);
+    assert(Emitted && "Failed to emit a copy instruction!"); Emitted=Emitted;
+  }
+  BuildMI(MBB, DL, TII.get(DivOpc)).addReg(Op1Reg);
+  Emitted = TII.copyRegToReg(*MBB, MBB->end(), ResultReg,
+                             IsDiv ? LoReg : HiReg, RC, RC);
+  assert(Emitted && "Failed to emit a copy instruction!"); Emitted=Emitted;
+  UpdateValueMap(I, ResultReg);
+  return true;
+}
+
+/// X86SelectBitCast - Select and emit code for bitcasts between vector types
+/// that live in the same register class, which need no code at all.
+bool X86FastISel::X86SelectBitCast(Instruction *I) {
+  EVT SrcVT, DstVT;
+  if (!isTypeLegal(I->getOperand(0)->getType(), SrcVT) ||
+      !isTypeLegal(I->getType(), DstVT))
+    return false;
+  if (!SrcVT.isVector() || !DstVT.isVector() ||
+      TLI.getRegClassFor(SrcVT) != TLI.getRegClassFor(DstVT))
+    return false;
+
+  unsigned Reg = getRegForValue(I->getOperand(0));
+  if (Reg == 0) return false;
+  UpdateValueMap(I, Reg);
+  return true;
+}
+
+/// X86SelectRet - Select and emit code for a return of nothing or of a
+/// single value in a register. Returns on the x87 stack, sret functions and
+/// functions that pop their arguments are left to SelectionDAG.
+bool X86FastISel::X86SelectRet(Instruction *I) {
+  ReturnInst *Ret = cast<ReturnInst>(I);
+  const Function &F = *I->getParent()->getParent();
+
+  CallingConv::ID CC = F.getCallingConv();
+  if (CC != CallingConv::C &&
+      CC != CallingConv::Fast &&
+      CC != CallingConv::X86_FastCall)
+    return false;
+
+  // fastcc with -tailcallopt is intended to provide a guaranteed
+  // tail call optimization. Fastisel doesn't know how to do that.
+  if (CC == CallingConv::Fast && GuaranteedTailCallOpt)
+    return false;
+
+  // x86-64 returns the sret pointer in RAX, and x86-32 callees pop it.
+  if (F.hasStructRetAttr() ||
+      MF.getInfo<X86MachineFunctionInfo>()->getBytesToPopOnReturn() != 0)
+    return false;
+
+  if (Ret->getNumOperands() != 0) {
+    Value *RV = Ret->getOperand(0);
+    EVT VT;
+    if (!isTypeLegal(RV->getType(), VT, /*AllowI1=*/true))
+      return false;
+
+    // MMX values are returned in XMM registers or RAX on x86-64.
+    if (VT.isVector() && VT.getSizeInBits() == 64)
+      return false;
+
+    unsigned Reg = getRegForValue(RV);
+    if (Reg == 0)
+      return false;
+
+    // A signext or zeroext return value is promoted to i32, as
+    // SelectionDAGBuilder::visitRet does.
+    bool SExt = F.paramHasAttr(0, Attribute::SExt);
+    bool ZExt = F.paramHasAttr(0, Attribute::ZExt);
+    if ((SExt || ZExt) && VT.isInteger() && VT.bitsLT(MVT::i32)) {
+      if (VT == MVT::i1) {
+        if (SExt)
+          return false;
+        Reg = FastEmitZExtFromI1(MVT::i8, Reg);
+        if (Reg == 0)
+          return false;
+        VT = MVT::i8;
+      }
+      if (!X86FastEmitExtend(SExt ? ISD::SIGN_EXTEND : ISD::ZERO_EXTEND,
+                             MVT::i32, Reg, VT, Reg))
+        return false;
+      VT = MVT::i32;
+    } else if (VT == MVT::i1) {
+      // Otherwise an i1 is returned as an i8 with undefined high bits.
+      VT = MVT::i8;
+    }
+
+    SmallVector<CCValAssign, 16> RVLocs;
+    CCState CCInfo(CC, F.isVarArg(), TM, RVLocs, I->getContext());
+    CCInfo.AnalyzeCallResult(VT, RetCC_X86);
+    if (RVLocs.size() != 1)
+      return false;
+    CCValAssign &VA = RVLocs[0];
+    if (!VA.isRegLoc() || VA.getLocInfo() != CCValAssign::Full)
+      return false;
+
+    // The x87 stack needs the FP stackifier's help.
+    unsigned DstReg = VA.getLocReg();
+    if (DstReg == X86::ST0 || DstReg == X86::ST1)
+      return false;
+
+    TargetRegisterClass *RC = TLI.getRegClassFor(VT);
+    if (!RC->contains(DstReg))
+      return false;
+    bool Emitted = TII.copyRegToReg(*MBB, MBB->end(), DstReg, Reg, RC, RC);
+    assert(Emitted && "Failed to emit a copy instruction!"); Emitted=Emitted;
+
+    if (!MRI.isLiveOut(DstReg))
+      MRI.addLiveOut(DstReg);
+  }
+
+  BuildMI(MBB, DL, TII.get(X86::RET));
+  return true;
+}
+
+/// X86SelectSwitch - Select and emit code for a switch as a chain of blocks,
+/// each comparing against one case value and branching to its destination
+/// or falling through to the next, the last one branching to the default
+/// destination.  SelectionDAG builds jump tables and binary trees instead,
+/// which are only worth their compile time for large switches.
+bool X86FastISel::X86SelectSwitch(Instruction *I) {
+  SwitchInst *SI = cast<SwitchInst>(I);
+  if (SI->getNumCases() > 64)
+    return false;
+
+  // The chain adds blocks that SelectionDAGISel doesn't know about, and PHI
+  // operands are only added for the block it started with.
+  for (unsigned i = 0, e = SI->getNumSuccessors(); i != e; ++i)
+    if (isa<PHINode>(SI->getSuccessor(i)->begin()))
+      return false;
+
+  EVT VT;
+  if (!isTypeLegal(SI->getCondition()->getType(), VT))
+    return false;
+  unsigned CmpOpc = X86ChooseCmpOpcode(VT);
+  if (CmpOpc == 0)
+    return false;
+
+  unsigned CondReg = getRegForValue(SI->getCondition());
+  if (CondReg == 0)
+    return false;
+
+  // Materialize the case values that don't fit in an immediate in the first
+  // block, which dominates the rest of the chain, so that nothing is left
+  // behind if one of them can't be.  Cases that go to the default
+  // destination need no compare.  Case 0 is the default destination.
+  MachineBasicBlock *DefaultMBB = MBBMap[SI->getDefaultDest()];
+  SmallVector<unsigned, 16> Cases;
+  SmallVector<unsigned, 16> CaseRegs(SI->getNumCases());
+  for (unsigned i = 1, e = SI->getNumCases(); i != e; ++i) {
+    if (MBBMap[SI->getSuccessor(i)] == DefaultMBB)
+      continue;
+    Cases.push_back(i);
+    if (!X86ChooseCmpImmediateOpcode(VT, SI->getCaseValue(i))) {
+      CaseRegs[i] = getRegForValue(SI->getCaseValue(i));
+      if (CaseRegs[i] == 0)
+        return false;
+    }
+  }
+
+  for (unsigned i = 0, e = Cases.size(); i != e; ++i) {
+    ConstantInt *CaseVal = SI->getCaseValue(Cases[i]);
+    MachineBasicBlock *CaseMBB = MBBMap[SI->getSuccessor(Cases[i])];
+    if (unsigned CmpImmOpc = X86ChooseCmpImmediateOpcode(VT, CaseVal))
+      BuildMI(MBB, DL, TII.get(CmpImmOpc)).addReg(CondReg)
+        .addImm(CaseVal->getSExtValue());
+    else
+      BuildMI(MBB, DL, TII.get(CmpOpc)).addReg(CondReg)
+        .addReg(CaseRegs[Cases[i]]);
+    BuildMI(MBB, DL, TII.get(X86::JE_4)).addMBB(CaseMBB);
+    MBB->addSuccessor(CaseMBB);
+
+    // The last compare is followed by the branch to the default destination.
+    if (i + 1 == e)
+      break;
+    MachineBasicBlock *NextMBB = MF.CreateMachineBasicBlock(SI->getParent());
+    MF.insert(llvm::next(MachineFunction::iterator(MBB)), NextMBB);
+    MBB->addSuccessor(NextMBB);
+    setCurrentBlock(NextMBB);
+  }
+
+  FastEmitBranch(DefaultMBB);
+  return true;
+}
+
 bool X86FastISel::X86VisitIntrinsicCall(IntrinsicInst &I) {
   // FIXME: Handle more intrinsics.
   switch (I.getIntrinsicID()) {
@@ -1207,6 +1582,165 @@ bool X86FastISel::X86VisitIntrinsicCall(IntrinsicInst &I) {
     BuildMI(MBB, DL, TII.get(X86::TRAP));
     return true;
   }
+  case Intrinsic::memcpy:
+  case Intrinsic::memmove: {
+    // Copy small constant lengths inline.
+    Value *Len = I.getOperand(3);
+    if (I.getIntrinsicID() == Intrinsic::memcpy && isa<ConstantInt>(Len) &&
+        IsMemcpySmall(cast<ConstantInt>(Len)->getZExtValue())) {
+      X86AddressMode DestAM, SrcAM;
+      if (!X86SelectAddress(I.getOperand(1), DestAM) ||
+          !X86SelectAddress(I.getOperand(2), SrcAM))
+        return false;
+      return TryEmitSmallMemcpy(DestAM, SrcAM,
+                                cast<ConstantInt>(Len)->getZExtValue());
+    }
+
+    // Otherwise call the library function, if the length already has the
+    // type of its size_t argument.
+    if (Len->getType() != TD.getIntPtrType(I.getContext()))
+      return false;
+    return DoSelectCall(&I, I.getIntrinsicID() == Intrinsic::memcpy ?
+                            "memcpy" : "memmove");
+  }
+  case Intrinsic::memset: {
+    if (I.getOperand(3)->getType() != TD.getIntPtrType(I.getContext()))
+      return false;
+    return DoSelectCall(&I, "memset");
+  }
+  case Intrinsic::bswap: {
+    EVT VT;
+    if (!isTypeLegal(I.getType(), VT))
+      return false;
+
+    unsigned Opc = 0;
+    if (VT == MVT::i32)
+      Opc = X86::BSWAP32r;
+    else if (VT == MVT::i64)
+      Opc = X86::BSWAP64r;
+    else
+      return false;
+
+    unsigned OpReg = getRegForValue(I.getOperand(1));
+    if (OpReg == 0)
+      return false;
+    unsigned ResultReg = createResultReg(TLI.getRegClassFor(VT));
+    BuildMI(MBB, DL, TII.get(Opc), ResultReg).addReg(OpReg);
+    UpdateValueMap(&I, ResultReg);
+    return true;
+  }
+  case Intrinsic::memory_barrier: {
+    // Without SSE2 this becomes a call to __sync_synchronize.
+    if (!Subtarget->hasSSE2())
+      return false;
+
+    bool Flags[5];
+    for (unsigned i = 0; i != 5; ++i) {
+      ConstantInt *CI = dyn_cast<ConstantInt>(I.getOperand(i + 1));
+      if (!CI)
+        return false;
+      Flags[i] = !CI->isZero();
+    }
+    bool LoadLoad = Flags[0], LoadStore = Flags[1], StoreLoad = Flags[2],
+         StoreStore = Flags[3], Device = Flags[4];
+
+    // A barrier that doesn't cover device memory only constrains the
+    // compiler, and FastISel doesn't reorder memory operations.
+    if (!Device)
+      return true;
+
+    unsigned Opc = X86::MFENCE;
+    if (!LoadLoad && !LoadStore && !StoreLoad && StoreStore)
+      Opc = X86::SFENCE;
+    else if (LoadLoad && !LoadStore && !StoreLoad && !StoreStore)
+      Opc = X86::LFENCE;
+    BuildMI(MBB, DL, TII.get(Opc));
+    return true;
+  }
+  case Intrinsic::atomic_load_add:
+  case Intrinsic::atomic_load_sub:
+  case Intrinsic::atomic_swap: {
+    // These are a LOCK XADD or an XCHG, which leave the old value in the
+    // register that held the operand. A subtraction adds the negated
+    // operand.
+    EVT VT;
+    if (!isTypeLegal(I.getType(), VT))
+      return false;
+
+    bool IsSwap = I.getIntrinsicID() == Intrinsic::atomic_swap;
+    unsigned Opc = 0, NegOpc = 0;
+    switch (VT.getSimpleVT().SimpleTy) {
+    default: return false;
+    case MVT::i8:
+      Opc = IsSwap ? X86::XCHG8rm : X86::LXADD8;   NegOpc = X86::NEG8r;
+      break;
+    case MVT::i16:
+      Opc = IsSwap ? X86::XCHG16rm : X86::LXADD16; NegOpc = X86::NEG16r;
+      break;
+    case MVT::i32:
+      Opc = IsSwap ? X86::XCHG32rm : X86::LXADD32; NegOpc = X86::NEG32r;
+      break;
+    case MVT::i64:
+      Opc = IsSwap ? X86::XCHG64rm : X86::LXADD64; NegOpc = X86::NEG64r;
+      break;
+    }
+
+    X86AddressMode AM;
+    if (!X86SelectAddress(I.getOperand(1), AM))
+      return false;
+    unsigned ValReg = getRegForValue(I.getOperand(2));
+    if (ValReg == 0)
+      return false;
+
+    const TargetRegisterClass *RC = TLI.getRegClassFor(VT);
+    if (I.getIntrinsicID() == Intrinsic::atomic_load_sub) {
+      unsigned NegReg = createResultReg(RC);
+      BuildMI(MBB, DL, TII.get(NegOpc), NegReg).addReg(ValReg);
+      ValReg = NegReg;
+    }
+
+    unsigned ResultReg = createResultReg(RC);
+    addFullAddress(BuildMI(MBB, DL, TII.get(Opc), ResultReg).addReg(ValReg),
+                   AM);
+    UpdateValueMap(&I, ResultReg);
+    return true;
+  }
+  case Intrinsic::atomic_cmp_swap: {
+    // LOCK CMPXCHG compares with and returns the old value in the
+    // accumulator.
+    EVT VT;
+    if (!isTypeLegal(I.getType(), VT))
+      return false;
+
+    unsigned Opc = 0, AccReg = 0;
+    switch (VT.getSimpleVT().SimpleTy) {
+    default: return false;
+    case MVT::i8:  Opc = X86::LCMPXCHG8;  AccReg = X86::AL;  break;
+    case MVT::i16: Opc = X86::LCMPXCHG16; AccReg = X86::AX;  break;
+    case MVT::i32: Opc = X86::LCMPXCHG32; AccReg = X86::EAX; break;
+    case MVT::i64: Opc = X86::LCMPXCHG64; AccReg = X86::RAX; break;
+    }
+
+    X86AddressMode AM;
+    if (!X86SelectAddress(I.getOperand(1), AM))
+      return false;
+    unsigned CmpReg = getRegForValue(I.getOperand(2));
+    if (CmpReg == 0)
+      return false;
+    unsigned NewReg = getRegForValue(I.getOperand(3));
+    if (NewReg == 0)
+      return false;
+
+    TargetRegisterClass *RC = TLI.getRegClassFor(VT);
+    bool Emitted = TII.copyRegToReg(*MBB, MBB->end(), AccReg, CmpReg, RC, RC);
+    assert(Emitted && "Failed to emit a copy instruction!"); Emitted=Emitted;
+    addFullAddress(BuildMI(MBB, DL, TII.get(Opc)), AM).addReg(NewReg);
+    unsigned ResultReg = createResultReg(RC);
+    Emitted = TII.copyRegToReg(*MBB, MBB->end(), ResultReg, AccReg, RC, RC);
+    assert(Emitted && "Failed to emit a copy instruction!"); Emitted=Emitted;
+    UpdateValueMap(&I, ResultReg);
+    return true;
+  }
   case Intrinsic::sadd_with_overflow:
   case Intrinsic::uadd_with_overflow: {
     // Replace "add with overflow" intrinsics with an "add" instruction followed
@@ -1276,6 +1810,17 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
   if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(CI))
     return X86VisitIntrinsicCall(*II);
 
+  return DoSelectCall(I, 0);
+}
+
+/// DoSelectCall - Select and emit code for the call I. If MemIntName is
+/// non-null, I is a memcpy, memmove or memset intrinsic, which is emitted as
+/// a call to the library function of that name, and whose last operand, the
+/// alignment, is not passed.
+bool X86FastISel::DoSelectCall(Instruction *I, const char *MemIntName) {
+  CallInst *CI = cast<CallInst>(I);
+  Value *Callee = I->getOperand(0);
+
   // Handle only C and fastcc calling conventions for now.
   CallSite CS(CI);
   CallingConv::ID CC = CS.getCallingConv();
@@ -1289,10 +1834,12 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
   if (CC == CallingConv::Fast && GuaranteedTailCallOpt)
     return false;
 
-  // Let SDISel handle vararg functions.
+  // Let SDISel handle vararg calls with other calling conventions, and on
+  // Win64, where variadic floating-point arguments go in two registers.
   const PointerType *PT = cast<PointerType>(CS.getCalledValue()->getType());
   const FunctionType *FTy = cast<FunctionType>(PT->getElementType());
-  if (FTy->isVarArg())
+  bool isVarArg = FTy->isVarArg();
+  if (isVarArg && (CC != CallingConv::C || Subtarget->isTargetWin64()))
     return false;
 
   // Handle *simple* calls for now.
@@ -1305,17 +1852,19 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
 
   // Materialize callee address in a register. FIXME: GV address can be
   // handled with a CALLpcrel32 instead.
-  X86AddressMode CalleeAM;
-  if (!X86SelectCallAddress(Callee, CalleeAM))
-    return false;
   unsigned CalleeOp = 0;
   GlobalValue *GV = 0;
-  if (CalleeAM.GV != 0) {
-    GV = CalleeAM.GV;
-  } else if (CalleeAM.Base.Reg != 0) {
-    CalleeOp = CalleeAM.Base.Reg;
-  } else
-    return false;
+  if (!MemIntName) {
+    X86AddressMode CalleeAM;
+    if (!X86SelectCallAddress(Callee, CalleeAM))
+      return false;
+    if (CalleeAM.GV != 0) {
+      GV = CalleeAM.GV;
+    } else if (CalleeAM.Base.Reg != 0) {
+      CalleeOp = CalleeAM.Base.Reg;
+    } else
+      return false;
+  }
 
   // Allow calls which produce i1 results.
   bool AndToI1 = false;
@@ -1333,8 +1882,10 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
   ArgVals.reserve(CS.arg_size());
   ArgVTs.reserve(CS.arg_size());
   ArgFlags.reserve(CS.arg_size());
-  for (CallSite::arg_iterator i = CS.arg_begin(), e = CS.arg_end();
-       i != e; ++i) {
+  CallSite::arg_iterator ArgEnd = CS.arg_end();
+  if (MemIntName)
+    --ArgEnd;
+  for (CallSite::arg_iterator i = CS.arg_begin(); i != ArgEnd; ++i) {
     unsigned Arg = getRegForValue(*i);
     if (Arg == 0)
       return false;
@@ -1348,14 +1899,41 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
     // FIXME: Only handle *easy* calls for now.
     if (CS.paramHasAttr(AttrInd, Attribute::InReg) ||
         CS.paramHasAttr(AttrInd, Attribute::StructRet) ||
-        CS.paramHasAttr(AttrInd, Attribute::Nest) ||
-        CS.paramHasAttr(AttrInd, Attribute::ByVal))
+        CS.paramHasAttr(AttrInd, Attribute::Nest))
       return false;
 
     const Type *ArgTy = (*i)->getType();
+
+    // Byval aggregates are copied into the argument area, which is only
+    // done for small ones.
+    if (CS.paramHasAttr(AttrInd, Attribute::ByVal)) {
+      const Type *ElementTy = cast<PointerType>(ArgTy)->getElementType();
+      unsigned FrameSize = TD.getTypeAllocSize(ElementTy);
+      if (!IsMemcpySmall(FrameSize))
+        return false;
+      unsigned FrameAlign = CS.getParamAlignment(AttrInd);
+      if (!FrameAlign)
+        FrameAlign = TLI.getByValTypeAlignment(ElementTy);
+      Flags.setByVal();
+      Flags.setByValAlign(FrameAlign);
+      Flags.setByValSize(FrameSize);
+    }
+
     EVT ArgVT;
-    if (!isTypeLegal(ArgTy, ArgVT))
+    if (!isTypeLegal(ArgTy, ArgVT, /*AllowI1=*/true))
       return false;
+
+    // An i1 is passed as an i8 with the high bits cleared, which satisfies
+    // both zeroext and plain arguments.
+    if (ArgVT == MVT::i1) {
+      if (Flags.isSExt())
+        return false;
+      Arg = FastEmitZExtFromI1(MVT::i8, Arg);
+      if (Arg == 0)
+        return false;
+      ArgVT = MVT::i8;
+    }
+
     unsigned OriginalAlignment = TD.getABITypeAlignment(ArgTy);
     Flags.setOrigAlign(OriginalAlignment);
 
@@ -1367,7 +1945,7 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
 
   // Analyze operands of the call, assigning locations to each operand.
   SmallVector<CCValAssign, 16> ArgLocs;
-  CCState CCInfo(CC, false, TM, ArgLocs, I->getParent()->getContext());
+  CCState CCInfo(CC, isVarArg, TM, ArgLocs, I->getParent()->getContext());
   CCInfo.AnalyzeCallOperands(ArgVTs, ArgFlags, CCAssignFnForCall(CC));
 
   // Get a count of how many bytes are to be pushed on the stack.
@@ -1442,11 +2020,18 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
       AM.Base.Reg = StackPtr;
       AM.Disp = LocMemOffset;
       Value *ArgVal = ArgVals[VA.getValNo()];
+      ISD::ArgFlagsTy Flags = ArgFlags[VA.getValNo()];
       
-      // If this is a really simple value, emit this with the Value* version of
+      // A byval argument is a copy of the aggregate Arg points to.  If this
+      // is a really simple value, emit this with the Value* version of
       // X86FastEmitStore.  If it isn't simple, we don't want to do this, as it
       // can cause us to reevaluate the argument.
-      if (isa<ConstantInt>(ArgVal) || isa<ConstantPointerNull>(ArgVal))
+      if (Flags.isByVal()) {
+        X86AddressMode SrcAM;
+        SrcAM.Base.Reg = Arg;
+        bool Emitted = TryEmitSmallMemcpy(AM, SrcAM, Flags.getByValSize());
+        assert(Emitted && "Failed to emit a byval copy!"); Emitted=Emitted;
+      } else if (isa<ConstantInt>(ArgVal) || isa<ConstantPointerNull>(ArgVal))
         X86FastEmitStore(ArgVT, ArgVal, AM);
       else
         X86FastEmitStore(ArgVT, Arg, AM);
@@ -1462,6 +2047,18 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
     assert(Emitted && "Failed to emit a copy instruction!"); Emitted=Emitted;
     Emitted = true;
   }
+
+  // The x86-64 ABI passes the number of vector registers used by a varargs
+  // call in AL.
+  if (isVarArg && Subtarget->is64Bit()) {
+    static const unsigned XMMArgRegs[] = {
+      X86::XMM0, X86::XMM1, X86::XMM2, X86::XMM3,
+      X86::XMM4, X86::XMM5, X86::XMM6, X86::XMM7
+    };
+    unsigned NumXMMRegs = CCInfo.getFirstUnallocated(XMMArgRegs, 8);
+    BuildMI(MBB, DL, TII.get(X86::MOV8ri), X86::AL).addImm(NumXMMRegs);
+    RegArgs.push_back(X86::AL);
+  }
   
   // Issue the call.
   MachineInstrBuilder MIB;
@@ -1472,7 +2069,7 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
     
   } else {
     // Direct call.
-    assert(GV && "Not a direct call");
+    assert((GV || MemIntName) && "Not a direct call");
     unsigned CallOpc =
       Subtarget->is64Bit() ? X86::CALL64pcrel32 : X86::CALLpcrel32;
     
@@ -1482,13 +2079,15 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
     // On ELF targets, in both X86-64 and X86-32 mode, direct calls to
     // external symbols most go through the PLT in PIC mode.  If the symbol
     // has hidden or protected visibility, or if it is static or local, then
-    // we don't need to use the PLT - we can directly call it.
+    // we don't need to use the PLT - we can directly call it.  Library
+    // functions are always external.
     if (Subtarget->isTargetELF() &&
         TM.getRelocationModel() == Reloc::PIC_ &&
-        GV->hasDefaultVisibility() && !GV->hasLocalLinkage()) {
+        (MemIntName ||
+         (GV->hasDefaultVisibility() && !GV->hasLocalLinkage()))) {
       OpFlags = X86II::MO_PLT;
     } else if (Subtarget->isPICStyleStubAny() &&
-               (GV->isDeclaration() || GV->isWeakForLinker()) &&
+               (MemIntName || GV->isDeclaration() || GV->isWeakForLinker()) &&
                Subtarget->getDarwinVers() < 9) {
       // PC-relative references to external symbols should go through $stub,
       // unless we're building with the leopard linker or later, which
@@ -1497,7 +2096,11 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
     }
     
     
-    MIB = BuildMI(MBB, DL, TII.get(CallOpc)).addGlobalAddress(GV, 0, OpFlags);
+    MIB = BuildMI(MBB, DL, TII.get(CallOpc));
+    if (MemIntName)
+      MIB.addExternalSymbol(MemIntName, OpFlags);
+    else
+      MIB.addGlobalAddress(GV, 0, OpFlags);
   }
 
   // Add an implicit use GOT pointer in EBX.
@@ -1515,7 +2118,7 @@ bool X86FastISel::X86SelectCall(Instruction *I) {
   // Now handle call return value (if any).
   if (RetVT.getSimpleVT().SimpleTy != MVT::isVoid) {
     SmallVector<CCValAssign, 16> RVLocs;
-    CCState CCInfo(CC, false, TM, RVLocs, I->getParent()->getContext());
+    CCState CCInfo(CC, isVarArg, TM, RVLocs, I->getParent()->getContext());
     CCInfo.AnalyzeCallResult(RetVT, RetCC_X86);
 
     // Copy all of the result registers out of their specified physreg.
@@ -1602,6 +2205,17 @@ X86FastISel::TargetSelectInstruction(Instruction *I)  {
     return X86SelectFPTrunc(I);
   case Instruction::ExtractValue:
     return X86SelectExtractValue(I);
+  case Instruction::SDiv:
+  case Instruction::UDiv:
+  case Instruction::SRem:
+  case Instruction::URem:
+    return X86SelectDivRem(I);
+  case Instruction::BitCast:
+    return X86SelectBitCast(I);
+  case Instruction::Ret:
+    return X86SelectRet(I);
+  case Instruction::Switch:
+    return X86SelectSwitch(I);
   case Instruction::IntToPtr: // Deliberate fall-through.
   case Instruction::PtrToInt: {
     EVT SrcVT = TLI.getValueType(I->getOperand(0)->getType());
@@ -1668,6 +2282,21 @@ unsigned X86FastISel::TargetMaterializeConstant(Constant *C) {
   case MVT::f80:
     // No f80 support yet.
     return false;
+  case MVT::v4f32:
+  case MVT::v2f64:
+  case MVT::v4i32:
+  case MVT::v2i64:
+  case MVT::v8i16:
+  case MVT::v16i8:
+    // Zero vectors are materialized with xorps rather than loaded.
+    if (isa<ConstantAggregateZero>(C)) {
+      unsigned ResultReg = createResultReg(X86::VR128RegisterClass);
+      BuildMI(MBB, DL, TII.get(X86::V_SET0), ResultReg);
+      return ResultReg;
+    }
+    Opc = X86::MOVAPSrm;
+    RC  = X86::VR128RegisterClass;
+    break;
   }
   
   // Materialize addresses with LEA instructions.
@@ -17,7 +17,10 @@ namespace X86 {
 enum Fixups {
   reloc_pcrel_4byte = FirstTargetFixupKind,  // 32-bit pcrel, e.g. a branch.
   reloc_pcrel_1byte,                         // 8-bit pcrel, e.g. branch_1
-  reloc_riprel_4byte                         // 32-bit rip-relative
+  reloc_riprel_4byte,                        // 32-bit rip-relative
+  reloc_signed_4byte                         // 32-bit, sign extended to 64
+                                             // bits when used, e.g. a disp32
+                                             // in 64-bit mode.
 };
 }
 }
@@ -38,14 +38,15 @@ public:
   ~X86MCCodeEmitter() {}
 
   unsigned getNumFixupKinds() const {
-    return 3;
+    return 4;
   }
 
   const MCFixupKindInfo &getFixupKindInfo(MCFixupKind Kind) const {
     const static MCFixupKindInfo Infos[] = {
       { "reloc_pcrel_4byte", 0, 4 * 8 },
       { "reloc_pcrel_1byte", 0, 1 * 8 },
-      { "reloc_riprel_4byte", 0, 4 * 8 }
+      { "reloc_riprel_4byte", 0, 4 * 8 },
+      { "reloc_signed_4byte", 0, 4 * 8 }
     };
     
     if (Kind < FirstTargetFixupKind)
@@ -56,6 +57,12 @@ public:
     return Infos[Kind - FirstTargetFixupKind];
   }
   
+  /// getDisp32FixupKind - Return the fixup kind for a 32-bit displacement
+  /// that is not rip-relative.  In 64-bit mode it is sign extended.
+  MCFixupKind getDisp32FixupKind() const {
+    return Is64BitMode ? MCFixupKind(X86::reloc_signed_4byte) : FK_Data_4;
+  }
+
   static unsigned GetX86RegNum(const MCOperand &MO) {
     return X86RegisterInfo::getX86RegNum(MO.getReg());
   }
@@ -139,7 +146,13 @@ static MCFixupKind getImmFixupKind(unsigned TSFlags) {
   switch (Size) {
   default: assert(0 && "Unknown immediate size");
   case 1: return isPCRel ? MCFixupKind(X86::reloc_pcrel_1byte) : FK_Data_1;
-  case 4: return isPCRel ? MCFixupKind(X86::reloc_pcrel_4byte) : FK_Data_4;
+  case 4:
+    if (isPCRel)
+      return MCFixupKind(X86::reloc_pcrel_4byte);
+    // A 32-bit immediate of a 64-bit operation is sign extended.
+    if (TSFlags & X86II::REX_W)
+      return MCFixupKind(X86::reloc_signed_4byte);
+    return FK_Data_4;
   case 2: assert(!isPCRel); return FK_Data_2;
   case 8: assert(!isPCRel); return FK_Data_8;
   }
@@ -250,7 +263,7 @@ void X86MCCodeEmitter::EmitMemModRMByte(const MCInst &MI, unsigned Op,
     
     // Otherwise, emit the most general non-SIB encoding: [REG+disp32]
     EmitByte(ModRMByte(2, RegOpcodeField, BaseRegNo), CurByte, OS);
-    EmitImmediate(Disp, 4, FK_Data_4, CurByte, OS, Fixups);
+    EmitImmediate(Disp, 4, getDisp32FixupKind(), CurByte, OS, Fixups);
     return;
   }
     
@@ -307,7 +320,7 @@ void X86MCCodeEmitter::EmitMemModRMByte(const MCInst &MI, unsigned Op,
   if (ForceDisp8)
     EmitImmediate(Disp, 1, FK_Data_1, CurByte, OS, Fixups);
   else if (ForceDisp32 || Disp.getImm() != 0)
-    EmitImmediate(Disp, 4, FK_Data_4, CurByte, OS, Fixups);
+    EmitImmediate(Disp, 4, getDisp32FixupKind(), CurByte, OS, Fixups);
 }
 
 /// DetermineREXPrefix - Determine if the MCInst has to be encoded with a X86-64
@@ -0,0 +1,276 @@
+//===-- PartitionModule.cpp - Split a module for parallel codegen ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements PartitionModule and ExtractPartition, which divide the
+// definitions of a module into partitions that can be code generated
+// independently.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/PartitionModule.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+using namespace llvm;
+
+namespace {
+  /// RefGraphNode - A function definition and the function definitions that
+  /// its body refers to.  The root node refers to every function definition,
+  /// so that all of them are reachable from it.
+  struct RefGraphNode {
+    const Function *F;
+    unsigned Size;
+    std::vector<RefGraphNode*> Refs;
+    RefGraphNode() : F(0), Size(0) {}
+  };
+}
+
+namespace llvm {
+  template<> struct GraphTraits<RefGraphNode*> {
+    typedef RefGraphNode NodeType;
+    typedef std::vector<RefGraphNode*>::iterator ChildIteratorType;
+
+    static NodeType *getEntryNode(RefGraphNode *N) { return N; }
+    static ChildIteratorType child_begin(NodeType *N) {
+      return N->Refs.begin();
+    }
+    static ChildIteratorType child_end(NodeType *N) { return N->Refs.end(); }
+  };
+}
+
+typedef DenseMap<const GlobalValue*, unsigned> PartitionMapTy;
+
+/// FindUserPartitions - Add to Parts the partitions of the functions, global
+/// variables and aliases that refer to V, directly or through constants.
+/// Users that have not been assigned a partition yet are ignored.
+static void FindUserPartitions(const Value *V,
+                               const PartitionMapTy &PartitionOf,
+                               SmallPtrSet<const Value*, 16> &Visited,
+                               SmallVectorImpl<unsigned> &Parts) {
+  for (Value::use_const_iterator UI = V->use_begin(), E = V->use_end();
+       UI != E; ++UI) {
+    const User *U = *UI;
+    const GlobalValue *Owner;
+    if (const Instruction *I = dyn_cast<Instruction>(U))
+      Owner = I->getParent()->getParent();
+    else if (const GlobalValue *GV = dyn_cast<GlobalValue>(U))
+      Owner = GV;
+    else {
+      if (isa<Constant>(U) && Visited.insert(U))
+        FindUserPartitions(U, PartitionOf, Visited, Parts);
+      continue;
+    }
+
+    PartitionMapTy::const_iterator I = PartitionOf.find(Owner);
+    if (I != PartitionOf.end())
+      Parts.push_back(I->second);
+  }
+}
+
+/// PartitionFunctions - Assign the function definitions of M to partitions by
+/// walking the strongly connected components of the call graph bottom-up and
+/// starting a new partition whenever the current one has its share of the
+/// instructions.  Returns the number of partitions used.
+static unsigned PartitionFunctions(Module *M, unsigned NumPartitions,
+                                   PartitionMapTy &PartitionOf) {
+  std::vector<RefGraphNode> Nodes(M->size()+1);
+  DenseMap<const Function*, RefGraphNode*> NodeFor;
+  RefGraphNode *Root = &Nodes.back();
+  unsigned NumNodes = 0, TotalSize = 0;
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration()) {
+      RefGraphNode *N = &Nodes[NumNodes++];
+      N->F = F;
+      NodeFor[F] = N;
+      Root->Refs.push_back(N);
+    }
+
+  for (unsigned i = 0; i != NumNodes; ++i) {
+    RefGraphNode *N = &Nodes[i];
+    for (Function::const_iterator BB = N->F->begin(), BE = N->F->end();
+         BB != BE; ++BB)
+      for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end();
+           I != IE; ++I) {
+        ++N->Size;
+        for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end();
+             OI != OE; ++OI)
+          if (const Function *Callee =
+                dyn_cast<Function>((*OI)->stripPointerCasts())) {
+            DenseMap<const Function*, RefGraphNode*>::iterator CI =
+              NodeFor.find(Callee);
+            if (CI != NodeFor.end())
+              N->Refs.push_back(CI->second);
+          }
+      }
+    TotalSize += N->Size;
+  }
+
+  unsigned Target = (TotalSize + NumPartitions - 1) / NumPartitions;
+  unsigned Partition = 0, PartitionSize = 0;
+  for (scc_iterator<RefGraphNode*> I = scc_begin(Root), E = scc_end(Root);
+       I != E; ++I) {
+    std::vector<RefGraphNode*> &SCC = *I;
+    if (SCC.size() == 1 && SCC[0] == Root)
+      continue;
+
+    if (PartitionSize >= Target && Partition+1 < NumPartitions) {
+      ++Partition;
+      PartitionSize = 0;
+    }
+    for (unsigned i = 0, e = SCC.size(); i != e; ++i) {
+      PartitionOf[SCC[i]->F] = Partition;
+      PartitionSize += SCC[i]->Size;
+    }
+  }
+  return Partition+1;
+}
+
+/// PromoteToHidden - Give GV hidden external linkage and a name that does not
+/// clash with anything it might be linked with.
+static void PromoteToHidden(GlobalValue *GV) {
+  std::string Name = GV->getName();
+  GV->setName(Name + ".lto_priv");
+  GV->setLinkage(GlobalValue::ExternalLinkage);
+  GV->setVisibility(GlobalValue::HiddenVisibility);
+}
+
+unsigned llvm::PartitionModule(Module *M, unsigned NumPartitions,
+                               std::vector<unsigned> &Assignment) {
+  assert(NumPartitions && "Need at least one partition!");
+  PartitionMapTy PartitionOf;
+  unsigned NumUsed = PartitionFunctions(M, NumPartitions, PartitionOf);
+
+  // Put each global variable in the first partition that uses it.  Variables
+  // that are not used by any function or earlier variable go to partition 0.
+  for (Module::global_iterator GV = M->global_begin(), E = M->global_end();
+       GV != E; ++GV) {
+    if (GV->isDeclaration() || GV->hasAppendingLinkage()) {
+      PartitionOf[GV] = 0;
+      continue;
+    }
+    SmallPtrSet<const Value*, 16> Visited;
+    SmallVector<unsigned, 8> Parts;
+    FindUserPartitions(GV, PartitionOf, Visited, Parts);
+    unsigned Partition = Parts.empty() ? 0 : Parts[0];
+    for (unsigned i = 1, e = Parts.size(); i != e; ++i)
+      Partition = std::min(Partition, Parts[i]);
+    PartitionOf[GV] = Partition;
+  }
+
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (F->isDeclaration())
+      PartitionOf[F] = 0;
+
+  for (Module::alias_iterator GA = M->alias_begin(), E = M->alias_end();
+       GA != E; ++GA) {
+    const GlobalValue *Aliasee = GA->resolveAliasedGlobal(false);
+    PartitionMapTy::iterator I = Aliasee ? PartitionOf.find(Aliasee)
+                                         : PartitionOf.end();
+    unsigned Partition = I != PartitionOf.end() ? I->second : 0;
+    PartitionOf[GA] = Partition;
+  }
+
+  // Collect the assignment, and make everything that is referred to across
+  // partitions visible to the other partitions.
+  std::vector<GlobalValue*> GVs;
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    GVs.push_back(I);
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    GVs.push_back(I);
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    GVs.push_back(I);
+
+  Assignment.clear();
+  Assignment.reserve(GVs.size());
+  for (unsigned i = 0, e = GVs.size(); i != e; ++i) {
+    GlobalValue *GV = GVs[i];
+    unsigned Partition = PartitionOf[GV];
+    Assignment.push_back(Partition);
+    if (!GV->hasLocalLinkage() || NumUsed == 1)
+      continue;
+
+    SmallPtrSet<const Value*, 16> Visited;
+    SmallVector<unsigned, 8> Parts;
+    FindUserPartitions(GV, PartitionOf, Visited, Parts);
+    for (unsigned j = 0, je = Parts.size(); j != je; ++j)
+      if (Parts[j] != Partition) {
+        PromoteToHidden(GV);
+        break;
+      }
+  }
+
+  return NumUsed;
+}
+
+void llvm::ExtractPartition(Module *M, const std::vector<unsigned> &Assignment,
+                            unsigned Partition) {
+  assert(Assignment.size() ==
+         M->getGlobalList().size() + M->size() + M->alias_size() &&
+         "Module doesn't match the partition assignment!");
+  std::vector<GlobalValue*> Drop;
+  std::vector<GlobalVariable*> Appending;
+  std::vector<GlobalAlias*> Aliases;
+  unsigned i = 0;
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    if (Assignment[i++] != Partition && !I->isDeclaration()) {
+      if (I->hasAppendingLinkage())
+        Appending.push_back(I);
+      else
+        Drop.push_back(I);
+    }
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (Assignment[i++] != Partition && !I->isDeclaration())
+      Drop.push_back(I);
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    if (Assignment[i++] != Partition)
+      Aliases.push_back(I);
+
+  // An alias has to refer to a definition, so aliases defined elsewhere are
+  // replaced by declarations of the same name.
+  for (unsigned j = 0, je = Aliases.size(); j != je; ++j) {
+    GlobalAlias *GA = Aliases[j];
+    const PointerType *PTy = GA->getType();
+    GlobalValue *Decl;
+    if (const FunctionType *FTy =
+          dyn_cast<FunctionType>(PTy->getElementType()))
+      Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", M);
+    else
+      Decl = new GlobalVariable(*M, PTy->getElementType(), false,
+                                GlobalValue::ExternalLinkage, 0, "", 0, false,
+                                PTy->getAddressSpace());
+    Decl->setVisibility(GA->getVisibility());
+    Decl->takeName(GA);
+    GA->replaceAllUsesWith(Decl);
+    GA->eraseFromParent();
+  }
+
+  for (unsigned j = 0, je = Appending.size(); j != je; ++j)
+    Appending[j]->eraseFromParent();
+
+  if (Partition != 0)
+    M->setModuleInlineAsm("");
+
+  if (!Drop.empty()) {
+    PassManager PM;
+    PM.add(createGVExtractionPass(Drop, /*deleteFn=*/true));
+    PM.run(*M);
+  }
+}
@@ -37,6 +37,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/System/Threading.h"
 #include <algorithm>
 #include <cctype>
 #include <map>
@@ -155,6 +156,10 @@ void TypePrinting::addTypeName(const Type *Ty, const std::string &N) {
   getTypeNamesMap(TypeNames).insert(std::make_pair(Ty, N));
 }
 
+void TypePrinting::copyTypeNames(const TypePrinting &Other) {
+  getTypeNamesMap(TypeNames) = getTypeNamesMap(Other.TypeNames);
+}
+
 
 TypePrinting::TypePrinting() {
   TypeNames = new DenseMap<const Type *, std::string>();
@@ -329,6 +334,14 @@ namespace {
     TypeFinder(TypePrinting &tp, std::vector<const Type*> &numberedTypes)
       : TP(tp), NumberedTypes(numberedTypes) {}
 
+    /// NameVisitedTypes - Compute and remember the name of every type that Run
+    /// found.  This has to wait until Run has numbered all of the types.
+    void NameVisitedTypes() {
+      for (DenseSet<const Type*>::iterator I = VisitedTypes.begin(),
+           E = VisitedTypes.end(); I != E; ++I)
+        TP.print(*I, nulls());
+    }
+
     void Run(const Module &M) {
       // Get types from the type symbol table.  This gets opaque types referened
       // only through derived named types.
@@ -372,6 +385,10 @@ namespace {
 
   private:
     void IncorporateType(const Type *Ty) {
+      // Primitive types have no subtypes and never need a number.
+      if (Ty->isPrimitiveType() || Ty->isIntegerTy())
+        return;
+
       // Check to see if we're already visited this type.
       if (!VisitedTypes.insert(Ty).second)
         return;
@@ -415,10 +432,12 @@ namespace {
 
 /// AddModuleTypesToPrinter - Add all of the symbolic type names for types in
 /// the specified module to the TypePrinter and all numbered types to it and the
-/// NumberedTypes table.
+/// NumberedTypes table.  If NameAllTypes is true, the names of all the other
+/// types used in the module are computed up front as well.
 static void AddModuleTypesToPrinter(TypePrinting &TP,
                                     std::vector<const Type*> &NumberedTypes,
-                                    const Module *M) {
+                                    const Module *M,
+                                    bool NameAllTypes = false) {
   if (M == 0) return;
 
   // If the module has a symbol table, take all global types and stuff their
@@ -454,7 +473,10 @@ static void AddModuleTypesToPrinter(TypePrinting &TP,
   // types.  This is required for correctness by opaque types (because multiple
   // uses of an unnamed opaque type needs to be referred to by the same ID) and
   // it shrinks complex recursive structure types substantially in some cases.
-  TypeFinder(TP, NumberedTypes).Run(*M);
+  TypeFinder Finder(TP, NumberedTypes);
+  Finder.Run(*M);
+  if (NameAllTypes)
+    Finder.NameVisitedTypes();
 }
 
 
@@ -490,6 +512,11 @@ private:
   const Function* TheFunction;
   bool FunctionProcessed;
 
+  /// ModuleSlots - If not null, the tracker that holds the module level slot
+  /// numbers, including those of the metadata of every function.  This one
+  /// then only numbers the values local to the incorporated function.
+  const SlotTracker *ModuleSlots;
+
   /// mMap - The TypePlanes map for the module level data.
   ValueMap mMap;
   unsigned mNext;
@@ -506,6 +533,10 @@ public:
   explicit SlotTracker(const Module *M);
   /// Construct from a function, starting out in incorp state.
   explicit SlotTracker(const Function *F);
+  /// Construct a tracker for the functions of ModuleSlots' module, which
+  /// must not change while this one is in use.  Several such trackers can
+  /// be used on different threads.
+  explicit SlotTracker(const SlotTracker *ModuleSlots);
 
   /// Return the slot number of the specified value in it's type
   /// plane.  If something is not in the SlotTracker, return -1.
@@ -525,6 +556,10 @@ public:
   /// will reset the state of the machine back to just the module contents.
   void purgeFunction();
 
+  /// incorporateFunctionMetadata - Number the metadata used by the body of F,
+  /// as incorporating and processing F would.
+  void incorporateFunctionMetadata(const Function *F);
+
   /// MDNode map iterators.
   typedef DenseMap<const MDNode*, unsigned>::iterator mdn_iterator;
   mdn_iterator mdn_begin() { return mdnMap.begin(); }
@@ -546,6 +581,11 @@ private:
   /// CreateFunctionSlot - Insert the specified Value* into the slot table.
   void CreateFunctionSlot(const Value *V);
 
+  /// CreateInstructionMetadataSlots - Insert the metadata that I uses into
+  /// the slot table.
+  void CreateInstructionMetadataSlots(const Instruction *I,
+                        SmallVectorImpl<std::pair<unsigned, MDNode*> > &MDs);
+
   /// Add all of the module level global variables (and their initializers)
   /// and function declarations, but not the contents of those functions.
   void processModule();
@@ -594,7 +634,7 @@ static SlotTracker *createSlotTracker(const Value *V) {
 // Module level constructor. Causes the contents of the Module (sans functions)
 // to be added to the slot table.
 SlotTracker::SlotTracker(const Module *M)
-  : TheModule(M), TheFunction(0), FunctionProcessed(false), 
+  : TheModule(M), TheFunction(0), FunctionProcessed(false), ModuleSlots(0),
     mNext(0), fNext(0),  mdnNext(0) {
 }
 
@@ -602,6 +642,13 @@ SlotTracker::SlotTracker(const Module *M)
 // function provided to be added to the slot table.
 SlotTracker::SlotTracker(const Function *F)
   : TheModule(F ? F->getParent() : 0), TheFunction(F), FunctionProcessed(false),
+    ModuleSlots(0), mNext(0), fNext(0), mdnNext(0) {
+}
+
+// Function level constructor that shares the module level slots of another
+// tracker, which has to have numbered them already.
+SlotTracker::SlotTracker(const SlotTracker *MS)
+  : TheModule(0), TheFunction(0), FunctionProcessed(false), ModuleSlots(MS),
     mNext(0), fNext(0), mdnNext(0) {
 }
 
@@ -672,18 +719,10 @@ void SlotTracker::processFunction() {
          ++I) {
       if (!I->getType()->isVoidTy() && !I->hasName())
         CreateFunctionSlot(I);
-      
-      // Intrinsics can directly use metadata.
-      if (isa<IntrinsicInst>(I))
-        for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
-          if (MDNode *N = dyn_cast_or_null<MDNode>(I->getOperand(i)))
-            CreateMetadataSlot(N);
-
-      // Process metadata attached with this instruction.
-      I->getAllMetadata(MDForInst);
-      for (unsigned i = 0, e = MDForInst.size(); i != e; ++i)
-        CreateMetadataSlot(MDForInst[i].second);
-      MDForInst.clear();
+
+      // The module level tracker already has the metadata.
+      if (!ModuleSlots)
+        CreateInstructionMetadataSlots(I, MDForInst);
     }
   }
 
@@ -692,6 +731,16 @@ void SlotTracker::processFunction() {
   ST_DEBUG("end processFunction!\n");
 }
 
+void SlotTracker::incorporateFunctionMetadata(const Function *F) {
+  initialize();
+
+  SmallVector<std::pair<unsigned, MDNode*>, 4> MDForInst;
+  for (Function::const_iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I != E;
+         ++I)
+      CreateInstructionMetadataSlots(I, MDForInst);
+}
+
 /// Clean up after incorporating a function. This is the only way to get out of
 /// the function incorporation state that affects get*Slot/Create*Slot. Function
 /// incorporation state is indicated by TheFunction != 0.
@@ -709,8 +758,9 @@ int SlotTracker::getGlobalSlot(const GlobalValue *V) {
   initialize();
 
   // Find the type plane in the module map
-  ValueMap::iterator MI = mMap.find(V);
-  return MI == mMap.end() ? -1 : (int)MI->second;
+  const ValueMap &Map = ModuleSlots ? ModuleSlots->mMap : mMap;
+  ValueMap::const_iterator MI = Map.find(V);
+  return MI == Map.end() ? -1 : (int)MI->second;
 }
 
 /// getMetadataSlot - Get the slot number of a MDNode.
@@ -719,8 +769,10 @@ int SlotTracker::getMetadataSlot(const MDNode *N) {
   initialize();
 
   // Find the type plane in the module map
-  mdn_iterator MI = mdnMap.find(N);
-  return MI == mdnMap.end() ? -1 : (int)MI->second;
+  const DenseMap<const MDNode*, unsigned> &Map =
+    ModuleSlots ? ModuleSlots->mdnMap : mdnMap;
+  DenseMap<const MDNode*, unsigned>::const_iterator MI = Map.find(N);
+  return MI == Map.end() ? -1 : (int)MI->second;
 }
 
 
@@ -765,6 +817,23 @@ void SlotTracker::CreateFunctionSlot(const Value *V) {
            DestSlot << " [o]\n");
 }
 
+/// CreateInstructionMetadataSlots - Insert the metadata that I uses into the
+/// slot table.  MDs is scratch space.
+void SlotTracker::CreateInstructionMetadataSlots(const Instruction *I,
+                        SmallVectorImpl<std::pair<unsigned, MDNode*> > &MDs) {
+  // Intrinsics can directly use metadata.
+  if (isa<IntrinsicInst>(I))
+    for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
+      if (MDNode *N = dyn_cast_or_null<MDNode>(I->getOperand(i)))
+        CreateMetadataSlot(N);
+
+  // Process metadata attached with this instruction.
+  I->getAllMetadata(MDs);
+  for (unsigned i = 0, e = MDs.size(); i != e; ++i)
+    CreateMetadataSlot(MDs[i].second);
+  MDs.clear();
+}
+
 /// CreateModuleSlot - Insert the specified MDNode* into the slot table.
 void SlotTracker::CreateMetadataSlot(const MDNode *N) {
   assert(N && "Can't insert a null Value into SlotTracker!");
@@ -1241,15 +1310,25 @@ class AssemblyWriter {
 public:
   inline AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
                         const Module *M,
-                        AssemblyAnnotationWriter *AAW)
+                        AssemblyAnnotationWriter *AAW,
+                        bool NameAllTypes = false)
     : Out(o), Machine(Mac), TheModule(M), AnnotationWriter(AAW) {
-    AddModuleTypesToPrinter(TypePrinter, NumberedTypes, M);
+    AddModuleTypesToPrinter(TypePrinter, NumberedTypes, M, NameAllTypes);
+  }
+
+  /// Construct a writer that prints to o the functions of the module that
+  /// Parent prints, using the type names Parent has computed so far.
+  AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
+                 const AssemblyWriter &Parent)
+    : Out(o), Machine(Mac), TheModule(Parent.TheModule),
+      AnnotationWriter(Parent.AnnotationWriter) {
+    TypePrinter.copyTypeNames(Parent.TypePrinter);
   }
 
   void printMDNodeBody(const MDNode *MD);
   void printNamedMDNode(const NamedMDNode *NMD);
   
-  void printModule(const Module *M);
+  void printModule(const Module *M, unsigned NumThreads = 1);
 
   void writeOperand(const Value *Op, bool PrintType);
   void writeParamOperand(const Value *Operand, Attributes Attrs);
@@ -1260,6 +1339,7 @@ public:
   void printGlobal(const GlobalVariable *GV);
   void printAlias(const GlobalAlias *GV);
   void printFunction(const Function *F);
+  void printFunctionsInParallel(const Module *M, unsigned NumThreads);
   void printArgument(const Argument *FA, Attributes Attrs);
   void printBasicBlock(const BasicBlock *BB);
   void printInstruction(const Instruction &I);
@@ -1300,7 +1380,7 @@ void AssemblyWriter::writeParamOperand(const Value *Operand,
   WriteAsOperandInternal(Out, Operand, &TypePrinter, &Machine);
 }
 
-void AssemblyWriter::printModule(const Module *M) {
+void AssemblyWriter::printModule(const Module *M, unsigned NumThreads) {
   if (!M->getModuleIdentifier().empty() &&
       // Don't print the ID if it will start a new line (which would
       // require a comment char before it).
@@ -1365,8 +1445,11 @@ void AssemblyWriter::printModule(const Module *M) {
     printAlias(I);
 
   // Output all of the functions.
-  for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
-    printFunction(I);
+  if (NumThreads > 1)
+    printFunctionsInParallel(M, NumThreads);
+  else
+    for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
+      printFunction(I);
 
   // Output named metadata.
   if (!M->named_metadata_empty()) Out << '\n';
@@ -1630,6 +1713,76 @@ void AssemblyWriter::printFunction(const Function *F) {
   Machine.purgeFunction();
 }
 
+namespace {
+  /// ParallelFunctionPrinter - The state that printFunctionsInParallel shares
+  /// with the threads that print the function bodies.
+  struct ParallelFunctionPrinter {
+    const AssemblyWriter &Parent;
+    const SlotTracker &ModuleSlots;
+
+    /// Functions - The functions to print, in module order.
+    std::vector<const Function*> Functions;
+
+    /// RunStarts - Thread i prints Functions[RunStarts[i], RunStarts[i+1]).
+    std::vector<unsigned> RunStarts;
+
+    /// Buffers - The text printed by each thread.
+    std::vector<std::string> Buffers;
+
+    ParallelFunctionPrinter(const AssemblyWriter &parent,
+                            const SlotTracker &moduleSlots)
+      : Parent(parent), ModuleSlots(moduleSlots) {}
+  };
+}
+
+static void PrintFunctionRun(void *Arg, unsigned ThreadNo) {
+  ParallelFunctionPrinter &PP = *static_cast<ParallelFunctionPrinter*>(Arg);
+  unsigned Begin = PP.RunStarts[ThreadNo], End = PP.RunStarts[ThreadNo+1];
+  if (Begin == End)
+    return;
+
+  raw_string_ostream ROS(PP.Buffers[ThreadNo]);
+  formatted_raw_ostream OS(ROS);
+  SlotTracker Machine(&PP.ModuleSlots);
+  AssemblyWriter W(OS, Machine, PP.Parent);
+  for (unsigned i = Begin; i != End; ++i)
+    W.printFunction(PP.Functions[i]);
+}
+
+/// printFunctionsInParallel - Print the functions of M on NumThreads threads,
+/// each into its own buffer, and then write the buffers out in order.  The
+/// output is the same as printing the functions one after another.
+void AssemblyWriter::printFunctionsInParallel(const Module *M,
+                                              unsigned NumThreads) {
+  ParallelFunctionPrinter PP(*this, Machine);
+
+  // The metadata used by a function is numbered after the metadata of the
+  // functions printed before it, so number the metadata of all of them up
+  // front.  Also count instructions to give each thread a similar amount of
+  // work.
+  std::vector<unsigned> Sizes;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F) {
+    PP.Functions.push_back(F);
+    Machine.incorporateFunctionMetadata(F);
+    // The GC table is created lazily; do that before the threads read it.
+    F->hasGC();
+
+    unsigned Size = 1;
+    for (Function::const_iterator BB = F->begin(), BE = F->end();
+         BB != BE; ++BB)
+      Size += BB->size();
+    Sizes.push_back(Size);
+  }
+
+  NumThreads = llvm_split_into_runs(Sizes, NumThreads, PP.RunStarts);
+
+  PP.Buffers.resize(NumThreads);
+  llvm_execute_on_threads(PrintFunctionRun, &PP, NumThreads);
+
+  for (unsigned i = 0; i != NumThreads; ++i)
+    Out << PP.Buffers[i];
+}
+
 /// printArgument - This member is called for every argument that is passed into
 /// the function.  Simply print it out
 ///
@@ -2053,11 +2206,16 @@ void AssemblyWriter::printMDNodeBody(const MDNode *Node) {
 //                       External Interface declarations
 //===----------------------------------------------------------------------===//
 
-void Module::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW) const {
+void Module::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW,
+                   unsigned NumThreads) const {
+  // The annotation writer's callbacks expect to run one after another.
+  if (AAW)
+    NumThreads = 1;
+
   SlotTracker SlotTable(this);
   formatted_raw_ostream OS(ROS);
-  AssemblyWriter W(OS, SlotTable, this, AAW);
-  W.printModule(this);
+  AssemblyWriter W(OS, SlotTable, this, AAW, NumThreads > 1);
+  W.printModule(this, NumThreads);
 }
 
 void Type::print(raw_ostream &OS) const {
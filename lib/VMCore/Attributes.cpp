@@ -104,6 +104,8 @@ Attributes Attribute::typeIncompatible(const Type *Ty) {
 // AttributeListImpl Definition
 //===----------------------------------------------------------------------===//
 
+static ManagedStatic<sys::SmartMutex<true> > ALMutex;
+
 namespace llvm {
 class AttributeListImpl : public FoldingSetNode {
   sys::cas_flag RefCount;
@@ -111,7 +113,7 @@ class AttributeListImpl : public FoldingSetNode {
   // AttributesList is uniqued, these should not be publicly available.
   void operator=(const AttributeListImpl &); // Do not implement
   AttributeListImpl(const AttributeListImpl &); // Do not implement
-  ~AttributeListImpl();                        // Private implementation
+  ~AttributeListImpl() {}                      // Private implementation
 public:
   SmallVector<AttributeWithIndex, 4> Attrs;
   
@@ -121,10 +123,7 @@ public:
   }
   
   void AddRef() { sys::AtomicIncrement(&RefCount); }
-  void DropRef() {
-    sys::cas_flag old = sys::AtomicDecrement(&RefCount);
-    if (old == 0) delete this;
-  }
+  void DropRef();
   
   void Profile(FoldingSetNodeID &ID) const {
     Profile(ID, Attrs.data(), Attrs.size());
@@ -137,12 +136,16 @@ public:
 };
 }
 
-static ManagedStatic<sys::SmartMutex<true> > ALMutex;
 static ManagedStatic<FoldingSet<AttributeListImpl> > AttributesLists;
 
-AttributeListImpl::~AttributeListImpl() {
+void AttributeListImpl::DropRef() {
+  // The count has to drop to zero under the lock, or another thread could
+  // find this list in AttributesLists and revive it while it is deleted.
   sys::SmartScopedLock<true> Lock(*ALMutex);
-  AttributesLists->RemoveNode(this);
+  if (sys::AtomicDecrement(&RefCount) == 0) {
+    AttributesLists->RemoveNode(this);
+    delete this;
+  }
 }
 
 
@@ -37,10 +37,37 @@ LLVMContext &BasicBlock::getContext() const {
 // are not in the public header file...
 template class llvm::SymbolTableListTraits<Instruction, BasicBlock>;
 
+void ilist_traits<Instruction>::addNodeToList(Instruction *I) {
+  SymbolTableListTraits<Instruction, BasicBlock>::addNodeToList(I);
+  if (Function *F = getListOwner()->getParent())
+    F->markModified();
+}
+
+void ilist_traits<Instruction>::removeNodeFromList(Instruction *I) {
+  SymbolTableListTraits<Instruction, BasicBlock>::removeNodeFromList(I);
+  if (Function *F = getListOwner()->getParent())
+    F->markModified();
+}
+
+void ilist_traits<Instruction>::transferNodesFromList(
+                                            ilist_traits<Instruction> &L2,
+                                            ilist_iterator<Instruction> first,
+                                            ilist_iterator<Instruction> last) {
+  SymbolTableListTraits<Instruction, BasicBlock>::transferNodesFromList(L2,
+                                                                first, last);
+  if (Function *F = getListOwner()->getParent())
+    F->markModified();
+  if (Function *F = L2.getListOwner()->getParent())
+    F->markModified();
+}
+
 
 BasicBlock::BasicBlock(LLVMContext &C, const Twine &Name, Function *NewParent,
                        BasicBlock *InsertBefore)
   : Value(Type::getLabelTy(C), Value::BasicBlockVal), Parent(0) {
+  // operator new took the memory from the current arena, if there is one.
+  if (IRArena::getCurrent())
+    setValueSubclassData(FromArenaBit);
 
   // Make sure that we get added to a function
   LeakDetector::addGarbageObject(this);
@@ -81,6 +108,13 @@ BasicBlock::~BasicBlock() {
   InstList.clear();
 }
 
+void BasicBlock::operator delete(void *BB) {
+  // The block has been destroyed, but its fields are still intact.
+  bool FromArena =
+    static_cast<BasicBlock*>(BB)->getSubclassDataFromValue() & FromArenaBit;
+  IRArena::deallocate(BB, FromArena);
+}
+
 void BasicBlock::setParent(Function *parent) {
   if (getParent())
     LeakDetector::addGarbageObject(this);
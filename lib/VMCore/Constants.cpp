@@ -865,6 +865,15 @@ getWithOperands(Constant* const *Ops, unsigned NumOps) const {
     return ConstantExpr::getExtractElement(Ops[0], Ops[1]);
   case Instruction::ShuffleVector:
     return ConstantExpr::getShuffleVector(Ops[0], Ops[1], Ops[2]);
+  case Instruction::ExtractValue: {
+    const SmallVector<unsigned, 4> &Indices = getIndices();
+    return ConstantExpr::getExtractValue(Ops[0], &Indices[0], Indices.size());
+  }
+  case Instruction::InsertValue: {
+    const SmallVector<unsigned, 4> &Indices = getIndices();
+    return ConstantExpr::getInsertValue(Ops[0], Ops[1],
+                                        &Indices[0], Indices.size());
+  }
   case Instruction::GetElementPtr:
     return cast<GEPOperator>(this)->isInBounds() ?
       ConstantExpr::getInBoundsGetElementPtr(Ops[0], &Ops[1], NumOps-1) :
@@ -1136,15 +1145,18 @@ void BlockAddress::destroyConstant() {
 }
 
 void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
+  Value *Ops[] = { getFunction(), getBasicBlock() };
+  Ops[U - OperandList] = To;
+  replaceOperandsOnConstant(Ops, 2);
+}
+
+void BlockAddress::replaceOperandsOnConstant(Value *const *Ops,
+                                             unsigned NumOps) {
+  assert(NumOps == 2 && "Block addresses have two operands!");
   // This could be replacing either the Basic Block or the Function.  In either
   // case, we have to remove the map entry.
-  Function *NewF = getFunction();
-  BasicBlock *NewBB = getBasicBlock();
-  
-  if (U == &Op<0>())
-    NewF = cast<Function>(To);
-  else
-    NewBB = cast<BasicBlock>(To);
+  Function *NewF = cast<Function>(Ops[0]);
+  BasicBlock *NewBB = cast<BasicBlock>(Ops[1]);
   
   // See if the 'new' entry already exists, if not, just update this in place
   // and return early.
@@ -1967,11 +1979,7 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
   LLVMContext &Context = getType()->getContext();
   LLVMContextImpl *pImpl = Context.pImpl;
 
-  std::pair<LLVMContextImpl::ArrayConstantsTy::MapKey, ConstantArray*> Lookup;
-  Lookup.first.first = getType();
-  Lookup.second = this;
-
-  std::vector<Constant*> &Values = Lookup.first.second;
+  std::vector<Constant*> Values;
   Values.reserve(getNumOperands());  // Build replacement array.
 
   // Fill values with the modified operands of the constant array.  Also, 
@@ -2005,18 +2013,14 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
     Replacement = ConstantAggregateZero::get(getType());
   } else {
     // Check to see if we have this array type already.
-    bool Exists;
-    LLVMContextImpl::ArrayConstantsTy::MapTy::iterator I =
-      pImpl->ArrayConstants.InsertOrGetItem(Lookup, Exists);
+    Replacement = pImpl->ArrayConstants.getExisting(getType(), Values);
     
-    if (Exists) {
-      Replacement = I->second;
-    } else {
+    if (!Replacement) {
       // Okay, the new shape doesn't exist in the system yet.  Instead of
       // creating a new constant array, inserting it, replaceallusesof'ing the
       // old with the new, then deleting the old... just update the current one
       // in place!
-      pImpl->ArrayConstants.MoveConstantToNewSlot(this, I);
+      pImpl->ArrayConstants.MoveConstantToNewSlot(this, Values);
       
       // Update to the new value.  Optimize for the case when we have a single
       // operand that we're changing, but handle bulk updates efficiently.
@@ -2044,6 +2048,42 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
   destroyConstant();
 }
 
+/// replaceOperandsOnConstant - Rebuild this constant array with the operands
+/// in Ops.  Like replaceUsesOfWithOnConstant, this updates the array in place
+/// if the new shape does not exist yet.
+void ConstantArray::replaceOperandsOnConstant(Value *const *Ops,
+                                              unsigned NumOps) {
+  assert(NumOps == getNumOperands() && "Operand count mismatch!");
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+
+  std::vector<Constant*> Values;
+  Values.reserve(NumOps);
+  bool isAllZeros = true;
+  for (unsigned i = 0; i != NumOps; ++i) {
+    Constant *Val = cast<Constant>(Ops[i]);
+    Values.push_back(Val);
+    if (isAllZeros) isAllZeros = Val->isNullValue();
+  }
+
+  Constant *Replacement = 0;
+  if (isAllZeros) {
+    Replacement = ConstantAggregateZero::get(getType());
+  } else {
+    Replacement = pImpl->ArrayConstants.getExisting(getType(), Values);
+    if (!Replacement) {
+      pImpl->ArrayConstants.MoveConstantToNewSlot(this, Values);
+      for (unsigned i = 0; i != NumOps; ++i)
+        if (getOperand(i) != Values[i])
+          setOperand(i, Values[i]);
+      return;
+    }
+  }
+
+  assert(Replacement != this && "No operand was replaced!");
+  uncheckedReplaceAllUsesWith(Replacement);
+  destroyConstant();
+}
+
 void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
@@ -2052,10 +2092,7 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
   unsigned OperandToUpdate = U-OperandList;
   assert(getOperand(OperandToUpdate) == From && "ReplaceAllUsesWith broken!");
 
-  std::pair<LLVMContextImpl::StructConstantsTy::MapKey, ConstantStruct*> Lookup;
-  Lookup.first.first = getType();
-  Lookup.second = this;
-  std::vector<Constant*> &Values = Lookup.first.second;
+  std::vector<Constant*> Values;
   Values.reserve(getNumOperands());  // Build replacement struct.
   
   
@@ -2082,19 +2119,15 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
   if (isAllZeros) {
     Replacement = ConstantAggregateZero::get(getType());
   } else {
-    // Check to see if we have this array type already.
-    bool Exists;
-    LLVMContextImpl::StructConstantsTy::MapTy::iterator I =
-      pImpl->StructConstants.InsertOrGetItem(Lookup, Exists);
+    // Check to see if we have this struct type already.
+    Replacement = pImpl->StructConstants.getExisting(getType(), Values);
     
-    if (Exists) {
-      Replacement = I->second;
-    } else {
+    if (!Replacement) {
       // Okay, the new shape doesn't exist in the system yet.  Instead of
       // creating a new constant struct, inserting it, replaceallusesof'ing the
       // old with the new, then deleting the old... just update the current one
       // in place!
-      pImpl->StructConstants.MoveConstantToNewSlot(this, I);
+      pImpl->StructConstants.MoveConstantToNewSlot(this, Values);
       
       // Update to the new value.
       setOperand(OperandToUpdate, ToC);
@@ -2111,6 +2144,39 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
   destroyConstant();
 }
 
+void ConstantStruct::replaceOperandsOnConstant(Value *const *Ops,
+                                               unsigned NumOps) {
+  assert(NumOps == getNumOperands() && "Operand count mismatch!");
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+
+  std::vector<Constant*> Values;
+  Values.reserve(NumOps);
+  bool isAllZeros = true;
+  for (unsigned i = 0; i != NumOps; ++i) {
+    Constant *Val = cast<Constant>(Ops[i]);
+    Values.push_back(Val);
+    if (isAllZeros) isAllZeros = Val->isNullValue();
+  }
+
+  Constant *Replacement = 0;
+  if (isAllZeros) {
+    Replacement = ConstantAggregateZero::get(getType());
+  } else {
+    Replacement = pImpl->StructConstants.getExisting(getType(), Values);
+    if (!Replacement) {
+      pImpl->StructConstants.MoveConstantToNewSlot(this, Values);
+      for (unsigned i = 0; i != NumOps; ++i)
+        if (getOperand(i) != Values[i])
+          setOperand(i, Values[i]);
+      return;
+    }
+  }
+
+  assert(Replacement != this && "No operand was replaced!");
+  uncheckedReplaceAllUsesWith(Replacement);
+  destroyConstant();
+}
+
 void ConstantUnion::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
@@ -2120,11 +2186,6 @@ void ConstantUnion::replaceUsesOfWithOnConstant(Value *From, Value *To,
   assert(getNumOperands() == 1 && "Union constants can only have one use!");
   assert(getOperand(0) == From && "ReplaceAllUsesWith broken!");
 
-  std::pair<LLVMContextImpl::UnionConstantsTy::MapKey, ConstantUnion*> Lookup;
-  Lookup.first.first = getType();
-  Lookup.second = this;
-  Lookup.first.second = ToC;
-
   LLVMContext &Context = getType()->getContext();
   LLVMContextImpl *pImpl = Context.pImpl;
 
@@ -2133,18 +2194,14 @@ void ConstantUnion::replaceUsesOfWithOnConstant(Value *From, Value *To,
     Replacement = ConstantAggregateZero::get(getType());
   } else {
     // Check to see if we have this union type already.
-    bool Exists;
-    LLVMContextImpl::UnionConstantsTy::MapTy::iterator I =
-      pImpl->UnionConstants.InsertOrGetItem(Lookup, Exists);
+    Replacement = pImpl->UnionConstants.getExisting(getType(), ToC);
     
-    if (Exists) {
-      Replacement = I->second;
-    } else {
+    if (!Replacement) {
       // Okay, the new shape doesn't exist in the system yet.  Instead of
       // creating a new constant union, inserting it, replaceallusesof'ing the
       // old with the new, then deleting the old... just update the current one
       // in place!
-      pImpl->UnionConstants.MoveConstantToNewSlot(this, I);
+      pImpl->UnionConstants.MoveConstantToNewSlot(this, ToC);
       
       // Update to the new value.
       setOperand(0, ToC);
@@ -2161,6 +2218,12 @@ void ConstantUnion::replaceUsesOfWithOnConstant(Value *From, Value *To,
   destroyConstant();
 }
 
+void ConstantUnion::replaceOperandsOnConstant(Value *const *Ops,
+                                              unsigned NumOps) {
+  assert(NumOps == 1 && "Union constants can only have one use!");
+  replaceUsesOfWithOnConstant(getOperand(0), Ops[0], OperandList);
+}
+
 void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
@@ -2183,6 +2246,20 @@ void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
   destroyConstant();
 }
 
+void ConstantVector::replaceOperandsOnConstant(Value *const *Ops,
+                                               unsigned NumOps) {
+  assert(NumOps == getNumOperands() && "Operand count mismatch!");
+  std::vector<Constant*> Values;
+  Values.reserve(NumOps);
+  for (unsigned i = 0; i != NumOps; ++i)
+    Values.push_back(cast<Constant>(Ops[i]));
+
+  Constant *Replacement = get(getType(), Values);
+  assert(Replacement != this && "No operand was replaced!");
+  uncheckedReplaceAllUsesWith(Replacement);
+  destroyConstant();
+}
+
 void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
                                                Use *U) {
   assert(isa<Constant>(ToV) && "Cannot make Constant refer to non-constant!");
@@ -2200,8 +2277,12 @@ void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
       if (Val == From) Val = To;
       Indices.push_back(Val);
     }
-    Replacement = ConstantExpr::getGetElementPtr(Pointer,
-                                                 &Indices[0], Indices.size());
+    if (cast<GEPOperator>(this)->isInBounds())
+      Replacement = ConstantExpr::getInBoundsGetElementPtr(Pointer,
+                                                   &Indices[0], Indices.size());
+    else
+      Replacement = ConstantExpr::getGetElementPtr(Pointer,
+                                                   &Indices[0], Indices.size());
   } else if (getOpcode() == Instruction::ExtractValue) {
     Constant *Agg = getOperand(0);
     if (Agg == From) Agg = To;
@@ -2238,7 +2319,7 @@ void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
   } else if (getOpcode() == Instruction::InsertElement) {
     Constant *C1 = getOperand(0);
     Constant *C2 = getOperand(1);
-    Constant *C3 = getOperand(1);
+    Constant *C3 = getOperand(2);
     if (C1 == From) C1 = To;
     if (C2 == From) C2 = To;
     if (C3 == From) C3 = To;
@@ -2281,3 +2362,16 @@ void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
   // Delete the old constant!
   destroyConstant();
 }
+
+void ConstantExpr::replaceOperandsOnConstant(Value *const *Ops,
+                                             unsigned NumOps) {
+  SmallVector<Constant*, 8> NewOps;
+  NewOps.reserve(NumOps);
+  for (unsigned i = 0; i != NumOps; ++i)
+    NewOps.push_back(cast<Constant>(Ops[i]));
+
+  Constant *Replacement = getWithOperands(&NewOps[0], NumOps);
+  assert(Replacement != this && "No operand was replaced!");
+  uncheckedReplaceAllUsesWith(Replacement);
+  destroyConstant();
+}
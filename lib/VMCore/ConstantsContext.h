@@ -17,6 +17,8 @@
 
 #include "llvm/Instructions.h"
 #include "llvm/Operator.h"
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -327,8 +329,9 @@ struct ExprMapKeyType {
   }
 };
 
-// The number of operands for each ConstantCreator::create method is
-// determined by the ConstantTraits template.
+// The number of operands for each ConstantCreator::create method, and the hash
+// of each ValType used by ConstantUniqueMap, are determined by the
+// ConstantTraits template.
 // ConstantCreator - A class that is used to create constants by
 // ConstantUniqueMap*.  This class should be partially specialized if there is
 // something strange that needs to be done to interface to the ctor for the
@@ -339,6 +342,12 @@ struct ConstantTraits< std::vector<T, Alloc> > {
   static unsigned uses(const std::vector<T, Alloc>& v) {
     return v.size();
   }
+  static unsigned getHashValue(const std::vector<T, Alloc>& v) {
+    unsigned Hash = v.size();
+    for (unsigned i = 0, e = v.size(); i != e; ++i)
+      Hash = Hash * 37 + DenseMapInfo<T>::getHashValue(v[i]);
+    return Hash;
+  }
 };
 
 template<>
@@ -346,8 +355,43 @@ struct ConstantTraits<Constant *> {
   static unsigned uses(Constant * const & v) {
     return 1;
   }
+  static unsigned getHashValue(Constant * const & v) {
+    return DenseMapInfo<Constant*>::getHashValue(v);
+  }
+};
+
+template<>
+struct ConstantTraits<char> {
+  static unsigned getHashValue(char v) {
+    return v;
+  }
 };
 
+template<>
+struct ConstantTraits<ExprMapKeyType> {
+  static unsigned getHashValue(const ExprMapKeyType &v) {
+    unsigned Hash = v.opcode | (v.subclassoptionaldata << 8) |
+                    (v.subclassdata << 16);
+    Hash = Hash * 37 +
+           ConstantTraits<std::vector<Constant*> >::getHashValue(v.operands);
+    for (unsigned i = 0, e = v.indices.size(); i != e; ++i)
+      Hash = Hash * 37 + v.indices[i];
+    return Hash;
+  }
+};
+
+/// ConstantOperandsEqual - Return true if the operands of C are the constants
+/// in V.
+static inline bool ConstantOperandsEqual(const User *C,
+                                         const std::vector<Constant*> &V) {
+  if (C->getNumOperands() != V.size())
+    return false;
+  for (unsigned i = 0, e = V.size(); i != e; ++i)
+    if (C->getOperand(i) != V[i])
+      return false;
+  return true;
+}
+
 template<class ConstantClass, class TypeClass, class ValType>
 struct ConstantCreator {
   static ConstantClass *create(const TypeClass *Ty, const ValType &V) {
@@ -423,6 +467,16 @@ struct ConstantKeyData<ConstantExpr> {
         CE->hasIndices() ?
           CE->getIndices() : SmallVector<unsigned, 4>());
   }
+  static bool isEqual(ConstantExpr *CE, const ValType &V) {
+    if (CE->getOpcode() != V.opcode ||
+        CE->getRawSubclassOptionalData() != V.subclassoptionaldata ||
+        (CE->isCompare() ? CE->getPredicate() : 0) != V.subclassdata ||
+        !ConstantOperandsEqual(CE, V.operands))
+      return false;
+    if (CE->hasIndices())
+      return CE->getIndices() == V.indices;
+    return V.indices.empty();
+  }
 };
 
 // ConstantAggregateZero does not take extra "value" argument...
@@ -443,6 +497,9 @@ struct ConstantKeyData<ConstantVector> {
       Elements.push_back(CP->getOperand(i));
     return Elements;
   }
+  static bool isEqual(ConstantVector *CP, const ValType &V) {
+    return ConstantOperandsEqual(CP, V);
+  }
 };
 
 template<>
@@ -451,6 +508,9 @@ struct ConstantKeyData<ConstantAggregateZero> {
   static ValType getValType(ConstantAggregateZero *C) {
     return 0;
   }
+  static bool isEqual(ConstantAggregateZero *C, const ValType &V) {
+    return true;
+  }
 };
 
 template<>
@@ -463,6 +523,9 @@ struct ConstantKeyData<ConstantArray> {
       Elements.push_back(cast<Constant>(CA->getOperand(i)));
     return Elements;
   }
+  static bool isEqual(ConstantArray *CA, const ValType &V) {
+    return ConstantOperandsEqual(CA, V);
+  }
 };
 
 template<>
@@ -475,6 +538,9 @@ struct ConstantKeyData<ConstantStruct> {
       Elements.push_back(cast<Constant>(CS->getOperand(i)));
     return Elements;
   }
+  static bool isEqual(ConstantStruct *CS, const ValType &V) {
+    return ConstantOperandsEqual(CS, V);
+  }
 };
 
 template<>
@@ -483,6 +549,9 @@ struct ConstantKeyData<ConstantUnion> {
   static ValType getValType(ConstantUnion *CU) {
     return cast<Constant>(CU->getOperand(0));
   }
+  static bool isEqual(ConstantUnion *CU, const ValType &V) {
+    return CU->getOperand(0) == V;
+  }
 };
 
 // ConstantPointerNull does not take extra "value" argument...
@@ -499,6 +568,9 @@ struct ConstantKeyData<ConstantPointerNull> {
   static ValType getValType(ConstantPointerNull *C) {
     return 0;
   }
+  static bool isEqual(ConstantPointerNull *C, const ValType &V) {
+    return true;
+  }
 };
 
 // UndefValue does not take extra "value" argument...
@@ -515,81 +587,179 @@ struct ConstantKeyData<UndefValue> {
   static ValType getValType(UndefValue *C) {
     return 0;
   }
+  static bool isEqual(UndefValue *C, const ValType &V) {
+    return true;
+  }
 };
 
-template<class ValType, class TypeClass, class ConstantClass,
-         bool HasLargeKey = false /*true for arrays and structs*/ >
+template<class ValType, class TypeClass, class ConstantClass>
 class ConstantUniqueMap : public AbstractTypeUser {
 public:
   typedef std::pair<const TypeClass*, ValType> MapKey;
-  typedef std::map<MapKey, ConstantClass *> MapTy;
-  typedef std::map<ConstantClass *, typename MapTy::iterator> InverseMapTy;
-  typedef std::map<const DerivedType*, typename MapTy::iterator>
-    AbstractTypeMapTy;
 private:
-  /// Map - This is the main map from the element descriptor to the Constants.
-  /// This is the primary way we avoid creating two of the same shape
-  /// constant.
-  MapTy Map;
-    
-  /// InverseMap - If "HasLargeKey" is true, this contains an inverse mapping
-  /// from the constants to their element in Map.  This is important for
-  /// removal of constants from the array, which would otherwise have to scan
-  /// through the map with very large keys.
-  InverseMapTy InverseMap;
+  /// Bucket - An entry in the hash table.  The type the constant was added
+  /// with is kept, because the constant's own type may already have been
+  /// forwarded while an abstract type is refined.  The hash of the key is kept
+  /// so that the table can be grown without recomputing it.
+  struct Bucket {
+    ConstantClass *Val;
+    const TypeClass *Ty;
+    unsigned Hash;
+  };
+
+  /// Buckets - This is the main map from the element descriptor to the
+  /// Constants, an open addressing hash table in the style of DenseMap.  The
+  /// element descriptors are not stored: they are compared against the
+  /// constants themselves.  This is the primary way we avoid creating two of
+  /// the same shape constant.
+  Bucket *Buckets;
+  unsigned NumBuckets;
+  unsigned NumEntries;
+  unsigned NumTombstones;
+
+  typedef std::map<const DerivedType*, SmallPtrSet<ConstantClass*, 4> >
+    AbstractTypeMapTy;
 
-  /// AbstractTypeMap - Map for abstract type constants.
+  /// AbstractTypeMap - The constants in the map of each abstract type.
   ///
   AbstractTypeMapTy AbstractTypeMap;
-    
-public:
-  typename MapTy::iterator map_begin() { return Map.begin(); }
-  typename MapTy::iterator map_end() { return Map.end(); }
 
-  void freeConstants() {
-    for (typename MapTy::iterator I=Map.begin(), E=Map.end();
-         I != E; ++I) {
-      if (I->second->use_empty())
-        delete I->second;
-    }
+  ConstantUniqueMap(const ConstantUniqueMap &);  // DO NOT IMPLEMENT
+  void operator=(const ConstantUniqueMap &);     // DO NOT IMPLEMENT
+
+  static ConstantClass *getEmptyVal() { return 0; }
+  static ConstantClass *getTombstoneVal() {
+    return reinterpret_cast<ConstantClass*>(-1);
   }
-    
-  /// InsertOrGetItem - Return an iterator for the specified element.
-  /// If the element exists in the map, the returned iterator points to the
-  /// entry and Exists=true.  If not, the iterator points to the newly
-  /// inserted entry and returns Exists=false.  Newly inserted entries have
-  /// I->second == 0, and should be filled in.
-  typename MapTy::iterator InsertOrGetItem(std::pair<MapKey, ConstantClass *>
-                                 &InsertVal,
-                                 bool &Exists) {
-    std::pair<typename MapTy::iterator, bool> IP = Map.insert(InsertVal);
-    Exists = !IP.second;
-    return IP.first;
+
+  static unsigned getKeyHash(const TypeClass *Ty, const ValType &V) {
+    return DenseMapInfo<const TypeClass*>::getHashValue(Ty) * 37 +
+           ConstantTraits<ValType>::getHashValue(V);
   }
-    
-private:
-  typename MapTy::iterator FindExistingElement(ConstantClass *CP) {
-    if (HasLargeKey) {
-      typename InverseMapTy::iterator IMI = InverseMap.find(CP);
-      assert(IMI != InverseMap.end() && IMI->second != Map.end() &&
-             IMI->second->second == CP &&
-             "InverseMap corrupt!");
-      return IMI->second;
+
+  /// LookupBucketFor - Look for the constant with the specified element
+  /// descriptor.  If it is found, return true and set FoundBucket to its
+  /// bucket.  Otherwise return false and set FoundBucket to the bucket to
+  /// insert it into, or null if the table is still empty.
+  bool LookupBucketFor(unsigned Hash, const TypeClass *Ty, const ValType &V,
+                       Bucket *&FoundBucket) const {
+    FoundBucket = 0;
+    if (NumBuckets == 0)
+      return false;
+
+    Bucket *FoundTombstone = 0;
+    unsigned BucketNo = Hash & (NumBuckets-1), ProbeAmt = 1;
+    while (1) {
+      Bucket *ThisBucket = Buckets + BucketNo;
+      if (ThisBucket->Val == getEmptyVal()) {
+        FoundBucket = FoundTombstone ? FoundTombstone : ThisBucket;
+        return false;
+      }
+
+      if (ThisBucket->Val == getTombstoneVal()) {
+        if (!FoundTombstone)
+          FoundTombstone = ThisBucket;
+      } else if (ThisBucket->Hash == Hash && ThisBucket->Ty == Ty &&
+                 ConstantKeyData<ConstantClass>::isEqual(ThisBucket->Val, V)) {
+        FoundBucket = ThisBucket;
+        return true;
+      }
+
+      BucketNo = (BucketNo + ProbeAmt++) & (NumBuckets-1);
     }
-      
-    typename MapTy::iterator I =
-      Map.find(MapKey(static_cast<const TypeClass*>(CP->getRawType()),
-                      ConstantKeyData<ConstantClass>::getValType(CP)));
-    if (I == Map.end() || I->second != CP) {
-      // FIXME: This should not use a linear scan.  If this gets to be a
-      // performance problem, someone should look at this.
-      for (I = Map.begin(); I != Map.end() && I->second != CP; ++I)
-        /* empty */;
+  }
+
+  /// FindBucketFor - Return the bucket that holds CP, searching the probe
+  /// sequence of CP with type Ty, or null if it is not there.
+  Bucket *FindBucketFor(ConstantClass *CP, const TypeClass *Ty) {
+    if (NumBuckets == 0)
+      return 0;
+    unsigned Hash =
+      getKeyHash(Ty, ConstantKeyData<ConstantClass>::getValType(CP));
+    unsigned BucketNo = Hash & (NumBuckets-1), ProbeAmt = 1;
+    while (Buckets[BucketNo].Val != CP) {
+      if (Buckets[BucketNo].Val == getEmptyVal())
+        return 0;
+      BucketNo = (BucketNo + ProbeAmt++) & (NumBuckets-1);
+    }
+    return Buckets + BucketNo;
+  }
+
+  /// FindExistingElement - Return the bucket that holds CP, and set Ty to the
+  /// type that CP had when it was added to the map.
+  Bucket *FindExistingElement(ConstantClass *CP, const TypeClass *&Ty) {
+    Bucket *B = FindBucketFor(CP,
+                              static_cast<const TypeClass*>(CP->getRawType()));
+
+    // If the abstract type of CP is being refined, its type may already have
+    // been forwarded to the new type.  Search with the type it was added with.
+    for (typename AbstractTypeMapTy::iterator I = AbstractTypeMap.begin(),
+         E = AbstractTypeMap.end(); !B && I != E; ++I)
+      if (I->second.count(CP))
+        B = FindBucketFor(CP, static_cast<const TypeClass*>(I->first));
+
+    if (!B)
+      llvm_unreachable("Constant not found in constant table!");
+    Ty = B->Ty;
+    return B;
+  }
+
+  /// FindFreeBucket - Return the first empty or tombstone bucket on the probe
+  /// sequence of Hash.
+  Bucket *FindFreeBucket(unsigned Hash) {
+    unsigned BucketNo = Hash & (NumBuckets-1), ProbeAmt = 1;
+    while (Buckets[BucketNo].Val != getEmptyVal() &&
+           Buckets[BucketNo].Val != getTombstoneVal())
+      BucketNo = (BucketNo + ProbeAmt++) & (NumBuckets-1);
+    return Buckets + BucketNo;
+  }
+
+  /// Grow - Rehash the table into NewNumBuckets buckets, which must be a power
+  /// of two, dropping the tombstones.
+  void Grow(unsigned NewNumBuckets) {
+    Bucket *OldBuckets = Buckets;
+    unsigned OldNumBuckets = NumBuckets;
+
+    NumBuckets = NewNumBuckets;
+    NumTombstones = 0;
+    Buckets = new Bucket[NumBuckets];
+    for (unsigned i = 0; i != NumBuckets; ++i)
+      Buckets[i].Val = getEmptyVal();
+
+    for (unsigned i = 0; i != OldNumBuckets; ++i) {
+      Bucket &B = OldBuckets[i];
+      if (B.Val != getEmptyVal() && B.Val != getTombstoneVal())
+        *FindFreeBucket(B.Hash) = B;
     }
-    return I;
+    delete[] OldBuckets;
   }
-    
-  void AddAbstractTypeUser(const Type *Ty, typename MapTy::iterator I) {
+
+  /// InsertNew - Add CP, which is not in the table yet, with the specified
+  /// type and hash.
+  void InsertNew(ConstantClass *CP, const TypeClass *Ty, unsigned Hash) {
+    // Grow when the table is more than 3/4 full, and rehash in place when
+    // fewer than 1/8 of the buckets are empty, like DenseMap does.
+    if (NumEntries*4 >= NumBuckets*3)
+      Grow(NumBuckets ? NumBuckets*2 : 64);
+    else if (NumBuckets-(NumEntries+NumTombstones) < NumBuckets/8)
+      Grow(NumBuckets);
+
+    Bucket *B = FindFreeBucket(Hash);
+    if (B->Val == getTombstoneVal())
+      --NumTombstones;
+    B->Val = CP;
+    B->Ty = Ty;
+    B->Hash = Hash;
+    ++NumEntries;
+  }
+
+  void EraseBucket(Bucket *B) {
+    B->Val = getTombstoneVal();
+    --NumEntries;
+    ++NumTombstones;
+  }
+
+  void AddAbstractTypeUser(const Type *Ty, ConstantClass *CP) {
     // If the type of the constant is abstract, make sure that an entry
     // exists for it in the AbstractTypeMap.
     if (Ty->isAbstract()) {
@@ -600,130 +770,92 @@ private:
         // Add ourselves to the ATU list of the type.
         cast<DerivedType>(DTy)->addAbstractTypeUser(this);
 
-        AbstractTypeMap.insert(TI, std::make_pair(DTy, I));
+        TI = AbstractTypeMap.insert(TI, std::make_pair(DTy,
+                                          SmallPtrSet<ConstantClass*, 4>()));
       }
+      TI->second.insert(CP);
     }
   }
 
-  ConstantClass* Create(const TypeClass *Ty, const ValType &V,
-                        typename MapTy::iterator I) {
+  void RemoveAbstractTypeUser(const DerivedType *Ty, ConstantClass *CP) {
+    typename AbstractTypeMapTy::iterator TI = AbstractTypeMap.find(Ty);
+    assert(TI != AbstractTypeMap.end() &&
+           "Abstract type not in AbstractTypeMap?");
+    TI->second.erase(CP);
+    if (TI->second.empty()) {
+      // We are removing the last instance of this type from the table.
+      // Remove from the ATM, and from user list.
+      AbstractTypeMap.erase(TI);
+      cast<DerivedType>(Ty)->removeAbstractTypeUser(this);
+    }
+  }
+
+  ConstantClass* Create(const TypeClass *Ty, const ValType &V, unsigned Hash) {
     ConstantClass* Result =
       ConstantCreator<ConstantClass,TypeClass,ValType>::create(Ty, V);
 
     assert(Result->getType() == Ty && "Type specified is not correct!");
-    I = Map.insert(I, std::make_pair(MapKey(Ty, V), Result));
-
-    if (HasLargeKey)  // Remember the reverse mapping if needed.
-      InverseMap.insert(std::make_pair(Result, I));
-
-    AddAbstractTypeUser(Ty, I);
+    InsertNew(Result, Ty, Hash);
+    AddAbstractTypeUser(Ty, Result);
       
     return Result;
   }
 public:
+  ConstantUniqueMap()
+    : Buckets(0), NumBuckets(0), NumEntries(0), NumTombstones(0) {}
+  ~ConstantUniqueMap() {
+    delete[] Buckets;
+  }
+
+  void freeConstants() {
+    for (unsigned i = 0; i != NumBuckets; ++i) {
+      ConstantClass *CP = Buckets[i].Val;
+      if (CP != getEmptyVal() && CP != getTombstoneVal() && CP->use_empty())
+        delete CP;
+    }
+  }
+
+  /// getExisting - Return the constant with the specified type and element
+  /// descriptor if it has been created already, otherwise return null.
+  ConstantClass *getExisting(const TypeClass *Ty, const ValType &V) const {
+    Bucket *B;
+    if (LookupBucketFor(getKeyHash(Ty, V), Ty, V, B))
+      return B->Val;
+    return 0;
+  }
     
   /// getOrCreate - Return the specified constant from the map, creating it if
   /// necessary.
   ConstantClass *getOrCreate(const TypeClass *Ty, const ValType &V) {
-    MapKey Lookup(Ty, V);
-    ConstantClass* Result = 0;
-    
-    typename MapTy::iterator I = Map.find(Lookup);
+    unsigned Hash = getKeyHash(Ty, V);
+    Bucket *B;
     // Is it in the map?  
-    if (I != Map.end())
-      Result = I->second;
-        
-    if (!Result) {
-      // If no preexisting value, create one now...
-      Result = Create(Ty, V, I);
-    }
-        
-    return Result;
-  }
-
-  void UpdateAbstractTypeMap(const DerivedType *Ty,
-                             typename MapTy::iterator I) {
-    assert(AbstractTypeMap.count(Ty) &&
-           "Abstract type not in AbstractTypeMap?");
-    typename MapTy::iterator &ATMEntryIt = AbstractTypeMap[Ty];
-    if (ATMEntryIt == I) {
-      // Yes, we are removing the representative entry for this type.
-      // See if there are any other entries of the same type.
-      typename MapTy::iterator TmpIt = ATMEntryIt;
-
-      // First check the entry before this one...
-      if (TmpIt != Map.begin()) {
-        --TmpIt;
-        if (TmpIt->first.first != Ty) // Not the same type, move back...
-          ++TmpIt;
-      }
+    if (LookupBucketFor(Hash, Ty, V, B))
+      return B->Val;
 
-      // If we didn't find the same type, try to move forward...
-      if (TmpIt == ATMEntryIt) {
-        ++TmpIt;
-        if (TmpIt == Map.end() || TmpIt->first.first != Ty)
-          --TmpIt;   // No entry afterwards with the same type
-      }
-
-      // If there is another entry in the map of the same abstract type,
-      // update the AbstractTypeMap entry now.
-      if (TmpIt != ATMEntryIt) {
-        ATMEntryIt = TmpIt;
-      } else {
-        // Otherwise, we are removing the last instance of this type
-        // from the table.  Remove from the ATM, and from user list.
-        cast<DerivedType>(Ty)->removeAbstractTypeUser(this);
-        AbstractTypeMap.erase(Ty);
-      }
-    }
+    // If no preexisting value, create one now...
+    return Create(Ty, V, Hash);
   }
 
   void remove(ConstantClass *CP) {
-    typename MapTy::iterator I = FindExistingElement(CP);
-    assert(I != Map.end() && "Constant not found in constant table!");
-    assert(I->second == CP && "Didn't find correct element?");
+    const TypeClass *Ty;
+    EraseBucket(FindExistingElement(CP, Ty));
 
-    if (HasLargeKey)  // Remember the reverse mapping if needed.
-      InverseMap.erase(CP);
-      
-    // Now that we found the entry, make sure this isn't the entry that
-    // the AbstractTypeMap points to.
-    const TypeClass *Ty = I->first.first;
+    // Now that we removed the entry, make sure that the AbstractTypeMap does
+    // not refer to it either.
     if (Ty->isAbstract())
-      UpdateAbstractTypeMap(static_cast<const DerivedType *>(Ty), I);
-
-    Map.erase(I);
+      RemoveAbstractTypeUser(static_cast<const DerivedType *>(Ty), CP);
   }
 
   /// MoveConstantToNewSlot - If we are about to change C to be the element
-  /// specified by I, update our internal data structures to reflect this
-  /// fact.
-  void MoveConstantToNewSlot(ConstantClass *C, typename MapTy::iterator I) {
-    // First, remove the old location of the specified constant in the map.
-    typename MapTy::iterator OldI = FindExistingElement(C);
-    assert(OldI != Map.end() && "Constant not found in constant table!");
-    assert(OldI->second == C && "Didn't find correct element?");
-      
-    // If this constant is the representative element for its abstract type,
-    // update the AbstractTypeMap so that the representative element is I.
-    if (C->getType()->isAbstract()) {
-      typename AbstractTypeMapTy::iterator ATI =
-          AbstractTypeMap.find(C->getType());
-      assert(ATI != AbstractTypeMap.end() &&
-             "Abstract type not in AbstractTypeMap?");
-      if (ATI->second == OldI)
-        ATI->second = I;
-    }
-      
-    // Remove the old entry from the map.
-    Map.erase(OldI);
-    
-    // Update the inverse map so that we know that this constant is now
-    // located at descriptor I.
-    if (HasLargeKey) {
-      assert(I->second == C && "Bad inversemap entry!");
-      InverseMap[C] = I;
-    }
+  /// specified by V, update our internal data structures to reflect this
+  /// fact.  This must be called before C is changed, and V must not be in the
+  /// map yet.
+  void MoveConstantToNewSlot(ConstantClass *C, const ValType &V) {
+    const TypeClass *Ty;
+    EraseBucket(FindExistingElement(C, Ty));
+    assert(!getExisting(Ty, V) && "Element is already in the map!");
+    InsertNew(C, Ty, getKeyHash(Ty, V));
   }
     
   void refineAbstractType(const DerivedType *OldTy, const Type *NewTy) {
@@ -736,36 +868,28 @@ public:
     // leaving will remove() itself, causing the AbstractTypeMapEntry to be
     // eliminated eventually.
     do {
-      ConstantClass *C = I->second->second;
-      MapKey Key(cast<TypeClass>(NewTy),
-                 ConstantKeyData<ConstantClass>::getValType(C));
+      ConstantClass *C = *I->second.begin();
+      const TypeClass *Ty = cast<TypeClass>(NewTy);
+      ValType V = ConstantKeyData<ConstantClass>::getValType(C);
+      unsigned Hash = getKeyHash(Ty, V);
 
-      std::pair<typename MapTy::iterator, bool> IP =
-        Map.insert(std::make_pair(Key, C));
-      if (IP.second) {
+      Bucket *B;
+      if (!LookupBucketFor(Hash, Ty, V, B)) {
         // The map didn't previously have an appropriate constant in the
         // new type.
         
         // Remove the old entry.
-        typename MapTy::iterator OldI =
-          Map.find(MapKey(cast<TypeClass>(OldTy), IP.first->first.second));
-        assert(OldI != Map.end() && "Constant not in map!");
-        UpdateAbstractTypeMap(OldTy, OldI);
-        Map.erase(OldI);
+        remove(C);
 
         // Set the constant's type. This is done in place!
         setType(C, NewTy);
 
-        // Update the inverse map so that we know that this constant is now
-        // located at descriptor I.
-        if (HasLargeKey)
-          InverseMap[C] = IP.first;
-
-        AddAbstractTypeUser(NewTy, IP.first);
+        InsertNew(C, Ty, Hash);
+        AddAbstractTypeUser(NewTy, C);
       } else {
         // The map already had an appropriate constant in the new type, so
         // there's no longer a need for the old constant.
-        C->uncheckedReplaceAllUsesWith(IP.first->second);
+        C->uncheckedReplaceAllUsesWith(B->Val);
         C->destroyConstant();    // This constant is now dead, destroy it.
       }
       I = AbstractTypeMap.find(OldTy);
@@ -19,6 +19,7 @@
 #include "llvm/Support/LeakDetector.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/StringPool.h"
+#include "llvm/System/Mutex.h"
 #include "llvm/System/RWMutex.h"
 #include "llvm/System/Threading.h"
 #include "SymbolTableListTraitsImpl.h"
@@ -32,6 +33,26 @@ using namespace llvm;
 template class llvm::SymbolTableListTraits<Argument, Function>;
 template class llvm::SymbolTableListTraits<BasicBlock, Function>;
 
+void ilist_traits<BasicBlock>::addNodeToList(BasicBlock *BB) {
+  SymbolTableListTraits<BasicBlock, Function>::addNodeToList(BB);
+  getListOwner()->markModified();
+}
+
+void ilist_traits<BasicBlock>::removeNodeFromList(BasicBlock *BB) {
+  SymbolTableListTraits<BasicBlock, Function>::removeNodeFromList(BB);
+  getListOwner()->markModified();
+}
+
+void ilist_traits<BasicBlock>::transferNodesFromList(
+                                             ilist_traits<BasicBlock> &L2,
+                                             ilist_iterator<BasicBlock> first,
+                                             ilist_iterator<BasicBlock> last) {
+  SymbolTableListTraits<BasicBlock, Function>::transferNodesFromList(L2, first,
+                                                                     last);
+  getListOwner()->markModified();
+  L2.getListOwner()->markModified();
+}
+
 //===----------------------------------------------------------------------===//
 // Argument Implementation
 //===----------------------------------------------------------------------===//
@@ -153,7 +174,7 @@ void Function::eraseFromParent() {
 Function::Function(const FunctionType *Ty, LinkageTypes Linkage,
                    const Twine &name, Module *ParentModule)
   : GlobalValue(PointerType::getUnqual(Ty), 
-                Value::FunctionVal, 0, 0, Linkage, name) {
+                Value::FunctionVal, 0, 0, Linkage, name), UnmodifiedEpoch(0) {
   assert(FunctionType::isValidReturnType(getReturnType()) &&
          !getReturnType()->isOpaqueTy() && "invalid return type");
   SymTab = new ValueSymbolTable();
@@ -185,6 +206,33 @@ Function::~Function() {
   clearGC();
 }
 
+unsigned Function::ModificationEpoch = 1;
+unsigned Function::NumModificationTrackers = 0;
+
+// Trackers like the incremental verifier may be created and destroyed on
+// different threads (opt -j hands them to worker pass managers), so the count,
+// the flag and the epoch only change under this lock.  The flag only goes from
+// true to false once no tracker is left anywhere, so a thread that owns a
+// tracker never sees it change underneath it.
+static ManagedStatic<sys::SmartMutex<true> > TrackingLock;
+
+void Function::startTrackingModifications() {
+  sys::SmartScopedLock<true> Guard(*TrackingLock);
+  if (NumModificationTrackers++ == 0)
+    Use::TrackModifications = true;
+}
+
+void Function::stopTrackingModifications() {
+  sys::SmartScopedLock<true> Guard(*TrackingLock);
+  assert(NumModificationTrackers && "Modifications are not tracked!");
+  if (--NumModificationTrackers == 0) {
+    Use::TrackModifications = false;
+    // Changes made from now on are not seen, so forget which functions were
+    // unmodified.
+    ++ModificationEpoch;
+  }
+}
+
 void Function::BuildLazyArguments() const {
   // Create the arguments vector, all arguments start out unnamed.
   const FunctionType *FT = getFunctionType();
@@ -279,12 +327,14 @@ void Function::setGC(const char *Str) {
   if (!GCNames)
     GCNames = new DenseMap<const Function*,PooledStringPtr>();
   (*GCNames)[this] = GCNamePool->intern(Str);
+  markModified();
 }
 
 void Function::clearGC() {
   sys::SmartScopedWriter<true> Writer(*GCLock);
   if (GCNames) {
-    GCNames->erase(this);
+    if (GCNames->erase(this))
+      markModified();
     if (GCNames->empty()) {
       delete GCNames;
       GCNames = 0;
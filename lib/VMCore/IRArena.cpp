@@ -0,0 +1,88 @@
+//===-- IRArena.cpp - Implement the IRArena class -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the IRArena class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IRArena.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/System/ThreadLocal.h"
+using namespace llvm;
+
+/// NumArenas - The number of arenas in existence.  As long as it is zero,
+/// allocate() does not look for the current arena.
+static volatile sys::cas_flag NumArenas = 0;
+
+static ManagedStatic<sys::ThreadLocal<const IRArena> > CurrentArena;
+
+/// MaxAlignType - The most strictly aligned scalar types.  ::operator new
+/// aligns for all of them, and the compiler is free to assume the same of
+/// the objects we hand out.
+union MaxAlignType {
+  long double LD;
+  double D;
+  uint64_t I;
+  void *P;
+};
+static const size_t MaxAlign = AlignOf<MaxAlignType>::Alignment;
+
+/// HeaderSize - The size of the word in front of each allocation from an arena
+/// that holds the arena.  It is a multiple of MaxAlign, so objects keep the
+/// alignment of the underlying storage.
+static const size_t HeaderSize =
+  sizeof(IRArena*) > MaxAlign ? sizeof(IRArena*) : MaxAlign;
+
+IRArena::IRArena() : RefCount(1), Allocator(16384, 4096) {
+  sys::AtomicIncrement(&NumArenas);
+}
+
+IRArena::~IRArena() {
+  sys::AtomicDecrement(&NumArenas);
+}
+
+IRArena *IRArena::create() {
+  return new IRArena();
+}
+
+IRArena *IRArena::getCurrent() {
+  if (NumArenas == 0)
+    return 0;
+  return const_cast<IRArena*>(CurrentArena->get());
+}
+
+IRArena::Scope::Scope(IRArena *A)
+  : Prev(const_cast<IRArena*>(CurrentArena->get())) {
+  CurrentArena->set(A);
+}
+
+IRArena::Scope::~Scope() {
+  CurrentArena->set(Prev);
+}
+
+void *IRArena::allocate(size_t Size) {
+  IRArena *A = getCurrent();
+  if (!A)
+    return ::operator new(Size);
+
+  sys::AtomicIncrement(&A->RefCount);
+  void *Storage = A->Allocator.Allocate(HeaderSize + Size, MaxAlign);
+  *static_cast<IRArena**>(Storage) = A;
+  return static_cast<char*>(Storage) + HeaderSize;
+}
+
+void IRArena::deallocate(void *Ptr, bool FromArena) {
+  if (!FromArena) {
+    ::operator delete(Ptr);
+    return;
+  }
+
+  void *Storage = static_cast<char*>(Ptr) - HeaderSize;
+  (*static_cast<IRArena**>(Storage))->dropRef();
+}
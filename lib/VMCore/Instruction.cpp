@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Instruction.h"
+#include "llvm/IRArena.h"
 #include "llvm/Type.h"
 #include "llvm/Instructions.h"
 #include "llvm/Constants.h"
@@ -23,6 +24,10 @@ using namespace llvm;
 Instruction::Instruction(const Type *ty, unsigned it, Use *Ops, unsigned NumOps,
                          Instruction *InsertBefore)
   : User(ty, Value::InstructionVal + it, Ops, NumOps), Parent(0) {
+  // operator new took the memory from the current arena, if there is one.
+  if (IRArena::getCurrent())
+    setValueSubclassData(FromArenaBit);
+
   // Make sure that we get added to a basicblock
   LeakDetector::addGarbageObject(this);
 
@@ -37,6 +42,10 @@ Instruction::Instruction(const Type *ty, unsigned it, Use *Ops, unsigned NumOps,
 Instruction::Instruction(const Type *ty, unsigned it, Use *Ops, unsigned NumOps,
                          BasicBlock *InsertAtEnd)
   : User(ty, Value::InstructionVal + it, Ops, NumOps), Parent(0) {
+  // operator new took the memory from the current arena, if there is one.
+  if (IRArena::getCurrent())
+    setValueSubclassData(FromArenaBit);
+
   // Make sure that we get added to a basicblock
   LeakDetector::addGarbageObject(this);
 
@@ -53,6 +62,13 @@ Instruction::~Instruction() {
     removeAllMetadata();
 }
 
+void Instruction::operator delete(void *I) {
+  // The instruction has been destroyed, but its fields are still intact.
+  bool FromArena =
+    static_cast<Instruction*>(I)->getSubclassDataFromValue() & FromArenaBit;
+  IRArena::deallocate(getAllocation(I), FromArena);
+}
+
 
 void Instruction::setParent(BasicBlock *P) {
   if (getParent()) {
@@ -64,6 +80,12 @@ void Instruction::setParent(BasicBlock *P) {
   Parent = P;
 }
 
+void Instruction::markFunctionModified() {
+  if (Parent)
+    if (Function *F = Parent->getParent())
+      F->markModified();
+}
+
 void Instruction::removeFromParent() {
   getParent()->getInstList().remove(this);
 }
@@ -114,11 +114,11 @@ public:
   ConstantUniqueMap<char, Type, ConstantAggregateZero> AggZeroConstants;
 
   typedef ConstantUniqueMap<std::vector<Constant*>, ArrayType,
-    ConstantArray, true /*largekey*/> ArrayConstantsTy;
+    ConstantArray> ArrayConstantsTy;
   ArrayConstantsTy ArrayConstants;
   
   typedef ConstantUniqueMap<std::vector<Constant*>, StructType,
-    ConstantStruct, true /*largekey*/> StructConstantsTy;
+    ConstantStruct> StructConstantsTy;
   StructConstantsTy StructConstants;
   
   typedef ConstantUniqueMap<Constant*, UnionType, ConstantUnion>
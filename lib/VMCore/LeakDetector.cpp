@@ -35,6 +35,9 @@ void LeakDetector::addGarbageObjectImpl(void *Object) {
 }
 
 void LeakDetector::addGarbageObjectImpl(const Value *Object) {
+  // The list sentinels of every module are in the global context, so this
+  // can be reached from threads working in different contexts.
+  sys::SmartScopedLock<true> Lock(*ObjectsLock);
   LLVMContextImpl *pImpl = Object->getContext().pImpl;
   pImpl->LLVMObjects.addGarbage(Object);
 }
@@ -45,6 +48,7 @@ void LeakDetector::removeGarbageObjectImpl(void *Object) {
 }
 
 void LeakDetector::removeGarbageObjectImpl(const Value *Object) {
+  sys::SmartScopedLock<true> Lock(*ObjectsLock);
   LLVMContextImpl *pImpl = Object->getContext().pImpl;
   pImpl->LLVMObjects.removeGarbage(Object);
 }
@@ -16,16 +16,21 @@
 #include "llvm/Assembly/Writer.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Module.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/System/Mutex.h"
+#include "llvm/System/Process.h"
+#include "llvm/System/ThreadLocal.h"
 #include "llvm/System/Threading.h"
+#include "llvm/System/TimeValue.h"
 #include "llvm-c/Core.h"
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <map>
 using namespace llvm;
 
@@ -40,9 +45,10 @@ namespace llvm {
 // pass name to be printed before it executes.
 //
 
-// Different debug levels that can be enabled...
+// Different debug levels that can be enabled...  Recompute is not a level
+// of detail; it prints a report of analysis recomputations on exit instead.
 enum PassDebugLevel {
-  None, Arguments, Structure, Executions, Details
+  None, Recompute, Arguments, Structure, Executions, Details
 };
 
 static cl::opt<enum PassDebugLevel>
@@ -50,11 +56,22 @@ PassDebugging("debug-pass", cl::Hidden,
                   cl::desc("Print PassManager debugging information"),
                   cl::values(
   clEnumVal(None      , "disable debug output"),
+  clEnumVal(Recompute , "print how often each analysis is recomputed"),
   clEnumVal(Arguments , "print pass arguments to pass to 'opt'"),
   clEnumVal(Structure , "print pass structure before run()"),
   clEnumVal(Executions, "print pass name before it is executed"),
   clEnumVal(Details   , "print pass details when it is executed"),
                              clEnumValEnd));
+
+static cl::opt<std::string>
+PassTraceFile("pass-trace", cl::value_desc("filename"),
+  cl::desc("Write a record of each pass run to this file, in Chrome "
+           "trace-event format"));
+
+static cl::opt<bool>
+DisableAnalysisReuse("disable-analysis-reuse", cl::Hidden,
+  cl::desc("Recompute analyses that were invalidated by passes which did "
+           "not change the function"));
 } // End of llvm namespace
 
 /// isPassDebuggingExecutionsOrMore - Return true if -debug-pass=Executions
@@ -97,6 +114,187 @@ void PassManagerPrettyStackEntry::print(raw_ostream &OS) const {
 }
 
 
+namespace {
+
+//===----------------------------------------------------------------------===//
+/// PassTrace Class - This class writes the events recorded by PassTraceEvent
+/// to the -pass-trace file.  Events are written as they are recorded, as a
+/// JSON array of Chrome trace events, so the file can be loaded with
+/// chrome://tracing.  The closing bracket is written on shutdown, but the
+/// trace viewer also accepts a file without it, e.g. after a crash.
+///
+static ManagedStatic<sys::SmartMutex<true> > PassTraceMutex;
+
+class PassTrace {
+  raw_fd_ostream *OS;
+  uint64_t StartTime;
+  unsigned NumThreads;
+  bool NeedComma;
+  sys::ThreadLocal<const void> ThreadID;
+
+public:
+  PassTrace();
+  ~PassTrace();
+
+  /// getThreadID - Return a small number that identifies the calling thread.
+  unsigned getThreadID();
+
+  void record(Pass *P, const char *Category, StringRef Unit, uint64_t Begin,
+              uint64_t End, unsigned InstructionsBefore,
+              unsigned InstructionsAfter, ssize_t MemoryDelta);
+};
+
+} // End of anon namespace
+
+static ManagedStatic<PassTrace> ThePassTrace;
+
+/// getTraceTime - Return the current time in microseconds.
+static uint64_t getTraceTime() {
+  return sys::TimeValue::now().usec();
+}
+
+/// writeJSONString - Write S to OS as a quoted JSON string.
+static void writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned i = 0, e = S.size(); i != e; ++i) {
+    unsigned char C = S[i];
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+PassTrace::PassTrace() : OS(0), StartTime(getTraceTime()), NumThreads(0),
+                         NeedComma(false) {
+  std::string ErrorInfo;
+  OS = new raw_fd_ostream(PassTraceFile.c_str(), ErrorInfo);
+  if (!ErrorInfo.empty()) {
+    errs() << "Error opening pass-trace file '" << PassTraceFile
+           << "' for writing!\n";
+    delete OS;
+    OS = 0;
+    return;
+  }
+  *OS << "[\n";
+}
+
+PassTrace::~PassTrace() {
+  if (!OS)
+    return;
+  *OS << "\n]\n";
+  delete OS;
+}
+
+unsigned PassTrace::getThreadID() {
+  if (const void *ID = ThreadID.get())
+    return (unsigned)(intptr_t)ID;
+  unsigned ID = ++NumThreads;
+  ThreadID.set((const void *)(intptr_t)ID);
+  return ID;
+}
+
+void PassTrace::record(Pass *P, const char *Category, StringRef Unit,
+                       uint64_t Begin, uint64_t End,
+                       unsigned InstructionsBefore, unsigned InstructionsAfter,
+                       ssize_t MemoryDelta) {
+  sys::SmartScopedLock<true> Lock(*PassTraceMutex);
+  if (!OS)
+    return;
+
+  if (NeedComma)
+    *OS << ",\n";
+  NeedComma = true;
+
+  *OS << "{\"name\":";
+  writeJSONString(*OS, P->getPassName());
+  *OS << ",\"cat\":\"" << Category << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+      << getThreadID() << ",\"ts\":" << Begin - StartTime
+      << ",\"dur\":" << End - Begin << ",\"args\":{\"unit\":";
+  writeJSONString(*OS, Unit);
+  *OS << ",\"instructions_before\":" << InstructionsBefore
+      << ",\"instructions_after\":" << InstructionsAfter
+      << ",\"malloc_delta\":" << (int64_t)MemoryDelta << "}}";
+}
+
+/// countInstructions - Return the number of instructions in F.
+static unsigned countInstructions(Function *F) {
+  unsigned Count = 0;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    Count += BB->size();
+  return Count;
+}
+
+bool PassTraceEvent::isEnabled() {
+  return !PassTraceFile.empty();
+}
+
+PassTraceEvent::PassTraceEvent(Pass *p, Module &m)
+  : P(p), M(&m), Category("module") {
+  start();
+}
+
+PassTraceEvent::PassTraceEvent(Pass *p, Function &f, const char *Category)
+  : P(p), M(0), Category(Category) {
+  Functions.push_back(&f);
+  start();
+}
+
+PassTraceEvent::PassTraceEvent(Pass *p, Function *const *Begin,
+                               Function *const *End)
+  : P(p), M(0), Functions(Begin, End), Category("scc") {
+  start();
+}
+
+void PassTraceEvent::start() {
+  if (!isEnabled()) {
+    P = 0;
+    return;
+  }
+
+  InstructionsBefore = 0;
+  if (M)
+    for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+      InstructionsBefore += countInstructions(F);
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+    InstructionsBefore += countInstructions(Functions[i]);
+
+  // Open the trace first, so that this event starts after it.
+  (void)*ThePassTrace;
+
+  StartMemory = sys::Process::GetMallocUsage();
+  StartTime = getTraceTime();
+}
+
+PassTraceEvent::~PassTraceEvent() {
+  if (!P)
+    return;
+
+  uint64_t EndTime = getTraceTime();
+  ssize_t MemoryDelta = sys::Process::GetMallocUsage() - StartMemory;
+
+  unsigned InstructionsAfter = 0;
+  std::string Unit;
+  if (M) {
+    for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+      InstructionsAfter += countInstructions(F);
+    Unit = M->getModuleIdentifier();
+  }
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    InstructionsAfter += countInstructions(Functions[i]);
+    if (i)
+      Unit += ',';
+    Unit += Functions[i]->getName();
+  }
+
+  ThePassTrace->record(P, Category, Unit, StartTime, EndTime,
+                       InstructionsBefore, InstructionsAfter, MemoryDelta);
+}
+
+
 namespace {
 
 //===----------------------------------------------------------------------===//
@@ -413,9 +611,120 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+/// RecomputeInfo Class - This class counts how often each analysis is
+/// computed, and how many of those computations were redundant because
+/// nothing had changed since the analysis was last computed on the same
+/// function (or module, for module analyses).  This only happens when
+/// -debug-pass=Recompute is enabled on the command line.
+///
+/// Changes are tracked with a global epoch that is bumped whenever a pass
+/// reports a modification.  Changes made by call graph SCC and loop passes
+/// are only seen when their pass manager returns.
+
+static ManagedStatic<sys::SmartMutex<true> > RecomputeInfoMutex;
+
+class RecomputeInfo {
+  struct Counts {
+    unsigned Computed, Redundant, Reused;
+    Counts() : Computed(0), Redundant(0), Reused(0) {}
+  };
+  std::map<const PassInfo*, Counts> CountsFor;
+
+  typedef std::pair<const PassInfo*, const Function*> ResultKey;
+  DenseMap<ResultKey, unsigned> ComputedAt;
+  DenseMap<const Function*, unsigned> FunctionChangedAt;
+  unsigned Epoch, ModuleChangedAt;
+
+public:
+  RecomputeInfo() : Epoch(0), ModuleChangedAt(0) {}
+
+  // Print the report when -debug-pass=Recompute output is done.
+  ~RecomputeInfo();
+
+  // createTheRecomputeInfo - This method either initializes the
+  // TheRecomputeInfo pointer to a non null value (if -debug-pass=Recompute is
+  // enabled) or it leaves it null.  It may be called multiple times.
+  static void createTheRecomputeInfo();
+
+  /// passChanged - A pass modified F, or the whole module if F is null.
+  void passChanged(const Function *F) {
+    sys::SmartScopedLock<true> Lock(*RecomputeInfoMutex);
+    if (F)
+      FunctionChangedAt[F] = ++Epoch;
+    else
+      ModuleChangedAt = ++Epoch;
+  }
+
+  /// analysisComputed - Analysis P was run on F, or on the module if F is
+  /// null.
+  void analysisComputed(Pass *P, const Function *F) {
+    const PassInfo *PI = P->getPassInfo();
+    if (PI == 0 || !PI->isAnalysis())
+      return;
+
+    sys::SmartScopedLock<true> Lock(*RecomputeInfoMutex);
+    Counts &C = CountsFor[PI];
+    ++C.Computed;
+
+    unsigned LastChange = F ? std::max(FunctionChangedAt.lookup(F),
+                                       ModuleChangedAt)
+                            : Epoch;
+    std::pair<DenseMap<ResultKey, unsigned>::iterator, bool> Entry =
+      ComputedAt.insert(std::make_pair(ResultKey(PI, F), Epoch));
+    if (!Entry.second) {
+      if (Entry.first->second >= LastChange)
+        ++C.Redundant;
+      Entry.first->second = Epoch;
+    }
+  }
+
+  /// analysisReused - Analysis P was not run because the results of an
+  /// earlier instance were still valid.
+  void analysisReused(Pass *P) {
+    sys::SmartScopedLock<true> Lock(*RecomputeInfoMutex);
+    ++CountsFor[P->getPassInfo()].Reused;
+  }
+};
+
 } // End of anon namespace
 
 static TimingInfo *TheTimeInfo;
+static RecomputeInfo *TheRecomputeInfo;
+
+namespace {
+  struct PassNameCompare {
+    bool operator()(const PassInfo *LHS, const PassInfo *RHS) const {
+      return strcmp(LHS->getPassName(), RHS->getPassName()) < 0;
+    }
+  };
+}
+
+RecomputeInfo::~RecomputeInfo() {
+  std::vector<const PassInfo*> Analyses;
+  for (std::map<const PassInfo*, Counts>::iterator I = CountsFor.begin(),
+       E = CountsFor.end(); I != E; ++I)
+    Analyses.push_back(I->first);
+  std::stable_sort(Analyses.begin(), Analyses.end(), PassNameCompare());
+
+  raw_ostream &OS = dbgs();
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                     ... Analysis recomputation report ...\n"
+     << "===" << std::string(73, '-') << "===\n\n"
+     << "  Computed  Redundant    Reused  Analysis\n";
+
+  Counts Total;
+  for (unsigned i = 0, e = Analyses.size(); i != e; ++i) {
+    const Counts &C = CountsFor[Analyses[i]];
+    OS << format("%10u %10u %9u", C.Computed, C.Redundant, C.Reused)
+       << "  " << Analyses[i]->getPassName() << '\n';
+    Total.Computed += C.Computed;
+    Total.Redundant += C.Redundant;
+    Total.Reused += C.Reused;
+  }
+  OS << format("%10u %10u %9u", Total.Computed, Total.Redundant, Total.Reused)
+     << "  Total\n\n";
+}
 
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
@@ -720,9 +1029,9 @@ void PMDataManager::removeNotPreservedAnalysis(Pass *P) {
     return;
 
   const AnalysisUsage::VectorType &PreservedSet = AnUsage->getPreservedSet();
-  for (std::map<AnalysisID, Pass*>::iterator I = AvailableAnalysis.begin(),
+  for (DenseMap<AnalysisID, Pass*>::iterator I = AvailableAnalysis.begin(),
          E = AvailableAnalysis.end(); I != E; ) {
-    std::map<AnalysisID, Pass*>::iterator Info = I++;
+    DenseMap<AnalysisID, Pass*>::iterator Info = I++;
     if (Info->second->getAsImmutablePass() == 0 &&
         std::find(PreservedSet.begin(), PreservedSet.end(), Info->first) == 
         PreservedSet.end()) {
@@ -743,10 +1052,10 @@ void PMDataManager::removeNotPreservedAnalysis(Pass *P) {
     if (!InheritedAnalysis[Index])
       continue;
 
-    for (std::map<AnalysisID, Pass*>::iterator 
+    for (DenseMap<AnalysisID, Pass*>::iterator 
            I = InheritedAnalysis[Index]->begin(),
            E = InheritedAnalysis[Index]->end(); I != E; ) {
-      std::map<AnalysisID, Pass *>::iterator Info = I++;
+      DenseMap<AnalysisID, Pass *>::iterator Info = I++;
       if (Info->second->getAsImmutablePass() == 0 &&
           std::find(PreservedSet.begin(), PreservedSet.end(), Info->first) == 
              PreservedSet.end()) {
@@ -806,7 +1115,7 @@ void PMDataManager::freePass(Pass *P, StringRef Msg,
     // listed as the available implementation.
     const std::vector<const PassInfo*> &II = PI->getInterfacesImplemented();
     for (unsigned i = 0, e = II.size(); i != e; ++i) {
-      std::map<AnalysisID, Pass*>::iterator Pos =
+      DenseMap<AnalysisID, Pass*>::iterator Pos =
         AvailableAnalysis.find(II[i]);
       if (Pos != AvailableAnalysis.end() && Pos->second == P)
         AvailableAnalysis.erase(Pos);
@@ -945,7 +1254,7 @@ void PMDataManager::initializeAnalysisImpl(Pass *P) {
 Pass *PMDataManager::findAnalysisPass(AnalysisID AID, bool SearchParent) {
 
   // Check if AvailableAnalysis map has one entry.
-  std::map<AnalysisID, Pass*>::const_iterator I =  AvailableAnalysis.find(AID);
+  DenseMap<AnalysisID, Pass*>::const_iterator I =  AvailableAnalysis.find(AID);
 
   if (I != AvailableAnalysis.end())
     return I->second;
@@ -1003,6 +1312,9 @@ void PMDataManager::dumpPassInfo(Pass *P, enum PassDebuggingString S1,
   case FREEING_MSG:
     dbgs() << " Freeing Pass '" << P->getPassName();
     break;
+  case REUSING_MSG:
+    dbgs() << "Reusing Pass '" << P->getPassName();
+    break;
   default:
     break;
   }
@@ -1295,6 +1607,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  RecomputeInfo::createTheRecomputeInfo();
 
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index)
@@ -1338,32 +1651,169 @@ bool FPPassManager::runOnFunction(Function &F) {
     FunctionPass *FP = getContainedPass(Index);
     bool LocalChanged = false;
 
-    dumpPassInfo(FP, EXECUTION_MSG, ON_FUNCTION_MSG, F.getName());
-    dumpRequiredSet(FP);
+    // If FP is an analysis whose results are still around from an earlier
+    // instance, use those instead of running it.
+    Pass *Reused = findReusableAnalysis(FP);
+    if (Reused) {
+      dumpPassInfo(FP, REUSING_MSG, ON_FUNCTION_MSG, F.getName());
+      reuseAnalysis(FP, Reused);
+    } else {
+      dumpPassInfo(FP, EXECUTION_MSG, ON_FUNCTION_MSG, F.getName());
+      dumpRequiredSet(FP);
+
+      initializeAnalysisImpl(FP);
 
-    initializeAnalysisImpl(FP);
+      {
+        PassManagerPrettyStackEntry X(FP, F);
+        PassTraceEvent Trace(FP, F);
 
-    {
-      PassManagerPrettyStackEntry X(FP, F);
+        Timer *T = StartPassTimer(FP);
+        LocalChanged |= FP->runOnFunction(F);
+        StopPassTimer(FP, T);
+      }
 
-      Timer *T = StartPassTimer(FP);
-      LocalChanged |= FP->runOnFunction(F);
-      StopPassTimer(FP, T);
+      if (TheRecomputeInfo)
+        TheRecomputeInfo->analysisComputed(FP, &F);
     }
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
       dumpPassInfo(FP, MODIFICATION_MSG, ON_FUNCTION_MSG, F.getName());
+      if (TheRecomputeInfo)
+        TheRecomputeInfo->passChanged(&F);
+    }
     dumpPreservedSet(FP);
 
-    verifyPreservedAnalysis(FP);
+    if (!Reused)
+      verifyPreservedAnalysis(FP);
+    if (LocalChanged)
+      releaseRetainedAnalysis(F);
+    else
+      recordReusableAnalysis(FP);
     removeNotPreservedAnalysis(FP);
-    recordAvailableAnalysis(FP);
-    removeDeadPasses(FP, F.getName(), ON_FUNCTION_MSG);
+    recordAvailableAnalysis(Reused ? Reused : FP);
+    releaseDeadPasses(FP, F);
   }
+
+  releaseRetainedAnalysis(F);
+  ReusedAnalysis.clear();
+  ExtraLifetimes.clear();
   return Changed;
 }
 
+/// recordReusableAnalysis - P did not change the function, so the analyses
+/// that it does not preserve are still valid.  Remember them before they are
+/// removed from the available analyses.
+void FPPassManager::recordReusableAnalysis(Pass *P) {
+  if (DisableAnalysisReuse)
+    return;
+
+  AnalysisUsage *AnUsage = TPM->findAnalysisUsage(P);
+  if (AnUsage->getPreservesAll())
+    return;
+
+  const AnalysisUsage::VectorType &PreservedSet = AnUsage->getPreservedSet();
+  DenseMap<AnalysisID, Pass*> *Available = getAvailableAnalysis();
+  for (DenseMap<AnalysisID, Pass*>::iterator I = Available->begin(),
+         E = Available->end(); I != E; ++I)
+    if (I->second->getAsImmutablePass() == 0 &&
+        std::find(PreservedSet.begin(), PreservedSet.end(), I->first) ==
+          PreservedSet.end())
+      ReusableAnalysis[I->first] = I->second;
+}
+
+/// findReusableAnalysis - If P is an analysis and an earlier instance of it
+/// still holds valid results for the current function, return that instance.
+Pass *FPPassManager::findReusableAnalysis(Pass *P) {
+  const PassInfo *PI = P->getPassInfo();
+  if (PI == 0 || !PI->isAnalysis())
+    return 0;
+
+  DenseMap<AnalysisID, Pass*>::iterator I = ReusableAnalysis.find(PI);
+  if (I == ReusableAnalysis.end() || I->second->getPassInfo() != PI)
+    return 0;
+  return I->second;
+}
+
+/// reuseAnalysis - Make Impl available in place of P, which is not run.  Impl
+/// then lives at least as long as P would have.
+void FPPassManager::reuseAnalysis(Pass *P, Pass *Impl) {
+  for (DenseMap<AnalysisID, Pass*>::iterator I = ReusableAnalysis.begin(),
+         E = ReusableAnalysis.end(); I != E; ) {
+    DenseMap<AnalysisID, Pass*>::iterator Info = I++;
+    if (Info->second == Impl)
+      ReusableAnalysis.erase(Info);
+  }
+
+  ReusedAnalysis[P] = Impl;
+  SmallVector<Pass*, 8>::iterator R =
+    std::find(RetainedAnalysis.begin(), RetainedAnalysis.end(), Impl);
+  if (R != RetainedAnalysis.end())
+    RetainedAnalysis.erase(R);
+  else
+    ++ExtraLifetimes[Impl];
+
+  if (TheRecomputeInfo)
+    TheRecomputeInfo->analysisReused(P);
+}
+
+/// releaseDeadPasses - Free the passes whose last user is P, like
+/// removeDeadPasses, but keep reusable analyses around and free the results
+/// that were used in place of a pass instead of the pass itself.
+void FPPassManager::releaseDeadPasses(Pass *P, Function &F) {
+  SmallVector<Pass *, 12> DeadPasses;
+
+  // If this is a on the fly manager then it does not have TPM.
+  if (!TPM)
+    return;
+
+  TPM->collectLastUses(DeadPasses, P);
+
+  if (PassDebugging >= Details && !DeadPasses.empty()) {
+    dbgs() << " -*- '" <<  P->getPassName();
+    dbgs() << "' is the last user of following pass instances.";
+    dbgs() << " Free these instances\n";
+  }
+
+  for (SmallVector<Pass *, 12>::iterator I = DeadPasses.begin(),
+         E = DeadPasses.end(); I != E; ++I) {
+    Pass *Dead = *I;
+    DenseMap<Pass*, Pass*>::iterator R = ReusedAnalysis.find(Dead);
+    if (R != ReusedAnalysis.end()) {
+      Dead = R->second;
+      ReusedAnalysis.erase(R);
+    }
+
+    DenseMap<Pass*, unsigned>::iterator L = ExtraLifetimes.find(Dead);
+    if (L != ExtraLifetimes.end()) {
+      if (--L->second == 0)
+        ExtraLifetimes.erase(L);
+      continue;
+    }
+
+    bool Reusable = false;
+    for (DenseMap<AnalysisID, Pass*>::iterator RI = ReusableAnalysis.begin(),
+           RE = ReusableAnalysis.end(); RI != RE; ++RI)
+      if (RI->second == Dead) {
+        Reusable = true;
+        break;
+      }
+    if (Reusable)
+      RetainedAnalysis.push_back(Dead);
+    else
+      freePass(Dead, F.getName(), ON_FUNCTION_MSG);
+  }
+}
+
+/// releaseRetainedAnalysis - The function changed, or all passes have run on
+/// it, so none of the reusable results can be used any more.
+void FPPassManager::releaseRetainedAnalysis(Function &F) {
+  ReusableAnalysis.clear();
+  for (unsigned i = 0, e = RetainedAnalysis.size(); i != e; ++i)
+    freePass(RetainedAnalysis[i], F.getName(), ON_FUNCTION_MSG);
+  RetainedAnalysis.clear();
+}
+
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = doInitialization(M);
 
@@ -1420,15 +1870,22 @@ MPPassManager::runOnModule(Module &M) {
 
     {
       PassManagerPrettyStackEntry X(MP, M);
+      PassTraceEvent Trace(MP, M);
       Timer *T = StartPassTimer(MP);
       LocalChanged |= MP->runOnModule(M);
       StopPassTimer(MP, T);
     }
 
+    if (TheRecomputeInfo)
+      TheRecomputeInfo->analysisComputed(MP, 0);
+
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
       dumpPassInfo(MP, MODIFICATION_MSG, ON_MODULE_MSG,
                    M.getModuleIdentifier());
+      if (TheRecomputeInfo)
+        TheRecomputeInfo->passChanged(0);
+    }
     dumpPreservedSet(MP);
     
     verifyPreservedAnalysis(MP);
@@ -1497,6 +1954,7 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, const PassInfo *PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  RecomputeInfo::createTheRecomputeInfo();
 
   dumpArguments();
   dumpPasses();
@@ -1558,6 +2016,18 @@ void TimingInfo::createTheTimeInfo() {
   TheTimeInfo = &*TTI;
 }
 
+// createTheRecomputeInfo - This method either initializes the
+// TheRecomputeInfo pointer to a non null value (if -debug-pass=Recompute is
+// enabled) or it leaves it null.  It may be called multiple times.
+void RecomputeInfo::createTheRecomputeInfo() {
+  if (PassDebugging != Recompute || TheRecomputeInfo) return;
+
+  // Constructed the first time this is called, like TimingInfo, so that the
+  // report is printed by llvm_shutdown.
+  static ManagedStatic<RecomputeInfo> RI;
+  TheRecomputeInfo = &*RI;
+}
+
 /// If TimingInfo is enabled then start pass timer.
 Timer *llvm::StartPassTimer(Pass *P) {
   if (TheTimeInfo) 
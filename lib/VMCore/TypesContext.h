@@ -17,6 +17,7 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include <map>
+#include <vector>
 
 
 //===----------------------------------------------------------------------===//
@@ -242,6 +243,12 @@ protected:
   ///
   std::multimap<unsigned, PATypeHolder> TypesByHash;
 
+  /// ConcreteTypes - The types that were already concrete when they were
+  /// added.  Those are never refined and can't have cycles, so they are kept
+  /// out of TypesByHash, and this only records them so that they are deleted
+  /// with the map.
+  std::vector<Type*> ConcreteTypes;
+
   ~TypeMapBase() {
     // PATypeHolder won't destroy non-abstract types.
     // We can't destroy them by simply iterating, because
@@ -259,6 +266,12 @@ protected:
         operator delete(Ty);
       }
     }
+    for (unsigned i = 0, e = ConcreteTypes.size(); i != e; ++i) {
+      Type *Ty = ConcreteTypes[i];
+      Ty->AbstractTypeUsers.clear();
+      static_cast<const Type*>(Ty)->Type::~Type();
+      operator delete(Ty);
+    }
   }
 
 public:
@@ -316,8 +329,11 @@ public:
   inline void add(const ValType &V, TypeClass *Ty) {
     Map.insert(std::make_pair(V, Ty));
 
-    // If this type has a cycle, remember it.
-    TypesByHash.insert(std::make_pair(ValType::hashTypeStructure(Ty), Ty));
+    // If this type might get a cycle, remember it.
+    if (Ty->isAbstract())
+      TypesByHash.insert(std::make_pair(ValType::hashTypeStructure(Ty), Ty));
+    else
+      ConcreteTypes.push_back(Ty);
     print("add");
   }
   
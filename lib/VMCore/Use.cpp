@@ -11,7 +11,8 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include "llvm/User.h"
+#include "llvm/Instruction.h"
+#include "llvm/IRArena.h"
 
 namespace llvm {
 
@@ -41,9 +42,27 @@ void Use::swap(Use &RHS) {
     } else {
       RHS.Val = 0;
     }
+
+    if (TrackModifications) {
+      noteUserModified();
+      RHS.noteUserModified();
+    }
   }
 }
 
+//===----------------------------------------------------------------------===//
+//                         Use modification tracking
+//===----------------------------------------------------------------------===//
+
+bool Use::TrackModifications = false;
+
+/// noteUserModified - The value of this use has changed.  If it is an operand
+/// of an instruction in a function, the function is now modified.
+void Use::noteUserModified() {
+  if (Instruction *I = dyn_cast<Instruction>(getUser()))
+    I->markFunctionModified();
+}
+
 //===----------------------------------------------------------------------===//
 //                         Use getImpliedUser Implementation
 //===----------------------------------------------------------------------===//
@@ -106,16 +125,36 @@ Use *Use::initTags(Use * const Start, Use *Stop, ptrdiff_t Done) {
   return Start;
 }
 
+//===----------------------------------------------------------------------===//
+//                         AugmentedUse layout struct
+//===----------------------------------------------------------------------===//
+
+/// AugmentedUse - The last Use of a hung-off operand list, followed by the
+/// User.  The low bit of the integer is always set, which tells getUser()
+/// that the User is there; FromArenaTag is set if the list was allocated from
+/// an IRArena.
+struct AugmentedUse : public Use {
+  enum { FromArenaTag = 2 };
+  PointerIntPair<User*, 2, unsigned> ref;
+  AugmentedUse(); // not implemented
+};
+
 //===----------------------------------------------------------------------===//
 //                         Use zap Implementation
 //===----------------------------------------------------------------------===//
 
 void Use::zap(Use *Start, const Use *Stop, bool del) {
   if (del) {
+    // Only hung-off operand lists are deleted.  Stop may be short of the end
+    // of the list, so look at the AugmentedUse behind it for where the memory
+    // came from.
+    const AugmentedUse *Last =
+      static_cast<const AugmentedUse*>(Start->getImpliedUser() - 1);
+    bool FromArena = Last->ref.getInt() & AugmentedUse::FromArenaTag;
     while (Start != Stop) {
       (--Stop)->~Use();
     }
-    ::operator delete(Start);
+    IRArena::deallocate(Start, FromArena);
     return;
   }
 
@@ -124,26 +163,16 @@ void Use::zap(Use *Start, const Use *Stop, bool del) {
   }
 }
 
-//===----------------------------------------------------------------------===//
-//                         AugmentedUse layout struct
-//===----------------------------------------------------------------------===//
-
-struct AugmentedUse : public Use {
-  PointerIntPair<User*, 1, Tag> ref;
-  AugmentedUse(); // not implemented
-};
-
-
 //===----------------------------------------------------------------------===//
 //                         Use getUser Implementation
 //===----------------------------------------------------------------------===//
 
 User *Use::getUser() const {
   const Use *End = getImpliedUser();
-  const PointerIntPair<User*, 1, Tag>& ref(
+  const PointerIntPair<User*, 2, unsigned>& ref(
                                 static_cast<const AugmentedUse*>(End - 1)->ref);
   User *She = ref.getPointer();
-  return ref.getInt()
+  return ref.getInt() & 1
     ? She
     : (User*)End;
 }
@@ -153,13 +182,17 @@ User *Use::getUser() const {
 //===----------------------------------------------------------------------===//
 
 Use *User::allocHungoffUses(unsigned N) const {
-  Use *Begin = static_cast<Use*>(::operator new(sizeof(Use) * N
-                                                + sizeof(AugmentedUse)
-                                                - sizeof(Use)));
+  // Only instructions have hung-off operands, so these come from the current
+  // IRArena if there is one.
+  bool FromArena = IRArena::getCurrent() != 0;
+  Use *Begin = static_cast<Use*>(IRArena::allocate(sizeof(Use) * N
+                                                   + sizeof(AugmentedUse)
+                                                   - sizeof(Use)));
   Use *End = Begin + N;
-  PointerIntPair<User*, 1, Tag>& ref(static_cast<AugmentedUse&>(End[-1]).ref);
+  PointerIntPair<User*, 2, unsigned>& ref(
+                                      static_cast<AugmentedUse&>(End[-1]).ref);
   ref.setPointer(const_cast<User*>(this));
-  ref.setInt(tagOne);
+  ref.setInt(FromArena ? 1 | AugmentedUse::FromArenaTag : 1);
   return Use::initTags(Begin, End);
 }
 
@@ -168,32 +201,30 @@ Use *User::allocHungoffUses(unsigned N) const {
 //===----------------------------------------------------------------------===//
 
 void *User::operator new(size_t s, unsigned Us) {
-  void *Storage = ::operator new(s + sizeof(Use) * Us);
-  Use *Start = static_cast<Use*>(Storage);
-  Use *End = Start + Us;
-  User *Obj = reinterpret_cast<User*>(End);
-  Obj->OperandList = Start;
-  Obj->NumOperands = Us;
-  Use::initTags(Start, End);
-  return Obj;
+  return allocateWithUses(s, Us, false, false);
+}
+
+void *User::operator new(size_t s, unsigned Us, bool Prefix) {
+  return allocateWithUses(s, Us, Prefix, false);
 }
 
 /// Prefixed allocation - just before the first Use, allocate a NULL pointer.
 /// The destructor can detect its presence and readjust the OperandList
 /// for deletition.
 ///
-void *User::operator new(size_t s, unsigned Us, bool Prefix) {
+void *User::allocateWithUses(size_t s, unsigned Us, bool Prefix,
+                             bool FromArena) {
   // currently prefixed allocation only admissible for
   // unconditional branch instructions
-  if (!Prefix)
-    return operator new(s, Us);
-
-  assert(Us == 1 && "Other than one Use allocated?");
+  assert((!Prefix || Us == 1) && "Other than one Use allocated?");
   typedef PointerIntPair<void*, 2, Use::PrevPtrTag> TaggedPrefix;
-  void *Raw = ::operator new(s + sizeof(TaggedPrefix) + sizeof(Use) * Us);
-  TaggedPrefix *Pre = static_cast<TaggedPrefix*>(Raw);
-  Pre->setFromOpaqueValue(0);
-  void *Storage = Pre + 1; // skip over prefix
+  size_t Size = s + sizeof(Use) * Us + (Prefix ? sizeof(TaggedPrefix) : 0);
+  void *Storage = FromArena ? IRArena::allocate(Size) : ::operator new(Size);
+  if (Prefix) {
+    TaggedPrefix *Pre = static_cast<TaggedPrefix*>(Storage);
+    Pre->setFromOpaqueValue(0);
+    Storage = Pre + 1; // skip over prefix
+  }
   Use *Start = static_cast<Use*>(Storage);
   Use *End = Start + Us;
   User *Obj = reinterpret_cast<User*>(End);
@@ -207,27 +238,27 @@ void *User::operator new(size_t s, unsigned Us, bool Prefix) {
 //                         User operator delete Implementation
 //===----------------------------------------------------------------------===//
 
-void User::operator delete(void *Usr) {
+void *User::getAllocation(void *Usr) {
   User *Start = static_cast<User*>(Usr);
   Use *Storage = static_cast<Use*>(Usr) - Start->NumOperands;
   //
   // look for a variadic User
-  if (Storage == Start->OperandList) {
-    ::operator delete(Storage);
-    return;
-  }
+  if (Storage == Start->OperandList)
+    return Storage;
   //
   // check for the flag whether the destructor has detected a prefixed
   // allocation, in which case we remove the flag and delete starting
   // at OperandList
-  if (reinterpret_cast<intptr_t>(Start->OperandList) & 1) {
-    ::operator delete(reinterpret_cast<char*>(Start->OperandList) - 1);
-    return;
-  }
+  if (reinterpret_cast<intptr_t>(Start->OperandList) & 1)
+    return reinterpret_cast<char*>(Start->OperandList) - 1;
   //
   // in all other cases just delete the nullary User (covers hung-off
   // uses also
-  ::operator delete(Usr);
+  return Usr;
+}
+
+void User::operator delete(void *Usr) {
+  ::operator delete(getAllocation(Usr));
 }
 
 } // End llvm namespace
@@ -20,7 +20,9 @@
 #include "llvm/Operator.h"
 #include "llvm/Module.h"
 #include "llvm/ValueSymbolTable.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/LeakDetector.h"
@@ -284,6 +286,22 @@ void Value::takeName(Value *V) {
 }
 
 
+/// ReplaceUsesOneByOne - Make each use of From a use of To, one use at a time.
+/// The value handles of From are not notified.
+static void ReplaceUsesOneByOne(Value *From, Value *To) {
+  while (!From->use_empty()) {
+    Use &U = From->use_begin().getUse();
+    // Must handle Constants specially, we cannot call replaceUsesOfWith on a
+    // constant because they are uniqued.
+    if (Constant *C = dyn_cast<Constant>(U.getUser()))
+      if (!isa<GlobalValue>(C)) {
+        C->replaceUsesOfWithOnConstant(From, To, &U);
+        continue;
+      }
+    U.set(To);
+  }
+}
+
 // uncheckedReplaceAllUsesWith - This is exactly the same as replaceAllUsesWith,
 // except that it doesn't have all of the asserts.  The asserts fail because we
 // are half-way done resolving types, which causes some types to exist as two
@@ -295,19 +313,7 @@ void Value::uncheckedReplaceAllUsesWith(Value *New) {
   if (HasValueHandle)
     ValueHandleBase::ValueIsRAUWd(this, New);
 
-  while (!use_empty()) {
-    Use &U = *UseList;
-    // Must handle Constants specially, we cannot call replaceUsesOfWith on a
-    // constant because they are uniqued.
-    if (Constant *C = dyn_cast<Constant>(U.getUser())) {
-      if (!isa<GlobalValue>(C)) {
-        C->replaceUsesOfWithOnConstant(this, New, &U);
-        continue;
-      }
-    }
-
-    U.set(New);
-  }
+  ReplaceUsesOneByOne(this, New);
 }
 
 void Value::replaceAllUsesWith(Value *New) {
@@ -319,6 +325,97 @@ void Value::replaceAllUsesWith(Value *New) {
   uncheckedReplaceAllUsesWith(New);
 }
 
+void Value::replaceAllUsesWith(
+              const SmallVectorImpl<std::pair<Value*, Value*> > &Repls) {
+  typedef DenseMap<Value*, Value*> ReplacementMapTy;
+  ReplacementMapTy Map;
+  for (unsigned i = 0, e = Repls.size(); i != e; ++i) {
+    Value *From = Repls[i].first, *To = Repls[i].second;
+    assert(To && "Value::replaceAllUsesWith(<null>) is invalid!");
+    assert(From != To && "this->replaceAllUsesWith(this) is NOT valid!");
+    assert(From->getType() == To->getType() &&
+           "replaceAllUses of value with new value of different type!");
+    bool Inserted = Map.insert(std::make_pair(From, To)).second;
+    assert(Inserted && "Value replaced by more than one pair!");
+    (void)Inserted;
+  }
+
+  // Resolve chains of replacements, pointing every value on a chain directly
+  // at its end so that each chain is only walked once.
+  SmallVector<Value*, 8> Chain;
+  for (unsigned i = 0, e = Repls.size(); i != e; ++i) {
+    Value *To = Map[Repls[i].first];
+    ReplacementMapTy::iterator I = Map.find(To);
+    if (I == Map.end())
+      continue;
+    Chain.clear();
+    Chain.push_back(Repls[i].first);
+    do {
+      Chain.push_back(To);
+      assert(Chain.size() <= Map.size() && "Cycle of replacements!");
+      To = I->second;
+      I = Map.find(To);
+    } while (I != Map.end());
+    for (unsigned j = 0, je = Chain.size(); j != je; ++j)
+      Map[Chain[j]] = To;
+  }
+
+  // Rewrite the uses by instructions and globals directly, and collect the
+  // constants that use any of the values.  Those are rebuilt afterwards, with
+  // all of their replaced operands at once.
+  SmallVector<WeakVH, 16> ConstantUsers;
+  SmallPtrSet<Constant*, 16> SeenConstants;
+  for (unsigned i = 0, e = Repls.size(); i != e; ++i) {
+    Value *From = Repls[i].first, *To = Map[From];
+    if (From->HasValueHandle)
+      ValueHandleBase::ValueIsRAUWd(From, To);
+
+    for (use_iterator UI = From->use_begin(), UE = From->use_end(); UI != UE;) {
+      Use &U = UI.getUse();
+      ++UI;
+      if (Constant *C = dyn_cast<Constant>(U.getUser()))
+        if (!isa<GlobalValue>(C)) {
+          if (SeenConstants.insert(C))
+            ConstantUsers.push_back(C);
+          continue;
+        }
+      U.set(To);
+    }
+  }
+
+  // Rebuilding one constant can replace or delete another one that is still
+  // on the list; the weak handles follow those changes.  Constants that are
+  // being replaced themselves have no uses left, and are not worth rebuilding.
+  SmallVector<Value*, 8> Ops;
+  for (unsigned i = 0, e = ConstantUsers.size(); i != e; ++i) {
+    Constant *C = dyn_cast_or_null<Constant>(ConstantUsers[i]);
+    if (C == 0 || isa<GlobalValue>(C) || Map.count(C))
+      continue;
+    Ops.clear();
+    bool Changed = false;
+    for (User::op_iterator OI = C->op_begin(), OE = C->op_end(); OI != OE;
+         ++OI) {
+      Value *Op = *OI;
+      ReplacementMapTy::iterator I = Map.find(Op);
+      if (I != Map.end()) {
+        Op = I->second;
+        Changed = true;
+      }
+      Ops.push_back(Op);
+    }
+    if (Changed)
+      C->replaceOperandsOnConstant(&Ops[0], Ops.size());
+  }
+
+  // Constant folding while rebuilding can, rarely, give new uses to a value
+  // that has already been replaced.  Pick those up one at a time.
+  for (unsigned i = 0, e = Repls.size(); i != e; ++i) {
+    Value *From = Repls[i].first;
+    if (!From->use_empty())
+      ReplaceUsesOneByOne(From, Map[From]);
+  }
+}
+
 Value *Value::stripPointerCasts() {
   if (!getType()->isPointerTy())
     return this;
@@ -39,6 +39,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "verify"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/CallingConv.h"
 #include "llvm/Constants.h"
@@ -57,17 +58,23 @@
 #include "llvm/Support/CFG.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/InstVisitor.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/System/Threading.h"
 #include <algorithm>
 #include <cstdarg>
 using namespace llvm;
 
+STATISTIC(NumUnmodifiedSkipped,
+          "Number of unmodified functions not checked again");
+
 namespace {  // Anonymous namespace for class
   struct PreVerifier : public FunctionPass {
     static char ID; // Pass ID, replacement for typeid
@@ -108,13 +115,17 @@ static const PassInfo *const PreVerifyID = &PreVer;
 namespace {
   class TypeSet : public AbstractTypeUser {
   public:
-    TypeSet() {}
+    /// TypeSet - If the types cannot be refined while the set is alive, there
+    /// is no need to listen for refinement, and then the set does not touch
+    /// the types at all.
+    explicit TypeSet(bool WatchRefinement = true)
+      : WatchRefinement(WatchRefinement) {}
 
     /// Insert a type into the set of types.
     bool insert(const Type *Ty) {
       if (!Types.insert(Ty))
         return false;
-      if (Ty->isAbstract())
+      if (WatchRefinement && Ty->isAbstract())
         Ty->addAbstractTypeUser(this);
       return true;
     }
@@ -122,6 +133,8 @@ namespace {
     // Remove ourselves as abstract type listeners for any types that remain
     // abstract when the TypeSet is destroyed.
     ~TypeSet() {
+      if (!WatchRefinement)
+        return;
       for (SmallSetVector<const Type *, 16>::iterator I = Types.begin(),
              E = Types.end(); I != E; ++I) {
         const Type *Ty = *I;
@@ -148,6 +161,7 @@ namespace {
 
   private:
     SmallSetVector<const Type *, 16> Types;
+    bool WatchRefinement;
 
     // Disallow copying.
     TypeSet(const TypeSet &);
@@ -158,12 +172,24 @@ namespace {
     static char ID; // Pass ID, replacement for typeid
     bool Broken;          // Is this module found to be broken?
     bool RealPass;        // Are we not being run by a PassManager?
+    bool Incremental;     // Only check functions modified since last checked?
+    bool Quiet;           // Only find out whether the module is broken?
     VerifierFailureAction action;
                           // What to do if verification fails.
     Module *Mod;          // Module we are verifying right now
     LLVMContext *Context; // Context within which we are verifying
     DominatorTree *DT;    // Dominator Tree, caution can be null!
 
+    /// LocalDT - In incremental mode no dominator tree is required, so that
+    /// none is built for the functions that are skipped.  The functions that
+    /// are checked get one here, unless one is available already.
+    OwningPtr<DominatorTree> LocalDT;
+
+    /// DeferredIntrinsicCalls - If this is not null, calls to intrinsics are
+    /// collected here instead of being checked, as checking them may create
+    /// types and attribute lists, which is not safe to do on a thread.
+    std::vector<CallInst*> *DeferredIntrinsicCalls;
+
     std::string Messages;
     raw_string_ostream MessagesStr;
 
@@ -178,21 +204,44 @@ namespace {
 
     Verifier()
       : FunctionPass(&ID), 
-      Broken(false), RealPass(true), action(AbortProcessAction),
-      Mod(0), Context(0), DT(0), MessagesStr(Messages) {}
-    explicit Verifier(VerifierFailureAction ctn)
+      Broken(false), RealPass(true), Incremental(false), Quiet(false),
+      action(AbortProcessAction), Mod(0), Context(0), DT(0),
+      DeferredIntrinsicCalls(0), MessagesStr(Messages) {}
+    explicit Verifier(VerifierFailureAction ctn, bool incremental = false)
       : FunctionPass(&ID), 
-      Broken(false), RealPass(true), action(ctn), Mod(0), Context(0), DT(0),
-      MessagesStr(Messages) {}
+      Broken(false), RealPass(true), Incremental(incremental), Quiet(false),
+      action(ctn), Mod(0), Context(0), DT(0), DeferredIntrinsicCalls(0),
+      MessagesStr(Messages) {
+      if (Incremental)
+        Function::startTrackingModifications();
+    }
     explicit Verifier(bool AB)
       : FunctionPass(&ID), 
-      Broken(false), RealPass(true),
+      Broken(false), RealPass(true), Incremental(false), Quiet(false),
       action( AB ? AbortProcessAction : PrintMessageAction), Mod(0),
-      Context(0), DT(0), MessagesStr(Messages) {}
+      Context(0), DT(0), DeferredIntrinsicCalls(0), MessagesStr(Messages) {}
     explicit Verifier(DominatorTree &dt)
       : FunctionPass(&ID), 
-      Broken(false), RealPass(false), action(PrintMessageAction), Mod(0),
-      Context(0), DT(&dt), MessagesStr(Messages) {}
+      Broken(false), RealPass(false), Incremental(false), Quiet(false),
+      action(PrintMessageAction), Mod(0), Context(0), DT(&dt),
+      DeferredIntrinsicCalls(0), MessagesStr(Messages) {}
+
+    /// Verifier - Create a verifier for checking function bodies on a thread
+    /// of verifyModule.  It only finds out whether they are broken, without
+    /// printing anything, and leaves the intrinsic calls it finds in Deferred
+    /// for checking later.  Nothing can refine a type while the module is
+    /// being verified, so the types it sees are not watched.
+    Verifier(DominatorTree &dt, std::vector<CallInst*> &Deferred)
+      : FunctionPass(&ID),
+      Broken(false), RealPass(false), Incremental(false), Quiet(true),
+      action(ReturnStatusAction), Mod(0), Context(0), DT(&dt),
+      DeferredIntrinsicCalls(&Deferred), MessagesStr(Messages),
+      Types(/*WatchRefinement=*/false) {}
+
+    ~Verifier() {
+      if (Incremental)
+        Function::stopTrackingModifications();
+    }
 
 
     bool doInitialization(Module &M) {
@@ -209,14 +258,41 @@ namespace {
     }
 
     bool runOnFunction(Function &F) {
+      // In incremental mode, functions that have not been modified since they
+      // were last found to be valid do not need to be checked again.
+      if (Incremental && !F.isModified()) {
+        ++NumUnmodifiedSkipped;
+        return false;
+      }
+
       // Get dominator information if we are being run by PassManager
-      if (RealPass) DT = &getAnalysis<DominatorTree>();
+      if (RealPass && !Incremental) {
+        DT = &getAnalysis<DominatorTree>();
+      } else if (RealPass) {
+        DT = getAnalysisIfAvailable<DominatorTree>();
+        if (!DT) {
+          if (!LocalDT)
+            LocalDT.reset(new DominatorTree());
+          LocalDT->runOnFunction(F);
+          DT = LocalDT.get();
+        }
+      }
 
       Mod = F.getParent();
       if (!Context) Context = &F.getContext();
 
+      bool WasBroken = Broken;
+      Broken = false;
       visit(F);
       InstsInThisBlock.clear();
+      if (LocalDT)
+        LocalDT->releaseMemory();
+
+      // Watch a valid function for modifications, so that it is not checked
+      // again until it changes.
+      if (Incremental && !Broken)
+        F.markUnmodified();
+      Broken |= WasBroken;
 
       // If this is a real pass, in a pass manager, we must abort before
       // returning back to the pass manager, or else the pass manager may try to
@@ -251,7 +327,7 @@ namespace {
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.setPreservesAll();
       AU.addRequiredID(PreVerifyID);
-      if (RealPass)
+      if (RealPass && !Incremental)
         AU.addRequired<DominatorTree>();
     }
 
@@ -364,30 +440,33 @@ namespace {
     void CheckFailed(const Twine &Message,
                      const Value *V1 = 0, const Value *V2 = 0,
                      const Value *V3 = 0, const Value *V4 = 0) {
+      Broken = true;
+      if (Quiet) return;
       MessagesStr << Message.str() << "\n";
       WriteValue(V1);
       WriteValue(V2);
       WriteValue(V3);
       WriteValue(V4);
-      Broken = true;
     }
 
     void CheckFailed(const Twine &Message, const Value *V1,
                      const Type *T2, const Value *V3 = 0) {
+      Broken = true;
+      if (Quiet) return;
       MessagesStr << Message.str() << "\n";
       WriteValue(V1);
       WriteType(T2);
       WriteValue(V3);
-      Broken = true;
     }
 
     void CheckFailed(const Twine &Message, const Type *T1,
                      const Type *T2 = 0, const Type *T3 = 0) {
+      Broken = true;
+      if (Quiet) return;
       MessagesStr << Message.str() << "\n";
       WriteType(T1);
       WriteType(T2);
       WriteType(T3);
-      Broken = true;
     }
   };
 } // End anonymous namespace
@@ -1142,8 +1221,12 @@ void Verifier::visitCallInst(CallInst &CI) {
   VerifyCallSite(&CI);
 
   if (Function *F = CI.getCalledFunction())
-    if (Intrinsic::ID ID = (Intrinsic::ID)F->getIntrinsicID())
-      visitIntrinsicFunctionCall(ID, CI);
+    if (Intrinsic::ID ID = (Intrinsic::ID)F->getIntrinsicID()) {
+      if (DeferredIntrinsicCalls)
+        DeferredIntrinsicCalls->push_back(&CI);
+      else
+        visitIntrinsicFunctionCall(ID, CI);
+    }
 }
 
 void Verifier::visitInvokeInst(InvokeInst &II) {
@@ -1933,6 +2016,10 @@ FunctionPass *llvm::createVerifierPass(VerifierFailureAction action) {
   return new Verifier(action);
 }
 
+FunctionPass *llvm::createIncrementalVerifierPass(VerifierFailureAction action) {
+  return new Verifier(action, /*incremental=*/true);
+}
+
 
 // verifyFunction - Create
 bool llvm::verifyFunction(const Function &f, VerifierFailureAction action) {
@@ -1946,11 +2033,103 @@ bool llvm::verifyFunction(const Function &f, VerifierFailureAction action) {
   return V->Broken;
 }
 
+namespace {
+  /// ParallelVerifier - The work of verifyModuleInParallel: the threads check
+  /// the function bodies in Functions[RunStarts[i], RunStarts[i+1]), and keep
+  /// what they found in Broken[i] and DeferredCalls[i].
+  struct ParallelVerifier {
+    std::vector<Function*> Functions;
+    std::vector<unsigned> RunStarts;
+    std::vector<char> Broken;
+    std::vector<std::vector<CallInst*> > DeferredCalls;
+  };
+}
+
+static void VerifyFunctionRun(void *Data, unsigned ThreadNo) {
+  ParallelVerifier &PV = *static_cast<ParallelVerifier*>(Data);
+  unsigned Begin = PV.RunStarts[ThreadNo], End = PV.RunStarts[ThreadNo+1];
+  if (Begin == End)
+    return;
+
+  DominatorTree DT;
+  Verifier V(DT, PV.DeferredCalls[ThreadNo]);
+  for (unsigned i = Begin; i != End && !V.Broken; ++i) {
+    Function &F = *PV.Functions[i];
+
+    // The dominator tree can only be built if every block has a terminator.
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+      if (BB->empty() || !BB->back().isTerminator()) {
+        V.Broken = true;
+        break;
+      }
+    if (V.Broken)
+      break;
+
+    DT.runOnFunction(F);
+    V.runOnFunction(F);
+  }
+  PV.Broken[ThreadNo] = V.Broken;
+}
+
+/// verifyModuleInParallel - Check M on NumThreads threads, returning true if it
+/// is broken.  This does not say what is wrong with the module.  The global
+/// values are checked on this thread, and the function bodies are split up
+/// between the threads.
+static bool verifyModuleInParallel(Module &M, unsigned NumThreads) {
+  ParallelVerifier PV;
+
+  // Split up the functions so that each thread has a similar number of
+  // instructions to check.  The argument lists and the GC table are built
+  // lazily; do that here, before the threads look at them.
+  std::vector<unsigned> Sizes;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    PV.Functions.push_back(F);
+    F->arg_size();
+    F->hasGC();
+
+    unsigned Size = 1;
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      Size += BB->size();
+    Sizes.push_back(Size);
+  }
+
+  NumThreads = llvm_split_into_runs(Sizes, NumThreads, PV.RunStarts);
+
+  PV.Broken.resize(NumThreads);
+  PV.DeferredCalls.resize(NumThreads);
+  llvm_execute_on_threads(VerifyFunctionRun, &PV, NumThreads);
+
+  for (unsigned i = 0; i != NumThreads; ++i)
+    if (PV.Broken[i])
+      return true;
+
+  // Check the global values, and the intrinsic calls that the threads left.
+  Verifier V(ReturnStatusAction);
+  V.Quiet = true;
+  V.doInitialization(M);
+  for (unsigned i = 0; i != NumThreads && !V.Broken; ++i)
+    for (unsigned j = 0, e = PV.DeferredCalls[i].size(); j != e; ++j) {
+      CallInst *CI = PV.DeferredCalls[i][j];
+      V.visitIntrinsicFunctionCall(
+        (Intrinsic::ID)CI->getCalledFunction()->getIntrinsicID(), *CI);
+    }
+  V.doFinalization(M);
+  return V.Broken;
+}
+
 /// verifyModule - Check a module for errors, printing messages on stderr.
 /// Return true if the module is corrupt.
 ///
 bool llvm::verifyModule(const Module &M, VerifierFailureAction action,
-                        std::string *ErrorInfo) {
+                        std::string *ErrorInfo, unsigned NumThreads) {
+  // Checking on threads only tells whether the module is valid; if it is not,
+  // check it again below to find out why.
+  if (NumThreads > 1 &&
+      !verifyModuleInParallel(const_cast<Module&>(M), NumThreads))
+    return false;
+
   PassManager PM;
   Verifier *V = new Verifier(action);
   PM.add(V);
@@ -0,0 +1,16 @@
+; RUN: llvm-as %s -o /dev/null
+; RUN: not llvm-extract -func g %s -S -o /dev/null |& FileCheck %s
+
+; When bodies are parsed lazily, as by llvm-extract, a forward reference must
+; agree with the declaration of the function it names.  llvm-as keeps the type
+; of the forward reference.
+
+; CHECK: invalid forward reference to function 'f' with wrong type!
+
+@p = global i8* bitcast (i32 (i32)* @f to i8*)
+
+define i32 @g() {
+  ret i32 0
+}
+
+declare i32 @f(i64)
@@ -0,0 +1,57 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-link %t.bc -o %t1.bc
+; RUN: llvm-link -bitcode-writer-threads=2 %t.bc -o %t2.bc
+; RUN: llvm-link -bitcode-writer-threads=8 %t.bc -o %t8.bc
+; RUN: cmp %t1.bc %t2.bc
+; RUN: cmp %t1.bc %t8.bc
+; RUN: llvm-dis < %t8.bc | grep {metadata !{i32 %y}}
+
+; Function blocks encoded on separate threads must be spliced into exactly the
+; same bitcode as the serial writer produces, including the numbering of
+; function-local metadata, which continues from one function to the next.
+
+@table = global [3 x i32] [i32 1, i32 2, i32 3]
+@addr = global i8* blockaddress(@indirect, %target)
+
+declare void @llvm.dbg.value(metadata, i64, metadata) nounwind readnone
+declare i32 @external(i32)
+
+define i32 @first(i32 %x) {
+  %a = add i32 %x, 7
+  call void @llvm.dbg.value(metadata !{i32 %a}, i64 0, metadata !0)
+  %b = call i32 @external(i32 %a), !attached !1
+  ret i32 %b
+}
+
+define i32 @second(i32 %y) {
+entry:
+  call void @llvm.dbg.value(metadata !{i32 %y}, i64 0, metadata !1)
+  %p = getelementptr [3 x i32]* @table, i32 0, i32 %y
+  %v = load i32* %p
+  %c = icmp sgt i32 %v, 1
+  br i1 %c, label %big, label %small
+big:
+  %s = mul i32 %v, 1000000
+  ret i32 %s
+small:
+  ret i32 -1
+}
+
+define double @third(double %d) {
+  %f = fmul double %d, 2.500000e+00
+  %g = fadd double %f, 0x3FF0000000000001
+  ret double %g
+}
+
+define i8* @indirect(i32 %n) {
+entry:
+  %z = icmp eq i32 %n, 0
+  br i1 %z, label %target, label %other
+target:
+  ret i8* blockaddress(@indirect, %target)
+other:
+  ret i8* null
+}
+
+!0 = metadata !{metadata !"first"}
+!1 = metadata !{i32 2, metadata !"second"}
@@ -0,0 +1,19 @@
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s
+; The reader builds the types of the type table in dependency order.  Check
+; that recursive, mutually recursive and opaque types still come out right.
+
+; CHECK: %list = type { %list*, i32 }
+; CHECK: %node = type { %tree*, %node*, [2 x %pair] }
+; CHECK: %opaque = type opaque
+; CHECK: %pair = type { i32, %opaque* }
+; CHECK: %tree = type { %node*, %list }
+
+%list = type { %list*, i32 }
+%node = type { %tree*, %node*, [2 x %pair] }
+%opaque = type opaque
+%pair = type { i32, %opaque* }
+%tree = type { %node*, %list }
+
+@n = global %node zeroinitializer
+@t = external global %tree
+@f = global void (%tree*, <4 x i32>)* null
@@ -0,0 +1,48 @@
+; RUN: llc < %s -filetype=obj | elf-dump | FileCheck %s
+
+; ELF object file emission for i386 uses REL relocations, with the addend in
+; the relocated data.
+
+target triple = "i386-unknown-linux-gnu"
+
+@arr = global [4 x i32] zeroinitializer
+@cnt = internal global i32 0
+
+declare void @ext()
+
+define i32 @f(i32 %i) nounwind {
+  call void @ext()
+  %p = getelementptr [4 x i32]* @arr, i32 0, i32 %i
+  %v = load i32* %p
+  %c = load i32* @cnt
+  %a = add i32 %v, %c
+  ret i32 %a
+}
+
+; CHECK: ('e_ident[EI_CLASS]', 1)
+; CHECK: ('e_machine', 3)
+
+; CHECK: # '.symtab'
+; CHECK: # 'cnt'
+; CHECK-NEXT: ('st_bind', 0)
+; CHECK: # 'f'
+; CHECK-NEXT: ('st_bind', 1)
+; CHECK-NEXT: ('st_type', 2)
+; CHECK: # 'ext'
+; CHECK-NEXT: ('st_bind', 1)
+; CHECK-NEXT: ('st_type', 0)
+; CHECK: # 'arr'
+; CHECK-NEXT: ('st_bind', 1)
+; CHECK-NEXT: ('st_type', 1)
+
+; CHECK: # '.rel.text'
+; CHECK-NEXT: ('sh_type', 9)
+; CHECK: ('r_sym', {{[0-9]+}}) # 'ext'
+; CHECK-NEXT: ('r_type', 2)
+; CHECK-NEXT: ),
+; CHECK: ('r_sym', {{[0-9]+}}) # 'arr'
+; CHECK-NEXT: ('r_type', 1)
+; CHECK-NEXT: ),
+; CHECK: ('r_sym', 2) # ''
+; CHECK-NEXT: ('r_type', 1)
+; CHECK-NEXT: ),
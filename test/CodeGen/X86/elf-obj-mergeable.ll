@@ -0,0 +1,35 @@
+; RUN: llc < %s -filetype=obj | elf-dump | FileCheck %s
+
+; The linker moves the entries of SHF_MERGE sections, so a constant pool load
+; must be relocated against the .LCPI symbol, not against the section symbol
+; plus an offset.
+
+target triple = "x86_64-unknown-linux-gnu"
+
+define double @f(double %x) nounwind {
+  %a = fadd double %x, 1.500000e+00
+  ret double %a
+}
+
+define float @g(float %x) nounwind {
+  %a = fmul float %x, 2.500000e+00
+  ret float %a
+}
+
+; CHECK: # '.rodata.cst8'
+; CHECK-NEXT: ('sh_type', 1)
+; CHECK-NEXT: ('sh_flags', 0x12)
+
+; CHECK: # '.symtab'
+; CHECK: # '.LCPI1_0'
+; CHECK-NEXT: ('st_bind', 0)
+; CHECK: # '.LCPI2_0'
+; CHECK-NEXT: ('st_bind', 0)
+
+; CHECK: # '.rela.text'
+; CHECK: ('r_sym', {{[0-9]+}}) # '.LCPI1_0'
+; CHECK-NEXT: ('r_type', 2)
+; CHECK-NEXT: ('r_addend', -4)
+; CHECK: ('r_sym', {{[0-9]+}}) # '.LCPI2_0'
+; CHECK-NEXT: ('r_type', 2)
+; CHECK-NEXT: ('r_addend', -4)
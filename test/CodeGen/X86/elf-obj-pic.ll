@@ -0,0 +1,17 @@
+; RUN: not llc < %s -relocation-model=pic -filetype=obj -o /dev/null |& \
+; RUN:   FileCheck %s
+
+; The ELF writer has no GOT or PLT relocations yet, so object file emission
+; is refused for position independent code.
+
+target triple = "x86_64-unknown-linux-gnu"
+
+@g = global i32 0
+
+define i32 @f() nounwind {
+  %v = load i32* @g
+  ret i32 %v
+}
+
+; CHECK: target does not support generation of this file type
+; CHECK: note: ELF object files cannot be written for position independent code yet
@@ -0,0 +1,96 @@
+; RUN: llc < %s -filetype=obj | elf-dump --dump-section-data | FileCheck %s
+
+; ELF object file emission for x86-64: sections, symbols, RELA relocations
+; and the .eh_frame contents.
+
+target triple = "x86_64-unknown-linux-gnu"
+
+@arr = global [4 x i64] zeroinitializer
+@cnt = internal global i32 0
+
+declare void @ext()
+
+define i64 @f(i64 %i) nounwind {
+  %p = getelementptr [4 x i64]* @arr, i64 0, i64 %i
+  %v = load i64* %p
+  %a = add i64 %v, ptrtoint ([4 x i64]* @arr to i64)
+  ret i64 %a
+}
+
+define i32 @g() {
+  call void @ext()
+  %v = load i32* @cnt
+  ret i32 %v
+}
+
+; CHECK: ('e_ident[EI_CLASS]', 2)
+; CHECK: ('e_type', 1)
+; CHECK: ('e_machine', 62)
+
+; CHECK: # '.text'
+; CHECK-NEXT: ('sh_type', 1)
+; CHECK-NEXT: ('sh_flags', 0x6)
+
+; CHECK: # '.bss'
+; CHECK-NEXT: ('sh_type', 8)
+; CHECK-NEXT: ('sh_flags', 0x3)
+
+; The CIE, with the LEB128 fields written out as bytes: code alignment 1,
+; data alignment -8, return address register 16.
+; CHECK: # '.eh_frame'
+; CHECK-NEXT: ('sh_type', 1)
+; CHECK: ('_section_data', '1400000000000000017a5200017810010
+; CHECK-NEXT: ),
+
+; CHECK: # '.symtab'
+; CHECK-NEXT: ('sh_type', 2)
+; Local symbols come first; the .bss symbol of @cnt gets the common size.
+; CHECK: # 'cnt'
+; CHECK-NEXT: ('st_bind', 0)
+; CHECK-NEXT: ('st_type', 1)
+; CHECK-NEXT: ('st_other', 0)
+; CHECK-NEXT: ('st_shndx', 2)
+; CHECK-NEXT: ('st_value', 32)
+; CHECK-NEXT: ('st_size', 4)
+; CHECK: # 'f'
+; CHECK-NEXT: ('st_bind', 1)
+; CHECK-NEXT: ('st_type', 2)
+; CHECK-NEXT: ('st_other', 0)
+; CHECK-NEXT: ('st_shndx', 1)
+; CHECK: # 'arr'
+; CHECK-NEXT: ('st_bind', 1)
+; CHECK-NEXT: ('st_type', 1)
+; CHECK-NEXT: ('st_other', 0)
+; CHECK-NEXT: ('st_shndx', 2)
+; CHECK-NEXT: ('st_value', 0)
+; CHECK-NEXT: ('st_size', 32)
+; CHECK: # 'ext'
+; CHECK-NEXT: ('st_bind', 1)
+; CHECK-NEXT: ('st_type', 0)
+; CHECK-NEXT: ('st_other', 0)
+; CHECK-NEXT: ('st_shndx', 0)
+
+; CHECK: # '.rela.text'
+; CHECK-NEXT: ('sh_type', 4)
+; movl $arr, %eax is zero extended: R_X86_64_32.
+; CHECK: ('r_sym', {{[0-9]+}}) # 'arr'
+; CHECK-NEXT: ('r_type', 10)
+; CHECK-NEXT: ('r_addend', 0)
+; addq arr(,%rdi,8), %rax has a sign extended displacement: R_X86_64_32S.
+; CHECK: ('r_sym', {{[0-9]+}}) # 'arr'
+; CHECK-NEXT: ('r_type', 11)
+; CHECK-NEXT: ('r_addend', 0)
+; The call: R_X86_64_PC32.
+; CHECK: ('r_sym', {{[0-9]+}}) # 'ext'
+; CHECK-NEXT: ('r_type', 2)
+; CHECK-NEXT: ('r_addend', -4)
+; The local @cnt is reached through the .bss section symbol.
+; CHECK: ('r_sym', 2) # ''
+; CHECK-NEXT: ('r_type', 2)
+; CHECK-NEXT: ('r_addend', 28)
+
+; CHECK: # '.rela.eh_frame'
+; CHECK-NEXT: ('sh_type', 4)
+; CHECK: ('r_sym', 1) # ''
+; CHECK-NEXT: ('r_type', 10)
+; CHECK-NEXT: ('r_addend', 16)
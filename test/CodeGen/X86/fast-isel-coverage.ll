@@ -0,0 +1,129 @@
+; RUN: llc < %s -O0 -fast-isel-abort -verify-machineinstrs -march=x86-64 | \
+; RUN:   FileCheck %s
+; RUN: llc < %s -O2 -fast-isel -fast-isel-abort -verify-machineinstrs \
+; RUN:   -march=x86-64 | FileCheck %s --check-prefix=OPT
+; RUN: llc < %s -O0 -fast-isel-stats -march=x86-64 -o /dev/null |& \
+; RUN:   FileCheck %s --check-prefix=STATS
+
+; Constructs that x86 FastISel selects without falling back to SelectionDAG.
+
+; STATS: instructions selected by FastISel (100.0%)
+; STATS: 0 instructions selected by SelectionDAG
+
+define i32 @sw(i32 %x) nounwind {
+entry:
+  switch i32 %x, label %def [ i32 1, label %a
+                              i32 5, label %b ]
+a:
+  ret i32 10
+b:
+  ret i32 20
+def:
+  ret i32 40
+; CHECK: sw:
+; CHECK: cmpl $1
+; CHECK-NEXT: je
+; CHECK: cmpl $5
+; CHECK-NEXT: je
+; CHECK: jmp
+}
+
+; Each compare of the chain is in its own block, so branch folding can
+; merge the identical destinations without losing a branch target.
+define i32 @sw2(i32 %x) nounwind {
+entry:
+  switch i32 %x, label %def [ i32 1, label %a
+                              i32 5, label %a
+                              i32 7, label %b ]
+a:
+  ret i32 10
+b:
+  ret i32 10
+def:
+  ret i32 40
+; CHECK: sw2:
+; CHECK: cmpl $1
+; CHECK-NEXT: je
+; CHECK-NEXT: # BB
+; CHECK: cmpl $5
+; CHECK-NEXT: je
+; CHECK-NEXT: # BB
+; CHECK: cmpl $7
+; CHECK-NEXT: je
+; CHECK-NEXT: jmp
+; OPT: sw2:
+; OPT-NOT: _-1
+; OPT: div:
+}
+
+define i32 @div(i32 %a, i32 %b) nounwind {
+  %q = sdiv i32 %a, %b
+  %r = urem i32 %a, %b
+  %s = add i32 %q, %r
+  ret i32 %s
+; CHECK: div:
+; CHECK: cltd
+; CHECK: idivl
+; CHECK: divl
+}
+
+define void @vec(<4 x float>* %p, <4 x float>* %q) nounwind {
+  %v = load <4 x float>* %p, align 16
+  store <4 x float> %v, <4 x float>* %q, align 4
+  ret void
+; CHECK: vec:
+; CHECK: movaps (%rdi)
+; CHECK: movups {{.*}}(%rsi)
+}
+
+define float @self(i1 %c, float %a, float %b) nounwind {
+  %s = select i1 %c, float %a, float %b
+  ret float %s
+; CHECK: self:
+; CHECK: cmov
+}
+
+declare i32 @llvm.bswap.i32(i32) nounwind readnone
+
+define i32 @bswap(i32 %x) nounwind {
+  %r = call i32 @llvm.bswap.i32(i32 %x)
+  ret i32 %r
+; CHECK: bswap:
+; CHECK: bswapl
+}
+
+declare i32 @llvm.atomic.load.add.i32.p0i32(i32*, i32) nounwind
+declare i32 @llvm.atomic.cmp.swap.i32.p0i32(i32*, i32, i32) nounwind
+
+define i32 @atomics(i32* %p, i32 %v) nounwind {
+  %o = call i32 @llvm.atomic.load.add.i32.p0i32(i32* %p, i32 %v)
+  %c = call i32 @llvm.atomic.cmp.swap.i32.p0i32(i32* %p, i32 %o, i32 %v)
+  ret i32 %c
+; CHECK: atomics:
+; CHECK: lock
+; CHECK-NEXT: xaddl
+; CHECK: lock
+; CHECK-NEXT: cmpxchgl
+}
+
+declare void @llvm.memcpy.i64(i8*, i8*, i64, i32) nounwind
+
+define void @cpy(i8* %d, i8* %s) nounwind {
+  call void @llvm.memcpy.i64(i8* %d, i8* %s, i64 12, i32 4)
+  ret void
+; CHECK: cpy:
+; CHECK-NOT: memcpy
+; CHECK: movq
+; CHECK: movl
+; CHECK-NOT: memcpy
+; CHECK: vararg:
+}
+
+declare i32 @printf(i8*, ...)
+
+define i32 @vararg(i8* %f, double %d) nounwind {
+  %r = call i32 (i8*, ...)* @printf(i8* %f, double %d)
+  ret i32 %r
+; CHECK: movb $1, %al
+; CHECK: call
+}
@@ -0,0 +1,59 @@
+; RUN: llc < %s -march=x86 -verify-machineinstrs -stats |& grep {had to backtrack}
+
+; Each value is live in its own block and again in a cold block laid out at the
+; end of the function, so it sits in the inactive set across the blocks in
+; between.  There are not enough registers for all of them, which forces the
+; allocator to spill and roll back intervals that are inactive.
+
+declare void @use(i32, i32, i32, i32)
+
+define i32 @holes(i32 %a, i32 %b, i32* %p) nounwind {
+entry:
+  br label %b0
+
+b0:
+  %x0 = load i32* %p
+  %y0 = mul i32 %x0, %b
+  %z0 = add i32 %y0, %a
+  %w0 = xor i32 %z0, %x0
+  %c0 = icmp eq i32 %w0, 0
+  br i1 %c0, label %cold0, label %b1
+
+b1:
+  %q1 = getelementptr i32* %p, i32 1
+  %x1 = load i32* %q1
+  %y1 = mul i32 %x1, %y0
+  %z1 = add i32 %y1, %z0
+  %w1 = xor i32 %z1, %w0
+  %c1 = icmp eq i32 %w1, 1
+  br i1 %c1, label %cold1, label %b2
+
+b2:
+  %q2 = getelementptr i32* %p, i32 2
+  %x2 = load i32* %q2
+  %y2 = mul i32 %x2, %y1
+  %z2 = add i32 %y2, %z1
+  %w2 = xor i32 %z2, %w1
+  %c2 = icmp eq i32 %w2, 2
+  br i1 %c2, label %cold2, label %exit
+
+exit:
+  %r0 = add i32 %x2, %y2
+  %r1 = add i32 %r0, %z2
+  %r2 = add i32 %r1, %w2
+  %r3 = add i32 %r2, %w0
+  ret i32 %r3
+
+cold0:
+  call void @use(i32 %x0, i32 %y0, i32 %z0, i32 %w0)
+  br label %b1
+
+cold1:
+  call void @use(i32 %x1, i32 %y1, i32 %z1, i32 %w1)
+  br label %b2
+
+cold2:
+  call void @use(i32 %x2, i32 %y2, i32 %z2, i32 %w2)
+  call void @use(i32 %x0, i32 %y1, i32 %z0, i32 %w1)
+  br label %exit
+}
@@ -0,0 +1,28 @@
+; RUN: llc < %s -march=x86 -O3 -post-RA-scheduler | FileCheck %s
+; RUN: llc < %s -march=x86 -O3 -post-RA-scheduler -sched-max-pending-loads=1 | FileCheck %s
+
+; The loads through %p0, %p1 and %p2 have no known underlying object, so the
+; store to %r must stay below all of them, also when the post-RA scheduler
+; chains the loads together once too many are pending.
+
+; CHECK: f:
+; CHECK: addl (%
+; CHECK: addl (%
+; CHECK: movl $0, (%
+
+define i32 @f(i32** %q, i32* %r) nounwind {
+entry:
+  %b0 = getelementptr i32** %q, i32 0
+  %p0 = load i32** %b0
+  %b1 = getelementptr i32** %q, i32 1
+  %p1 = load i32** %b1
+  %b2 = getelementptr i32** %q, i32 2
+  %p2 = load i32** %b2
+  %x0 = load i32* %p0
+  %x1 = load i32* %p1
+  %x2 = load i32* %p2
+  store i32 0, i32* %r
+  %s0 = add i32 %x0, %x1
+  %s1 = add i32 %s0, %x2
+  ret i32 %s1
+}
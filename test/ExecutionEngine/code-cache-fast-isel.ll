@@ -0,0 +1,26 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: rm -rf %t.cache
+; RUN: lli -jit-code-cache=%t.cache %t.bc
+; RUN: ls %t.cache | count 2
+; RUN: lli -jit-code-cache=%t.cache -fast-isel %t.bc
+; RUN: ls %t.cache | count 4
+
+; Code selected by FastISel is cached apart from code selected by
+; SelectionDAG.
+
+define i32 @twice(i32 %x) {
+	%y = shl i32 %x, 1
+	ret i32 %y
+}
+
+define i32 @main() {
+	%r = call i32 @twice(i32 21)
+	%ok = icmp eq i32 %r, 42
+	br i1 %ok, label %pass, label %fail
+
+pass:
+	ret i32 0
+
+fail:
+	ret i32 1
+}
@@ -0,0 +1,52 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: rm -rf %t.cache
+; RUN: lli -jit-code-cache=%t.cache %t.bc
+; RUN: lli -jit-code-cache=%t.cache -stats %t.bc |& FileCheck -check-prefix=HIT %s
+; RUN: lli -jit-code-cache=%t.cache -disable-lazy-compilation %t.bc
+
+; Three more entries do not fit in 1KB, so older ones are removed.
+; RUN: lli -jit-code-cache=%t.cache -O3 -jit-code-cache-size-limit=1 -stats \
+; RUN:   %t.bc |& FileCheck -check-prefix=PRUNE %s
+; RUN: lli -jit-code-cache=%t.cache %t.bc
+
+; HIT: 3 jit - Number of functions loaded from the code cache
+; PRUNE: jit - Number of code cache entries removed to limit its size
+
+@counter = global i32 10
+
+define double @scale(double %x) {
+	%y = fmul double %x, 2.500000e+00
+	ret double %y
+}
+
+define i32 @bump(i32 %n) {
+entry:
+	br label %loop
+
+loop:
+	%i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+	%c = load i32* @counter
+	%c.next = add i32 %c, 1
+	store i32 %c.next, i32* @counter
+	%i.next = add i32 %i, 1
+	%done = icmp eq i32 %i.next, %n
+	br i1 %done, label %exit, label %loop
+
+exit:
+	%d = sitofp i32 %c.next to double
+	%s = call double @scale(double %d)
+	%r = fptosi double %s to i32
+	ret i32 %r
+}
+
+define i32 @main() {
+	%r = call i32 @bump(i32 6)
+	%ok = icmp eq i32 %r, 40
+	br i1 %ok, label %pass, label %fail
+
+pass:
+	ret i32 0
+
+fail:
+	ret i32 1
+}
@@ -0,0 +1,60 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-dis < %t.bc > %t1.ll
+; RUN: llvm-dis -asm-writer-threads=2 < %t.bc > %t2.ll
+; RUN: llvm-dis -asm-writer-threads=8 < %t.bc > %t8.ll
+; RUN: diff %t1.ll %t2.ll
+; RUN: diff %t1.ll %t8.ll
+; RUN: grep {!dbg !2} %t8.ll
+
+; Function bodies formatted on separate threads must come out exactly as the
+; serial writer prints them, including the numbering of unnamed values and of
+; the metadata attached to instructions, which continues from one function to
+; the next.
+
+%pair = type { i32, %pair* }
+%0 = type { i8, i16 }
+
+@0 = global %0 zeroinitializer
+@table = global [3 x i32] [i32 1, i32 2, i32 3]
+@addr = global i8* blockaddress(@indirect, %target)
+
+declare i32 @external(i32)
+
+define i32 @first(i32 %x) {
+  %1 = add i32 %x, 7
+  %2 = call i32 @external(i32 %1), !dbg !0
+  ret i32 %2
+}
+
+define i32 @second(%pair* %p) {
+entry:
+  %f = getelementptr %pair* %p, i32 0, i32 0
+  %v = load i32* %f, !dbg !1
+  br label %0
+
+; <label>:0
+  %s = load i16* getelementptr (%0* @0, i32 0, i32 1), !dbg !0
+  %t = sext i16 %s to i32
+  ret i32 %t
+}
+
+define void @indirect() {
+  br label %target
+
+target:
+  ret void
+}
+
+define i8 @third(%0* %q) gc "shadow-stack" {
+  %1 = getelementptr %0* %q, i32 0, i32 0
+  %2 = load i8* %1, !dbg !2
+  ret i8 %2
+}
+
+define void @fourth() {
+  ret void
+}
+
+!0 = metadata !{i32 1, metadata !"first"}
+!1 = metadata !{i32 2, metadata !0}
+!2 = metadata !{i32 3, metadata !1}
@@ -0,0 +1,41 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: rm -rf %t.cache
+; RUN: llvm-lto %t.bc -o %t1.o -pic-model=static -integrated-as \
+; RUN:   -cache-dir=%t.cache -stats |& FileCheck -check-prefix=MISS %s
+; RUN: llvm-lto %t.bc -o %t2.o -pic-model=static -integrated-as \
+; RUN:   -cache-dir=%t.cache -stats |& FileCheck -check-prefix=HIT %s
+; RUN: diff %t1.o %t2.o
+
+; Changing the code generator options invalidates the entry.
+; RUN: llvm-lto %t.bc -o %t3.o -pic-model=dynamic -integrated-as \
+; RUN:   -cache-dir=%t.cache -stats |& FileCheck -check-prefix=MISS %s
+; RUN: llvm-lto %t.bc -o %t3.o -pic-model=static \
+; RUN:   -cache-dir=%t.cache -stats |& FileCheck -check-prefix=MISS %s
+
+; Adding a fourth entry with a 1KB limit removes the other three.
+; RUN: llvm-lto %t.bc -o %t4.o -pic-model=dynamic \
+; RUN:   -cache-dir=%t.cache -lto-cache-size-limit=1 -stats |& \
+; RUN:   FileCheck -check-prefix=PRUNE %s
+; RUN: llvm-lto %t.bc -o %t4.o -pic-model=dynamic \
+; RUN:   -cache-dir=%t.cache -stats |& FileCheck -check-prefix=HIT %s
+; RUN: llvm-lto %t.bc -o %t1.o -pic-model=static -integrated-as \
+; RUN:   -cache-dir=%t.cache -stats |& FileCheck -check-prefix=MISS %s
+
+target triple = "x86_64-unknown-linux-gnu"
+
+@counter = global i32 0
+
+declare void @abort() noreturn
+
+define void @fail() noreturn nounwind {
+  store i32 1, i32* @counter
+  tail call void @abort() noreturn nounwind
+  unreachable
+}
+
+; MISS-NOT: found in the cache
+; MISS: 1 lto - Number of object files not found in the cache
+
+; HIT: 1 lto - Number of object files found in the cache
+
+; PRUNE: 3 lto - Number of cache entries removed to limit its size
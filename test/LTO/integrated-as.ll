@@ -0,0 +1,46 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-lto %t.bc -o %t.o -pic-model=static -integrated-as -stats |& \
+; RUN:   FileCheck -check-prefix=STATIC %s
+; RUN: elf-dump %t.o | FileCheck -check-prefix=STATIC-OBJ %s
+; RUN: llvm-lto %t.bc -o %t.o -pic-model=dynamic -integrated-as -stats |& \
+; RUN:   FileCheck -check-prefix=PIC %s
+; RUN: elf-dump %t.o | FileCheck -check-prefix=PIC-OBJ %s
+
+; With -integrated-as, libLTO emits the object file in memory.  The ELF
+; writer cannot produce position independent code yet, so then the external
+; assembler is used instead.  The function does not return, because the
+; return sequence of this tree is not accepted by the system assembler.
+
+target triple = "x86_64-unknown-linux-gnu"
+
+@counter = global i32 0
+@table = global [2 x i32*] [i32* @counter, i32* @counter]
+
+declare void @abort() noreturn
+
+define void @fail() noreturn nounwind {
+  store i32 1, i32* @counter
+  tail call void @abort() noreturn nounwind
+  unreachable
+}
+
+; STATIC-NOT: external assembler
+; STATIC: 1 lto - Number of object files emitted in memory
+
+; STATIC-OBJ: # '.rela.text'
+; STATIC-OBJ: # 'counter'
+; STATIC-OBJ: # 'abort'
+; STATIC-OBJ: # '.rela.data'
+; STATIC-OBJ: # 'counter'
+; STATIC-OBJ-NEXT: ('r_type', 1)
+; STATIC-OBJ: # 'counter'
+; STATIC-OBJ-NEXT: ('r_type', 1)
+
+; PIC: 1 lto - Number of object files built by the external assembler
+
+; The store goes through the GOT and the call through the PLT.
+; PIC-OBJ: # '.rela.text'
+; PIC-OBJ: # 'counter'
+; PIC-OBJ-NEXT: ('r_type', {{9|42}})
+; PIC-OBJ: # 'abort'
+; PIC-OBJ-NEXT: ('r_type', 4)
@@ -0,0 +1,18 @@
+; RUN: opt < %s -gvn -memcpyopt -disable-output -debug-pass=Recompute |& FileCheck %s
+; RUN: opt < %s -gvn -memcpyopt -disable-output -debug-pass=Recompute -disable-analysis-reuse |& FileCheck %s -check-prefix=NOREUSE
+
+; GVN does not preserve memory dependence analysis, but it does not change
+; @f, so memcpyopt can use the results that GVN used.
+
+; CHECK: Analysis recomputation report
+; CHECK: Computed  Redundant    Reused  Analysis
+; CHECK: 1          0         0  Dominator Tree Construction
+; CHECK: 1          0         1  Memory Dependence Analysis
+
+; NOREUSE: 1          0         0  Dominator Tree Construction
+; NOREUSE: 2          1         0  Memory Dependence Analysis
+
+define i32 @f(i32* %p) {
+  %v = load i32* %p
+  ret i32 %v
+}
@@ -0,0 +1,39 @@
+; RUN: llvm-extract -func get %s -S -o - | FileCheck %s
+; RUN: not llvm-extract -func broken %s -S -o /dev/null |& FileCheck %s -check-prefix=BROKEN
+
+; Function bodies in a .ll file are only parsed when they are needed, so the
+; error in @broken is not seen unless @broken is extracted.
+
+; CHECK: define i32 @get(i32 %x)
+; CHECK: call i32 @helper(i32 %x)
+; CHECK-NOT: @broken
+; CHECK: declare i32 @helper(i32)
+
+; BROKEN: use of undefined value '%undefined'
+
+@str = internal constant [8 x i8] c"{;\22}}{\0A\00"
+
+define i32 @get(i32 %x) {
+entry:
+  %y = call i32 @helper(i32 %x)
+  %z = add i32 %y, 1  ; a comment with a } brace
+  ret i32 %z
+}
+
+define internal i32 @helper(i32 %x) {
+  %a = mul i32 %x, 2
+  %"weird}" = add i32 %a, 3
+  ret i32 %"weird}"
+}
+
+define void @jump() {
+entry:
+  indirectbr i8* blockaddress(@jump, %target), [label %target]
+target:
+  ret void
+}
+
+define void @broken() {
+  %a = add i32 %undefined, 1
+  ret void
+}
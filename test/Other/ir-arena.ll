@@ -0,0 +1,40 @@
+; RUN: opt < %s -S -ir-arena -inline -instcombine -simplifycfg | FileCheck %s
+; RUN: opt < %s -S -inline -instcombine -simplifycfg | FileCheck %s
+
+; The input is read into an IRArena.  The passes delete arena instructions,
+; grow the operand lists of arena PHI nodes and switches, and move heap
+; instructions into arena blocks, so arena and heap objects are freed side by
+; side.
+
+define internal i32 @callee(i32 %x) {
+  %a = add i32 %x, 0
+  %b = mul i32 %a, 2
+  ret i32 %b
+}
+
+define i32 @caller(i32 %x, i1 %c) {
+entry:
+  switch i32 %x, label %other [ i32 1, label %one
+                                i32 2, label %two ]
+one:
+  br label %join
+two:
+  br label %join
+other:
+  %v = call i32 @callee(i32 %x)
+  br i1 %c, label %join, label %exit
+join:
+  %p = phi i32 [ 10, %one ], [ 20, %two ], [ %v, %other ]
+  br label %exit
+exit:
+  %r = phi i32 [ %p, %join ], [ 0, %other ]
+  ret i32 %r
+}
+
+; CHECK-NOT: @callee
+; CHECK: define i32 @caller
+; CHECK: switch i32 %x
+; CHECK: ret i32 20
+; CHECK: shl i32 %x, 1
+; CHECK-NEXT: select i1 %c
+; CHECK: ret i32 10
@@ -0,0 +1,52 @@
+; RUN: opt < %s -S -j 4 -instcombine -simplify-libcalls | FileCheck %s
+; RUN: opt < %s -S -instcombine -simplify-libcalls | FileCheck %s
+; RUN: opt < %s -S -j 4 -verify-each -instcombine -simplify-libcalls | FileCheck %s
+
+; Function passes run on several threads with -j.  The results are merged back
+; into the module, including the declarations that the passes create.
+
+@str = internal constant [7 x i8] c"hello\0A\00"
+@G = global i32 0
+; CHECK: @str{{[0-9]+}} = internal constant [6 x i8] c"hello\00"
+; CHECK-NEXT: @str{{[0-9]+}} = internal constant [6 x i8] c"hello\00"
+
+declare i32 @printf(i8*, ...)
+; CHECK: declare i32 @printf(i8* nocapture, ...) nounwind
+
+define i32 @f1(i32 %x) {
+  %a = add i32 %x, 0
+  ret i32 %a
+}
+; CHECK: define i32 @f1(i32 %x) {
+; CHECK-NEXT: ret i32 %x
+
+define void @f2() {
+  %p = getelementptr [7 x i8]* @str, i32 0, i32 0
+  %r = call i32 (i8*, ...)* @printf(i8* %p)
+  ret void
+}
+; Which thread creates which string, and so the strings' names, depends on
+; timing.  Each call gets a string of its own.
+; CHECK: define void @f2() {
+; CHECK-NEXT: call i32 @puts(i8* getelementptr inbounds ([6 x i8]* @str{{[0-9]+}}
+
+define void @f3() {
+  %p = getelementptr [7 x i8]* @str, i32 0, i32 0
+  %r = call i32 (i8*, ...)* @printf(i8* %p)
+  store i32 1, i32* @G
+  ret void
+}
+; CHECK: define void @f3() {
+; CHECK-NEXT: call i32 @puts(i8* getelementptr inbounds ([6 x i8]* @str{{[0-9]+}}
+; CHECK-NEXT: store i32 1, i32* @G
+
+define i32 @f4(i32 %x) {
+  %a = mul i32 %x, 1
+  %b = call i32 @f1(i32 %a)
+  ret i32 %b
+}
+; CHECK: define i32 @f4(i32 %x) {
+; CHECK-NEXT: %b = call i32 @f1(i32 %x)
+; CHECK-NEXT: ret i32 %b
+
+; CHECK: declare i32 @puts(i8* nocapture) nounwind
@@ -0,0 +1,14 @@
+; RUN: opt < %s -instcombine -disable-output -pass-trace=%t
+; RUN: FileCheck %s < %t
+
+; CHECK: [
+; CHECK: {"name":"Combine redundant instructions","cat":"function","ph":"X",
+; CHECK: "args":{"unit":"f","instructions_before":2,"instructions_after":1,
+; CHECK: {"name":"Function Pass Manager","cat":"module","ph":"X",
+; CHECK: "instructions_before":2,"instructions_after":1,
+; CHECK: ]
+
+define i32 @f(i32 %x) {
+  %y = add i32 %x, 0
+  ret i32 %y
+}
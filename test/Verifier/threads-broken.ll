@@ -0,0 +1,39 @@
+; RUN: not llvm-as -verifier-threads=4 < %s |& FileCheck %s
+
+; When the function bodies are checked on several threads, the errors are
+; still reported as they are when checking on one thread.
+
+; CHECK: Instruction does not dominate all uses!
+; CHECK-NEXT: %y = add i32 %x, 1
+; CHECK-NEXT: %z = add i32 %y, 2
+
+define i32 @a(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+define i32 @b(i32 %x) {
+  %y = add i32 %x, 2
+  ret i32 %y
+}
+
+define i32 @c(i32 %x) {
+entry:
+  br i1 true, label %then, label %else
+
+then:
+  %y = add i32 %x, 1
+  br label %else
+
+else:
+  %z = add i32 %y, 2
+  ret i32 %z
+}
+
+define i32 @d(i32 %x) {
+  ret i32 %x
+}
+
+define i32 @e(i32 %x) {
+  ret i32 %x
+}
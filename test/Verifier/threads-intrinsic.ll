@@ -0,0 +1,21 @@
+; RUN: not llvm-as -verifier-threads=2 < %s |& FileCheck %s
+
+; Calls to intrinsics are checked after the threads are done with the function
+; bodies.
+
+; CHECK: Enclosing function does not use GC.
+; CHECK-NEXT: call void @llvm.gcroot(i8** %root, i8* null)
+
+declare void @llvm.gcroot(i8**, i8*)
+
+define void @a() gc "shadow-stack" {
+  %root = alloca i8*
+  call void @llvm.gcroot(i8** %root, i8* null)
+  ret void
+}
+
+define void @b() {
+  %root = alloca i8*
+  call void @llvm.gcroot(i8** %root, i8* null)
+  ret void
+}
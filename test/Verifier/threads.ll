@@ -0,0 +1,48 @@
+; RUN: llvm-as -verifier-threads=4 < %s -o /dev/null
+
+; Function bodies can be checked on several threads.
+
+%obj = type { i32 }
+
+declare void @llvm.gcroot(i8**, i8*)
+declare void @llvm.memcpy.i32(i8*, i8*, i32, i32)
+
+define void @copy(i8* %d, i8* %s) {
+  call void @llvm.memcpy.i32(i8* %d, i8* %s, i32 16, i32 1)
+  ret void
+}
+
+define void @rooted() gc "shadow-stack" {
+  %root = alloca i8*
+  call void @llvm.gcroot(i8** %root, i8* null)
+  ret void
+}
+
+define i32 @loop(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %next = add i32 %i, 1
+  %done = icmp eq i32 %next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %next
+}
+
+define i32 @throws(%obj* %o) {
+entry:
+  %v = invoke i32 @loop(i32 3) to label %ok unwind label %bad
+
+ok:
+  ret i32 %v
+
+bad:
+  ret i32 0
+}
+
+define void @empty() {
+  ret void
+}
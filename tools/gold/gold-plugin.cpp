@@ -60,6 +60,11 @@ namespace {
 namespace options {
   bool generate_api_file = false;
   const char *as_path = NULL;
+  // Number of object files to split the code generation into.  Values above
+  // one generate code for the partitions in parallel.
+  unsigned partitions = 1;
+  // Directory in which the generated code is kept for later links.
+  const char *cache_dir = NULL;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed 
   // as plugin exclusive to pass to the code generator.
@@ -81,6 +86,14 @@ namespace options {
       } else {
         as_path = strdup(opt + 3);
       }
+    } else if (strncmp("cache-dir=", opt, 10) == 0) {
+      cache_dir = strdup(opt + 10);
+    } else if (strncmp("partitions=", opt, 11) == 0) {
+      partitions = atoi(opt + 11);
+      if (partitions == 0) {
+        (*message)(LDPL_WARNING, "Ignoring invalid option %s", opt);
+        partitions = 1;
+      }
     } else {
       // Save this option to pass to the code generator.
       extra.push_back(std::string(opt));
@@ -368,6 +381,8 @@ ld_plugin_status all_symbols_read_hook(void) {
     sys::Path p = sys::Program::FindProgramByName(options::as_path);
     lto_codegen_set_assembler_path(cg, p.c_str());
   }
+  if (options::cache_dir)
+    lto_codegen_set_cache_dir(cg, options::cache_dir);
   // Pass through extra options to the code generator.
   if (!options::extra.empty()) {
     for (std::vector<std::string>::iterator it = options::extra.begin();
@@ -376,38 +391,66 @@ ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  size_t bufsize = 0;
-  const char *buffer = static_cast<const char *>(lto_codegen_compile(cg,
+  std::vector<std::pair<const char *, size_t> > Objects;
+  if (options::partitions > 1) {
+    unsigned NumObjects = lto_codegen_compile_partitions(cg,
+                                                         options::partitions);
+    for (unsigned i = 0; i != NumObjects; ++i) {
+      size_t bufsize = 0;
+      const char *buffer = static_cast<const char *>(
+        lto_codegen_get_partition_object(cg, i, &bufsize));
+      Objects.push_back(std::make_pair(buffer, bufsize));
+    }
+  } else {
+    size_t bufsize = 0;
+    const char *buffer = static_cast<const char *>(lto_codegen_compile(cg,
                                                                      &bufsize));
+    Objects.push_back(std::make_pair(buffer, bufsize));
+  }
 
-  std::string ErrMsg;
-
-  sys::Path uniqueObjPath("/tmp/llvmgold.o");
-  if (uniqueObjPath.createTemporaryFileOnDisk(true, &ErrMsg)) {
-    (*message)(LDPL_ERROR, "%s", ErrMsg.c_str());
+  if (Objects.empty() || Objects[0].first == NULL) {
+    (*message)(LDPL_ERROR, "%s", lto_get_error_message());
+    lto_codegen_dispose(cg);
     return LDPS_ERR;
   }
-  raw_fd_ostream *objFile = 
-    new raw_fd_ostream(uniqueObjPath.c_str(), ErrMsg,
-                       raw_fd_ostream::F_Binary);
-  if (!ErrMsg.empty()) {
+
+  std::string ErrMsg;
+
+  std::vector<sys::Path> ObjPaths;
+  for (unsigned i = 0, e = Objects.size(); i != e; ++i) {
+    sys::Path uniqueObjPath("/tmp/llvmgold.o");
+    if (uniqueObjPath.createTemporaryFileOnDisk(true, &ErrMsg)) {
+      (*message)(LDPL_ERROR, "%s", ErrMsg.c_str());
+      return LDPS_ERR;
+    }
+    raw_fd_ostream *objFile = 
+      new raw_fd_ostream(uniqueObjPath.c_str(), ErrMsg,
+                         raw_fd_ostream::F_Binary);
+    if (!ErrMsg.empty()) {
+      delete objFile;
+      (*message)(LDPL_ERROR, "%s", ErrMsg.c_str());
+      return LDPS_ERR;
+    }
+
+    objFile->write(Objects[i].first, Objects[i].second);
+    objFile->close();
     delete objFile;
-    (*message)(LDPL_ERROR, "%s", ErrMsg.c_str());
-    return LDPS_ERR;
+    ObjPaths.push_back(uniqueObjPath);
   }
 
-  objFile->write(buffer, bufsize);
-  objFile->close();
-
   lto_codegen_dispose(cg);
 
-  if ((*add_input_file)(const_cast<char*>(uniqueObjPath.c_str())) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", uniqueObjPath.c_str());
-    return LDPS_ERR;
-  }
+  for (unsigned i = 0, e = ObjPaths.size(); i != e; ++i) {
+    const sys::Path &uniqueObjPath = ObjPaths[i];
+    if ((*add_input_file)(const_cast<char*>(uniqueObjPath.c_str())) !=
+        LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", uniqueObjPath.c_str());
+      return LDPS_ERR;
+    }
 
-  Cleanup.push_back(uniqueObjPath);
+    Cleanup.push_back(uniqueObjPath);
+  }
 
   return LDPS_OK;
 }
@@ -360,6 +360,11 @@ int main(int argc, char **argv) {
                                    DisableVerify)) {
       errs() << argv[0] << ": target does not support generation of this"
              << " file type!\n";
+      if (FileType == TargetMachine::CGFT_ObjectFile &&
+          TheTriple.getOS() != Triple::Darwin &&
+          TargetMachine::getRelocationModel() == Reloc::PIC_)
+        errs() << argv[0] << ": note: ELF object files cannot be written for"
+               << " position independent code yet\n";
       if (Out != &fouts()) delete Out;
       // And the Out file is empty and useless, so remove it now.
       sys::Path(OutputFilename).eraseFromDisk();
@@ -21,6 +21,7 @@
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/ExecutionEngine/JITCodeCache.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -93,12 +94,25 @@ namespace {
   NoLazyCompilation("disable-lazy-compilation",
                   cl::desc("Disable JIT lazy compilation"),
                   cl::init(false));
+
+  cl::opt<std::string>
+  CodeCacheDir("jit-code-cache",
+               cl::desc("Reuse and save JIT'd machine code in this directory"),
+               cl::value_desc("directory"));
+
+  cl::opt<unsigned>
+  CodeCacheSizeLimit("jit-code-cache-size-limit",
+    cl::desc("Remove the least recently used entries from the code cache "
+             "when it grows beyond this many kilobytes (0 for no limit)"),
+    cl::init(1024 * 1024));
 }
 
 static ExecutionEngine *EE = 0;
+static JITCodeCache *CodeCache = 0;
 
 static void do_shutdown() {
   delete EE;
+  delete CodeCache;
   llvm_shutdown();
 }
 
@@ -185,6 +199,17 @@ int main(int argc, char **argv, char * const *envp) {
 
   EE->DisableLazyCompilation(NoLazyCompilation);
 
+  if (!CodeCacheDir.empty()) {
+    CodeCache = createFileJITCodeCache(CodeCacheDir,
+                                       uint64_t(CodeCacheSizeLimit) * 1024,
+                                       &ErrorMsg);
+    if (!CodeCache) {
+      errs() << argv[0] << ": error creating code cache: " << ErrorMsg << "\n";
+      exit(1);
+    }
+    EE->setJITCodeCache(CodeCache);
+  }
+
   // If the user specifically requested an argv[0] to pass into the program,
   // do it now.
   if (!FakeArgv0.empty()) {
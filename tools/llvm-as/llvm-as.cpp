@@ -50,6 +50,11 @@ static cl::opt<bool>
 DisableVerify("disable-verify", cl::Hidden,
               cl::desc("Do not run verifier on input LLVM (dangerous!)"));
 
+static cl::opt<unsigned>
+VerifierThreads("verifier-threads",
+                cl::desc("Number of threads to verify function bodies on"),
+                cl::init(1));
+
 static void WriteOutputFile(const Module *M) {
   // Infer the output filename if needed.
   if (OutputFilename.empty()) {
@@ -104,7 +109,7 @@ int main(int argc, char **argv) {
 
   if (!DisableVerify) {
     std::string Err;
-    if (verifyModule(*M.get(), ReturnStatusAction, &Err)) {
+    if (verifyModule(*M.get(), ReturnStatusAction, &Err, VerifierThreads)) {
       errs() << argv[0]
              << ": assembly parsed, but does not verify as correct!\n";
       errs() << Err;
@@ -41,6 +41,11 @@ Force("f", cl::desc("Enable binary output on terminals"));
 static cl::opt<bool>
 DontPrint("disable-output", cl::desc("Don't output the .ll file"), cl::Hidden);
 
+static cl::opt<unsigned>
+WriterThreads("asm-writer-threads", cl::init(1),
+              cl::desc("Number of threads to format function bodies on"),
+              cl::value_desc("N"));
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -104,7 +109,7 @@ int main(int argc, char **argv) {
 
   // All that llvm-dis does is write the assembly to a file.
   if (!DontPrint)
-    *Out << *M;
+    M->print(*Out, 0, WriterThreads);
 
   return 0;
 }
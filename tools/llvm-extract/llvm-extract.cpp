@@ -74,7 +74,7 @@ int main(int argc, char **argv) {
 
   SMDiagnostic Err;
   std::auto_ptr<Module> M;
-  M.reset(ParseIRFile(InputFilename, Err, Context));
+  M.reset(getLazyIRFileModule(InputFilename, Err, Context));
 
   if (M.get() == 0) {
     Err.Print(argv[0], errs());
@@ -105,6 +105,22 @@ int main(int argc, char **argv) {
     GVs.push_back(GV);
   }
 
+  // Only the bodies of the functions we extract have to be read in, unless we
+  // delete them and keep everything else.
+  std::string ErrorInfo;
+  if (DeleteFn) {
+    if (M->MaterializeAllPermanently(&ErrorInfo)) {
+      errs() << argv[0] << ": " << ErrorInfo << '\n';
+      return 1;
+    }
+  } else {
+    for (size_t i = 0, e = GVs.size(); i != e; ++i)
+      if (GVs[i]->Materialize(&ErrorInfo)) {
+        errs() << argv[0] << ": " << ErrorInfo << '\n';
+        return 1;
+      }
+  }
+
   // In addition to deleting all other functions, we also want to spiff it
   // up a little bit.  Do this now.
   PassManager Passes;
@@ -120,7 +136,6 @@ int main(int argc, char **argv) {
   // SIGINT
   sys::RemoveFileOnSignal(sys::Path(OutputFilename));
 
-  std::string ErrorInfo;
   raw_fd_ostream Out(OutputFilename.c_str(), ErrorInfo,
                      raw_fd_ostream::F_Binary);
   if (!ErrorInfo.empty()) {
@@ -47,6 +47,11 @@ OutputAssembly("S",
 static cl::opt<bool>
 Verbose("v", cl::desc("Print information about actions taken"));
 
+static cl::opt<unsigned>
+WriterThreads("bitcode-writer-threads", cl::init(1),
+              cl::desc("Number of threads to encode function bodies on"),
+              cl::value_desc("N"));
+
 static cl::opt<bool>
 DumpAsm("d", cl::desc("Print assembly as linked"), cl::Hidden);
 
@@ -145,7 +150,7 @@ int main(int argc, char **argv) {
   if (OutputAssembly) {
     *Out << *Composite;
   } else if (Force || !CheckBitcodeOutputToConsole(*Out, true))
-    WriteBitcodeToFile(Composite.get(), *Out);
+    WriteBitcodeToFile(Composite.get(), *Out, WriterThreads);
 
   return 0;
 }
@@ -0,0 +1,104 @@
+//===- llvm-lto.cpp - Drive the LLVM link time optimizer ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program runs bitcode files through libLTO the way a linker would, and
+// writes the native object file that libLTO returns.  It is used to test
+// libLTO without a linker plugin:
+//  llvm-lto a.bc b.bc -o x.o
+//
+// The tool links libLTO statically, so the code generator options of the
+// library (such as -integrated-as and -stats) may be given directly.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm-c/lto.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/System/Signals.h"
+using namespace llvm;
+
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::OneOrMore,
+               cl::desc("<input bitcode files>"));
+
+static cl::opt<std::string>
+OutputFilename("o", cl::desc("Output filename"), cl::init("-"),
+               cl::value_desc("filename"));
+
+static cl::opt<lto_codegen_model>
+PICModel("pic-model", cl::desc("Relocation model to generate code for:"),
+         cl::init(LTO_CODEGEN_PIC_MODEL_DYNAMIC),
+         cl::values(
+           clEnumValN(LTO_CODEGEN_PIC_MODEL_STATIC, "static",
+                      "Non-relocatable code"),
+           clEnumValN(LTO_CODEGEN_PIC_MODEL_DYNAMIC, "dynamic",
+                      "Fully relocatable, position independent code"),
+           clEnumValN(LTO_CODEGEN_PIC_MODEL_DYNAMIC_NO_PIC, "dynamic-no-pic",
+                      "Relocatable external references, non-relocatable code"),
+           clEnumValEnd));
+
+static cl::list<std::string>
+ExportedSymbols("exported-symbol",
+                cl::desc("Symbol to keep visible outside the merged module"),
+                cl::value_desc("symbol"));
+
+static cl::opt<std::string>
+CacheDir("cache-dir", cl::desc("Directory in which to keep generated code"),
+         cl::value_desc("directory"));
+
+static int Error(const char *ProgName, const std::string &Msg) {
+  errs() << ProgName << ": " << Msg << '\n';
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  // Print a stack trace if we signal out.
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  cl::ParseCommandLineOptions(argc, argv, "llvm link time optimizer\n");
+
+  lto_code_gen_t CodeGen = lto_codegen_create();
+  lto_codegen_set_pic_model(CodeGen, PICModel);
+  if (!CacheDir.empty())
+    lto_codegen_set_cache_dir(CodeGen, CacheDir.c_str());
+  for (unsigned i = 0, e = ExportedSymbols.size(); i != e; ++i)
+    lto_codegen_add_must_preserve_symbol(CodeGen, ExportedSymbols[i].c_str());
+
+  for (unsigned i = 0, e = InputFilenames.size(); i != e; ++i) {
+    lto_module_t Module = lto_module_create(InputFilenames[i].c_str());
+    if (!Module)
+      return Error(argv[0], "error loading file '" + InputFilenames[i] +
+                   "': " + lto_get_error_message());
+    bool Failed = lto_codegen_add_module(CodeGen, Module);
+    lto_module_dispose(Module);
+    if (Failed)
+      return Error(argv[0], "error linking file '" + InputFilenames[i] +
+                   "': " + lto_get_error_message());
+  }
+
+  size_t Length;
+  const void *Object = lto_codegen_compile(CodeGen, &Length);
+  if (!Object)
+    return Error(argv[0], std::string("error compiling the merged module: ") +
+                 lto_get_error_message());
+
+  std::string ErrorInfo;
+  raw_fd_ostream Out(OutputFilename.c_str(), ErrorInfo,
+                     raw_fd_ostream::F_Binary);
+  if (!ErrorInfo.empty())
+    return Error(argv[0], ErrorInfo);
+  Out.write(static_cast<const char*>(Object), Length);
+
+  lto_codegen_dispose(CodeGen);
+  return 0;
+}
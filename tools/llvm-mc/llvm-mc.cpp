@@ -293,6 +293,13 @@ static int AssembleInput(const char *ProgName) {
   } else {
     assert(FileType == OFT_ObjectFile && "Invalid file type!");
     CE.reset(TheTarget->createCodeEmitter(*TM, Ctx));
+    // FIXME: The parser only creates Mach-O sections, so only Darwin targets
+    // can be assembled to an object file.
+    if (Triple(TripleName).getOS() != Triple::Darwin) {
+      errs() << ProgName
+             << ": error: object file emission requires a Darwin target.\n";
+      return 1;
+    }
     TAB.reset(TheTarget->createAsmBackend(TripleName));
     Str.reset(createMachOStreamer(Ctx, *TAB, *Out, CE.get()));
   }
@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "lto"
 #include "LTOModule.h"
 #include "LTOCodeGenerator.h"
 
@@ -21,6 +22,8 @@
 #include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
 #include "llvm/PassManager.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/Passes.h"
@@ -37,26 +40,47 @@
 #include "llvm/Target/TargetRegistry.h"
 #include "llvm/Target/TargetSelect.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PartitionModule.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/StandardPasses.h"
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/System/Host.h"
 #include "llvm/System/Program.h"
 #include "llvm/System/Signals.h"
+#include "llvm/System/Threading.h"
 #include "llvm/Config/config.h"
+#include <algorithm>
 #include <cstdlib>
+#include <set>
 #include <unistd.h>
 #include <fcntl.h>
 
 
 using namespace llvm;
 
+STATISTIC(NumObjectsEmitted, "Number of object files emitted in memory");
+STATISTIC(NumObjectsAssembled,
+          "Number of object files built by the external assembler");
+STATISTIC(NumCacheHits, "Number of object files found in the cache");
+STATISTIC(NumCacheMisses, "Number of object files not found in the cache");
+STATISTIC(NumCachePruned, "Number of cache entries removed to limit its size");
+
 static cl::opt<bool> DisableInline("disable-inlining",
   cl::desc("Do not run the inliner pass"));
 
+static cl::opt<bool> IntegratedAssembler("integrated-as",
+  cl::desc("Emit the object file in memory with the MC object writer "
+           "instead of running an external assembler"));
+
+static cl::opt<unsigned> CacheSizeLimit("lto-cache-size-limit",
+  cl::desc("Remove the least recently used entries from the cache directory "
+           "when it grows beyond this many kilobytes (0 for no limit)"),
+  cl::init(1024 * 1024));
+
 
 const char* LTOCodeGenerator::getVersionString()
 {
@@ -83,6 +107,7 @@ LTOCodeGenerator::~LTOCodeGenerator()
 {
     delete _target;
     delete _nativeObjectFile;
+    this->clearPartitionObjects();
 }
 
 
@@ -130,6 +155,14 @@ void LTOCodeGenerator::setAssemblerPath(const char* path)
     _assemblerPath = new sys::Path(path);
 }
 
+/// setCacheDirectory - Keep the native code generated for the merged module,
+/// or for each of its partitions, in 'path', and reuse it when the same
+/// optimized code is generated again by a later link.
+void LTOCodeGenerator::setCacheDirectory(const char* path)
+{
+    _cacheDir = path ? path : "";
+}
+
 void LTOCodeGenerator::addMustPreserveSymbol(const char* sym)
 {
     _mustPreserveSymbols[sym] = 1;
@@ -169,6 +202,169 @@ bool LTOCodeGenerator::writeMergedModules(const char *path,
 
 const void* LTOCodeGenerator::compile(size_t* length, std::string& errMsg)
 {
+    // if options were requested, set them
+    if ( !_codegenOptions.empty() )
+        cl::ParseCommandLineOptions(_codegenOptions.size(), 
+                                                (char**)&_codegenOptions[0]);
+
+    if ( this->optimize(errMsg) )
+        return NULL;
+
+    MemoryBuffer* objFile = this->compileModuleCached(_linker.getModule(),
+                                                      _target, errMsg);
+    if ( objFile == NULL )
+        return NULL;
+
+    // remove old buffer if compile() called twice
+    delete _nativeObjectFile;
+    _nativeObjectFile = objFile;
+    *length = _nativeObjectFile->getBufferSize();
+    return _nativeObjectFile->getBufferStart();
+}
+
+
+namespace {
+  /// PartitionCompiler - The state shared by the threads that compile the
+  /// partitions of the merged module.  Each partition is read from the bitcode
+  /// of the whole module into its own LLVMContext, so that the threads don't
+  /// share any IR.
+  struct PartitionCompiler {
+    LTOCodeGenerator*           CodeGen;
+    const Target*               March;
+    std::string                 Triple;
+    std::string                 Features;
+    std::string                 Bitcode;
+    std::vector<unsigned>       Assignment;
+    std::vector<MemoryBuffer*>  Objects;
+    std::vector<std::string>    Errors;
+  };
+}
+
+void LTOCodeGenerator::compilePartitionOnThread(void* arg, unsigned partition)
+{
+    PartitionCompiler& PC = *static_cast<PartitionCompiler*>(arg);
+    std::string& errMsg = PC.Errors[partition];
+
+    LLVMContext context;
+    // c_str() is null-terminated like MemoryBuffer::getMemBuffer requires.
+    MemoryBuffer* buffer =
+      MemoryBuffer::getMemBuffer(PC.Bitcode.c_str(),
+                                 PC.Bitcode.c_str() + PC.Bitcode.size(),
+                                 "ld-temp.o");
+    OwningPtr<Module> module(ParseBitcodeFile(buffer, context, &errMsg));
+    delete buffer;
+    if ( !module )
+        return;
+    ExtractPartition(module.get(), PC.Assignment, partition);
+
+    OwningPtr<TargetMachine> target(PC.March->createTargetMachine(PC.Triple,
+                                                                  PC.Features));
+    PC.Objects[partition] = PC.CodeGen->compileModuleCached(module.get(),
+                                                            target.get(),
+                                                            errMsg);
+}
+
+/// compilePartitions - Optimize the merged module, then split it into at most
+/// 'count' partitions and generate code for them in parallel, one native
+/// object file per partition.
+unsigned LTOCodeGenerator::compilePartitions(unsigned count,
+                                             std::string& errMsg)
+{
+    // if options were requested, set them
+    if ( !_codegenOptions.empty() )
+        cl::ParseCommandLineOptions(_codegenOptions.size(), 
+                                                (char**)&_codegenOptions[0]);
+
+    if ( this->optimize(errMsg) )
+        return 0;
+
+    if ( count == 0 )
+        count = 1;
+
+    Module* mergedModule = _linker.getModule();
+    PartitionCompiler PC;
+    PC.CodeGen = this;
+    PC.March = &_target->getTarget();
+    PC.Triple = getTargetTriple();
+    PC.Features =
+      SubtargetFeatures::getDefaultSubtargetFeatures(llvm::Triple(PC.Triple));
+    count = PartitionModule(mergedModule, count, PC.Assignment);
+    {
+      raw_string_ostream bitcodeOS(PC.Bitcode);
+      WriteBitcodeToFile(mergedModule, bitcodeOS, count);
+    }
+    PC.Objects.resize(count);
+    PC.Errors.resize(count);
+
+    if ( count > 1 && !llvm_is_multithreaded() )
+        llvm_start_multithreaded();
+    llvm_execute_on_threads(compilePartitionOnThread, &PC, count);
+
+    // remove old buffers if compilePartitions() called twice
+    this->clearPartitionObjects();
+    for (unsigned i = 0; i != count; ++i) {
+        if ( PC.Objects[i] == NULL ) {
+            if ( errMsg.empty() )
+                errMsg = PC.Errors[i];
+            delete PC.Objects[i];
+            continue;
+        }
+        _partitionObjects.push_back(PC.Objects[i]);
+    }
+    if ( _partitionObjects.size() != count ) {
+        this->clearPartitionObjects();
+        return 0;
+    }
+    return count;
+}
+
+const void* LTOCodeGenerator::getPartitionObject(unsigned index,
+                                                 size_t* length)
+{
+    if ( index >= _partitionObjects.size() )
+        return NULL;
+    *length = _partitionObjects[index]->getBufferSize();
+    return _partitionObjects[index]->getBufferStart();
+}
+
+void LTOCodeGenerator::clearPartitionObjects()
+{
+    for (unsigned i = 0, e = _partitionObjects.size(); i != e; ++i)
+        delete _partitionObjects[i];
+    _partitionObjects.clear();
+}
+
+
+/// compileModule - Generate code for 'module' with 'target' and return the
+/// native object file.  With -integrated-as the object is produced in memory
+/// by the MC object writer; otherwise assembly is written to a temporary .s
+/// file and handed to the assembler.
+MemoryBuffer* LTOCodeGenerator::compileModule(Module* module,
+                                              TargetMachine* target,
+                                              std::string& errMsg)
+{
+    if ( IntegratedAssembler ) {
+        SmallVector<char, 0> objBuffer;
+        bool genResult;
+        {
+          raw_svector_ostream objOS(objBuffer);
+          formatted_raw_ostream objFile(objOS);
+          genResult = this->generateCode(module, target, objFile,
+                                         TargetMachine::CGFT_ObjectFile,
+                                         errMsg);
+        }
+        if ( !genResult ) {
+            ++NumObjectsEmitted;
+            return MemoryBuffer::getMemBufferCopy(objBuffer.begin(),
+                                                  objBuffer.end(),
+                                                  "lto-llvm.o");
+        }
+        // The object writers do not handle every relocation model yet (ELF
+        // has no GOT or PLT relocations, for instance), and the target says
+        // so before emitting anything.  Use the assembler instead.
+        errMsg.clear();
+    }
+
     // make unique temp .s file to put generated assembly code
     sys::Path uniqueAsmPath("lto-llvm.s");
     if ( uniqueAsmPath.createTemporaryFileOnDisk(true, &errMsg) )
@@ -182,7 +378,8 @@ const void* LTOCodeGenerator::compile(size_t* length, std::string& errMsg)
       formatted_raw_ostream asmFile(asmFD);
       if (!errMsg.empty())
         return NULL;
-      genResult = this->generateAssemblyCode(asmFile, errMsg);
+      genResult = this->generateCode(module, target, asmFile,
+                                     TargetMachine::CGFT_AssemblyFile, errMsg);
     }
     if ( genResult ) {
         if ( uniqueAsmPath.exists() )
@@ -200,25 +397,216 @@ const void* LTOCodeGenerator::compile(size_t* length, std::string& errMsg)
     sys::RemoveFileOnSignal(uniqueObjPath);
 
     // assemble the assembly code
+    MemoryBuffer* objFile = NULL;
     const std::string& uniqueObjStr = uniqueObjPath.str();
     bool asmResult = this->assemble(uniqueAsmPath.str(), uniqueObjStr, errMsg);
     if ( !asmResult ) {
-        // remove old buffer if compile() called twice
-        delete _nativeObjectFile;
-        
         // read .o file into memory buffer
-        _nativeObjectFile = MemoryBuffer::getFile(uniqueObjStr.c_str(),&errMsg);
+        objFile = MemoryBuffer::getFile(uniqueObjStr.c_str(), &errMsg);
+        ++NumObjectsAssembled;
     }
 
     // remove temp files
     uniqueAsmPath.eraseFromDisk();
     uniqueObjPath.eraseFromDisk();
 
-    // return buffer, unless error
-    if ( _nativeObjectFile == NULL )
+    return objFile;
+}
+
+
+static const char CacheFileMagic[] = "LLVMLTOC";
+static const unsigned CacheFileMagicSize = sizeof(CacheFileMagic) - 1;
+static const char CacheFileSuffix[] = ".lto.o";
+
+namespace {
+  /// HashingStream - A raw_ostream that feeds what is written to it into a
+  /// SHA-1 digest instead of keeping it.
+  class HashingStream : public raw_ostream {
+    SHA1&     Hash;
+    uint64_t  Pos;
+
+    virtual void write_impl(const char* ptr, size_t size) {
+        Hash.update(StringRef(ptr, size));
+        Pos += size;
+    }
+    virtual uint64_t current_pos() const { return Pos; }
+  public:
+    explicit HashingStream(SHA1& hash) : Hash(hash), Pos(0) {}
+    ~HashingStream() { flush(); }
+  };
+}
+
+/// getCachePath - Return the file in 'dir' that holds the object for the
+/// key with the given digest.
+static sys::Path getCachePath(const std::string& dir, StringRef digest)
+{
+    std::string name;
+    for (unsigned i = 0, e = digest.size(); i != e; ++i) {
+        unsigned char c = digest[i];
+        name += hexdigit(c >> 4);
+        name += hexdigit(c & 15);
+    }
+    name += CacheFileSuffix;
+
+    sys::Path path(dir);
+    path.appendComponent(name);
+    return path;
+}
+
+/// getCacheKey - Return the SHA-1 digest of what determines the native code
+/// generated for 'module': the target and code generator options, followed
+/// by the bitcode of the module.  Since the module has already been
+/// optimized, the bitcode covers everything it imports from other modules,
+/// such as inlined function bodies and the declarations it refers to.
+std::string LTOCodeGenerator::getCacheKey(Module* module)
+{
+    SHA1 hash;
+    {
+        HashingStream keyOS(hash);
+        keyOS << "libLTO " PACKAGE_VERSION "\n";
+        keyOS << module->getTargetTriple() << '\n';
+        keyOS << _codeModel << ' ' << TargetMachine::getRelocationModel() << ' '
+              << IntegratedAssembler << '\n';
+        if ( _assemblerPath )
+            keyOS << _assemblerPath->str();
+        keyOS << '\n';
+        for (unsigned i = 0, e = _codegenOptions.size(); i != e; ++i) {
+            // The size limit does not change the generated code.
+            if ( StringRef(_codegenOptions[i]).startswith(
+                   "-lto-cache-size-limit") )
+                continue;
+            keyOS << _codegenOptions[i] << '\n';
+        }
+        keyOS << '\n';
+        WriteBitcodeToFile(module, keyOS);
+    }
+    return hash.final();
+}
+
+namespace {
+  /// CacheEntry - A file in the cache directory, for pruning.
+  struct CacheEntry {
+    sys::TimeValue  ModTime;
+    uint64_t        Size;
+    sys::Path       Path;
+
+    CacheEntry(const sys::FileStatus& status, const sys::Path& path)
+      : ModTime(status.getTimestamp()), Size(status.getSize()), Path(path) {}
+
+    bool operator<(const CacheEntry& other) const {
+        return ModTime < other.ModTime;
+    }
+  };
+}
+
+/// pruneCache - Remove the least recently used entries from the cache
+/// directory 'dir' until it is within -lto-cache-size-limit, but never the
+/// entry 'keep' that was just added.
+static void pruneCache(const sys::Path& dir, const sys::Path& keep)
+{
+    if ( CacheSizeLimit == 0 )
+        return;
+
+    std::set<sys::Path> contents;
+    if ( dir.getDirectoryContents(contents, NULL) )
+        return;
+
+    std::vector<CacheEntry> entries;
+    uint64_t totalSize = 0;
+    for (std::set<sys::Path>::iterator it = contents.begin(),
+         e = contents.end(); it != e; ++it) {
+        if ( !StringRef(it->str()).endswith(CacheFileSuffix) )
+            continue;
+        sys::PathWithStatus path(*it);
+        const sys::FileStatus* status = path.getFileStatus(false, NULL);
+        if ( status == NULL || status->isDir )
+            continue;
+        entries.push_back(CacheEntry(*status, *it));
+        totalSize += status->getSize();
+    }
+
+    uint64_t limit = uint64_t(CacheSizeLimit) * 1024;
+    std::sort(entries.begin(), entries.end());
+    for (unsigned i = 0, e = entries.size(); i != e && totalSize > limit; ++i) {
+        if ( entries[i].Path == keep )
+            continue;
+        // Another link may have removed it already; that is fine too.
+        entries[i].Path.eraseFromDisk();
+        totalSize -= entries[i].Size;
+        ++NumCachePruned;
+    }
+}
+
+/// compileModuleCached - Like compileModule, but first look for the object
+/// file in the cache directory, and store it there after generating it.
+/// An entry holds the digest of its key in front of the object, and is used
+/// only when the whole digest matches.  Problems with the cache are not
+/// errors; they just mean that the code has to be generated.
+MemoryBuffer* LTOCodeGenerator::compileModuleCached(Module* module,
+                                                    TargetMachine* target,
+                                                    std::string& errMsg)
+{
+    if ( _cacheDir.empty() )
+        return this->compileModule(module, target, errMsg);
+
+    std::string digest = this->getCacheKey(module);
+    sys::PathWithStatus cachePath(getCachePath(_cacheDir, digest));
+
+    // look for an entry with the same key
+    OwningPtr<MemoryBuffer> entry(MemoryBuffer::getFile(cachePath.c_str()));
+    unsigned headerSize = CacheFileMagicSize + SHA1::DigestSize;
+    if ( entry && entry->getBufferSize() >= headerSize ) {
+        StringRef contents = entry->getBuffer();
+        if ( contents.startswith(StringRef(CacheFileMagic,
+                                           CacheFileMagicSize)) &&
+             contents.substr(CacheFileMagicSize, SHA1::DigestSize) == digest ) {
+            ++NumCacheHits;
+            // Mark the entry as recently used, for pruning.
+            if ( const sys::FileStatus* status =
+                   cachePath.getFileStatus(false, NULL) ) {
+                // setStatusInfoOnDisk mishandles fractions of a second, so
+                // leave them out.
+                sys::FileStatus used = *status;
+                used.modTime = sys::TimeValue(sys::TimeValue::now().seconds());
+                cachePath.setStatusInfoOnDisk(used, NULL);
+            }
+            StringRef obj = contents.substr(headerSize);
+            return MemoryBuffer::getMemBufferCopy(obj.begin(), obj.end(),
+                                                  "lto-llvm.o");
+        }
+    }
+    ++NumCacheMisses;
+
+    MemoryBuffer* objFile = this->compileModule(module, target, errMsg);
+    if ( objFile == NULL )
         return NULL;
-    *length = _nativeObjectFile->getBufferSize();
-    return _nativeObjectFile->getBufferStart();
+
+    // Write the new entry to a temporary file and rename it into place, so
+    // that concurrent links never see a partially written entry.
+    sys::Path dir(_cacheDir);
+    sys::Path tmpPath(cachePath);
+    if ( (!dir.exists() && dir.createDirectoryOnDisk(true))
+         || tmpPath.createTemporaryFileOnDisk() )
+        return objFile;
+    {
+        std::string ignored;
+        raw_fd_ostream out(tmpPath.c_str(), ignored, raw_fd_ostream::F_Binary);
+        if ( ignored.empty() ) {
+            out << StringRef(CacheFileMagic, CacheFileMagicSize);
+            out << digest << objFile->getBuffer();
+            out.close();
+            if ( out.has_error() ) {
+                out.clear_error();
+                ignored = "write error";
+            }
+        }
+        if ( !ignored.empty() || tmpPath.renamePathOnDisk(cachePath, 0) ) {
+            tmpPath.eraseFromDisk();
+            return objFile;
+        }
+    }
+    pruneCache(dir, cachePath);
+    return objFile;
 }
 
 
@@ -277,12 +665,18 @@ bool LTOCodeGenerator::assemble(const std::string& asmPath,
 
 
 
+std::string LTOCodeGenerator::getTargetTriple()
+{
+    std::string Triple = _linker.getModule()->getTargetTriple();
+    if (Triple.empty())
+      Triple = sys::getHostTriple();
+    return Triple;
+}
+
 bool LTOCodeGenerator::determineTarget(std::string& errMsg)
 {
     if ( _target == NULL ) {
-        std::string Triple = _linker.getModule()->getTargetTriple();
-        if (Triple.empty())
-          Triple = sys::getHostTriple();
+        std::string Triple = getTargetTriple();
 
         // create target machine from info for merged modules
         const Target *march = TargetRegistry::lookupTarget(Triple, errMsg);
@@ -345,9 +739,8 @@ void LTOCodeGenerator::applyScopeRestrictions() {
   _scopeRestrictionsDone = true;
 }
 
-/// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateAssemblyCode(formatted_raw_ostream& out,
-                                            std::string& errMsg)
+/// Optimize merged modules using various IPO passes.
+bool LTOCodeGenerator::optimize(std::string& errMsg)
 {
     if ( this->determineTarget(errMsg) ) 
         return true;
@@ -371,11 +764,6 @@ bool LTOCodeGenerator::generateAssemblyCode(formatted_raw_ostream& out,
       assert (0 && "Unknown exception handling model!");
     }
 
-    // if options were requested, set them
-    if ( !_codegenOptions.empty() )
-        cl::ParseCommandLineOptions(_codegenOptions.size(), 
-                                                (char**)&_codegenOptions[0]);
-
     // Instantiate the pass manager to organize the passes.
     PassManager passes;
 
@@ -391,29 +779,43 @@ bool LTOCodeGenerator::generateAssemblyCode(formatted_raw_ostream& out,
     // Make sure everything is still good.
     passes.add(createVerifierPass());
 
-    FunctionPassManager* codeGenPasses = new FunctionPassManager(mergedModule);
+    // Run our queue of passes all at once now, efficiently.
+    passes.run(*mergedModule);
+
+    return false; // success
+}
+
+/// Emit 'module' to 'out' as either an assembly file or a native object file,
+/// using 'target'.  This only reads the state of the LTOCodeGenerator, so it
+/// may run on several threads at once for different modules and targets.
+bool LTOCodeGenerator::generateCode(Module* module, TargetMachine* target,
+                                    formatted_raw_ostream& out,
+                                    TargetMachine::CodeGenFileType fileType,
+                                    std::string& errMsg)
+{
+    FunctionPassManager* codeGenPasses = new FunctionPassManager(module);
 
-    codeGenPasses->add(new TargetData(*_target->getTargetData()));
+    codeGenPasses->add(new TargetData(*target->getTargetData()));
 
-    if (_target->addPassesToEmitFile(*codeGenPasses, out,
-                                     TargetMachine::CGFT_AssemblyFile,
-                                     CodeGenOpt::Aggressive)) {
-      errMsg = "target file type not supported";
+    if (target->addPassesToEmitFile(*codeGenPasses, out, fileType,
+                                    CodeGenOpt::Aggressive)) {
+      errMsg = fileType == TargetMachine::CGFT_ObjectFile ?
+        "target does not support direct object file emission" :
+        "target file type not supported";
+      delete codeGenPasses;
       return true;
     }
 
-    // Run our queue of passes all at once now, efficiently.
-    passes.run(*mergedModule);
-
-    // Run the code generator, and write assembly file
+    // Run the code generator, and write the output file
     codeGenPasses->doInitialization();
 
     for (Module::iterator
-           it = mergedModule->begin(), e = mergedModule->end(); it != e; ++it)
+           it = module->begin(), e = module->end(); it != e; ++it)
       if (!it->isDeclaration())
         codeGenPasses->run(*it);
 
     codeGenPasses->doFinalization();
+    delete codeGenPasses;
 
     return false; // success
 }
@@ -19,8 +19,10 @@
 #include "llvm/LLVMContext.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Target/TargetMachine.h"
 
 #include <string>
+#include <vector>
 
 
 //
@@ -37,14 +39,31 @@ struct LTOCodeGenerator {
     bool                setDebugInfo(lto_debug_model, std::string& errMsg);
     bool                setCodePICModel(lto_codegen_model, std::string& errMsg);
     void                setAssemblerPath(const char* path);
+    void                setCacheDirectory(const char* path);
     void                addMustPreserveSymbol(const char* sym);
     bool                writeMergedModules(const char* path, 
                                                            std::string& errMsg);
     const void*         compile(size_t* length, std::string& errMsg);
+    unsigned            compilePartitions(unsigned count, std::string& errMsg);
+    const void*         getPartitionObject(unsigned index, size_t* length);
     void                setCodeGenDebugOptions(const char *opts); 
 private:
-    bool                generateAssemblyCode(llvm::formatted_raw_ostream& out, 
-                                             std::string& errMsg);
+    bool                optimize(std::string& errMsg);
+    bool                generateCode(llvm::Module* module,
+                                 llvm::TargetMachine* target,
+                                 llvm::formatted_raw_ostream& out,
+                                 llvm::TargetMachine::CodeGenFileType fileType,
+                                 std::string& errMsg);
+    llvm::MemoryBuffer* compileModule(llvm::Module* module,
+                                      llvm::TargetMachine* target,
+                                      std::string& errMsg);
+    llvm::MemoryBuffer* compileModuleCached(llvm::Module* module,
+                                            llvm::TargetMachine* target,
+                                            std::string& errMsg);
+    std::string         getCacheKey(llvm::Module* module);
+    static void         compilePartitionOnThread(void* arg, unsigned partition);
+    void                clearPartitionObjects();
+    std::string         getTargetTriple();
     bool                assemble(const std::string& asmPath, 
                             const std::string& objPath, std::string& errMsg);
     void                applyScopeRestrictions();
@@ -60,8 +79,10 @@ private:
     lto_codegen_model           _codeModel;
     StringSet                   _mustPreserveSymbols;
     llvm::MemoryBuffer*         _nativeObjectFile;
+    std::vector<llvm::MemoryBuffer*> _partitionObjects;
     std::vector<const char*>    _codegenOptions;
     llvm::sys::Path*            _assemblerPath;
+    std::string                 _cacheDir;
 };
 
 #endif // LTO_CODE_GENERATOR_H
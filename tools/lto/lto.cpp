@@ -210,6 +210,14 @@ void lto_codegen_set_assembler_path(lto_code_gen_t cg, const char* path)
     cg->setAssemblerPath(path);
 }
 
+//
+// sets the directory in which generated native code is cached
+//
+void lto_codegen_set_cache_dir(lto_code_gen_t cg, const char* path)
+{
+    cg->setCacheDirectory(path);
+}
+
 //
 // adds to a list of all global symbols that must exist in the final
 // generated code.  If a function is not listed there, it might be
@@ -247,6 +255,30 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length)
 }
 
 
+//
+// Generates code for all added modules into up to 'count' native object
+// files, generated in parallel.  Returns the number of objects generated.
+// On failure, returns 0 (check lto_get_error_message() for details).
+//
+extern unsigned int
+lto_codegen_compile_partitions(lto_code_gen_t cg, unsigned int count)
+{
+  return cg->compilePartitions(count, sLastErrorString);
+}
+
+
+//
+// Returns the index'th native object file generated by the last call to
+// lto_codegen_compile_partitions(), or NULL if there is no such object.
+//
+extern const void*
+lto_codegen_get_partition_object(lto_code_gen_t cg, unsigned int index,
+                                 size_t* length)
+{
+  return cg->getPartitionObject(index, length);
+}
+
+
 //
 // Used to pass extra options to the code generator
 //
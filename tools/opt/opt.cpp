@@ -12,8 +12,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/DerivedTypes.h"
+#include "llvm/IRArena.h"
 #include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
+#include "llvm/TypeSymbolTable.h"
 #include "llvm/PassManager.h"
 #include "llvm/CallGraphSCCPass.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -21,11 +24,15 @@
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/Analysis/LoopPass.h"
 #include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/FindUsedTypes.h"
 #include "llvm/Target/TargetData.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Support/PassNameParser.h"
+#include "llvm/System/Atomic.h"
 #include "llvm/System/Signals.h"
+#include "llvm/System/Threading.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/IRReader.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -34,10 +41,13 @@
 #include "llvm/Support/StandardPasses.h"
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/LinkAllPasses.h"
 #include "llvm/LinkAllVMCore.h"
 #include <memory>
 #include <algorithm>
+#include <set>
 using namespace llvm;
 
 // The OptimizationList is automatically populated with registered Passes by the
@@ -75,6 +85,10 @@ NoVerify("disable-verify", cl::desc("Do not verify result module"), cl::Hidden);
 static cl::opt<bool>
 VerifyEach("verify-each", cl::desc("Verify after each transform"));
 
+static cl::opt<bool>
+UseIRArena("ir-arena", cl::Hidden,
+           cl::desc("Allocate the instructions of the input from an IRArena"));
+
 static cl::opt<bool>
 StripDebug("strip-debug",
            cl::desc("Strip debugger symbol info from translation unit"));
@@ -128,6 +142,10 @@ QuietA("quiet", cl::desc("Alias for -q"), cl::aliasopt(Quiet));
 static cl::opt<bool>
 AnalyzeOnly("analyze", cl::desc("Only perform analysis, no optimization"));
 
+static cl::opt<unsigned>
+NumThreads("j", cl::desc("Run function passes on this many threads"),
+           cl::value_desc("N"), cl::init(1));
+
 static cl::opt<std::string>
 DefaultDataLayout("default-data-layout", 
           cl::desc("data layout string to use if not specified by module"),
@@ -270,12 +288,13 @@ struct BasicBlockPassPrinter : public BasicBlockPass {
 };
 
 char BasicBlockPassPrinter::ID = 0;
-inline void addPass(PassManager &PM, Pass *P) {
+inline void addPass(PassManagerBase &PM, Pass *P) {
   // Add the pass to the pass manager...
   PM.add(P);
 
   // If we are verifying all of the intermediate steps, add the verifier...
-  if (VerifyEach) PM.add(createVerifierPass());
+  // Only the functions the pass modified need to be checked again.
+  if (VerifyEach) PM.add(createIncrementalVerifierPass());
 }
 
 /// AddOptimizationPasses - This routine adds optimization passes
@@ -283,7 +302,7 @@ inline void addPass(PassManager &PM, Pass *P) {
 /// duplicates llvm-gcc behaviour.
 ///
 /// OptLevel - Optimization Level
-void AddOptimizationPasses(PassManager &MPM, FunctionPassManager &FPM,
+void AddOptimizationPasses(PassManagerBase &MPM, PassManagerBase &FPM,
                            unsigned OptLevel) {
   createStandardFunctionPasses(&FPM, OptLevel);
 
@@ -307,7 +326,7 @@ void AddOptimizationPasses(PassManager &MPM, FunctionPassManager &FPM,
                              InliningPass);
 }
 
-void AddStandardCompilePasses(PassManager &PM) {
+void AddStandardCompilePasses(PassManagerBase &PM) {
   PM.add(createVerifierPass());                  // Verify that input is correct
 
   addPass(PM, createLowerSetJmpPass());          // Lower llvm.setjmp/.longjmp
@@ -330,7 +349,7 @@ void AddStandardCompilePasses(PassManager &PM) {
                              InliningPass);
 }
 
-void AddStandardLinkPasses(PassManager &PM) {
+void AddStandardLinkPasses(PassManagerBase &PM) {
   PM.add(createVerifierPass());                  // Verify that input is correct
 
   // If the -strip-debug command line option was specified, do it.
@@ -344,6 +363,537 @@ void AddStandardLinkPasses(PassManager &PM) {
                           /*VerifyEach=*/ VerifyEach);
 }
 
+/// AddPassesFromCommandLine - Add the passes requested on the command line to
+/// Passes, in command line order, and the function passes of the -O options
+/// to FPasses, which may only be null if there are no -O options.  With -j the
+/// pipeline is built once for each thread, so this leaves the options alone.
+/// ProgName is used to report passes that cannot be created, if it is not
+/// null.
+void AddPassesFromCommandLine(PassManagerBase &Passes,
+                              PassManagerBase *FPasses,
+                              const char *ProgName) {
+  bool AddCompileOpts = StandardCompileOpts;
+  bool AddLinkOpts = StandardLinkOpts;
+  bool AddO1 = OptLevelO1, AddO2 = OptLevelO2, AddO3 = OptLevelO3;
+
+  // If the -strip-debug command line option was specified, add it.  If
+  // -std-compile-opts was also specified, it will handle StripDebug.
+  if (StripDebug && !StandardCompileOpts)
+    addPass(Passes, createStripSymbolsPass(true));
+
+  // Create a new optimization pass for each one specified on the command line
+  for (unsigned i = 0; i < PassList.size(); ++i) {
+    // Check to see if -std-compile-opts was specified before this option.  If
+    // so, handle it.
+    if (AddCompileOpts &&
+        StandardCompileOpts.getPosition() < PassList.getPosition(i)) {
+      AddStandardCompilePasses(Passes);
+      AddCompileOpts = false;
+    }
+
+    if (AddLinkOpts &&
+        StandardLinkOpts.getPosition() < PassList.getPosition(i)) {
+      AddStandardLinkPasses(Passes);
+      AddLinkOpts = false;
+    }
+
+    if (AddO1 && OptLevelO1.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 1);
+      AddO1 = false;
+    }
+
+    if (AddO2 && OptLevelO2.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 2);
+      AddO2 = false;
+    }
+
+    if (AddO3 && OptLevelO3.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 3);
+      AddO3 = false;
+    }
+
+    const PassInfo *PassInf = PassList[i];
+    Pass *P = 0;
+    if (PassInf->getNormalCtor())
+      P = PassInf->getNormalCtor()();
+    else if (ProgName)
+      errs() << ProgName << ": cannot create pass: "
+             << PassInf->getPassName() << "\n";
+    if (P) {
+      PassKind Kind = P->getPassKind();
+      addPass(Passes, P);
+
+      if (AnalyzeOnly) {
+        switch (Kind) {
+        case PT_BasicBlock:
+          Passes.add(new BasicBlockPassPrinter(PassInf));
+          break;
+        case PT_Loop:
+          Passes.add(new LoopPassPrinter(PassInf));
+          break;
+        case PT_Function:
+          Passes.add(new FunctionPassPrinter(PassInf));
+          break;
+        case PT_CallGraphSCC:
+          Passes.add(new CallGraphSCCPassPrinter(PassInf));
+          break;
+        default:
+          Passes.add(new ModulePassPrinter(PassInf));
+          break;
+        }
+      }
+    }
+
+    if (PrintEachXForm)
+      Passes.add(createPrintModulePass(&errs()));
+  }
+
+  // If -std-compile-opts was specified at the end of the pass list, add them.
+  if (AddCompileOpts)
+    AddStandardCompilePasses(Passes);
+
+  if (AddLinkOpts)
+    AddStandardLinkPasses(Passes);
+
+  if (AddO1)
+    AddOptimizationPasses(Passes, *FPasses, 1);
+
+  if (AddO2)
+    AddOptimizationPasses(Passes, *FPasses, 2);
+
+  if (AddO3)
+    AddOptimizationPasses(Passes, *FPasses, 3);
+}
+
+//===----------------------------------------------------------------------===//
+// Running function passes on several threads (-j)
+//
+// Nothing that lives in an LLVMContext (types, constants, metadata, value
+// handles, use lists) may be touched by two threads at once, and function
+// passes touch all of them.  So each thread gets its own context, its own copy
+// of the module read from bitcode, and its own copy of the passes.  The
+// threads claim function definitions one at a time and run the passes on
+// them, then send the optimized bodies back as bitcode, which are spliced into
+// the original module in place of the old ones.
+
+/// PassRecorder - A pass manager that just remembers the passes added to it,
+/// so that they can be scheduled by hand.  It deletes the passes it still
+/// holds when it is destroyed.
+class PassRecorder : public PassManagerBase {
+public:
+  std::vector<Pass*> Passes;
+
+  ~PassRecorder() {
+    for (unsigned i = 0, e = Passes.size(); i != e; ++i)
+      delete Passes[i];
+  }
+
+  virtual void add(Pass *P) { Passes.push_back(P); }
+};
+
+/// PipelineCopy - One copy of the passes from the command line.
+struct PipelineCopy {
+  PassRecorder Passes;
+  PassRecorder FPasses;
+};
+
+/// ModuleGlobals - The global values of a module by kind, in module order.
+struct ModuleGlobals {
+  std::vector<GlobalValue*> Variables, Functions, Aliases;
+
+  explicit ModuleGlobals(Module &M) {
+    for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+         I != E; ++I)
+      Variables.push_back(I);
+    for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+      Functions.push_back(I);
+    for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+         I != E; ++I)
+      Aliases.push_back(I);
+  }
+};
+
+/// ParallelFunctionStage - Runs a range of the function passes of the
+/// pipeline over all functions of the module, on one thread per pipeline copy.
+class ParallelFunctionStage : public ModulePass {
+  std::vector<PipelineCopy*> &Copies;
+  bool InFPasses;
+  unsigned Begin, End;
+  std::vector<const PassInfo*> Immutables;
+  std::string DataLayout;
+
+  void mergeThreadResult(Module &M, const std::string &Bitcode,
+                         const std::vector<unsigned> &Claimed,
+                         bool UpdateDeclarations,
+                         const ModuleGlobals &Globals);
+public:
+  static char ID;
+  ParallelFunctionStage(std::vector<PipelineCopy*> &copies, bool inFPasses,
+                        unsigned begin, unsigned end,
+                        const std::vector<const PassInfo*> &immutables,
+                        const TargetData *TD)
+    : ModulePass(&ID), Copies(copies), InFPasses(inFPasses), Begin(begin),
+      End(end), Immutables(immutables),
+      DataLayout(TD ? TD->getStringRepresentation() : "") {}
+
+  /// addPasses - Move this stage's passes from the given copy of the pipeline
+  /// to FPM, along with the analyses they may use.
+  void addPasses(FunctionPassManager &FPM, unsigned Copy);
+
+  virtual bool runOnModule(Module &M);
+
+  virtual const char *getPassName() const {
+    return "Parallel Function Pass Stage";
+  }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<FindUsedTypes>();
+  }
+};
+
+char ParallelFunctionStage::ID = 0;
+
+/// StageWork - What the threads running a ParallelFunctionStage share.
+struct StageWork {
+  ParallelFunctionStage *Stage;
+  const std::string *Bitcode;
+  volatile sys::cas_flag NextFunction;
+  std::vector<std::string> Results;
+  std::vector<std::vector<unsigned> > Claimed;
+  std::vector<std::string> Errors;
+
+  StageWork(ParallelFunctionStage *stage, const std::string *bitcode,
+            unsigned NumThreads)
+    : Stage(stage), Bitcode(bitcode), NextFunction(0), Results(NumThreads),
+      Claimed(NumThreads), Errors(NumThreads) {}
+};
+
+void ParallelFunctionStage::addPasses(FunctionPassManager &FPM,
+                                      unsigned Copy) {
+  if (!DataLayout.empty())
+    FPM.add(new TargetData(DataLayout));
+  for (unsigned i = 0, e = Immutables.size(); i != e; ++i)
+    FPM.add(Immutables[i]->getNormalCtor()());
+
+  PassRecorder &Recorder = InFPasses ? Copies[Copy]->FPasses
+                                     : Copies[Copy]->Passes;
+  for (unsigned i = Begin; i != End; ++i) {
+    FPM.add(Recorder.Passes[i]);
+    Recorder.Passes[i] = 0;
+  }
+}
+
+/// RunStageOnThread - Read a copy of the module into a new context, run the
+/// stage's passes on the functions this thread manages to claim, and write
+/// the copy back out with only those bodies left in it.
+static void RunStageOnThread(void *Data, unsigned Thread) {
+  StageWork &Work = *static_cast<StageWork*>(Data);
+  LLVMContext Context;
+
+  const std::string &Bitcode = *Work.Bitcode;
+  OwningPtr<MemoryBuffer> Buffer(
+    MemoryBuffer::getMemBuffer(Bitcode.c_str(),
+                               Bitcode.c_str() + Bitcode.size()));
+  OwningPtr<Module> Copy(ParseBitcodeFile(Buffer.get(), Context,
+                                          &Work.Errors[Thread]));
+  if (!Copy)
+    return;
+
+  std::vector<Function*> Functions;
+  for (Module::iterator I = Copy->begin(), E = Copy->end(); I != E; ++I)
+    Functions.push_back(I);
+
+  std::vector<unsigned> &Claimed = Work.Claimed[Thread];
+  {
+    FunctionPassManager FPM(Copy.get());
+    Work.Stage->addPasses(FPM, Thread);
+    FPM.doInitialization();
+    for (;;) {
+      unsigned i = sys::AtomicIncrement(&Work.NextFunction) - 1;
+      if (i >= Functions.size())
+        break;
+      if (Functions[i]->isDeclaration())
+        continue;
+      FPM.run(*Functions[i]);
+      Claimed.push_back(i);
+    }
+    FPM.doFinalization();
+  }
+
+  // Drop the bodies that other threads are responsible for, they only make
+  // the result bigger.
+  std::sort(Claimed.begin(), Claimed.end());
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+    if (!std::binary_search(Claimed.begin(), Claimed.end(), i))
+      Functions[i]->deleteBody();
+
+  raw_string_ostream OS(Work.Results[Thread]);
+  WriteBitcodeToFile(Copy.get(), OS);
+}
+
+/// RedirectGlobals - Add to Repls the pairs that make everything that
+/// refers to the global values in CopyGVs refer to the corresponding ones in
+/// GVs instead.  The global values at the end of CopyGVs that GVs doesn't have
+/// are added to NewGVs.
+static void RedirectGlobals(const std::vector<GlobalValue*> &CopyGVs,
+                            const std::vector<GlobalValue*> &GVs,
+                            SmallVectorImpl<std::pair<Value*, Value*> > &Repls,
+                            std::vector<GlobalValue*> &NewGVs) {
+  for (unsigned i = 0, e = CopyGVs.size(); i != e; ++i) {
+    if (i >= GVs.size()) {
+      NewGVs.push_back(CopyGVs[i]);
+      continue;
+    }
+    assert(CopyGVs[i]->getName() == GVs[i]->getName() &&
+           "Copy doesn't match module!");
+    if (!CopyGVs[i]->use_empty())
+      Repls.push_back(std::make_pair(CopyGVs[i], GVs[i]));
+  }
+}
+
+/// MoveNewGlobal - GV was created by a pass on a thread's copy of the module.
+/// Move it over to M, unless M already has a global that it should be the
+/// same as.
+static void MoveNewGlobal(GlobalValue *GV, Module &M) {
+  if (!GV->hasLocalLinkage())
+    if (GlobalValue *Existing = M.getNamedValue(GV->getName())) {
+      GV->replaceAllUsesWith(ConstantExpr::getBitCast(Existing,
+                                                      GV->getType()));
+      return;
+    }
+
+  if (Function *F = dyn_cast<Function>(GV)) {
+    F->removeFromParent();
+    M.getFunctionList().push_back(F);
+  } else if (GlobalVariable *G = dyn_cast<GlobalVariable>(GV)) {
+    G->removeFromParent();
+    M.getGlobalList().push_back(G);
+  } else {
+    GlobalAlias *GA = cast<GlobalAlias>(GV);
+    GA->removeFromParent();
+    M.getAliasList().push_back(GA);
+  }
+}
+
+/// mergeThreadResult - Read back the copy of the module that a thread wrote,
+/// into M's context, and splice the bodies of the functions it claimed into
+/// M.  The copy starts out with the global values that M had when the stage
+/// began, which are in Globals.
+void ParallelFunctionStage::mergeThreadResult(Module &M,
+                                           const std::string &Bitcode,
+                                           const std::vector<unsigned> &Claimed,
+                                           bool UpdateDeclarations,
+                                           const ModuleGlobals &Globals) {
+  OwningPtr<MemoryBuffer> Buffer(
+    MemoryBuffer::getMemBuffer(Bitcode.c_str(),
+                               Bitcode.c_str() + Bitcode.size()));
+  std::string ErrMsg;
+  OwningPtr<Module> Copy(ParseBitcodeFile(Buffer.get(), M.getContext(),
+                                          &ErrMsg));
+  if (!Copy)
+    llvm_report_error("Error reading back parallel pass results: " + ErrMsg);
+
+  // Opaque types are not uniqued, so the copy has its own version of each.
+  // Resolve them to the ones in M by name.
+  const TypeSymbolTable &ST = M.getTypeSymbolTable();
+  for (TypeSymbolTable::const_iterator I = ST.begin(), E = ST.end();
+       I != E; ++I)
+    if (isa<OpaqueType>(I->second))
+      if (const Type *CopyTy = Copy->getTypeByName(I->first))
+        if (CopyTy != I->second && isa<OpaqueType>(CopyTy))
+          const_cast<OpaqueType*>(cast<OpaqueType>(CopyTy))->
+            refineAbstractTypeTo(I->second);
+
+  ModuleGlobals CopyGlobals(*Copy);
+  for (unsigned i = 0, e = Claimed.size(); i != e; ++i) {
+    Function *F = cast<Function>(Globals.Functions[Claimed[i]]);
+    Function *CopyF = cast<Function>(CopyGlobals.Functions[Claimed[i]]);
+    assert(F->getName() == CopyF->getName() && "Copy doesn't match module!");
+
+    F->dropAllReferences();
+    F->getBasicBlockList().splice(F->end(), CopyF->getBasicBlockList());
+    for (Function::arg_iterator AI = F->arg_begin(), AE = F->arg_end(),
+         CAI = CopyF->arg_begin(); AI != AE; ++AI, ++CAI) {
+      CAI->replaceAllUsesWith(AI);
+      if (AI->getName() != CAI->getName())
+        AI->takeName(CAI);
+    }
+    F->setAttributes(CopyF->getAttributes());
+  }
+
+  // Pick up the attributes that passes add to declarations when they are
+  // initialized.  Every thread does the same, so one is enough.
+  if (UpdateDeclarations)
+    for (unsigned i = 0, e = Globals.Functions.size(); i != e; ++i) {
+      Function *F = cast<Function>(Globals.Functions[i]);
+      if (F->isDeclaration())
+        F->setAttributes(
+          cast<Function>(CopyGlobals.Functions[i])->getAttributes());
+    }
+
+  // Redirect everything that refers to the copy's global values to M's, then
+  // move over the ones that the passes created.  Doing all of the redirections
+  // at once rebuilds each constant that refers to several of them only once.
+  SmallVector<std::pair<Value*, Value*>, 64> Replacements;
+  std::vector<GlobalValue*> NewGlobals;
+  RedirectGlobals(CopyGlobals.Variables, Globals.Variables, Replacements,
+                  NewGlobals);
+  RedirectGlobals(CopyGlobals.Functions, Globals.Functions, Replacements,
+                  NewGlobals);
+  RedirectGlobals(CopyGlobals.Aliases, Globals.Aliases, Replacements,
+                  NewGlobals);
+  Value::replaceAllUsesWith(Replacements);
+  for (unsigned i = 0, e = NewGlobals.size(); i != e; ++i)
+    MoveNewGlobal(NewGlobals[i], M);
+}
+
+bool ParallelFunctionStage::runOnModule(Module &M) {
+  unsigned NumThreads = Copies.size();
+
+  // Blocks whose address is taken cannot be moved between modules, and types
+  // that can't be matched up by name cannot be carried over in bitcode.  Run
+  // on this thread in those cases, and when there isn't anything to split.
+  bool RunHere = NumThreads < 2;
+  unsigned NumDefinitions = 0;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E && !RunHere; ++F) {
+    if (!F->isDeclaration())
+      ++NumDefinitions;
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      if (BB->hasAddressTaken()) {
+        RunHere = true;
+        break;
+      }
+  }
+  if (NumDefinitions < 2)
+    RunHere = true;
+
+  if (!RunHere) {
+    std::set<const Type*> NamedTypes;
+    const TypeSymbolTable &ST = M.getTypeSymbolTable();
+    for (TypeSymbolTable::const_iterator I = ST.begin(), E = ST.end();
+         I != E; ++I)
+      NamedTypes.insert(I->second);
+
+    const std::set<const Type*> &Types = getAnalysis<FindUsedTypes>().getTypes();
+    for (std::set<const Type*>::const_iterator I = Types.begin(),
+         E = Types.end(); I != E; ++I)
+      if (isa<OpaqueType>(*I) && !NamedTypes.count(*I)) {
+        RunHere = true;
+        break;
+      }
+  }
+
+  if (RunHere) {
+    FunctionPassManager FPM(&M);
+    addPasses(FPM, 0);
+    bool Changed = FPM.doInitialization();
+    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+      Changed |= FPM.run(*F);
+    Changed |= FPM.doFinalization();
+    return Changed;
+  }
+
+  std::string Bitcode;
+  {
+    raw_string_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+
+  StageWork Work(this, &Bitcode, NumThreads);
+  llvm_execute_on_threads(RunStageOnThread, &Work, NumThreads);
+  for (unsigned i = 0; i != NumThreads; ++i)
+    if (Work.Results[i].empty())
+      llvm_report_error("Error reading module on pass thread: " +
+                        Work.Errors[i]);
+
+  ModuleGlobals Globals(M);
+  for (unsigned i = 0; i != NumThreads; ++i)
+    if (i == 0 || !Work.Claimed[i].empty())
+      mergeThreadResult(M, Work.Results[i], Work.Claimed[i], i == 0, Globals);
+  return true;
+}
+
+/// CanRunOnThreads - Return true if P can be run on a thread's copy of the
+/// module, in a FunctionPassManager.  This is not the case for passes that
+/// need a module level analysis.
+static bool CanRunOnThreads(Pass *P) {
+  PassKind Kind = P->getPassKind();
+  if (Kind != PT_Function && Kind != PT_Loop && Kind != PT_BasicBlock)
+    return false;
+
+  AnalysisUsage AU;
+  P->getAnalysisUsage(AU);
+  const AnalysisUsage::VectorType *Sets[] = {
+    &AU.getRequiredSet(), &AU.getRequiredTransitiveSet()
+  };
+  for (unsigned s = 0; s != 2; ++s)
+    for (unsigned i = 0, e = Sets[s]->size(); i != e; ++i) {
+      const PassInfo *PI = (*Sets[s])[i];
+      if (PI->isAnalysisGroup())
+        continue;
+      if (!PI->getNormalCtor())
+        return false;
+      OwningPtr<Pass> Required(PI->getNormalCtor()());
+      PassKind RKind = Required->getPassKind();
+      if (RKind != PT_Function && RKind != PT_Loop && RKind != PT_BasicBlock &&
+          !Required->getAsImmutablePass())
+        return false;
+    }
+  return true;
+}
+
+/// AddParallelPasses - Add the passes of Main to Passes, replacing each run
+/// of function passes that don't need module level analyses by a
+/// ParallelFunctionStage.  Function passes that follow a CallGraphSCCPass
+/// are left alone, as they are run on each SCC in turn.
+void AddParallelPasses(PassManager &Passes, PipelineCopy &Main,
+                       std::vector<PipelineCopy*> &Copies,
+                       const TargetData *TD) {
+  std::vector<const PassInfo*> Immutables;
+
+  // The -O function passes run before everything else.
+  if (!Main.FPasses.Passes.empty())
+    Passes.add(new ParallelFunctionStage(Copies, true, 0,
+                                         Main.FPasses.Passes.size(),
+                                         Immutables, TD));
+
+  std::vector<Pass*> &List = Main.Passes.Passes;
+  bool InCallGraphSCC = false;
+  unsigned RunBegin = ~0U;
+  for (unsigned i = 0, e = List.size(); i != e; ++i) {
+    Pass *P = List[i];
+    if (!InCallGraphSCC && CanRunOnThreads(P)) {
+      if (RunBegin == ~0U)
+        RunBegin = i;
+      continue;
+    }
+
+    if (RunBegin != ~0U) {
+      Passes.add(new ParallelFunctionStage(Copies, false, RunBegin, i,
+                                           Immutables, TD));
+      RunBegin = ~0U;
+    }
+
+    if (P->getAsImmutablePass()) {
+      // Each thread needs its own instance of the analysis.
+      const PassInfo *PI = P->getPassInfo();
+      if (PI && PI->getNormalCtor())
+        Immutables.push_back(PI);
+    } else if (P->getPassKind() == PT_CallGraphSCC) {
+      InCallGraphSCC = true;
+    } else if (P->getPassKind() == PT_Module) {
+      InCallGraphSCC = false;
+    }
+
+    Passes.add(P);
+    List[i] = 0;
+  }
+
+  if (RunBegin != ~0U)
+    Passes.add(new ParallelFunctionStage(Copies, false, RunBegin, List.size(),
+                                         Immutables, TD));
+}
+
 } // anonymous namespace
 
 
@@ -371,7 +921,13 @@ int main(int argc, char **argv) {
 
   // Load the input module...
   std::auto_ptr<Module> M;
-  M.reset(ParseIRFile(InputFilename, Err, Context));
+  IRArena *Arena = UseIRArena ? IRArena::create() : 0;
+  {
+    IRArena::Scope S(Arena);
+    M.reset(ParseIRFile(InputFilename, Err, Context));
+  }
+  if (Arena)
+    Arena->release();
 
   if (M.get() == 0) {
     Err.Print(argv[0], errs());
@@ -424,114 +980,44 @@ int main(int argc, char **argv) {
   if (TD)
     Passes.add(TD);
 
-  FunctionPassManager *FPasses = NULL;
-  if (OptLevelO1 || OptLevelO2 || OptLevelO3) {
-    FPasses = new FunctionPassManager(M.get());
-    if (TD)
-      FPasses->add(new TargetData(*TD));
-  }
-
-  // If the -strip-debug command line option was specified, add it.  If
-  // -std-compile-opts was also specified, it will handle StripDebug.
-  if (StripDebug && !StandardCompileOpts)
-    addPass(Passes, createStripSymbolsPass(true));
-
-  // Create a new optimization pass for each one specified on the command line
-  for (unsigned i = 0; i < PassList.size(); ++i) {
-    // Check to see if -std-compile-opts was specified before this option.  If
-    // so, handle it.
-    if (StandardCompileOpts &&
-        StandardCompileOpts.getPosition() < PassList.getPosition(i)) {
-      AddStandardCompilePasses(Passes);
-      StandardCompileOpts = false;
-    }
-
-    if (StandardLinkOpts &&
-        StandardLinkOpts.getPosition() < PassList.getPosition(i)) {
-      AddStandardLinkPasses(Passes);
-      StandardLinkOpts = false;
-    }
-
-    if (OptLevelO1 && OptLevelO1.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 1);
-      OptLevelO1 = false;
+  // With -j, the runs of function passes are done on several threads, each
+  // with its own copy of the pipeline.
+  PipelineCopy MainPipeline;
+  std::vector<PipelineCopy*> ThreadPipelines;
+  if (NumThreads > 1 && !AnalyzeOnly) {
+    llvm_start_multithreaded();
+    AddPassesFromCommandLine(MainPipeline.Passes, &MainPipeline.FPasses,
+                             argv[0]);
+    for (unsigned i = 0; i != NumThreads; ++i) {
+      ThreadPipelines.push_back(new PipelineCopy());
+      AddPassesFromCommandLine(ThreadPipelines[i]->Passes,
+                               &ThreadPipelines[i]->FPasses, 0);
     }
-
-    if (OptLevelO2 && OptLevelO2.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 2);
-      OptLevelO2 = false;
+    AddParallelPasses(Passes, MainPipeline, ThreadPipelines, TD);
+  } else {
+    FunctionPassManager *FPasses = NULL;
+    if (OptLevelO1 || OptLevelO2 || OptLevelO3) {
+      FPasses = new FunctionPassManager(M.get());
+      if (TD)
+        FPasses->add(new TargetData(*TD));
     }
 
-    if (OptLevelO3 && OptLevelO3.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 3);
-      OptLevelO3 = false;
-    }
+    AddPassesFromCommandLine(Passes, FPasses, argv[0]);
 
-    const PassInfo *PassInf = PassList[i];
-    Pass *P = 0;
-    if (PassInf->getNormalCtor())
-      P = PassInf->getNormalCtor()();
-    else
-      errs() << argv[0] << ": cannot create pass: "
-             << PassInf->getPassName() << "\n";
-    if (P) {
-      PassKind Kind = P->getPassKind();
-      addPass(Passes, P);
-
-      if (AnalyzeOnly) {
-        switch (Kind) {
-        case PT_BasicBlock:
-          Passes.add(new BasicBlockPassPrinter(PassInf));
-          break;
-        case PT_Loop:
-          Passes.add(new LoopPassPrinter(PassInf));
-          break;
-        case PT_Function:
-          Passes.add(new FunctionPassPrinter(PassInf));
-          break;
-        case PT_CallGraphSCC:
-          Passes.add(new CallGraphSCCPassPrinter(PassInf));
-          break;
-        default:
-          Passes.add(new ModulePassPrinter(PassInf));
-          break;
-        }
-      }
+    // The OptLevel flags are cleared when -O is given before other passes, so
+    // test FPasses, which is only created for -O.
+    if (FPasses) {
+      FPasses->doInitialization();
+      for (Module::iterator I = M.get()->begin(), E = M.get()->end();
+           I != E; ++I)
+        FPasses->run(*I);
     }
-
-    if (PrintEachXForm)
-      Passes.add(createPrintModulePass(&errs()));
-  }
-
-  // If -std-compile-opts was specified at the end of the pass list, add them.
-  if (StandardCompileOpts) {
-    AddStandardCompilePasses(Passes);
-    StandardCompileOpts = false;
-  }
-
-  if (StandardLinkOpts) {
-    AddStandardLinkPasses(Passes);
-    StandardLinkOpts = false;
-  }
-
-  if (OptLevelO1)
-    AddOptimizationPasses(Passes, *FPasses, 1);
-
-  if (OptLevelO2)
-    AddOptimizationPasses(Passes, *FPasses, 2);
-
-  if (OptLevelO3)
-    AddOptimizationPasses(Passes, *FPasses, 3);
-
-  if (OptLevelO1 || OptLevelO2 || OptLevelO3) {
-    FPasses->doInitialization();
-    for (Module::iterator I = M.get()->begin(), E = M.get()->end();
-         I != E; ++I)
-      FPasses->run(*I);
   }
 
-  // Check that the module is well formed on completion of optimization
-  if (!NoVerify && !VerifyEach)
+  // Check that the module is well formed on completion of optimization.  With
+  // -verify-each, this also catches changes that the incremental verifiers
+  // could not see.
+  if (!NoVerify)
     Passes.add(createVerifierPass());
 
   // Write bitcode or assembly out to disk or outs() as the last step...
@@ -545,6 +1031,9 @@ int main(int argc, char **argv) {
   // Now that we have all of the passes ready, run them.
   Passes.run(*M.get());
 
+  for (unsigned i = 0, e = ThreadPipelines.size(); i != e; ++i)
+    delete ThreadPipelines[i];
+
   // Delete the raw_fd_ostream.
   if (Out != &outs())
     delete Out;
@@ -10,13 +10,20 @@
 #include "gtest/gtest.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Assembly/Parser.h"
 #include "llvm/BasicBlock.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineJumpTableInfo.h"
 #include "llvm/Constant.h"
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/ExecutionEngine/JITCodeCache.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/Function.h"
 #include "llvm/GlobalValue.h"
@@ -27,6 +34,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TypeBuilder.h"
+#include "llvm/System/Threading.h"
 #include "llvm/Target/TargetSelect.h"
 #include "llvm/Type.h"
 
@@ -541,9 +549,128 @@ TEST_F(JITTest, FunctionPointersOutliveTheirCreator) {
 #endif
 }
 
+int RemappedTarget() { return 42; }
+
+TEST_F(JITTest, RemappedFunctionIsNotReturnedStale) {
+  LoadAssembly("define i32 @f() { "
+               "  ret i32 7 "
+               "} ");
+  Function *F = M->getFunction("f");
+  TheJIT->DisableLazyCompilation(true);
+
+  void *FPtr = TheJIT->getPointerToFunction(F);
+  ASSERT_TRUE(FPtr != NULL);
+
+  // A client remapping the function must see the new address, not the one
+  // getPointerToFunction remembered from compiling it.
+  void *Target = (void*)(intptr_t)RemappedTarget;
+  EXPECT_EQ(FPtr, TheJIT->updateGlobalMapping(F, Target));
+  EXPECT_EQ(Target, TheJIT->getPointerToFunction(F));
+
+  TheJIT->clearAllGlobalMappings();
+  TheJIT->addGlobalMapping(F, FPtr);
+  EXPECT_EQ(FPtr, TheJIT->getPointerToFunction(F));
+  TheJIT->updateGlobalMapping(F, Target);
+  EXPECT_EQ(Target, TheJIT->getPointerToFunction(F));
+}
+
+// Each thread asks for the address of every function, compiling some of them
+// and finding others already compiled by another thread.
+struct ConcurrentLookups {
+  ExecutionEngine *EE;
+  std::vector<Function*> Functions;
+  std::vector<std::vector<void*> > Addresses;
+};
+
+static void LookUpAllFunctions(void *UserData, unsigned ThreadNo) {
+  ConcurrentLookups &L = *static_cast<ConcurrentLookups*>(UserData);
+  for (unsigned Round = 0; Round != 100; ++Round)
+    for (unsigned i = 0, e = L.Functions.size(); i != e; ++i) {
+      // Start at a different function in each thread.
+      unsigned Idx = (i + ThreadNo) % e;
+      void *Addr = L.EE->getPointerToFunction(L.Functions[Idx]);
+      if (Round == 0)
+        L.Addresses[ThreadNo][Idx] = Addr;
+      else if (Addr != L.Addresses[ThreadNo][Idx])
+        L.Addresses[ThreadNo][Idx] = 0;
+    }
+}
+
+TEST_F(JITTest, GetPointerToFunctionFromSeveralThreads) {
+  const unsigned NumFunctions = 16, NumThreads = 4;
+  ConcurrentLookups L;
+  L.EE = TheJIT.get();
+  for (unsigned i = 0; i != NumFunctions; ++i) {
+    std::string Name = "f" + utostr(i);
+    std::string Asm = "define i32 @" + Name + "() { ret i32 " + utostr(i) +
+                      " } ";
+    LoadAssembly(Asm.c_str());
+    L.Functions.push_back(M->getFunction(Name));
+  }
+  TheJIT->DisableLazyCompilation(true);
+  // Compile half of the functions up front.
+  for (unsigned i = 0; i != NumFunctions; i += 2)
+    TheJIT->getPointerToFunction(L.Functions[i]);
+
+  L.Addresses.resize(NumThreads, std::vector<void*>(NumFunctions));
+  llvm_execute_on_threads(LookUpAllFunctions, &L, NumThreads);
+
+  EXPECT_EQ(NumFunctions, RJMM->startFunctionBodyCalls.size())
+    << "Each function should be compiled exactly once";
+  for (unsigned i = 0; i != NumFunctions; ++i) {
+    void *Addr = TheJIT->getPointerToFunction(L.Functions[i]);
+    for (unsigned t = 0; t != NumThreads; ++t)
+      EXPECT_EQ(Addr, L.Addresses[t][i])
+        << "thread " << t << " saw another address for @f" << i;
+    int (*FPtr)() = reinterpret_cast<int(*)()>((intptr_t)Addr);
+    EXPECT_EQ(int(i), FPtr());
+  }
+}
+
 // ARM doesn't have an implementation of replaceMachineCodeForFunction(), so
 // recompileAndRelinkFunction doesn't work.
 #if !defined(__arm__)
+TEST_F(JITTest, FreedFunctionIsRecompiled) {
+  LoadAssembly("define i32 @f() { "
+               "  ret i32 7 "
+               "} ");
+  Function *F = M->getFunction("f");
+  TheJIT->DisableLazyCompilation(true);
+
+  void *FPtr = TheJIT->getPointerToFunction(F);
+  ASSERT_TRUE(FPtr != NULL);
+  EXPECT_EQ(FPtr, TheJIT->getPointerToFunction(F));
+  EXPECT_EQ(1U, RJMM->startFunctionBodyCalls.size());
+
+  // Once its code is freed, the function must be compiled again rather than
+  // handing back the stale address.
+  TheJIT->freeMachineCodeForFunction(F);
+  EXPECT_EQ(NULL, TheJIT->getPointerToGlobalIfAvailable(F));
+  int (*NewFPtr)() = reinterpret_cast<int(*)()>(
+    (intptr_t)TheJIT->getPointerToFunction(F));
+  EXPECT_EQ(2U, RJMM->startFunctionBodyCalls.size());
+  EXPECT_EQ(7, NewFPtr());
+}
+
+TEST_F(JITTest, RunFunctionThroughStub) {
+  // runFunction has no fast path for this signature, so it builds and
+  // compiles a nullary stub which calls the function.
+  LoadAssembly("define i64 @add(i64 %a, i64 %b) { "
+               "  %r = add i64 %a, %b "
+               "  ret i64 %r "
+               "} ");
+  Function *F = M->getFunction("add");
+  unsigned NumFunctions = M->size();
+
+  std::vector<GenericValue> Args(2);
+  Args[0].IntVal = APInt(64, 40);
+  Args[1].IntVal = APInt(64, 2);
+  GenericValue Result = TheJIT->runFunction(F, Args);
+  EXPECT_EQ(42U, Result.IntVal.getZExtValue());
+  // The stub is removed again afterwards.
+  EXPECT_EQ(NumFunctions, M->size());
+}
+
 TEST_F(JITTest, FunctionIsRecompiledAndRelinked) {
   Function *F = Function::Create(TypeBuilder<int(void), false>::get(Context),
                                  GlobalValue::ExternalLinkage, "test", M);
@@ -574,6 +701,183 @@ TEST_F(JITTest, FunctionIsRecompiledAndRelinked) {
   EXPECT_EQ(2, OrigFPtr())
     << "The old pointer's target should now jump to the new version";
 }
+
+TEST_F(JITTest, FunctionIsRecompiledAtHigherOptLevel) {
+  LoadAssembly("define i32 @sum(i32 %n) { "
+               "entry: "
+               "  br label %loop "
+               "loop: "
+               "  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ] "
+               "  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ] "
+               "  %s.next = add i32 %s, %i "
+               "  %i.next = add i32 %i, 1 "
+               "  %done = icmp eq i32 %i.next, %n "
+               "  br i1 %done, label %exit, label %loop "
+               "exit: "
+               "  ret i32 %s.next "
+               "} ");
+  Function *F = M->getFunction("sum");
+  TheJIT->DisableLazyCompilation(true);
+
+  typedef int (*SumPtr)(int);
+  SumPtr OrigFPtr = reinterpret_cast<SumPtr>(
+    (intptr_t)TheJIT->getPointerToFunction(F));
+  EXPECT_EQ(45, OrigFPtr(10));
+
+  SumPtr NewFPtr = reinterpret_cast<SumPtr>(
+    (intptr_t)TheJIT->recompileAndRelinkFunction(F, CodeGenOpt::Aggressive));
+  EXPECT_EQ(2U, RJMM->startFunctionBodyCalls.size());
+  EXPECT_EQ(45, NewFPtr(10));
+  EXPECT_EQ(45, OrigFPtr(10))
+    << "The old pointer's target should now jump to the new version";
+  EXPECT_EQ((void*)(intptr_t)NewFPtr, TheJIT->getPointerToFunction(F));
+}
+
+// A JITCodeCache that keeps its entries in memory.
+class MemoryJITCodeCache : public JITCodeCache {
+public:
+  MemoryJITCodeCache() : Hits(0), Stores(0) {}
+
+  virtual MemoryBuffer *lookup(StringRef Key) {
+    StringMap<std::string>::iterator I = Entries.find(Key);
+    if (I == Entries.end())
+      return 0;
+    ++Hits;
+    const std::string &Blob = I->second;
+    return MemoryBuffer::getMemBufferCopy(Blob.data(),
+                                          Blob.data() + Blob.size());
+  }
+  virtual void store(StringRef Key, StringRef Blob) {
+    ++Stores;
+    Entries[Key] = Blob;
+  }
+
+  StringMap<std::string> Entries;
+  unsigned Hits, Stores;
+};
+
+TEST_F(JITTest, FunctionIsLoadedFromCodeCache) {
+  const char *Assembly =
+    "@counter = global i32 10 "
+    "define double @scale(double %x) { "
+    "  %y = fmul double %x, 2.5 "
+    "  ret double %y "
+    "} "
+    "define i32 @bump(i32 %n) { "
+    "entry: "
+    "  br label %loop "
+    "loop: "
+    "  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ] "
+    "  %c = load i32* @counter "
+    "  %c.next = add i32 %c, 1 "
+    "  store i32 %c.next, i32* @counter "
+    "  %i.next = add i32 %i, 1 "
+    "  %done = icmp eq i32 %i.next, %n "
+    "  br i1 %done, label %exit, label %loop "
+    "exit: "
+    "  %d = sitofp i32 %c.next to double "
+    "  %s = call double @scale(double %d) "
+    "  %r = fptosi double %s to i32 "
+    "  ret i32 %r "
+    "} ";
+  MemoryJITCodeCache Cache;
+  TheJIT->setJITCodeCache(&Cache);
+  LoadAssembly(Assembly);
+  TheJIT->DisableLazyCompilation(true);
+
+  typedef int (*BumpPtr)(int);
+  BumpPtr FPtr = reinterpret_cast<BumpPtr>(
+    (intptr_t)TheJIT->getPointerToFunction(M->getFunction("bump")));
+  EXPECT_EQ(0U, Cache.Hits);
+  EXPECT_EQ(2U, Cache.Stores);
+  EXPECT_EQ(40, FPtr(6));
+
+  // A second JIT for an identical module should reuse the stored code, but
+  // link it against its own globals.
+  Module *M2 = new Module("<second>", Context);
+  LoadAssemblyInto(M2, Assembly);
+  std::string Error;
+  OwningPtr<ExecutionEngine> JIT2(EngineBuilder(M2)
+                                  .setEngineKind(EngineKind::JIT)
+                                  .setErrorStr(&Error).create());
+  ASSERT_TRUE(JIT2.get() != NULL) << Error;
+  JIT2->setJITCodeCache(&Cache);
+  JIT2->DisableLazyCompilation(true);
+
+  BumpPtr FPtr2 = reinterpret_cast<BumpPtr>(
+    (intptr_t)JIT2->getPointerToFunction(M2->getFunction("bump")));
+  EXPECT_EQ(2U, Cache.Hits);
+  EXPECT_EQ(2U, Cache.Stores);
+  EXPECT_NE((void*)(intptr_t)FPtr, (void*)(intptr_t)FPtr2);
+  EXPECT_EQ(32, FPtr2(3));
+  int32_t *Counter =
+    (int32_t*)JIT2->getPointerToGlobal(M2->getGlobalVariable("counter"));
+  EXPECT_EQ(13, *Counter);
+  Counter =
+    (int32_t*)TheJIT->getPointerToGlobal(M->getGlobalVariable("counter"));
+  EXPECT_EQ(16, *Counter) << "The first JIT's global should be unaffected";
+}
+
+// Records whether each emitted function was given a jump table, which only
+// SelectionDAG builds for a switch.
+struct JumpTableListener : public JITEventListener {
+  std::vector<bool> HadJumpTable;
+  virtual void NotifyFunctionEmitted(const Function &F, void *Code,
+                                     size_t Size,
+                                     const EmittedFunctionDetails &Details) {
+    const MachineJumpTableInfo *JTI = Details.MF->getJumpTableInfo();
+    HadJumpTable.push_back(JTI && !JTI->isEmpty());
+  }
+};
+
+TEST(JIT, RecompileAtDefaultDoesNotUseFastISel) {
+  LLVMContext Context;
+  Module *M = new Module("<main>", Context);
+  std::string Error;
+  OwningPtr<ExecutionEngine> JIT(EngineBuilder(M)
+                                 .setEngineKind(EngineKind::JIT)
+                                 .setErrorStr(&Error)
+                                 .setOptLevel(CodeGenOpt::None)
+                                 .create());
+  ASSERT_EQ(Error, "");
+  JIT->DisableLazyCompilation(true);
+  JumpTableListener Listener;
+  JIT->RegisterJITEventListener(&Listener);
+
+  LoadAssemblyInto(M,
+                   "define i32 @pick(i32 %x) { "
+                   "entry: "
+                   "  switch i32 %x, label %d [ i32 0, label %a "
+                   "                            i32 1, label %b "
+                   "                            i32 2, label %c "
+                   "                            i32 3, label %e "
+                   "                            i32 4, label %f ] "
+                   "a: ret i32 10 "
+                   "b: ret i32 11 "
+                   "c: ret i32 12 "
+                   "e: ret i32 13 "
+                   "f: ret i32 14 "
+                   "d: ret i32 0 "
+                   "} ");
+  Function *F = M->getFunction("pick");
+
+  typedef int (*PickPtr)(int);
+  PickPtr FPtr = reinterpret_cast<PickPtr>(
+    (intptr_t)JIT->getPointerToFunction(F));
+  EXPECT_EQ(13, FPtr(3));
+
+  FPtr = reinterpret_cast<PickPtr>(
+    (intptr_t)JIT->recompileAndRelinkFunction(F, CodeGenOpt::Default));
+  EXPECT_EQ(13, FPtr(3));
+  EXPECT_EQ(0, FPtr(7));
+
+  JIT->UnregisterJITEventListener(&Listener);
+  ASSERT_EQ(2U, Listener.HadJumpTable.size());
+  EXPECT_FALSE(Listener.HadJumpTable[0])
+    << "CodeGenOpt::None should select the switch with FastISel";
+  EXPECT_TRUE(Listener.HadJumpTable[1])
+    << "CodeGenOpt::Default should select the switch with SelectionDAG";
+}
 #endif  // !defined(__arm__)
 
 }  // anonymous namespace
@@ -793,6 +1097,36 @@ TEST(LazyLoadedJITTest, EagerCompiledRecursionThroughGhost) {
   EXPECT_EQ(3, recur1(4));
 }
 
+TEST(LazyLoadedJITTest, GlobalInitializerIsReadOnDemand) {
+  LLVMContext Context;
+  const std::string Bitcode =
+    AssembleToBitcode(Context,
+                      "@table = global [3 x i32] [i32 5, i32 6, i32 7] "
+                      " "
+                      "define i32 @get(i32 %i) { "
+                      "  %p = getelementptr [3 x i32]* @table, i32 0, i32 %i "
+                      "  %v = load i32* %p "
+                      "  ret i32 %v "
+                      "} ");
+  ASSERT_FALSE(Bitcode.empty()) << "Assembling failed";
+  Module *M;
+  OwningPtr<ExecutionEngine> TheJIT(getJITFromBitcode(Context, Bitcode, M));
+  ASSERT_TRUE(TheJIT.get()) << "Failed to create JIT.";
+  TheJIT->DisableLazyCompilation(true);
+
+  // The initializer isn't read until something needs it.
+  GlobalVariable *TableIR = M->getGlobalVariable("table");
+  EXPECT_TRUE(TableIR->isMaterializable());
+  EXPECT_FALSE(TableIR->hasInitializer());
+
+  int32_t (*get)(int32_t) = reinterpret_cast<int32_t(*)(int32_t)>(
+    (intptr_t)TheJIT->getPointerToFunction(M->getFunction("get")));
+  EXPECT_FALSE(TableIR->isMaterializable());
+  ASSERT_TRUE(TableIR->hasInitializer());
+  EXPECT_EQ(6, get(1));
+  EXPECT_EQ(7, get(2));
+}
+
 // This code is copied from JITEventListenerTest, but it only runs once for all
 // the tests in this directory.  Everything seems fine, but that's strange
 // behavior.
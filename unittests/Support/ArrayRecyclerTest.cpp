@@ -0,0 +1,130 @@
+//===- llvm/unittest/Support/ArrayRecyclerTest.cpp - ArrayRecycler tests --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ArrayRecycler.h"
+#include "llvm/Support/Allocator.h"
+
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+struct Object {
+  int Num;
+  Object *Other;
+};
+typedef ArrayRecycler<Object> ARO;
+
+TEST(ArrayRecyclerTest, Capacity) {
+  // Capacities are the powers of two.
+  ARO::Capacity Cap = ARO::Capacity::get(0);
+  EXPECT_EQ(1u, Cap.getSize());
+  EXPECT_EQ(0u, Cap.getBucket());
+
+  Cap = ARO::Capacity::get(1);
+  EXPECT_EQ(1u, Cap.getSize());
+  EXPECT_EQ(0u, Cap.getBucket());
+
+  Cap = ARO::Capacity::get(2);
+  EXPECT_EQ(2u, Cap.getSize());
+  EXPECT_EQ(1u, Cap.getBucket());
+
+  Cap = ARO::Capacity::get(3);
+  EXPECT_EQ(4u, Cap.getSize());
+  EXPECT_EQ(2u, Cap.getBucket());
+
+  Cap = ARO::Capacity::get(8);
+  EXPECT_EQ(8u, Cap.getSize());
+  EXPECT_EQ(3u, Cap.getBucket());
+
+  Cap = Cap.getNext();
+  EXPECT_EQ(16u, Cap.getSize());
+  EXPECT_EQ(4u, Cap.getBucket());
+}
+
+TEST(ArrayRecyclerTest, Basics) {
+  BumpPtrAllocator Allocator;
+  ArrayRecycler<Object> DUT;
+
+  ARO::Capacity Cap = ARO::Capacity::get(8);
+  Object *A1 = DUT.Allocate(Cap, Allocator);
+  A1[0].Num = 21;
+  A1[7].Num = 17;
+
+  Object *A2 = DUT.Allocate(Cap, Allocator);
+  A2[0].Num = 121;
+  A2[7].Num = 117;
+
+  Object *A3 = DUT.Allocate(Cap, Allocator);
+  A3[0].Num = 221;
+  A3[7].Num = 217;
+
+  EXPECT_EQ(21, A1[0].Num);
+  EXPECT_EQ(17, A1[7].Num);
+  EXPECT_EQ(121, A2[0].Num);
+  EXPECT_EQ(117, A2[7].Num);
+  EXPECT_EQ(221, A3[0].Num);
+  EXPECT_EQ(217, A3[7].Num);
+
+  DUT.Deallocate(Cap, A2);
+
+  // Check that deallocation didn't clobber anything.
+  EXPECT_EQ(21, A1[0].Num);
+  EXPECT_EQ(17, A1[7].Num);
+  EXPECT_EQ(221, A3[0].Num);
+  EXPECT_EQ(217, A3[7].Num);
+
+  // Verify recycling.
+  Object *A2x = DUT.Allocate(Cap, Allocator);
+  EXPECT_EQ(A2, A2x);
+
+  DUT.Deallocate(Cap, A2x);
+  DUT.Deallocate(Cap, A1);
+  DUT.Deallocate(Cap, A3);
+
+  // Objects are not required to be recycled in reverse deallocation order, but
+  // that is what the current implementation does.
+  Object *A3x = DUT.Allocate(Cap, Allocator);
+  EXPECT_EQ(A3, A3x);
+  Object *A1x = DUT.Allocate(Cap, Allocator);
+  EXPECT_EQ(A1, A1x);
+  Object *A2y = DUT.Allocate(Cap, Allocator);
+  EXPECT_EQ(A2, A2y);
+
+  // Back to allocation from the BumpPtrAllocator.
+  Object *A4 = DUT.Allocate(Cap, Allocator);
+  EXPECT_NE(A1, A4);
+  EXPECT_NE(A2, A4);
+  EXPECT_NE(A3, A4);
+
+  DUT.clear(Allocator);
+}
+
+TEST(ArrayRecyclerTest, SeparateCapacities) {
+  BumpPtrAllocator Allocator;
+  ArrayRecycler<Object> DUT;
+
+  // An array is only handed out again for its own capacity.
+  ARO::Capacity Small = ARO::Capacity::get(2);
+  ARO::Capacity Large = Small.getNext();
+  Object *S = DUT.Allocate(Small, Allocator);
+  DUT.Deallocate(Small, S);
+
+  Object *L = DUT.Allocate(Large, Allocator);
+  EXPECT_NE(S, L);
+  EXPECT_EQ(S, DUT.Allocate(Small, Allocator));
+
+  DUT.Deallocate(Large, L);
+  EXPECT_EQ(L, DUT.Allocate(Large, Allocator));
+
+  DUT.clear(Allocator);
+}
+
+} // end anonymous namespace
@@ -0,0 +1,61 @@
+//===- llvm/unittest/Support/SHA1Test.cpp - SHA-1 tests -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/ADT/StringExtras.h"
+#include <string>
+
+using namespace llvm;
+namespace {
+
+std::string toHex(StringRef Digest) {
+  std::string Hex;
+  for (unsigned i = 0, e = Digest.size(); i != e; ++i) {
+    unsigned char C = Digest[i];
+    Hex += hexdigit(C >> 4);
+    Hex += hexdigit(C & 15);
+  }
+  return Hex;
+}
+
+std::string hash(StringRef Data) {
+  SHA1 Hash;
+  Hash.update(Data);
+  return toHex(Hash.final());
+}
+
+// The examples of FIPS 180-2, appendix A.
+TEST(SHA1Test, Vectors) {
+  EXPECT_EQ("DA39A3EE5E6B4B0D3255BFEF95601890AFD80709", hash(""));
+  EXPECT_EQ("A9993E364706816ABA3E25717850C26C9CD0D89D", hash("abc"));
+  EXPECT_EQ("84983E441C3BD26EBAAE4AA1F95129E5E54670F1",
+            hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+  EXPECT_EQ("34AA973CD4C4DAA4F61EEB2BDBAD27316534016F",
+            hash(std::string(1000000, 'a')));
+}
+
+TEST(SHA1Test, Incremental) {
+  std::string Data(1000, 'x');
+  for (unsigned i = 0; i != Data.size(); ++i)
+    Data[i] = char(i * 7);
+
+  SHA1 Hash;
+  for (unsigned Start = 0, Step = 1; Start < Data.size(); Start += Step++)
+    Hash.update(StringRef(Data).substr(Start, Step));
+  std::string Incremental = toHex(Hash.final());
+  EXPECT_EQ(hash(Data), Incremental);
+
+  // init() starts over.
+  Hash.init();
+  Hash.update("abc");
+  EXPECT_EQ("A9993E364706816ABA3E25717850C26C9CD0D89D", toHex(Hash.final()));
+}
+
+}
@@ -0,0 +1,116 @@
+//===- PartitionModule.cpp - Unit tests for module partitioning -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalAlias.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/Analysis/Verifier.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Transforms/IPO/PartitionModule.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+using namespace llvm;
+
+namespace {
+
+// @helper and @a are put in the first partition, as they are visited first
+// and fill half of the module; @b goes to the second.
+const char TestModule[] =
+  "@counter = internal global i32 0 "
+  "define internal i32 @helper(i32 %x) { "
+  "  %y = add i32 %x, 1 "
+  "  ret i32 %y "
+  "} "
+  "define i32 @a() { "
+  "  %v = load i32* @counter "
+  "  %r = call i32 @helper(i32 %v) "
+  "  ret i32 %r "
+  "} "
+  "define i32 @b() { "
+  "  %r = call i32 @helper(i32 2) "
+  "  ret i32 %r "
+  "} "
+  "declare i32 @ext() "
+  "@alias_a = alias i32 ()* @a ";
+
+class PartitionModuleTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    SMDiagnostic Error;
+    M.reset(ParseAssemblyString(TestModule, NULL, Error, Context));
+    ASSERT_TRUE(M != NULL);
+  }
+
+  LLVMContext Context;
+  OwningPtr<Module> M;
+};
+
+TEST_F(PartitionModuleTest, SinglePartitionLeavesModuleAlone) {
+  std::vector<unsigned> Assignment;
+  EXPECT_EQ(1U, PartitionModule(M.get(), 1, Assignment));
+  ASSERT_EQ(6U, Assignment.size());
+  for (unsigned i = 0, e = Assignment.size(); i != e; ++i)
+    EXPECT_EQ(0U, Assignment[i]);
+  EXPECT_TRUE(M->getFunction("helper")->hasInternalLinkage());
+}
+
+TEST_F(PartitionModuleTest, PromotesCrossPartitionLocals) {
+  std::vector<unsigned> Assignment;
+  EXPECT_EQ(2U, PartitionModule(M.get(), 2, Assignment));
+  ASSERT_EQ(6U, Assignment.size());
+
+  // @counter, @helper, @a, @b, @ext, @alias_a
+  EXPECT_EQ(0U, Assignment[0]);
+  EXPECT_EQ(0U, Assignment[1]);
+  EXPECT_EQ(0U, Assignment[2]);
+  EXPECT_EQ(1U, Assignment[3]);
+  EXPECT_EQ(0U, Assignment[4]);
+  EXPECT_EQ(0U, Assignment[5]);
+
+  // @helper is called from both partitions, @counter only from the first.
+  EXPECT_EQ(0, M->getFunction("helper"));
+  Function *Helper = M->getFunction("helper.lto_priv");
+  ASSERT_TRUE(Helper != NULL);
+  EXPECT_TRUE(Helper->hasExternalLinkage());
+  EXPECT_TRUE(Helper->hasHiddenVisibility());
+  EXPECT_TRUE(M->getGlobalVariable("counter", true)->hasInternalLinkage());
+  EXPECT_FALSE(verifyModule(*M));
+}
+
+TEST_F(PartitionModuleTest, ExtractPartitions) {
+  std::vector<unsigned> Assignment;
+  ASSERT_EQ(2U, PartitionModule(M.get(), 2, Assignment));
+
+  OwningPtr<Module> P0(CloneModule(M.get()));
+  ExtractPartition(P0.get(), Assignment, 0);
+  EXPECT_FALSE(verifyModule(*P0));
+  EXPECT_FALSE(P0->getFunction("a")->isDeclaration());
+  EXPECT_FALSE(P0->getFunction("helper.lto_priv")->isDeclaration());
+  EXPECT_TRUE(P0->getFunction("b")->isDeclaration());
+  EXPECT_FALSE(P0->getGlobalVariable("counter", true)->isDeclaration());
+  EXPECT_TRUE(P0->getNamedAlias("alias_a") != NULL);
+
+  OwningPtr<Module> P1(CloneModule(M.get()));
+  ExtractPartition(P1.get(), Assignment, 1);
+  EXPECT_FALSE(verifyModule(*P1));
+  EXPECT_FALSE(P1->getFunction("b")->isDeclaration());
+  EXPECT_TRUE(P1->getFunction("a")->isDeclaration());
+  EXPECT_TRUE(P1->getFunction("helper.lto_priv")->isDeclaration());
+  EXPECT_EQ(0, P1->getNamedAlias("alias_a"));
+  Function *AliasDecl = P1->getFunction("alias_a");
+  ASSERT_TRUE(AliasDecl != NULL);
+  EXPECT_TRUE(AliasDecl->isDeclaration());
+}
+
+}
@@ -9,7 +9,10 @@
 
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
+#include "llvm/GlobalVariable.h"
 #include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include <vector>
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -109,5 +112,93 @@ TEST(ConstantsTest, IntSigns) {
   EXPECT_EQ(0x3b, ConstantInt::get(Int8Ty, 0x13b)->getSExtValue());
 }
 
+TEST(ConstantsTest, UniqueManyConstantExprs) {
+  // Enough constants to make the uniquing tables grow many times over.
+  const unsigned N = 50000;
+  LLVMContext Context;
+  Module M("test", Context);
+  const Type *Int32Ty = Type::getInt32Ty(Context);
+  const Type *Int64Ty = Type::getInt64Ty(Context);
+  const ArrayType *ArrTy = ArrayType::get(Int32Ty, N);
+  GlobalVariable *G = new GlobalVariable(M, ArrTy, false,
+                                         GlobalValue::ExternalLinkage, 0, "g");
+  Constant *GInt = ConstantExpr::getPtrToInt(G, Int64Ty);
+
+  std::vector<Constant*> GEPs, Adds;
+  for (unsigned i = 0; i != N; ++i) {
+    Constant *Idx[] = { ConstantInt::get(Int32Ty, 0),
+                        ConstantInt::get(Int32Ty, i) };
+    GEPs.push_back(ConstantExpr::getGetElementPtr(G, Idx, 2));
+    Adds.push_back(ConstantExpr::getAdd(GInt, ConstantInt::get(Int64Ty, i)));
+  }
+
+  unsigned Mismatches = 0;
+  for (unsigned i = 0; i != N; ++i) {
+    Constant *Idx[] = { ConstantInt::get(Int32Ty, 0),
+                        ConstantInt::get(Int32Ty, i) };
+    if (ConstantExpr::getGetElementPtr(G, Idx, 2) != GEPs[i])
+      ++Mismatches;
+    if (ConstantExpr::getAdd(GInt, ConstantInt::get(Int64Ty, i)) != Adds[i])
+      ++Mismatches;
+    if (i && (GEPs[i] == GEPs[i-1] || Adds[i] == Adds[i-1]))
+      ++Mismatches;
+  }
+  EXPECT_EQ(0U, Mismatches);
+}
+
+TEST(ConstantsTest, ReplaceOperandOfAggregate) {
+  LLVMContext Context;
+  Module M("test", Context);
+  const Type *Int32Ty = Type::getInt32Ty(Context);
+  const ArrayType *ArrTy = ArrayType::get(PointerType::getUnqual(Int32Ty), 2);
+  GlobalVariable *A = new GlobalVariable(M, Int32Ty, false,
+                                         GlobalValue::ExternalLinkage, 0, "a");
+  GlobalVariable *B = new GlobalVariable(M, Int32Ty, false,
+                                         GlobalValue::ExternalLinkage, 0, "b");
+  GlobalVariable *C = new GlobalVariable(M, Int32Ty, false,
+                                         GlobalValue::ExternalLinkage, 0, "c");
+
+  Constant *AB[] = { A, B };
+  Constant *CB[] = { C, B };
+  Constant *BB[] = { B, B };
+  Constant *ArrAB = ConstantArray::get(ArrTy, AB, 2);
+  Constant *ArrCB = ConstantArray::get(ArrTy, CB, 2);
+  GlobalVariable *G = new GlobalVariable(M, ArrTy, false,
+                                         GlobalValue::ExternalLinkage, ArrCB,
+                                         "g");
+
+  // [a, b] becomes [b, b] in place, as there is no such array yet.
+  A->replaceAllUsesWith(B);
+  EXPECT_EQ(ArrAB, ConstantArray::get(ArrTy, BB, 2));
+
+  // [c, b] becomes the existing [b, b].
+  C->replaceAllUsesWith(B);
+  EXPECT_EQ(ArrAB, G->getInitializer());
+  EXPECT_EQ(ArrAB, ConstantArray::get(ArrTy, BB, 2));
+}
+
+TEST(ConstantsTest, UniquingAcrossTypeRefinement) {
+  LLVMContext Context;
+  Module M("test", Context);
+  const Type *Int32Ty = Type::getInt32Ty(Context);
+  const PointerType *Int32PtrTy = PointerType::getUnqual(Int32Ty);
+  PATypeHolder Opaque = OpaqueType::get(Context);
+  const PointerType *OpaquePtrTy = PointerType::getUnqual(Opaque);
+
+  Constant *Null = ConstantPointerNull::get(OpaquePtrTy);
+  Constant *Undef = UndefValue::get(Int32PtrTy);
+  GlobalVariable *G = new GlobalVariable(M, OpaquePtrTy, false,
+                                         GlobalValue::ExternalLinkage,
+                                         UndefValue::get(OpaquePtrTy), "g");
+
+  cast<OpaqueType>(Opaque.get())->refineAbstractTypeTo(Int32Ty);
+
+  // The null pointer is retyped in place, while the undef is replaced by the
+  // one that already existed for the new type.
+  EXPECT_EQ(Int32PtrTy, Null->getType());
+  EXPECT_EQ(Null, ConstantPointerNull::get(Int32PtrTy));
+  EXPECT_EQ(Undef, G->getInitializer());
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
@@ -0,0 +1,127 @@
+//===- llvm/unittest/VMCore/IRArenaTest.cpp - IRArena unit tests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IRArena.h"
+#include "llvm/BasicBlock.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Analysis/Verifier.h"
+#include "gtest/gtest.h"
+
+namespace llvm {
+namespace {
+
+class IRArenaTest : public testing::Test {
+protected:
+  IRArenaTest()
+    : M(new Module("test", Context)), Int32(Type::getInt32Ty(Context)) {}
+
+  /// makeFunction - Create a function with a loop, so that it has PHI nodes
+  /// with hung-off operands and unconditional branches with prefixed ones.
+  Function *makeFunction(const char *Name) {
+    std::vector<const Type*> Params(1, Int32);
+    FunctionType *FTy = FunctionType::get(Int32, Params, false);
+    Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage, Name,
+                                   M.get());
+    BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+    BasicBlock *Loop = BasicBlock::Create(Context, "loop", F);
+    BasicBlock *Exit = BasicBlock::Create(Context, "exit", F);
+    Value *Zero = ConstantInt::get(Int32, 0);
+    BranchInst::Create(Loop, Entry);
+    PHINode *IV = PHINode::Create(Int32, "iv", Loop);
+    Value *Next = BinaryOperator::CreateAdd(IV, ConstantInt::get(Int32, 1),
+                                            "next", Loop);
+    Value *Done = new ICmpInst(*Loop, ICmpInst::ICMP_EQ, Next, F->arg_begin(),
+                               "done");
+    BranchInst::Create(Exit, Loop, Done, Loop);
+    IV->addIncoming(Zero, Entry);
+    IV->addIncoming(Next, Loop);
+    ReturnInst::Create(Context, Next, Exit);
+    return F;
+  }
+
+  LLVMContext Context;
+  OwningPtr<Module> M;
+  const Type *Int32;
+};
+
+TEST_F(IRArenaTest, Scope) {
+  EXPECT_TRUE(IRArena::getCurrent() == 0);
+  IRArena *A = IRArena::create(), *B = IRArena::create();
+  {
+    IRArena::Scope SA(A);
+    EXPECT_EQ(A, IRArena::getCurrent());
+    {
+      IRArena::Scope SB(B);
+      EXPECT_EQ(B, IRArena::getCurrent());
+      IRArena::Scope SNone(0);
+      EXPECT_TRUE(IRArena::getCurrent() == 0);
+    }
+    EXPECT_EQ(A, IRArena::getCurrent());
+  }
+  EXPECT_TRUE(IRArena::getCurrent() == 0);
+  A->release();
+  B->release();
+}
+
+TEST_F(IRArenaTest, CreateAndErase) {
+  for (unsigned i = 0; i != 100; ++i) {
+    IRArena *A = IRArena::create();
+    Function *F;
+    {
+      IRArena::Scope S(A);
+      F = makeFunction("f");
+      EXPECT_FALSE(verifyFunction(*F, ReturnStatusAction));
+
+      // Growing a PHI node replaces its operand list, and the old one is
+      // returned to the arena.
+      PHINode *IV = cast<PHINode>((++F->begin())->begin());
+      for (unsigned j = 0; j != 64; ++j)
+        IV->addIncoming(UndefValue::get(Int32), &F->getEntryBlock());
+    }
+    A->release();
+    F->eraseFromParent();
+  }
+}
+
+TEST_F(IRArenaTest, MoveOutOfArena) {
+  Function *Long = makeFunction("long");
+  IRArena *A = IRArena::create();
+  Function *Short;
+  Instruction *Sum;
+  {
+    IRArena::Scope S(A);
+    Short = makeFunction("short");
+    Sum = BinaryOperator::CreateAdd(ConstantInt::get(Int32, 1),
+                                    ConstantInt::get(Int32, 2), "sum",
+                                    &Short->getEntryBlock().front());
+  }
+  A->release();
+
+  // Move an instruction of the arena-allocated function into the heap
+  // allocated one.  It has to stay valid after the rest of its arena is gone.
+  ReturnInst *Ret = cast<ReturnInst>(Long->back().getTerminator());
+  Sum->moveBefore(Ret);
+  Ret->setOperand(0, Sum);
+  Short->eraseFromParent();
+
+  EXPECT_FALSE(verifyFunction(*Long, ReturnStatusAction));
+  EXPECT_EQ("sum", Sum->getName());
+  EXPECT_EQ(ConstantInt::get(Int32, 2), Sum->getOperand(1));
+  Ret->setOperand(0, UndefValue::get(Int32));
+  Sum->eraseFromParent();
+}
+
+}  // end anonymous namespace
+}  // end namespace llvm
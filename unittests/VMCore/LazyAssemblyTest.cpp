@@ -0,0 +1,78 @@
+//===- llvm/unittest/VMCore/LazyAssemblyTest.cpp - Lazy .ll reading tests -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+using namespace llvm;
+
+namespace {
+
+const char Source[] =
+  "define i32 @get() {\n"
+  "  %v = call i32 @helper()\n"
+  "  ret i32 %v\n"
+  "}\n"
+  "define internal i32 @helper() {\n"
+  "  ret i32 1\n"
+  "}\n";
+
+Module *readLazily(LLVMContext &Context) {
+  SMDiagnostic Err;
+  MemoryBuffer *Buffer =
+    MemoryBuffer::getMemBuffer(Source, Source + sizeof(Source) - 1);
+  return getLazyAssemblyModule(Buffer, Err, Context);
+}
+
+// A body that is parsed after its callee was renamed still calls the callee,
+// not a new function that took the old name.
+TEST(LazyAssemblyTest, RenamedGlobal) {
+  LLVMContext Context;
+  OwningPtr<Module> M(readLazily(Context));
+  ASSERT_TRUE(M.get() != 0);
+
+  Function *Get = M->getFunction("get");
+  Function *Helper = M->getFunction("helper");
+  ASSERT_TRUE(Get->isMaterializable());
+  Helper->setName("renamed");
+  Function *Other = Function::Create(Helper->getFunctionType(),
+                                     GlobalValue::ExternalLinkage, "helper",
+                                     M.get());
+  ASSERT_EQ("helper", Other->getName());
+
+  std::string ErrInfo;
+  ASSERT_FALSE(Get->Materialize(&ErrInfo)) << ErrInfo;
+  CallInst *CI = cast<CallInst>(Get->getEntryBlock().begin());
+  EXPECT_EQ(Helper, CI->getCalledFunction());
+  EXPECT_TRUE(Other->use_empty());
+}
+
+// A body whose callee was deleted before it was parsed is reported, rather
+// than calling whatever has the name now.
+TEST(LazyAssemblyTest, DeletedGlobal) {
+  LLVMContext Context;
+  OwningPtr<Module> M(readLazily(Context));
+  ASSERT_TRUE(M.get() != 0);
+
+  Function *Get = M->getFunction("get");
+  M->getFunction("helper")->eraseFromParent();
+
+  std::string ErrInfo;
+  EXPECT_TRUE(Get->Materialize(&ErrInfo));
+  EXPECT_NE(std::string::npos, ErrInfo.find("'@helper' was deleted"))
+    << ErrInfo;
+}
+
+}
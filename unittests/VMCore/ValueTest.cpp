@@ -0,0 +1,136 @@
+//===- llvm/unittest/VMCore/ValueTest.cpp - Value unit tests --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/BasicBlock.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ValueHandle.h"
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace llvm {
+namespace {
+
+typedef SmallVector<std::pair<Value*, Value*>, 4> ReplacementList;
+
+class BulkReplaceTest : public testing::Test {
+protected:
+  BulkReplaceTest()
+    : M(new Module("test", Context)),
+      Int32(Type::getInt32Ty(Context)),
+      Int32Ptr(PointerType::getUnqual(Int32)) {}
+
+  GlobalVariable *makeGlobal(const char *Name) {
+    return new GlobalVariable(*M, Int32, false, GlobalValue::ExternalLinkage,
+                              0, Name);
+  }
+
+  LLVMContext Context;
+  OwningPtr<Module> M;
+  const Type *Int32;
+  const PointerType *Int32Ptr;
+};
+
+TEST_F(BulkReplaceTest, Instructions) {
+  std::vector<const Type*> Params(1, Int32);
+  FunctionType *FTy = FunctionType::get(Int32, Params, false);
+  Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage, "f",
+                                 M.get());
+  BasicBlock *BB = BasicBlock::Create(Context, "entry", F);
+  Argument *Arg = F->arg_begin();
+  Instruction *A = BinaryOperator::CreateAdd(Arg, Arg, "a", BB);
+  Instruction *B = BinaryOperator::CreateMul(A, A, "b", BB);
+  Instruction *C = BinaryOperator::CreateSub(B, A, "c", BB);
+  ReturnInst::Create(Context, C, BB);
+
+  WeakVH WatchA(A);
+  Constant *One = ConstantInt::get(Int32, 1);
+
+  // A is replaced with B, which is replaced with 1 in turn.
+  ReplacementList Replacements;
+  Replacements.push_back(std::make_pair(A, B));
+  Replacements.push_back(std::make_pair(B, One));
+  Value::replaceAllUsesWith(Replacements);
+
+  EXPECT_TRUE(A->use_empty());
+  EXPECT_TRUE(B->use_empty());
+  EXPECT_EQ(One, C->getOperand(0));
+  EXPECT_EQ(One, C->getOperand(1));
+  EXPECT_EQ(One, B->getOperand(0));
+  EXPECT_EQ(One, static_cast<Value*>(WatchA));
+}
+
+TEST_F(BulkReplaceTest, ConstantUsers) {
+  GlobalVariable *A = makeGlobal("a"), *B = makeGlobal("b");
+  GlobalVariable *C = makeGlobal("c"), *D = makeGlobal("d");
+
+  // [2 x i32*] [i32* @a, i32* @b] uses both replaced values, and is updated
+  // in place.
+  Constant *Elts[] = { A, B };
+  ArrayType *ATy = ArrayType::get(Int32Ptr, 2);
+  Constant *Arr = ConstantArray::get(ATy, Elts, 2);
+  GlobalVariable *Table =
+    new GlobalVariable(*M, ATy, true, GlobalValue::ExternalLinkage, Arr,
+                       "table");
+
+  // i32 add (i32 ptrtoint (i32* @a to i32), i32 ptrtoint (i32* @b to i32))
+  // refers to the replaced values through other constants.
+  Constant *Sum = ConstantExpr::getAdd(ConstantExpr::getPtrToInt(A, Int32),
+                                       ConstantExpr::getPtrToInt(B, Int32));
+  GlobalVariable *Total =
+    new GlobalVariable(*M, Int32, true, GlobalValue::ExternalLinkage, Sum,
+                       "total");
+
+  ReplacementList Replacements;
+  Replacements.push_back(std::make_pair(A, C));
+  Replacements.push_back(std::make_pair(B, D));
+  Value::replaceAllUsesWith(Replacements);
+
+  EXPECT_TRUE(A->use_empty());
+  EXPECT_TRUE(B->use_empty());
+
+  Constant *NewElts[] = { C, D };
+  EXPECT_EQ(ConstantArray::get(ATy, NewElts, 2), Table->getInitializer());
+  EXPECT_EQ(Arr, Table->getInitializer());
+
+  Constant *NewSum =
+    ConstantExpr::getAdd(ConstantExpr::getPtrToInt(C, Int32),
+                         ConstantExpr::getPtrToInt(D, Int32));
+  EXPECT_EQ(NewSum, Total->getInitializer());
+}
+
+TEST_F(BulkReplaceTest, ExistingConstant) {
+  GlobalVariable *A = makeGlobal("a"), *B = makeGlobal("b");
+
+  // Once @a is replaced by @b, the two structs are the same constant.
+  std::vector<const Type*> Elts(2, Int32Ptr);
+  StructType *STy = StructType::get(Context, Elts);
+  Constant *From = ConstantStruct::get(STy, std::vector<Constant*>(2, A));
+  Constant *To = ConstantStruct::get(STy, std::vector<Constant*>(2, B));
+  GlobalVariable *GV =
+    new GlobalVariable(*M, STy, true, GlobalValue::ExternalLinkage, From,
+                       "pair");
+
+  ReplacementList Replacements;
+  Replacements.push_back(std::make_pair(A, B));
+  Value::replaceAllUsesWith(Replacements);
+
+  EXPECT_TRUE(A->use_empty());
+  EXPECT_EQ(To, GV->getInitializer());
+}
+
+}  // end anonymous namespace
+}  // end namespace llvm
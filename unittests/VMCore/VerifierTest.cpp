@@ -12,6 +12,8 @@
 #include "llvm/Function.h"
 #include "llvm/Instructions.h"
 #include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/PassManager.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/Analysis/Verifier.h"
 #include "gtest/gtest.h"
@@ -41,5 +43,97 @@ TEST(VerifierTest, Branch_i1) {
   EXPECT_TRUE(verifyFunction(*F, ReturnStatusAction));
 }
 
+TEST(VerifierTest, ModificationTracking) {
+  LLVMContext &C = getGlobalContext();
+  Module M("tracking", C);
+  const Type *Int32 = Type::getInt32Ty(C);
+  std::vector<const Type*> Params(1, Int32);
+  FunctionType *FTy = FunctionType::get(Int32, Params, /*isVarArg=*/false);
+  Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage, "f", &M);
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  Argument *X = F->arg_begin();
+  BinaryOperator *Add = BinaryOperator::CreateAdd(X, X, "add", Entry);
+  ReturnInst *Ret = ReturnInst::Create(C, Add, Entry);
+
+  // Without tracking, a function is always considered modified.
+  EXPECT_TRUE(F->isModified());
+
+  Function::startTrackingModifications();
+  F->markUnmodified();
+  EXPECT_FALSE(F->isModified());
+
+  Add->setOperand(1, ConstantInt::get(Int32, 1));
+  EXPECT_TRUE(F->isModified());
+
+  F->markUnmodified();
+  EXPECT_FALSE(Add->swapOperands());
+  EXPECT_TRUE(F->isModified());
+
+  F->markUnmodified();
+  BinaryOperator *Mul = BinaryOperator::CreateMul(X, X, "mul", Ret);
+  EXPECT_TRUE(F->isModified());
+
+  F->markUnmodified();
+  Mul->moveBefore(Add);
+  EXPECT_TRUE(F->isModified());
+
+  F->markUnmodified();
+  Add->replaceAllUsesWith(Mul);
+  EXPECT_TRUE(F->isModified());
+
+  F->markUnmodified();
+  Add->eraseFromParent();
+  EXPECT_TRUE(F->isModified());
+
+  F->markUnmodified();
+  BasicBlock *Exit = BasicBlock::Create(C, "exit", F);
+  EXPECT_TRUE(F->isModified());
+
+  F->markUnmodified();
+  Exit->moveBefore(Entry);
+  EXPECT_TRUE(F->isModified());
+  Exit->eraseFromParent();
+
+  F->markUnmodified();
+  F->addFnAttr(Attribute::NoUnwind);
+  EXPECT_TRUE(F->isModified());
+
+  // Changes are not seen while tracking is off, so they might have been made.
+  F->markUnmodified();
+  Function::stopTrackingModifications();
+  EXPECT_TRUE(F->isModified());
+  Function::startTrackingModifications();
+  EXPECT_TRUE(F->isModified());
+  Function::stopTrackingModifications();
+}
+
+TEST(VerifierTest, IncrementalVerifier) {
+  LLVMContext &C = getGlobalContext();
+  Module M("incremental", C);
+  const Type *Int32 = Type::getInt32Ty(C);
+  std::vector<const Type*> Params(1, Int32);
+  FunctionType *FTy = FunctionType::get(Int32, Params, /*isVarArg=*/false);
+  Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage, "f", &M);
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  ReturnInst *Ret = ReturnInst::Create(C, F->arg_begin(), Entry);
+
+  FunctionPassManager FPM(&M);
+  FPM.add(createIncrementalVerifierPass(ReturnStatusAction));
+  EXPECT_FALSE(FPM.run(*F));
+  EXPECT_FALSE(F->isModified());
+
+  // Return a value of the wrong type, and then pretend nothing changed: the
+  // function is not checked again.
+  Ret->setOperand(0, ConstantInt::get(Type::getInt64Ty(C), 0));
+  EXPECT_TRUE(F->isModified());
+  F->markUnmodified();
+  EXPECT_FALSE(FPM.run(*F));
+
+  // Once it is known to have changed, the error is found.
+  F->markModified();
+  EXPECT_TRUE(FPM.run(*F));
+  EXPECT_TRUE(F->isModified());
+}
+
 }
 }